@@ -0,0 +1,82 @@
+/*
+ * @Description: Inventario passivo del bus - ogni coppia (PGN, indirizzo
+ * sorgente) ricevuta, anche senza decoder, con periodo stimato e jitter,
+ * DLC e ultimo payload. Tabella a indirizzamento aperto (sondaggio lineare)
+ * a memoria fissa, aggiornata in O(1) per frame dal task CAN; a tabella
+ * piena le coppie nuove sono solo contate. Serve in messa in servizio per
+ * scegliere cosa mappare senza un analizzatore CAN esterno: con il filtro di
+ * accettazione aperto (j1939SetFilterOpen) si vede l'intero traffico.
+ *
+ * Periodo e jitter sono medie mobili esponenziali degli intervalli tra i
+ * frame (jitter come in RFC 3550), dai tempi di uscita dalla coda RX: i
+ * frame letti in lotto ne aumentano un po' il jitter.
+ *
+ * Un solo scrittore (task CAN); i lettori copiano le voci con un seqlock
+ * per voce.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config.h"
+#include "hal.h"
+
+static_assert((BUS_DISCOVERY_SLOTS & (BUS_DISCOVERY_SLOTS - 1)) == 0, "Slot in potenza di 2");
+
+// Coppie tracciate: 3/4 degli slot, sondaggi brevi anche a tabella piena
+#define BUS_DISCOVERY_CAPACITY (BUS_DISCOVERY_SLOTS * 3 / 4)
+
+struct BusDiscoveryEntry {
+    uint32_t identifier;     // Ultimo ID a 29 bit (priorità, destinazione)
+    uint32_t frames;
+    uint32_t firstSeenMs;
+    uint32_t lastSeenMs;
+    uint32_t periodUs;       // 0 fino al secondo frame
+    uint32_t jitterUs;
+    uint32_t pgn;            // 18 bit, con EDP e DP
+    uint8_t sourceAddress;
+    uint8_t dlc;
+    uint8_t data[8];         // Ultimo payload
+    bool handled;            // PGN con decoder o gestito dal gateway
+};
+
+struct BusDiscoveryStats {
+    uint32_t pairs;          // Coppie nella tabella
+    uint32_t untracked;      // Frame di coppie nuove a tabella piena
+};
+
+extern BusDiscoveryStats busDiscoveryStats;
+
+// Task CAN: frame esteso ricevuto (nowUs da hal_micros, nowMs da hal_millis)
+void busDiscoveryRecord(const twai_message_t &message, uint32_t pgn, bool handled,
+                        uint32_t nowUs, uint32_t nowMs);
+
+// Svuota la tabella al prossimo frame (eseguito dal task CAN)
+void busDiscoveryReset();
+
+// Copia coerente della voce nello slot, false se lo slot è vuoto
+bool busDiscoveryRead(uint16_t slot, BusDiscoveryEntry &entry);
+
+// Lettura come risposta JSON a pezzi (chunked), in ordine di slot:
+// {"pairs":N,"untracked":U,"capacity":C,"filterOpen":false,"entries":[
+//  {"pgn":61444,"sa":0,"priority":3,"da":255,"frames":F,"periodUs":P,"jitterUs":J,
+//   "ageMs":A,"dlc":8,"data":"0011...","handled":true},...]}
+// Con sourceAddress diverso da BUS_DISCOVERY_ALL solo le coppie di quella ECU
+#define BUS_DISCOVERY_ALL 0xFFFF
+
+struct BusDiscoveryQuery {
+    uint16_t sourceAddress;
+    uint16_t next;       // Slot successivo
+    uint8_t stage;       // 0 = intestazione, 1 = voci, 2 = completo
+    bool first;          // Nessuna voce ancora scritta
+    bool filterOpen;
+    uint32_t nowMs;      // Riferimento per ageMs
+};
+
+#define BUS_DISCOVERY_MIN_CHUNK 224  // Buffer minimo per busDiscoveryQueryRead
+
+void busDiscoveryQueryBegin(BusDiscoveryQuery &query, uint16_t sourceAddress, bool filterOpen, uint32_t nowMs);
+// Scrive la parte successiva della risposta, 0 a documento completo
+size_t busDiscoveryQueryRead(BusDiscoveryQuery &query, char *buffer, size_t size);
@@ -0,0 +1,48 @@
+/*
+ * @Description: Logger dei frame CAN grezzi su SD. Il task CAN copia ogni frame
+ * ricevuto, con timestamp in µs, in un ring buffer lock-free in RAM (un
+ * produttore, un consumatore); un task a bassa priorità lo svuota codificando
+ * i frame in blocchi da 512 byte, allineati ai settori della SD, e li scrive
+ * a gruppi di CAN_LOG_WRITE_BLOCKS. Se il ring è pieno il frame è scartato e
+ * contato, la ricezione CAN non attende mai la scheda.
+ *
+ * Formato file (little-endian), una sequenza di blocchi autonomi:
+ *   header 20 byte: magic "J1LG", sequenza blocco, timestamp base (µs),
+ *   frame persi prima del blocco (cumulativi), byte usati, numero frame
+ *   record: byte 0 = DLC (bit 0-3), esteso (bit 4), RTR (bit 5),
+ *   dimensione del delta - 1 (bit 6-7); delta µs dal record precedente
+ *   (il primo dal timestamp base); ID su 4 byte (esteso) o 2; dati
+ * I record non attraversano i blocchi, lo spazio residuo è a zero.
+ * tools/canlog_convert.cpp converte i file in formato candump o ASC.
+ */
+
+#pragma once
+
+#include "hal.h"
+
+#define CAN_LOG_BLOCK_SIZE      512
+#define CAN_LOG_HEADER_SIZE     20
+#define CAN_LOG_MAGIC           0x474C314AUL  // "J1LG"
+#define CAN_LOG_RECORD_MAX      17            // Flag + delta 4 + ID 4 + dati 8
+#define CAN_LOG_FLAG_DLC        0x0F
+#define CAN_LOG_FLAG_EXTENDED   0x10
+#define CAN_LOG_FLAG_RTR        0x20
+#define CAN_LOG_DELTA_SHIFT     6
+#define CAN_LOG_DIRECTORY       "canlog"
+
+struct CanLogStats {
+    uint32_t frames;         // Frame accodati
+    uint32_t dropped;        // Frame persi per ring pieno
+    uint32_t ringHighWater;  // Massima occupazione del ring (frame)
+    uint32_t blocks;         // Blocchi scritti
+    uint32_t writeErrors;    // Scritture SD fallite (blocchi persi)
+    uint32_t fileIndex;      // File corrente canlog/NNNNN.bin
+};
+
+extern CanLogStats canLogStats;
+
+bool canLogBegin();
+bool canLogActive();
+void canLogRecord(const twai_message_t &message, uint32_t timestampUs);
+void canLogService(uint32_t nowMs);
+void canLogStop();
@@ -0,0 +1,49 @@
+/*
+ * @Description: Lettura dei file del logger CAN (formato in can_log.h) e
+ * conversione dei frame in righe candump o Vector ASC (e ritorno, per il
+ * replay delle tracce). Non dipende dalla HAL: è usato sia dal firmware sia
+ * dagli strumenti host in tools/.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct CanLogFrame {
+    uint64_t timestamp;   // µs, esteso oltre il giro dei 32 bit di micros()
+    uint32_t identifier;
+    bool extended;
+    bool rtr;
+    uint8_t dlc;
+    uint8_t data[8];
+};
+
+// Stato tra un blocco e il successivo dello stesso file
+struct CanLogReader {
+    uint64_t timestamp;   // Ultimo timestamp esteso
+    uint32_t lastRaw;     // Ultimo timestamp a 32 bit
+    bool started;
+    uint32_t sequence;    // Sequenza attesa
+    uint32_t dropped;     // Frame persi dal logger prima dell'ultimo blocco
+    uint32_t gaps;        // Blocchi mancanti o fuori sequenza
+    uint32_t badBlocks;   // Blocchi con header o record non validi
+};
+
+typedef void (*CanLogFrameHandler)(const CanLogFrame &frame, void *ctx);
+
+void canLogReaderInit(CanLogReader &reader);
+// Decodifica un blocco da CAN_LOG_BLOCK_SIZE byte, ritorna i frame letti
+size_t canLogReadBlock(CanLogReader &reader, const uint8_t *block, CanLogFrameHandler handler, void *ctx);
+
+// Formattazione di una riga, ritorna la lunghezza senza terminatore
+size_t canLogFormatCandump(char *line, size_t size, const CanLogFrame &frame, const char *interface);
+size_t canLogFormatAsc(char *line, size_t size, const CanLogFrame &frame, uint64_t startTimestamp, uint8_t channel);
+// CSV: secondi da startTimestamp, ID esadecimale, esteso, RTR, DLC, dati
+#define CAN_LOG_CSV_HEADER "time_s,id,extended,rtr,dlc,data\n"
+size_t canLogFormatCsv(char *line, size_t size, const CanLogFrame &frame, uint64_t startTimestamp);
+
+// Riga di traccia -> frame: candump -L "(s.us) can0 ID#DATA", candump
+// "can0 ID [n] DATA" (timestamp 0) o ASC "s.us ch ID[x] Rx d n DATA".
+// false per intestazioni, eventi ed error frame
+bool canLogParseLine(const char *line, CanLogFrame &frame);
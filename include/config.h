@@ -0,0 +1,167 @@
+/*
+ * @Description: Configurazione hardware e parametri di default del gateway
+ */
+
+#pragma once
+
+// RS485
+#define RS485_TX 22
+#define RS485_RX 21
+#define RS485_CALLBACK 17
+#define RS485_EN 19
+
+// WS2812B
+#define WS2812B_DATA 4
+
+// CAN
+#define CAN_TX 27
+#define CAN_RX 26
+#define CAN_SPEED_MODE 23
+
+// RS485 and CAN Boost power supply
+#define ME2107_EN 16
+
+//SD
+#define SD_MISO 2
+#define SD_MOSI 15
+#define SD_SCLK 14
+#define SD_CS 13
+#define SD_SPI_FREQUENCY 20000000
+
+// Configurazione Modbus
+#define MODBUS_SLAVE_ID 1
+#define MODBUS_BAUDRATE 19200
+#define MODBUS_SERIAL_MODE SERIAL_8N1
+#define MODBUS_MAX_BAUDRATE 921600
+#define MODBUS_SET_MAPPING MODBUS_MAP_REGISTER_BANK  // Data set per ECU: banchi di registri o unit ID
+#define MODBUS_RX_TIMEOUT_MS 100     // Risveglio periodico del task Modbus senza traffico
+
+// Silenzio di fine frame in caratteri (T3.5 arrotondato). Fisso in caratteri
+// anche oltre 19200 baud per mantenere il tempo di risposta sotto il ms
+#ifndef MODBUS_RX_TIMEOUT_CHARS
+#define MODBUS_RX_TIMEOUT_CHARS 4
+#endif
+
+// Modbus TCP (stessa immagine registri dello slave RTU)
+#define MODBUS_TCP_PORT 502
+#define MODBUS_TCP_MAX_CLIENTS 4
+#define MODBUS_TCP_IDLE_TIMEOUT_S 60  // Chiusura client senza richieste
+
+// Dashboard web: intervallo di invio dei campi cambiati ai client WebSocket
+#define LIVE_PUSH_INTERVAL_MS 500
+#define LIVE_PUSH_MIN_INTERVAL_MS 100
+
+// MQTT report-by-exception: broker configurato da /mqtt (host vuoto = disattivato)
+#define MQTT_DEFAULT_PORT 1883
+#define MQTT_TOPIC_PREFIX "j1939gw"
+#define MQTT_FLUSH_INTERVAL_MS 1000     // Cambiamenti accorpati in un messaggio per ECU
+#define MQTT_MIN_FLUSH_INTERVAL_MS 100
+#define MQTT_MAX_AGE_MS 60000           // Ripubblicazione dei valori invariati
+#define MQTT_QUEUE_MESSAGES 64          // Messaggi trattenuti con WiFi o broker assenti
+#define MQTT_PAYLOAD_MAX 384            // Un data set completo con valori a 32 bit
+#define MQTT_POLL_MS 100
+#define MQTT_RECONNECT_MS 5000
+
+// Storico a più risoluzioni (min/max/media per intervallo, memoria fissa
+// dallo heap all'avvio, ~59 KB per data set con i default): bucket per
+// livello e data set storicizzati (i primi slot assegnati)
+#ifndef HISTORY_SOURCES
+#define HISTORY_SOURCES 1
+#endif
+#ifndef HISTORY_SECONDS
+#define HISTORY_SECONDS 300   // 1 s per 5 minuti
+#endif
+#ifndef HISTORY_MINUTES
+#define HISTORY_MINUTES 1440  // 1 min per 24 ore
+#endif
+#ifndef HISTORY_HOURS
+#define HISTORY_HOURS 720     // 1 h per 30 giorni
+#endif
+
+// Registro DTC (DM1/DM2): voci per tutte le ECU, attive e precedentemente
+// attive. A registro pieno un nuovo DTC sostituisce il precedente più vecchio
+#ifndef DTC_STORE_CAPACITY
+#define DTC_STORE_CAPACITY 64
+#endif
+
+// Inventario del bus (coppie PGN/indirizzo sorgente): slot della tabella,
+// potenza di 2 (52 byte per slot)
+#ifndef BUS_DISCOVERY_SLOTS
+#define BUS_DISCOVERY_SLOTS 128
+#endif
+
+// Configurazione Access Point per provisioning, aperto se la rete salvata
+// non si connette entro il timeout (la connessione non blocca l'avvio)
+#define AP_SSID "Gateway_Setup"
+#define AP_PASSWORD "12345678"
+#define WIFI_CONNECT_TIMEOUT_MS 20000
+
+// CAN: profondità coda RX del driver TWAI (frame)
+#ifndef CAN_RX_QUEUE_LEN
+#define CAN_RX_QUEUE_LEN 128
+#endif
+#define CAN_RX_TIMEOUT_MS 100   // Risveglio periodico del task CAN senza traffico
+#define CAN_RESTART_RETRY_MS 1000  // Nuovo tentativo se il driver TWAI non si reinstalla
+
+// Nodo J1939: il gateway rivendica un indirizzo (address claim) e richiede
+// con PGN 0xEA00 i parametri trasmessi solo su richiesta. Il budget limita
+// il carico sul bus dovuto alle richieste e alle risposte attese
+#define J1939_BITRATE 250000
+#define J1939_PREFERRED_ADDRESS 0xF9          // Se occupato: primo libero in 128-247
+#define J1939_NAME_FUNCTION 25                // Network Interconnect ECU
+#define J1939_NAME_MANUFACTURER 0             // Codice costruttore SAE (da assegnare)
+#define J1939_TX_BUDGET_PERMILLE 10           // 1% della banda del bus
+#define J1939_REQUEST_MIN_GAP_MS 50           // Distanza minima tra due richieste
+#define J1939_TX_BACKOFF_MIN_MS 100           // Pausa dopo TWAI_ALERT_TX_FAILED, raddoppiata
+#define J1939_TX_BACKOFF_MAX_MS 10000         // a ogni errore ripetuto fino al massimo
+#define J1939_REQUEST_HOURS_MS 10000          // Periodo per PGN, 0 = non richiesto
+#define J1939_REQUEST_DM2_MS 30000
+
+// Uscita comandi J1939 (j1939_command.h): slot scritti via Modbus e
+// trasmessi a passo fisso dal tick del timer hardware
+#define J1939_COMMAND_SLOTS 4
+#define J1939_COMMAND_TICK_US 1000            // Risoluzione dei periodi
+#define J1939_COMMAND_TIMEOUT_MS 500          // Timeout comandi di default
+#define J1939_COMMAND_TIMEOUT_MIN_MS 20
+#define J1939_COMMAND_TIMEOUT_MAX_MS 60000
+
+// Logger CAN su SD: frame in coda in RAM (potenza di 2) e scritture in
+// blocchi da 512 byte (~48 KB dallo heap, solo con la SD presente).
+// CAN_LOG_ALL_FRAMES apre il filtro di accettazione per registrare tutto il
+// traffico, non solo i PGN decodificati
+#ifndef CAN_LOG_RING_RECORDS
+#define CAN_LOG_RING_RECORDS 2048
+#endif
+#define CAN_LOG_WRITE_BLOCKS 16            // Blocchi per scrittura (8 KB)
+#define CAN_LOG_FLUSH_MS 1000              // Scrittura anche di blocchi parziali
+#define CAN_LOG_FILE_MAX_BYTES (64UL * 1024 * 1024)
+#ifndef CAN_LOG_ALL_FRAMES
+#define CAN_LOG_ALL_FRAMES 0
+#endif
+
+// Download dei log (log_download.h): download contemporanei e lavoro sulla
+// SD per pezzo di risposta, per non trattenere a lungo il file system
+#define LOG_DOWNLOAD_MAX_ACTIVE 2
+#define LOG_DOWNLOAD_READ_MAX 4096         // Byte letti per pezzo (file grezzo)
+#define LOG_DOWNLOAD_SCAN_BLOCKS 64        // Blocchi decodificati per pezzo (CSV, intervalli)
+
+// Task FreeRTOS: core, priorità e stack (byte). Il core 0 ospita lo stack WiFi,
+// CAN e Modbus stanno sul core 1 con priorità sopra il web server
+#define CAN_TASK_CORE         1
+#define CAN_TASK_PRIORITY     5
+#define CAN_TASK_STACK        4096
+#define MODBUS_TASK_CORE      1
+#define MODBUS_TASK_PRIORITY  4
+#define MODBUS_TASK_STACK     4096
+#define WEB_TASK_CORE         0
+#define WEB_TASK_PRIORITY     1
+#define WEB_TASK_STACK        8192
+#define LOG_TASK_CORE         0
+#define LOG_TASK_PRIORITY     1
+#define LOG_TASK_STACK        4096
+#define MQTT_TASK_CORE        0
+#define MQTT_TASK_PRIORITY    1
+#define MQTT_TASK_STACK       4096
+#define COMMAND_TASK_CORE     1     // Stesso core del task CAN, priorità più alta
+#define COMMAND_TASK_PRIORITY 6
+#define COMMAND_TASK_STACK    3072
@@ -0,0 +1,59 @@
+/*
+ * @Description: CRC-16/MODBUS a tabella (polinomio 0xA001 riflesso, init 0xFFFF).
+ * La tabella è generata a compile-time; crc16Update permette il calcolo
+ * incrementale byte per byte mentre il frame arriva dalla UART o mentre la
+ * risposta viene serializzata. Un frame RTU corretto, CRC incluso, ha residuo 0.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <array>
+
+#define CRC16_MODBUS_INIT 0xFFFF
+
+constexpr std::array<uint16_t, 256> crc16MakeTable() {
+    std::array<uint16_t, 256> table = {};
+    for (uint16_t i = 0; i < 256; i++) {
+        uint16_t crc = i;
+        for (uint8_t j = 0; j < 8; j++) {
+            crc = (crc & 0x0001) ? (crc >> 1) ^ 0xA001 : (crc >> 1);
+        }
+        table[i] = crc;
+    }
+    return table;
+}
+
+constexpr std::array<uint16_t, 256> CRC16_TABLE = crc16MakeTable();
+
+constexpr inline uint16_t crc16Update(uint16_t crc, uint8_t value) {
+    return (crc >> 8) ^ CRC16_TABLE[(crc ^ value) & 0xFF];
+}
+
+constexpr inline uint16_t crc16Compute(const uint8_t *data, size_t length, uint16_t crc = CRC16_MODBUS_INIT) {
+    for (size_t i = 0; i < length; i++) {
+        crc = crc16Update(crc, data[i]);
+    }
+    return crc;
+}
+
+// Vettori di prova, verificati a ogni compilazione
+template <size_t N>
+constexpr uint16_t crc16OfText(const char (&text)[N]) {
+    uint16_t crc = CRC16_MODBUS_INIT;
+    for (size_t i = 0; i + 1 < N; i++) {
+        crc = crc16Update(crc, (uint8_t)text[i]);
+    }
+    return crc;
+}
+
+constexpr uint8_t CRC16_VECTOR_READ[] = { 0x01, 0x03, 0x00, 0x00, 0x00, 0x0A };
+constexpr uint8_t CRC16_VECTOR_READ_FRAME[] = { 0x01, 0x03, 0x00, 0x00, 0x00, 0x0A, 0xC5, 0xCD };
+constexpr uint8_t CRC16_VECTOR_SPEC[] = { 0x02, 0x07 };
+
+static_assert(crc16OfText("123456789") == 0x4B37, "CRC-16/MODBUS check value");
+static_assert(crc16Compute(CRC16_VECTOR_READ, sizeof(CRC16_VECTOR_READ)) == 0xCDC5, "FC 0x03 di esempio");
+static_assert(crc16Compute(CRC16_VECTOR_SPEC, sizeof(CRC16_VECTOR_SPEC)) == 0x1241, "Esempio specifica Modbus RTU");
+static_assert(crc16Compute(CRC16_VECTOR_READ_FRAME, sizeof(CRC16_VECTOR_READ_FRAME)) == 0, "Residuo frame valido");
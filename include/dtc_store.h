@@ -0,0 +1,76 @@
+/*
+ * @Description: Registro dei codici errore J1939 (DM1 attivi, DM2 e DTC
+ * rientrati). Ogni DTC viene decodificato (SPN, FMI, occurrence count,
+ * conversion method) in una tabella a capacità fissa con ricerca O(1) per
+ * SA/SPN/FMI tramite hash a catene. Un DM1 è la lista completa dei DTC
+ * attivi della ECU: i DTC che non compaiono più passano nella lista dei
+ * precedentemente attivi, con la prima e l'ultima volta in cui sono stati
+ * visti. Le liste sono ordinate per attivazione (attivi) e per rientro
+ * (precedenti); a tabella piena si libera il precedente più vecchio.
+ *
+ * Un solo scrittore (task CAN); i lettori (Modbus, web) copiano i record
+ * con un seqlock sull'intero registro, ripetendo se una modifica è in corso.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config.h"
+
+static_assert(DTC_STORE_CAPACITY <= 254, "Voci indicizzate a 8 bit");
+
+enum DtcList : uint8_t {
+    DTC_LIST_ACTIVE,
+    DTC_LIST_PREVIOUS,
+    DTC_LIST_COUNT
+};
+
+struct DtcRecord {
+    uint32_t spn;              // 19 bit
+    uint32_t firstSeenMs;      // Prima ricezione (hal_millis)
+    uint32_t lastSeenMs;       // Ultimo DM1 in cui era attivo (o DM2 che lo ha riportato)
+    uint8_t sourceAddress;
+    uint8_t fmi;               // Failure Mode Identifier, 5 bit
+    uint8_t occurrence;        // Occurrence count, 7 bit (127 = non disponibile)
+    uint8_t conversion;        // Conversion method: 0 = SPN J1939-73 versione 4
+};
+
+struct DtcStoreInfo {
+    uint8_t count[DTC_LIST_COUNT];
+    uint32_t changes;          // Cambia quando le liste cambiano composizione o ordine
+    uint32_t dropped;          // DTC persi a tabella piena di soli attivi
+};
+
+// Task CAN: DTC (dal byte 2 del DM1/DM2, 4 byte ciascuno). Il DM1 sostituisce
+// gli attivi della ECU, il DM2 aggiunge o aggiorna i precedenti. Le voci con
+// SPN 0 o 0x7FFFF (nessun DTC) sono ignorate. Restituisce i DTC validi
+uint8_t dtcStoreActive(uint8_t sourceAddress, const uint8_t *dtcs, uint16_t length, uint32_t nowMs);
+uint8_t dtcStorePrevious(uint8_t sourceAddress, const uint8_t *dtcs, uint16_t length, uint32_t nowMs);
+void dtcStoreReset();  // Svuota il registro (CAN_J1939_Init, prima dell'uso)
+
+// Copia coerente di al massimo 'max' record della lista dalla posizione
+// first, con le informazioni del registro allo stesso istante. Restituisce
+// i record copiati (0 oltre la fine della lista)
+uint8_t dtcStoreRead(uint8_t list, uint8_t first, DtcRecord *records, uint8_t max, DtcStoreInfo &info);
+
+// Lettura come risposta JSON a pezzi (chunked):
+// {"changes":C,"dropped":D,"active":[{"sa":0,"spn":100,"fmi":1,"oc":3,"cm":0,
+//  "firstSeenMs":F,"lastSeenMs":L},...],"previous":[...]}
+// Con sourceAddress diverso da DTC_QUERY_ALL solo i DTC di quella ECU
+#define DTC_QUERY_ALL 0xFFFF
+
+struct DtcQuery {
+    uint16_t sourceAddress;
+    uint8_t list;
+    uint8_t next;        // Posizione nella lista corrente
+    uint8_t stage;       // 0 = intestazione, 1 = record, 2 = completo
+    bool first;          // Nessun record ancora scritto nella lista corrente
+};
+
+#define DTC_QUERY_MIN_CHUNK 160  // Buffer minimo per dtcQueryRead
+
+void dtcQueryBegin(DtcQuery &query, uint16_t sourceAddress);
+// Scrive la parte successiva della risposta, 0 a documento completo
+size_t dtcQueryRead(DtcQuery &query, char *buffer, size_t size);
@@ -0,0 +1,88 @@
+/*
+ * @Description: Modello dati motore condiviso tra decoder J1939, Modbus e web.
+ * Un data set per ogni indirizzo sorgente J1939 (ECU) che trasmette PGN
+ * decodificati: più motori, cambio, ecc. non si sovrascrivono a vicenda.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// Segnali decodificati da J1939: indice del bit in validFlags/spnErrorFlags
+enum EngineField : uint8_t {
+    FIELD_RPM,
+    FIELD_ENGINE_TEMP,
+    FIELD_OIL_PRESSURE,
+    FIELD_FUEL_RATE,
+    FIELD_ENGINE_HOURS,
+    FIELD_COOLANT_TEMP,
+    FIELD_INTAKE_TEMP,
+    FIELD_EXHAUST_TEMP,
+    FIELD_ENGINE_LOAD,
+    FIELD_THROTTLE_POS,
+    FIELD_ENGINE_TORQUE,
+    FIELD_BATTERY_VOLTAGE,
+    FIELD_COUNT
+};
+
+#define FIELD_BIT(field) (1UL << (field))
+
+// Campi con segno (complemento a 2 sulla dimensione del campo)
+#define ENGINE_SIGNED_FIELDS (FIELD_BIT(FIELD_ENGINE_TEMP) | FIELD_BIT(FIELD_COOLANT_TEMP) | \
+                              FIELD_BIT(FIELD_INTAKE_TEMP) | FIELD_BIT(FIELD_EXHAUST_TEMP) | \
+                              FIELD_BIT(FIELD_ENGINE_TORQUE))
+
+// Struttura dati motore
+struct EngineData {
+    uint32_t rpm;              // Giri motore
+    uint16_t engineTemp;       // Temperatura olio motore (°C * 10)
+    uint16_t oilPressure;      // Pressione olio (kPa)
+    uint32_t fuelRate;         // Consumo carburante (L/h * 100)
+    uint32_t engineHours;      // Ore di funzionamento (h * 100)
+    uint16_t coolantTemp;      // Temperatura liquido raffreddamento (°C * 10)
+    uint16_t intakeTemp;       // Temperatura aria aspirazione (°C * 10)
+    uint16_t exhaustTemp;      // Temperatura gas scarico (°C * 10)
+    uint16_t engineLoad;       // Carico motore (%)
+    uint16_t throttlePos;      // Posizione acceleratore (%)
+    uint32_t engineTorque;     // Coppia motore effettiva (% della coppia di riferimento)
+    uint16_t batteryVoltage;   // Tensione batteria (V * 10)
+    uint16_t statusFlags;      // Flag di stato
+    uint16_t errorFlags;       // Flag errori
+    uint16_t dtcCount;         // Numero codici errore attivi
+    uint16_t previousDtcCount; // Codici errore non più attivi (DM2, su richiesta)
+    uint32_t lastUpdate;       // Timestamp ultimo aggiornamento
+    uint32_t validFlags;       // Segnali con valore valido (bit = EngineField)
+    uint32_t spnErrorFlags;    // Segnali che la ECU riporta in errore (bit = EngineField)
+    uint8_t sourceAddress;     // Indirizzo sorgente J1939 della ECU
+};
+
+// Numero massimo di ECU (indirizzi sorgente) seguite contemporaneamente
+#ifndef ENGINE_DATA_MAX_SOURCES
+#define ENGINE_DATA_MAX_SOURCES 16
+#endif
+
+// Accesso ai campi per indice: nome (come in /data) e valore con segno
+const char *engineFieldName(EngineField field);
+int engineFieldIndex(const char *name);  // -1 se sconosciuto
+int64_t engineFieldValue(const EngineData &data, EngineField field);
+
+static_assert(ENGINE_DATA_MAX_SOURCES <= 32, "Slot tracciati in una maschera a 32 bit");
+
+// Copie di lavoro per slot, scritte solo dal task CAN (decoder J1939)
+extern EngineData engineDataSets[ENGINE_DATA_MAX_SOURCES];
+
+// Data set della sorgente: tabella diretta SA -> slot, lo slot viene assegnato
+// al primo PGN decodificato. NULL se tutti gli slot sono occupati
+EngineData *engineDataForSource(uint8_t sourceAddress);
+void engineDataTouch(uint8_t slot);  // Slot modificato, da pubblicare
+uint8_t engineDataSourceCount();     // Slot assegnati (0..count-1), leggibile da ogni task
+uint8_t engineDataSourceAddress(uint8_t slot);
+uint8_t engineDataSlotsBySource(uint8_t *slots);  // Slot ordinati per SA, restituisce il numero
+
+// Pubblicazione verso gli altri task tramite seqlock per slot: i lettori
+// ottengono sempre una copia coerente, mai metà di un aggiornamento (es. rpm
+// a 32 bit). Sono copiati solo gli slot modificati dall'ultima pubblicazione
+void engineDataPublish();
+void engineDataRead(uint8_t slot, EngineData &snapshot);
+uint32_t engineDataVersion();              // Cambia a ogni pubblicazione
+uint32_t engineDataVersion(uint8_t slot);  // Cambia a ogni pubblicazione dello slot
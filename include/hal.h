@@ -0,0 +1,122 @@
+/*
+ * @Description: Hardware abstraction layer per CAN (TWAI), UART RS485, clock
+ * e storage dei log. Su ESP32 le funzioni sono sottili wrapper di twai_*,
+ * driver UART, millis() e SD;
+ * sul target native sono implementate da un loopback in memoria usato dal
+ * simulatore (ECU motore + master Modbus) in src/sim.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef ARDUINO
+
+#include <Arduino.h>
+#include "driver/twai.h"
+
+#define HAL_LOG(...) Serial.printf(__VA_ARGS__)
+
+#else
+
+#include <stdio.h>
+
+#define HAL_LOG(...) printf(__VA_ARGS__)
+
+// Sottoinsieme compatibile di driver/twai.h per la build host
+typedef struct {
+    union {
+        struct {
+            uint32_t extd: 1;
+            uint32_t rtr: 1;
+            uint32_t ss: 1;
+            uint32_t self: 1;
+            uint32_t dlc_non_comp: 1;
+            uint32_t reserved: 27;
+        };
+        uint32_t flags;
+    };
+    uint32_t identifier;
+    uint8_t data_length_code;
+    uint8_t data[8];
+} twai_message_t;
+
+#define TWAI_ALERT_TX_IDLE          0x00000001
+#define TWAI_ALERT_TX_SUCCESS       0x00000002
+#define TWAI_ALERT_RX_DATA          0x00000004
+#define TWAI_ALERT_BUS_ERROR        0x00000200
+#define TWAI_ALERT_TX_FAILED        0x00000400
+#define TWAI_ALERT_RX_QUEUE_FULL    0x00000800
+#define TWAI_ALERT_ERR_PASS         0x00001000
+
+#endif
+
+// CAN
+bool hal_can_begin(uint32_t acceptanceCode, uint32_t acceptanceMask, bool singleFilter);
+// Riavvia il controller col nuovo filtro. false: filtro precedente ancora
+// attivo oppure driver rimosso (nessuna ricezione né trasmissione) finché
+// una chiamata successiva non riesce
+bool hal_can_set_filter(uint32_t acceptanceCode, uint32_t acceptanceMask, bool singleFilter);
+uint32_t hal_can_read_alerts(uint32_t timeoutMs);
+bool hal_can_receive(twai_message_t *message, uint32_t timeoutMs);
+bool hal_can_transmit(const twai_message_t *message, uint32_t timeoutMs);  // false se la coda TX è piena
+uint32_t hal_can_bus_error_count();
+uint32_t hal_can_rx_missed();        // Frame persi per coda RX o FIFO del controller pieni
+uint32_t hal_can_filter_rejected();
+
+// UART RS485 (half-duplex, direzione gestita dalla UART). hal_uart_receive
+// attende fino a timeoutMs e segnala in frameEnd il silenzio T3.5 dopo
+// l'ultimo byte restituito
+void hal_uart_begin(uint32_t baudrate);
+void hal_uart_set_baudrate(uint32_t baudrate);  // Dopo la fine della trasmissione in corso
+size_t hal_uart_receive(uint8_t *data, size_t maxLength, uint32_t timeoutMs, bool *frameEnd);
+size_t hal_uart_write(const uint8_t *data, size_t length);
+
+// Clock. hal_cycles è il contatore di cicli della CPU (ns sul target native),
+// per misurare intervalli brevi; si azzera ogni 2^32 cicli
+uint32_t hal_millis();
+uint32_t hal_micros();
+uint32_t hal_cycles();
+uint32_t hal_cycles_per_us();
+
+// Tick periodico da timer hardware (esp_timer su ESP32) per un solo task:
+// hal_tick_wait attende il tick successivo, false dopo timeoutMs. I tick
+// scaduti mentre il task lavora valgono come uno solo
+bool hal_tick_begin(uint32_t periodUs);
+bool hal_tick_wait(uint32_t timeoutMs);
+
+// Task: stack libero minimo dall'avvio (byte) del task FreeRTOS, 0 se non
+// disponibile (target native)
+uint32_t hal_task_stack_free(void *task);
+
+// Storage dei log (SD su ESP32, directory locale su native). Percorsi relativi
+// alla radice dello storage; un solo file di log aperto alla volta
+bool hal_storage_begin();
+bool hal_storage_exists(const char *path);
+bool hal_storage_mkdir(const char *path);
+bool hal_log_open(const char *path);
+size_t hal_log_write(const uint8_t *data, size_t length);  // Scrive e consolida su disco
+void hal_log_close();
+
+// Lettura dei file (download dei log): handle indipendenti dal file di log
+// in scrittura, più file aperti insieme. hal_file_open restituisce NULL se
+// il file manca, hal_storage_size false
+void *hal_file_open(const char *path);
+uint32_t hal_file_size(void *file);
+bool hal_file_seek(void *file, uint32_t offset);
+size_t hal_file_read(void *file, uint8_t *data, size_t length);
+void hal_file_close(void *file);
+bool hal_storage_size(const char *path, uint32_t *size);
+
+#ifndef ARDUINO
+// Loopback host: lato "bus" usato dal simulatore
+bool hal_native_can_inject(const twai_message_t &message);
+bool hal_native_can_take(twai_message_t *message);  // Frame trasmessi dal gateway
+void hal_native_can_alert(uint32_t alerts);         // Alert restituiti dalla prossima lettura
+void hal_native_can_fail(uint8_t count);            // Le prossime count installazioni falliscono
+void hal_native_uart_inject(const uint8_t *data, size_t length);
+size_t hal_native_uart_take(uint8_t *data, size_t maxLength);
+uint32_t hal_native_uart_baudrate();
+void hal_native_storage_root(const char *path);
+#endif
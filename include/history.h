@@ -0,0 +1,98 @@
+/*
+ * @Description: Storico dei segnali decodificati a più risoluzioni in memoria
+ * fissa. Per ogni data set storicizzato e segnale, un ring allocato all'avvio di
+ * bucket min/max/media per livello (1 s, 1 min, 1 h). I campioni arrivano dal
+ * task CAN a ogni PGN decodificato e aggiornano in modo incrementale gli
+ * accumulatori di tutti i livelli; alla fine di ogni intervallo il bucket
+ * viene chiuso nel ring. Intervalli senza campioni restano vuoti.
+ *
+ * Un solo scrittore (task CAN). I lettori indicizzano i bucket con un
+ * contatore assoluto: un bucket letto è valido se non è stato sovrascritto
+ * nel frattempo, senza lock.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config.h"
+#include "engine_data.h"
+
+#define HISTORY_TIER_COUNT 3
+
+// Segnali storicizzati (l'ordine definisce l'indice nello storico)
+constexpr EngineField HISTORY_FIELDS[] = {
+    FIELD_RPM,
+    FIELD_COOLANT_TEMP,
+    FIELD_OIL_PRESSURE,
+    FIELD_BATTERY_VOLTAGE,
+};
+
+constexpr size_t HISTORY_FIELD_COUNT = sizeof(HISTORY_FIELDS) / sizeof(HISTORY_FIELDS[0]);
+
+// Valori nelle unità di EngineData, saturati a 16 bit con segno. Bucket
+// vuoto: min > max
+struct HistoryBucket {
+    int16_t min;
+    int16_t max;
+    int16_t mean;
+};
+
+struct HistoryTierConfig {
+    const char *name;
+    uint32_t periodMs;
+    uint32_t length;
+};
+
+constexpr HistoryTierConfig HISTORY_TIERS[HISTORY_TIER_COUNT] = {
+    { "1s", 1000UL, HISTORY_SECONDS },
+    { "1m", 60000UL, HISTORY_MINUTES },
+    { "1h", 3600000UL, HISTORY_HOURS },
+};
+
+constexpr size_t HISTORY_BUCKETS_PER_FIELD = HISTORY_SECONDS + HISTORY_MINUTES + HISTORY_HOURS;
+
+// Memoria dei ring, nota a compile-time, allocata dallo heap da historyBegin
+constexpr size_t HISTORY_MEMORY_BYTES =
+    HISTORY_SOURCES * HISTORY_FIELD_COUNT * HISTORY_BUCKETS_PER_FIELD * sizeof(HistoryBucket);
+
+static_assert(HISTORY_SOURCES <= ENGINE_DATA_MAX_SOURCES, "HISTORY_SOURCES oltre gli slot disponibili");
+
+// Alloca i ring (prima di avviare il task CAN); false senza memoria, con lo
+// storico disattivato
+bool historyBegin();
+
+// Task CAN: campioni dei campi in 'fields' (FIELD_BIT) dello slot, e chiusura
+// periodica degli intervalli anche senza traffico
+void historyRecord(uint8_t slot, const EngineData &data, uint32_t fields, uint32_t nowMs);
+void historyTick(uint32_t nowMs);
+void historyReset();
+
+// Lettura di una serie come risposta JSON a pezzi (chunked), dal bucket più
+// vecchio al più recente, al più length - 1 bucket per livello:
+// {"set":N,"sa":S,"field":"rpm","tier":"1s","periodMs":1000,"ageMs":A,
+//  "points":[[min,max,mean],null,...]}
+// ageMs è il tempo trascorso dalla fine dell'ultimo bucket
+struct HistoryQuery {
+    uint8_t set;
+    uint8_t slot;
+    uint8_t field;       // Indice in HISTORY_FIELDS
+    uint8_t tier;
+    uint32_t first;      // Indice assoluto del primo bucket
+    uint32_t end;        // Indice assoluto dopo l'ultimo
+    uint32_t next;       // Prossimo bucket da scrivere
+    uint32_t ageMs;
+    uint8_t stage;       // 0 = intestazione, 1 = punti, 2 = completo
+};
+
+#define HISTORY_QUERY_MIN_CHUNK 128  // Buffer minimo per historyQueryRead
+
+int historyFieldIndex(const char *name);  // -1 se il campo non è storicizzato
+int historyTierIndex(const char *name);
+
+// false se il data set non è storicizzato o i parametri non sono validi
+bool historyQueryBegin(HistoryQuery &query, uint8_t set, uint8_t field, uint8_t tier,
+                       uint32_t count, uint32_t nowMs);
+// Scrive la parte successiva della risposta, 0 a documento completo
+size_t historyQueryRead(HistoryQuery &query, char *buffer, size_t size);
@@ -0,0 +1,46 @@
+/*
+ * @Description: Decoder CAN J1939 - PGN supportati e gestione ricezione
+ */
+
+#pragma once
+
+#include "hal.h"
+
+// J1939 PGN comuni per motori
+#define PGN_ELECTRONIC_ENGINE_2     0xF003  // 61443 - EEC2: pedale acceleratore, carico motore
+#define PGN_ELECTRONIC_ENGINE_1     0xF004  // 61444 - EEC1: giri motore, coppia effettiva
+#define PGN_DIAGNOSTIC_MESSAGE_1    0xFECA  // 65226 - DM1 Active Diagnostic Trouble Codes
+#define PGN_DIAGNOSTIC_MESSAGE_2    0xFECB  // 65227 - DM2 Previously Active Diagnostic Trouble Codes
+#define PGN_ENGINE_HOURS            0xFEE5  // 65253 - Engine Hours
+#define PGN_ENGINE_TEMP             0xFEEE  // 65262 - ET1 Engine Temperature 1
+#define PGN_ENGINE_FLUID_LEVEL      0xFEEF  // 65263 - EFL/P1 Engine Fluid Level/Pressure 1
+#define PGN_FUEL_ECONOMY            0xFEF2  // 65266 - LFE Fuel Economy
+#define PGN_INTAKE_EXHAUST_COND     0xFEF6  // 65270 - IC1 Inlet/Exhaust Conditions 1
+#define PGN_VEHICLE_ELECTRICAL      0xFEF7  // 65271 - VEP1 Vehicle Electrical Power
+
+// J1939 gestione rete (J1939-21/-81)
+#define PGN_ACKNOWLEDGMENT          0xE800  // 59392 - ACK/NACK
+#define PGN_REQUEST                 0xEA00  // 59904 - Request
+#define PGN_ADDRESS_CLAIMED         0xEE00  // 60928 - Address Claimed / Cannot Claim
+
+// J1939 Transport Protocol
+#define PGN_TP_DT                   0xEB00  // 60160 - TP.DT Data Transfer
+#define PGN_TP_CM                   0xEC00  // 60416 - TP.CM Connection Management
+
+#define J1939_PGN_EDP               0x20000 // Extended Data Page: frame non J1939
+
+#define J1939_GLOBAL_ADDRESS        0xFF
+#define J1939_NULL_ADDRESS          0xFE
+
+void CAN_J1939_Init();
+uint32_t getPGN(uint32_t canId);
+uint8_t getDestinationAddress(uint32_t canId);
+bool j1939DispatchPgn(uint32_t pgn, uint8_t sa, const uint8_t *data, uint16_t length);
+void processJ1939Message(twai_message_t &message);
+void CAN_Task(uint32_t timeoutMs = 0);
+
+// Filtro di accettazione aperto a tutto il traffico (inventario del bus) o
+// ristretto ai PGN decodificati. Applicato dal task CAN al giro successivo:
+// il controller viene riavviato e i frame in coda sono persi
+void j1939SetFilterOpen(bool open);
+bool j1939FilterOpen();
@@ -0,0 +1,80 @@
+/*
+ * @Description: Uscita comandi J1939 - PGN trasmessi periodicamente dal
+ * gateway con i valori scritti via Modbus (FC 0x06/0x10, registri da
+ * MODBUS_COMMAND_BASE): setpoint di velocità/coppia in TSC1 (PGN 0x0000,
+ * 10 ms), comandi di avvio/arresto nei PGN proprietari della ECU. Ogni slot
+ * ha PGN, priorità, destinazione, periodo e payload grezzo (8 byte):
+ * la codifica dei segnali spetta al master Modbus.
+ *
+ * Lo scheduler gira a ogni tick di un timer hardware (J1939_COMMAND_TICK_US)
+ * in un task dedicato sul core del task CAN, con priorità più alta: ogni
+ * slot esce a istanti fissi (scadenza precedente + periodo, senza deriva)
+ * con un jitter limitato al tick e alla latenza del risveglio. Le
+ * trasmissioni non passano dal budget delle richieste (j1939_node.h):
+ * sono il carico previsto dal master.
+ *
+ * Timeout: uno slot smette di trasmettere se non viene riscritto entro il
+ * timeout comandi (registro MB_CMD_TIMEOUT), così un master fermo non lascia
+ * sul bus un setpoint vecchio; riprende alla scrittura successiva. Nessuna
+ * trasmissione senza un indirizzo rivendicato (address claim concluso).
+ * La configurazione non è salvata: al riavvio il master riscrive gli slot.
+ *
+ * Scrittori (modbusMutex acquisito): j1939CommandWrite; lettore: il task
+ * comandi, con un seqlock per slot.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config.h"
+
+// Registri (offset da MODBUS_COMMAND_BASE): intestazione, poi uno slot ogni
+// MB_CMD_SLOT_STRIDE registri da MB_CMD_SLOTS. In sola lettura lo stato
+#define MB_CMD_TIMEOUT              0   // Timeout comandi (ms)
+#define MB_CMD_ACTIVE               1   // Sola lettura: bit = slot in trasmissione
+#define MB_CMD_SOURCE_ADDRESS       2   // Sola lettura: SA del gateway, 0x00FE senza indirizzo
+#define MB_CMD_HEADER_COUNT         3
+#define MB_CMD_SLOTS                0x0010
+#define MB_CMD_SLOT_STRIDE          0x0010
+
+// Registri di uno slot
+#define MB_CMD_SLOT_ENABLE          0   // 0/1
+#define MB_CMD_SLOT_PGN             1   // 2 registri (32-bit)
+#define MB_CMD_SLOT_PRIORITY        3   // 0-7
+#define MB_CMD_SLOT_DESTINATION     4   // Solo PGN PDU1 (PF < 240)
+#define MB_CMD_SLOT_PERIOD          5   // ms, multiplo del tick
+#define MB_CMD_SLOT_LENGTH          6   // DLC 0-8
+#define MB_CMD_SLOT_DATA            7   // 4 registri, byte 1 nel byte alto del primo
+#define MB_CMD_SLOT_WORDS           11
+
+#define MB_CMD_COUNT                (MB_CMD_SLOTS + J1939_COMMAND_SLOTS * MB_CMD_SLOT_STRIDE)
+
+static_assert(MB_CMD_SLOT_WORDS <= MB_CMD_SLOT_STRIDE, "Slot comandi oltre il passo");
+static_assert(J1939_COMMAND_SLOTS <= 16, "Stato attivo in un registro");
+
+struct J1939CommandStats {
+    uint32_t frames;           // Frame trasmessi
+    uint32_t txFailed;         // Coda TX piena alla scadenza
+    uint32_t overruns;         // Scadenze saltate (ritardo oltre un periodo)
+    uint32_t timeouts;         // Slot fermati per timeout comandi
+    uint32_t writes;           // Scritture Modbus accettate
+    uint32_t maxLateUs;        // Ritardo massimo rispetto alla scadenza
+};
+
+extern J1939CommandStats j1939CommandStats;
+
+// Scrittura Modbus (modbusMutex acquisito): offset dal blocco comandi.
+// Restituisce 0 oppure il codice di eccezione (0x02 indirizzo, 0x03 valore);
+// con un'eccezione nessun registro cambia. Gli slot scritti ripartono dal
+// timeout
+uint8_t j1939CommandWrite(uint16_t offset, uint16_t quantity, const uint8_t *values, uint32_t nowMs);
+// Lettura (modbusMutex acquisito), false se l'intervallo esce dal blocco
+bool j1939CommandRead(uint16_t offset, uint16_t quantity, uint16_t *words);
+
+// Task CAN: indirizzo sorgente dei comandi, J1939_NULL_ADDRESS senza claim
+void j1939CommandSetSource(uint8_t sourceAddress);
+
+// Task comandi, a ogni tick: trasmette gli slot scaduti
+void j1939CommandService(uint32_t nowUs, uint32_t nowMs);
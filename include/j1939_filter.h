@@ -0,0 +1,32 @@
+/*
+ * @Description: Filtri di accettazione TWAI calcolati dall'insieme dei PGN
+ * decodificati e statistiche sui frame scartati (hardware e software)
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Configurazione filtro nel formato di twai_filter_config_t (frame estesi)
+struct J1939AcceptanceFilter {
+    uint32_t acceptanceCode;
+    uint32_t acceptanceMask;   // Bit a 1 = indifferente
+    bool singleFilter;
+    uint32_t acceptedIds;      // ID a 29 bit che passano il filtro (selettività)
+};
+
+// Contatori ricezione
+struct J1939RxStats {
+    uint32_t accepted;          // Frame passati dal filtro hardware
+    uint32_t softwareRejected;  // Frame accettati ma senza decoder
+    uint32_t hardwareRejected;  // Frame scartati dal filtro (se il controller li conta)
+    uint32_t sourcesDropped;    // Frame decodificabili da ECU oltre ENGINE_DATA_MAX_SOURCES
+    uint32_t rxQueueFull;       // Alert TWAI_ALERT_RX_QUEUE_FULL
+    uint32_t errorPassive;      // Passaggi del controller in error passive
+    uint32_t busErrors;         // Alert TWAI_ALERT_BUS_ERROR
+};
+
+extern J1939RxStats j1939RxStats;
+
+J1939AcceptanceFilter j1939ComputeAcceptanceFilter(const uint32_t *pgns, size_t count);
@@ -0,0 +1,56 @@
+/*
+ * @Description: Nodo J1939 del gateway - address claim (J1939-81) e
+ * richieste periodiche (PGN 0xEA00) dei parametri che le ECU trasmettono
+ * solo su richiesta. Le richieste sono distribuite nel tempo (fasi sfalsate,
+ * distanza minima), limitate da un budget di carico sul bus a token bucket
+ * e sospese con pausa esponenziale dopo TWAI_ALERT_TX_FAILED.
+ *
+ * Finché j1939NodeBegin non viene chiamata il gateway resta in solo ascolto.
+ * Tutte le funzioni vanno chiamate dal task CAN.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// Richiesta periodica: le risposte attese (frame) entrano nel budget
+struct J1939RequestEntry {
+    uint32_t pgn;
+    uint32_t periodMs;
+    uint8_t destination;       // J1939_GLOBAL_ADDRESS: risposte in broadcast (BAM)
+    uint8_t responseFrames;
+};
+
+enum J1939ClaimState : uint8_t {
+    J1939_CLAIM_OFF,           // Solo ascolto
+    J1939_CLAIM_PENDING,       // Address Claimed inviato, attesa di 250 ms
+    J1939_CLAIM_DONE,
+    J1939_CLAIM_FAILED,        // Nessun indirizzo libero: Cannot Claim, nessuna trasmissione
+};
+
+struct J1939NodeStats {
+    uint32_t requests;         // Richieste trasmesse
+    uint32_t budgetDeferred;   // Richieste scadute rinviate per budget esaurito
+    uint32_t txFailed;         // Trasmissioni fallite (coda piena o alert)
+    uint32_t claimsLost;       // Indirizzi ceduti a un NAME con priorità maggiore
+    uint32_t nacks;            // Richieste a noi di PGN non supportati
+    uint32_t backoffMs;        // Pausa corrente dopo errori di trasmissione
+};
+
+#define J1939_CLAIM_WAIT_MS 250
+
+extern J1939NodeStats j1939NodeStats;
+
+// NAME a 64 bit: identità (21 bit) e campi di config.h, indirizzo arbitrario
+uint64_t j1939MakeName(uint32_t identity);
+
+void j1939NodeBegin(uint64_t name, uint32_t nowMs);
+void j1939NodeStop();
+uint8_t j1939NodeAddress();  // J1939_NULL_ADDRESS senza indirizzo
+J1939ClaimState j1939NodeState();
+
+// Request e Address Claimed ricevuti dal bus
+void j1939NodeProcessFrame(uint32_t pgn, uint8_t sa, uint8_t da,
+                           const uint8_t *data, uint8_t length, uint32_t nowMs);
+// Trasmissioni in attesa e richieste scadute; alerts da hal_can_read_alerts
+void j1939NodePoll(uint32_t nowMs, uint32_t alerts);
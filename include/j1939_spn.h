@@ -0,0 +1,267 @@
+/*
+ * @Description: Tabella SPN J1939 e generazione a compile-time dei decoder per PGN.
+ * Ogni riga descrive un SPN (posizione nel payload, scala intera, offset,
+ * campo EngineData di destinazione). I template sotto espandono la tabella in
+ * un decoder per PGN senza salti: estrazione a shift/maschera su payload a
+ * 64 bit, conversione in virgola fissa con arrotondamento e gestione dei
+ * valori J1939 "non disponibile" (0xFF..) ed "errore" (0xFE..).
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <array>
+#include <utility>
+
+#include "engine_data.h"
+#include "j1939.h"
+
+// Descrittore SPN: valore = (raw * scaleNum + scaleDen / 2) / scaleDen + offset,
+// espresso nelle unità del campo EngineData di destinazione
+struct SpnDescriptor {
+    uint32_t pgn;
+    uint16_t spn;
+    uint8_t startBit;      // Bit 0 = LSB del primo byte (J1939 è little endian)
+    uint8_t bitLength;
+    int32_t scaleNum;
+    int32_t scaleDen;
+    int32_t offset;
+    EngineField field;
+};
+
+// Tabella SPN, ordinata per PGN
+constexpr SpnDescriptor SPN_TABLE[] = {
+    // PGN                       SPN  bit  len  num  den  offset  campo
+    { PGN_ELECTRONIC_ENGINE_2,    91,   8,   8,   2,   5,      0, FIELD_THROTTLE_POS },     // 0.4 %/bit
+    { PGN_ELECTRONIC_ENGINE_2,    92,  16,   8,   1,   1,      0, FIELD_ENGINE_LOAD },      // 1 %/bit
+    { PGN_ELECTRONIC_ENGINE_1,   513,  16,   8,   1,   1,   -125, FIELD_ENGINE_TORQUE },    // 1 %/bit, -125 %
+    { PGN_ELECTRONIC_ENGINE_1,   190,  24,  16,   1,   8,      0, FIELD_RPM },              // 0.125 rpm/bit
+    { PGN_ENGINE_HOURS,          247,   0,  32,   5,   1,      0, FIELD_ENGINE_HOURS },     // 0.05 h/bit -> h * 100
+    { PGN_ENGINE_TEMP,           110,   0,   8,  10,   1,   -400, FIELD_COOLANT_TEMP },     // 1 °C/bit, -40 °C
+    { PGN_ENGINE_TEMP,           175,  16,  16,  10,  32,  -2730, FIELD_ENGINE_TEMP },      // 0.03125 °C/bit, -273 °C
+    { PGN_ENGINE_FLUID_LEVEL,    100,  24,   8,   4,   1,      0, FIELD_OIL_PRESSURE },     // 4 kPa/bit
+    { PGN_FUEL_ECONOMY,          183,   0,  16,   5,   1,      0, FIELD_FUEL_RATE },        // 0.05 L/h/bit -> L/h * 100
+    { PGN_INTAKE_EXHAUST_COND,   105,  16,   8,  10,   1,   -400, FIELD_INTAKE_TEMP },      // 1 °C/bit, -40 °C
+    { PGN_INTAKE_EXHAUST_COND,   173,  40,  16,  10,  32,  -2730, FIELD_EXHAUST_TEMP },     // 0.03125 °C/bit, -273 °C
+    { PGN_VEHICLE_ELECTRICAL,    168,  32,  16,   1,   2,      0, FIELD_BATTERY_VOLTAGE },  // 0.05 V/bit -> V * 10
+};
+
+constexpr size_t SPN_COUNT = sizeof(SPN_TABLE) / sizeof(SPN_TABLE[0]);
+
+// Posizione e dimensione di ogni campo EngineData, indicizzate per EngineField
+struct FieldLayout {
+    size_t offset;
+    size_t size;
+};
+
+#define FIELD_LAYOUT_ENTRY(member) { offsetof(EngineData, member), sizeof(EngineData::member) }
+
+constexpr FieldLayout FIELD_LAYOUT[FIELD_COUNT] = {
+    FIELD_LAYOUT_ENTRY(rpm),
+    FIELD_LAYOUT_ENTRY(engineTemp),
+    FIELD_LAYOUT_ENTRY(oilPressure),
+    FIELD_LAYOUT_ENTRY(fuelRate),
+    FIELD_LAYOUT_ENTRY(engineHours),
+    FIELD_LAYOUT_ENTRY(coolantTemp),
+    FIELD_LAYOUT_ENTRY(intakeTemp),
+    FIELD_LAYOUT_ENTRY(exhaustTemp),
+    FIELD_LAYOUT_ENTRY(engineLoad),
+    FIELD_LAYOUT_ENTRY(throttlePos),
+    FIELD_LAYOUT_ENTRY(engineTorque),
+    FIELD_LAYOUT_ENTRY(batteryVoltage),
+};
+
+// Verifiche sulla tabella a compile-time
+constexpr bool spnTableIsValid() {
+    for (size_t i = 0; i < SPN_COUNT; i++) {
+        const SpnDescriptor &d = SPN_TABLE[i];
+        if (i > 0 && d.pgn < SPN_TABLE[i - 1].pgn) return false;
+        if (d.bitLength < 2 || d.bitLength > 32) return false;
+        if (d.startBit + d.bitLength > 64) return false;
+        if (d.scaleDen <= 0) return false;
+        if (d.field >= FIELD_COUNT) return false;
+    }
+    return true;
+}
+
+static_assert(spnTableIsValid(), "SPN_TABLE: PGN non ordinati o SPN fuori dal payload");
+
+constexpr uint64_t spnMask(uint8_t bitLength) {
+    return (bitLength >= 64) ? ~0ULL : ((1ULL << bitLength) - 1);
+}
+
+// Scrive il campo solo se ok = 1, con selezione a maschera invece di un salto
+template <size_t Size>
+inline void spnStoreField(uint8_t *dst, uint32_t value, uint32_t ok) {
+    static_assert(Size == 2 || Size == 4, "Campo EngineData non supportato");
+    uint32_t keep = ok - 1;  // 0 se ok, 0xFFFFFFFF altrimenti
+    if (Size == 4) {
+        uint32_t old;
+        memcpy(&old, dst, 4);
+        uint32_t merged = (value & ~keep) | (old & keep);
+        memcpy(dst, &merged, 4);
+    } else {
+        uint16_t old;
+        memcpy(&old, dst, 2);
+        uint16_t merged = (uint16_t)((value & ~keep) | (old & keep));
+        memcpy(dst, &merged, 2);
+    }
+}
+
+// Decodifica l'SPN I della tabella dal payload del frame
+template <size_t I>
+inline void spnDecode(uint64_t payload, EngineData &data, uint32_t &valid, uint32_t &error) {
+    constexpr SpnDescriptor d = SPN_TABLE[I];
+    constexpr uint32_t bit = FIELD_BIT(d.field);
+
+    // J1939: byte più significativo 0xFF = non disponibile, 0xFE = errore,
+    // valido fino a 0xFA (per SPN sotto gli 8 bit: tutti 1 = non disponibile,
+    // tutti 1 meno uno = errore)
+    constexpr uint8_t statusShift = (d.bitLength >= 8) ? d.bitLength - 8 : 0;
+    constexpr uint32_t notAvailableCode = (d.bitLength >= 8) ? 0xFF : (uint32_t)spnMask(d.bitLength);
+    constexpr uint32_t errorCode = notAvailableCode - 1;
+    constexpr uint32_t validMax = (d.bitLength >= 8) ? 0xFA : errorCode - 1;
+
+    uint32_t raw = (uint32_t)((payload >> d.startBit) & spnMask(d.bitLength));
+    uint32_t status = raw >> statusShift;
+    uint32_t isError = (uint32_t)(status == errorCode);
+    uint32_t ok = (uint32_t)(status <= validMax);
+
+    int64_t value = ((int64_t)raw * d.scaleNum + d.scaleDen / 2) / d.scaleDen + d.offset;
+    spnStoreField<FIELD_LAYOUT[d.field].size>(
+        reinterpret_cast<uint8_t *>(&data) + FIELD_LAYOUT[d.field].offset, (uint32_t)value, ok);
+
+    valid = (valid & ~bit) | (bit & (0 - ok));
+    error = (error & ~bit) | (bit & (0 - isError));
+}
+
+// Intervallo di righe della tabella relative al P-esimo PGN distinto
+struct SpnPgnRange {
+    uint32_t pgn;
+    size_t first;
+    size_t count;
+};
+
+constexpr size_t spnPgnCount() {
+    size_t count = 0;
+    for (size_t i = 0; i < SPN_COUNT; i++) {
+        if (i == 0 || SPN_TABLE[i].pgn != SPN_TABLE[i - 1].pgn) count++;
+    }
+    return count;
+}
+
+constexpr SpnPgnRange spnPgnRange(size_t index) {
+    SpnPgnRange range = { 0, 0, 0 };
+    size_t current = 0;
+    for (size_t i = 0; i < SPN_COUNT; i++) {
+        if (i > 0 && SPN_TABLE[i].pgn != SPN_TABLE[i - 1].pgn) current++;
+        if (current == index) {
+            if (range.count == 0) {
+                range.pgn = SPN_TABLE[i].pgn;
+                range.first = i;
+            }
+            range.count++;
+        }
+    }
+    return range;
+}
+
+constexpr size_t SPN_PGN_COUNT = spnPgnCount();
+
+// Campi EngineData scritti dal decoder del P-esimo PGN (FIELD_BIT)
+constexpr uint32_t spnPgnFields(size_t index) {
+    SpnPgnRange range = spnPgnRange(index);
+    uint32_t fields = 0;
+    for (size_t i = range.first; i < range.first + range.count; i++) {
+        fields |= FIELD_BIT(SPN_TABLE[i].field);
+    }
+    return fields;
+}
+
+template <size_t First, size_t... I>
+inline void spnDecodeAll(uint64_t payload, EngineData &data, uint32_t &valid, uint32_t &error,
+                         std::index_sequence<I...>) {
+    (spnDecode<First + I>(payload, data, valid, error), ...);
+}
+
+// Decoder generato per il P-esimo PGN: tutti i suoi SPN, in linea
+template <size_t P>
+void spnDecodePgn(uint64_t payload, EngineData &data) {
+    constexpr SpnPgnRange range = spnPgnRange(P);
+    uint32_t valid = data.validFlags;
+    uint32_t error = data.spnErrorFlags;
+    spnDecodeAll<range.first>(payload, data, valid, error, std::make_index_sequence<range.count>{});
+    data.validFlags = valid;
+    data.spnErrorFlags = error;
+}
+
+typedef void (*SpnPgnDecoder)(uint64_t payload, EngineData &data);
+
+struct SpnPgnEntry {
+    uint32_t pgn;
+    SpnPgnDecoder decode;
+    uint32_t fields;
+};
+
+template <size_t... P>
+constexpr std::array<SpnPgnEntry, sizeof...(P)> spnMakePgnTable(std::index_sequence<P...>) {
+    return {{ { spnPgnRange(P).pgn, &spnDecodePgn<P>, spnPgnFields(P) }... }};
+}
+
+// Tabella PGN -> decoder, ordinata per PGN
+constexpr std::array<SpnPgnEntry, SPN_PGN_COUNT> SPN_PGN_TABLE =
+    spnMakePgnTable(std::make_index_sequence<SPN_PGN_COUNT>{});
+
+// Hash perfetto PGN -> riga di SPN_PGN_TABLE: moltiplicatore cercato a
+// compile-time in modo che ogni PGN della tabella cada in uno slot diverso
+constexpr uint32_t spnHashBitsFor(size_t count) {
+    uint32_t bits = 3;
+    while ((1UL << bits) < 2 * count) bits++;
+    return bits;
+}
+
+constexpr uint32_t SPN_HASH_BITS = spnHashBitsFor(SPN_PGN_COUNT);
+constexpr size_t SPN_HASH_SIZE = 1UL << SPN_HASH_BITS;
+constexpr uint8_t SPN_HASH_EMPTY = 0xFF;
+
+static_assert(SPN_PGN_COUNT < SPN_HASH_EMPTY, "Troppi PGN per indici a 8 bit");
+
+constexpr uint32_t spnHash(uint32_t pgn, uint32_t multiplier) {
+    return (uint32_t)(pgn * multiplier) >> (32 - SPN_HASH_BITS);
+}
+
+constexpr bool spnHashIsPerfect(uint32_t multiplier) {
+    bool used[SPN_HASH_SIZE] = {};
+    for (size_t i = 0; i < SPN_PGN_COUNT; i++) {
+        uint32_t slot = spnHash(SPN_PGN_TABLE[i].pgn, multiplier);
+        if (used[slot]) return false;
+        used[slot] = true;
+    }
+    return true;
+}
+
+constexpr uint32_t spnFindHashMultiplier() {
+    for (uint32_t k = 0; k < 100000; k++) {
+        uint32_t multiplier = 0x9E3779B1UL + 2 * k;
+        if (spnHashIsPerfect(multiplier)) return multiplier;
+    }
+    return 0;
+}
+
+constexpr uint32_t SPN_HASH_MULTIPLIER = spnFindHashMultiplier();
+
+static_assert(SPN_HASH_MULTIPLIER != 0, "Nessun hash perfetto per SPN_PGN_TABLE");
+
+constexpr std::array<uint8_t, SPN_HASH_SIZE> spnMakeHashSlots() {
+    std::array<uint8_t, SPN_HASH_SIZE> slots = {};
+    for (size_t i = 0; i < SPN_HASH_SIZE; i++) slots[i] = SPN_HASH_EMPTY;
+    for (size_t i = 0; i < SPN_PGN_COUNT; i++) {
+        slots[spnHash(SPN_PGN_TABLE[i].pgn, SPN_HASH_MULTIPLIER)] = (uint8_t)i;
+    }
+    return slots;
+}
+
+constexpr std::array<uint8_t, SPN_HASH_SIZE> SPN_HASH_SLOTS = spnMakeHashSlots();
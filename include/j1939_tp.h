@@ -0,0 +1,42 @@
+/*
+ * @Description: J1939 Transport Protocol (TP.CM/TP.DT) - riassemblaggio BAM e
+ * RTS/CTS su un pool statico di sessioni, senza allocazioni dinamiche.
+ * Le sessioni RTS/CTS tra altri nodi sono seguite in ascolto passivo.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// Dimensionamento pool (J1939-21: massimo 255 pacchetti da 7 byte)
+#ifndef J1939_TP_MAX_SESSIONS
+#define J1939_TP_MAX_SESSIONS 8
+#endif
+#define J1939_TP_MAX_SIZE     1785
+
+// Control byte TP.CM
+#define TP_CM_RTS             16
+#define TP_CM_CTS             17
+#define TP_CM_END_OF_MSG_ACK  19
+#define TP_CM_BAM             32
+#define TP_CM_ABORT           255
+
+// Timeout J1939-21 (ms)
+#define TP_TIMEOUT_T1         750   // Tra pacchetti TP.DT
+#define TP_TIMEOUT_T2         1250  // Dopo CTS, in attesa di TP.DT
+#define TP_TIMEOUT_T3         1250  // Dopo l'ultimo TP.DT, in attesa di CTS/EOM
+#define TP_TIMEOUT_T4         1050  // Dopo CTS di attesa (0 pacchetti)
+
+// Statistiche riassemblaggio
+struct J1939TpStats {
+    uint32_t completed;     // Messaggi riassemblati e decodificati
+    uint32_t timeouts;      // Sessioni scadute (T1-T4)
+    uint32_t aborted;       // Sessioni chiuse da Abort o errore di sequenza
+    uint32_t poolFull;      // Annunci scartati per pool esaurito
+};
+
+extern J1939TpStats j1939TpStats;
+
+void j1939TpProcessFrame(uint32_t pgn, uint8_t sa, uint8_t da,
+                         const uint8_t *data, uint8_t length, uint32_t now);
+void j1939TpPoll(uint32_t now);
@@ -0,0 +1,30 @@
+/*
+ * @Description: Encoder JSON minimo su buffer preallocato: nessuna
+ * allocazione, interi scritti a mano. Se il buffer non basta il documento
+ * viene marcato in overflow e jsonEnd restituisce 0.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct JsonWriter {
+    char *buffer;
+    size_t size;
+    size_t length;
+    bool needComma;
+    bool overflow;
+};
+
+void jsonBegin(JsonWriter &writer, char *buffer, size_t size);  // Apre l'oggetto radice
+size_t jsonEnd(JsonWriter &writer);                               // Chiude, termina con NUL
+
+void jsonUint(JsonWriter &writer, const char *key, uint32_t value);
+void jsonInt(JsonWriter &writer, const char *key, int64_t value);  // |value| < 2^32
+void jsonNull(JsonWriter &writer, const char *key);
+void jsonObjectBegin(JsonWriter &writer, const char *key);  // key NULL dentro un array
+void jsonObjectEnd(JsonWriter &writer);
+void jsonArrayBegin(JsonWriter &writer, const char *key);
+void jsonArrayUint(JsonWriter &writer, uint32_t value);
+void jsonArrayEnd(JsonWriter &writer);
@@ -0,0 +1,30 @@
+/*
+ * @Description: Dati motore per la dashboard web in JSON su buffer
+ * preallocato: messaggi con i soli campi cambiati, inviati periodicamente a
+ * tutti i client WebSocket (stato completo dopo liveDataReset)
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "engine_data.h"
+
+#define LIVE_DATA_BUFFER 8192  // Tutti i data set completi, caso peggiore
+
+// Ultimo stato inviato a tutti i client (usato solo dal task di push)
+struct LiveDataState {
+    uint8_t count;                             // 0xFF = reinvia tutto
+    uint8_t sources[ENGINE_DATA_MAX_SOURCES];  // SA per data set, in ordine di banco
+    EngineData sent[ENGINE_DATA_MAX_SOURCES];
+};
+
+void liveDataReset(LiveDataState &state);
+
+// {"sources":[...],"sets":[{"set":N,...campi cambiati}]}: elenco ECU solo se
+// cambiato, set nuovi o rinumerati per intero. 0 = nulla da inviare
+size_t liveDataEncodeChanges(LiveDataState &state, char *buffer, size_t size);
+
+// Un solo data set, oggetto piatto con elenco ECU (formato di /data)
+size_t liveDataEncodeSet(char *buffer, size_t size, uint8_t set);
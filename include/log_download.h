@@ -0,0 +1,98 @@
+/*
+ * @Description: Download dei log CAN della SD (canlog/NNNNN.bin) senza
+ * caricarli in RAM: elenco dei file e lettura a pezzi nel buffer della
+ * risposta HTTP, con al più un blocco da 512 byte di stato per download.
+ *
+ * - File grezzo: byte copiati dal file, con intervallo (HTTP Range) per
+ *   riprendere un download interrotto.
+ * - Intervallo di tempo (ms dal primo frame del file): blocchi interi che lo
+ *   toccano, ancora un file di log valido; oppure conversione in CSV con i
+ *   soli frame dell'intervallo. La lunghezza non è nota in anticipo: risposta
+ *   chunked. L'inizio dell'intervallo si trova leggendo i blocchi in ordine
+ *   (i timestamp a 32 bit girano ogni ~71 minuti).
+ *
+ * Ogni lettura lavora al più LOG_DOWNLOAD_READ_MAX byte o
+ * LOG_DOWNLOAD_SCAN_BLOCKS blocchi: il file system resta libero per il task
+ * di log, che nel frattempo accumula i frame nel suo ring. I task CAN,
+ * Modbus e comandi non toccano la SD.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "can_log.h"
+#include "can_log_reader.h"
+#include "config.h"
+
+#define LOG_DOWNLOAD_END_US UINT64_MAX  // Intervallo senza fine
+
+enum LogDownloadFormat : uint8_t {
+    LOG_FORMAT_BINARY,
+    LOG_FORMAT_CSV,
+};
+
+enum LogDownloadResult : uint8_t {
+    LOG_DOWNLOAD_OK,
+    LOG_DOWNLOAD_NOT_FOUND,
+    LOG_DOWNLOAD_BUSY,           // LOG_DOWNLOAD_MAX_ACTIVE download in corso
+};
+
+struct LogDownload {
+    void *file;
+    uint32_t size;               // Dimensione all'apertura
+    uint32_t position;           // Prossimo byte da leggere
+    uint32_t end;                // Fine (esclusa) dei byte da leggere
+    uint64_t fromUs;             // Intervallo dal primo frame del file
+    uint64_t toUs;
+    uint64_t startUs;            // Timestamp del primo frame (valido con started)
+    CanLogReader reader;         // Stato prima del blocco in block
+    uint16_t blockFrames;        // CSV: frame del blocco in block già elaborati
+    uint8_t format;
+    uint8_t stage;               // 0 = intestazione, 1 = dati, 2 = completo
+    bool started;
+    bool blockLoaded;            // CSV: blocco letto, righe non ancora tutte scritte
+    uint8_t block[CAN_LOG_BLOCK_SIZE];
+};
+
+// Buffer minimo per logDownloadRead: un blocco intero
+#define LOG_DOWNLOAD_MIN_CHUNK CAN_LOG_BLOCK_SIZE
+
+// Apre canlog/NNNNN.bin; con LOG_DOWNLOAD_OK va chiusa con logDownloadEnd
+LogDownloadResult logDownloadBegin(LogDownload &download, uint32_t index, LogDownloadFormat format,
+                                   uint64_t fromUs, uint64_t toUs);
+// Copia byte per byte del file: formato binario senza intervallo di tempo
+bool logDownloadRaw(const LogDownload &download);
+// Solo file grezzo: byte da first a end escluso
+void logDownloadSetRange(LogDownload &download, uint32_t first, uint32_t end);
+// Scrive la parte successiva; 0 a download completo (stage 2) oppure se
+// questa chiamata ha solo letto blocchi fuori dall'intervallo: riprovare
+size_t logDownloadRead(LogDownload &download, uint8_t *buffer, size_t size);
+void logDownloadEnd(LogDownload &download);
+
+// Header "Range: bytes=a-b" (anche "a-" e "-n") su un file di size byte.
+// Un solo intervallo: con più intervalli o unità diverse vale il file intero
+enum LogRangeResult : uint8_t {
+    LOG_RANGE_NONE,              // File intero (200)
+    LOG_RANGE_OK,                // [first, end) (206)
+    LOG_RANGE_INVALID,           // Non soddisfacibile (416)
+};
+
+LogRangeResult logDownloadParseRange(const char *header, uint32_t size, uint32_t &first, uint32_t &end);
+
+// Elenco dei file come risposta JSON a pezzi (chunked), da 00000.bin al file
+// corrente (canLogStats.fileIndex):
+// {"logging":true,"current":N,"files":[{"file":0,"name":"00000.bin","bytes":B},...]}
+struct LogListQuery {
+    uint32_t next;               // Indice del file successivo
+    uint32_t last;
+    uint8_t stage;               // 0 = intestazione, 1 = file, 2 = completo
+    bool first;
+    bool logging;
+};
+
+#define LOG_LIST_MIN_CHUNK 96    // Buffer minimo per logListQueryRead
+
+void logListQueryBegin(LogListQuery &query, uint32_t currentIndex, bool logging);
+size_t logListQueryRead(LogListQuery &query, char *buffer, size_t size);
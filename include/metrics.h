@@ -0,0 +1,66 @@
+/*
+ * @Description: Strumentazione del gateway - contatori per PGN, istogrammi
+ * dei tempi (decodifica CAN, turnaround Modbus RTU) ed esportazione in
+ * formato testo Prometheus. Ogni contatore ha un solo scrittore (task CAN o
+ * task Modbus): incrementi senza lock, letture a 32 bit coerenti.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "j1939_spn.h"
+
+// Istogramma a bucket fissi in ns: limiti 256 ns * 4^k, l'ultimo è +Inf
+#define METRICS_BUCKETS 10
+
+struct MetricsHistogram {
+    uint32_t buckets[METRICS_BUCKETS];  // Non cumulativi
+    uint32_t count;
+    uint64_t sumNs;
+};
+
+// Frame ricevuti per PGN: righe della tabella SPN, poi i PGN gestiti a parte
+enum MetricsPgnSlot : uint8_t {
+    METRICS_PGN_DM1 = SPN_PGN_COUNT,
+    METRICS_PGN_DM2,
+    METRICS_PGN_TP_CM,
+    METRICS_PGN_TP_DT,
+    METRICS_PGN_REQUEST,
+    METRICS_PGN_ADDRESS_CLAIMED,
+    METRICS_PGN_OTHER,
+    METRICS_PGN_SLOTS
+};
+
+extern uint32_t metricsPgnFrames[METRICS_PGN_SLOTS];
+extern MetricsHistogram metricsDecodeTime;     // processJ1939Message, task CAN
+extern MetricsHistogram metricsRtuTurnaround;  // Frame RTU completo -> risposta in UART
+
+static inline uint8_t metricsBucket(uint32_t ns) {
+    if (ns <= 256) return 0;
+    uint8_t bits = 32 - __builtin_clz(ns - 1);  // ceil(log2(ns))
+    uint8_t bucket = (bits - 7) / 2;
+    return (bucket < METRICS_BUCKETS - 1) ? bucket : METRICS_BUCKETS - 1;
+}
+
+static inline void metricsObserve(MetricsHistogram &histogram, uint32_t ns) {
+    histogram.buckets[metricsBucket(ns)]++;
+    histogram.count++;
+    histogram.sumNs += ns;
+}
+
+// Intervallo tra due letture di hal_cycles in ns
+uint32_t metricsCyclesToNs(uint32_t cycles);
+
+// Esportazione a pezzi (risposta chunked): righe intere finché il buffer
+// basta, 0 a documento completo
+struct MetricsCursor {
+    uint8_t family;
+    uint16_t item;
+};
+
+#define METRICS_MIN_CHUNK 384  // Buffer minimo per metricsRead (intestazione e una serie)
+
+void metricsBegin(MetricsCursor &cursor);
+size_t metricsRead(MetricsCursor &cursor, char *buffer, size_t size);
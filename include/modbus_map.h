@@ -0,0 +1,118 @@
+/*
+ * @Description: Mappa registri Modbus configurabile a runtime. Ogni voce
+ * associa un segnale (campo EngineData o dato di stato) a un indirizzo delle
+ * tabelle holding e/o input, con tipo (16/32 bit, float32), ordine delle word
+ * e scala. Al caricamento la mappa viene validata e compilata in un indice
+ * denso indirizzo -> word dell'immagine del data set: una lettura da 125
+ * registri è un solo passaggio, senza ricerche per registro.
+ *
+ * La mappa di default riproduce i registri MB_REG_* (modbus_rtu.h).
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "engine_data.h"
+
+// Tabelle (maschera)
+#define MODBUS_TABLE_HOLDING        0x01
+#define MODBUS_TABLE_INPUT          0x02
+#define MODBUS_TABLE_BOTH           (MODBUS_TABLE_HOLDING | MODBUS_TABLE_INPUT)
+#define MODBUS_TABLE_COUNT          2
+
+// Segnali: i primi FIELD_COUNT sono i campi EngineField
+enum ModbusSignal : uint8_t {
+    MB_SIGNAL_STATUS_FLAGS = FIELD_COUNT,
+    MB_SIGNAL_ERROR_FLAGS,
+    MB_SIGNAL_DTC_COUNT,
+    MB_SIGNAL_LAST_UPDATE,
+    MB_SIGNAL_VALID_FLAGS,
+    MB_SIGNAL_SPN_ERROR_FLAGS,
+    MB_SIGNAL_SOURCE_ADDRESS,
+    MB_SIGNAL_PREVIOUS_DTC_COUNT,         // Nuovi segnali in coda: le mappe salvate restano valide
+    MB_SIGNAL_COUNT
+};
+
+enum ModbusValueType : uint8_t {
+    MODBUS_TYPE_U16,
+    MODBUS_TYPE_I16,
+    MODBUS_TYPE_U32,
+    MODBUS_TYPE_I32,
+    MODBUS_TYPE_F32,
+    MODBUS_TYPE_COUNT
+};
+
+#define MODBUS_ORDER_HIGH_FIRST     0  // Word più significativa all'indirizzo più basso
+#define MODBUS_ORDER_LOW_FIRST      1
+
+// Valore pubblicato = valore * gain + offset. Con gain 1 e offset 0 i tipi
+// interi riportano il valore del campo senza conversioni; con una scala il
+// risultato è arrotondato e saturato al tipo. Segnale non valido: 0xFFFF,
+// 0xFFFFFFFF o NaN (float32)
+struct ModbusMapEntry {
+    uint16_t address;
+    uint8_t tables;
+    uint8_t signal;
+    uint8_t type;
+    uint8_t wordOrder;
+    float gain;
+    float offset;
+};
+
+#define MODBUS_MAP_MAX_ENTRIES      64
+#define MODBUS_MAP_INDEX_SIZE       512   // Indirizzi per tabella, dal più basso al più alto mappato
+#define MODBUS_BANK_WORDS           64    // Word dell'immagine per data set
+#define MODBUS_MAP_UNMAPPED         0xFF
+
+static_assert(MODBUS_BANK_WORDS <= MODBUS_MAP_UNMAPPED, "Word dell'immagine indicizzate a 8 bit");
+
+// Sorgente compilata di una voce: posizione del valore in EngineData e bit
+// di validità, così la costruzione dell'immagine non passa per il segnale
+#define MODBUS_SOURCE_SIGNED        0x01
+#define MODBUS_SOURCE_DIRECT        0x02  // Intero senza scala: valore copiato
+#define MODBUS_SOURCE_PRESENCE      0x04  // Valido solo se il banco ha una ECU
+
+struct ModbusMapSource {
+    uint8_t offset;
+    uint8_t size;
+    uint8_t flags;
+    uint32_t validBit;                    // 0 = sempre valido
+};
+
+// Mappa compilata: indice denso per tabella, sorgente e posizione di ogni
+// voce nell'immagine del data set
+struct ModbusMap {
+    ModbusMapEntry entries[MODBUS_MAP_MAX_ENTRIES];
+    ModbusMapSource sources[MODBUS_MAP_MAX_ENTRIES];
+    uint8_t entryWord[MODBUS_MAP_MAX_ENTRIES];
+    uint8_t count;
+    uint8_t imageWords;
+    uint16_t bankStride;                  // Passo dei banchi in MODBUS_MAP_REGISTER_BANK (0 = un solo banco)
+    uint16_t base[MODBUS_TABLE_COUNT];    // Primo indirizzo mappato
+    uint16_t end[MODBUS_TABLE_COUNT];     // Dopo l'ultimo (0 = tabella vuota)
+    uint8_t index[MODBUS_TABLE_COUNT][MODBUS_MAP_INDEX_SIZE];
+};
+
+// Mappa attiva, da leggere con modbusMutex acquisito
+extern ModbusMap modbusMap;
+
+extern const ModbusMapEntry MODBUS_DEFAULT_MAP[];
+extern const size_t MODBUS_DEFAULT_MAP_COUNT;
+
+// Valida e compila la mappa, poi la attiva (acquisisce modbusMutex).
+// Con bankStride > 0 tutti gli indirizzi devono stare sotto il passo; con 0
+// gli indirizzi sono liberi ma in MODBUS_MAP_REGISTER_BANK è esposto solo il
+// primo data set. Restituisce NULL o il motivo del rifiuto (la mappa attiva
+// resta invariata)
+const char *modbusMapLoad(const ModbusMapEntry *entries, size_t count, uint16_t bankStride);
+
+// Scrive le word della voce nell'immagine del data set (data NULL = banco vuoto)
+void modbusMapBuildImage(const ModbusMap &map, const EngineData *data, uint16_t *image);
+
+// Nomi usati nella configurazione JSON
+const char *modbusMapSignalName(uint8_t signal);
+int modbusMapSignalIndex(const char *name);
+const char *modbusMapTypeName(uint8_t type);
+int modbusMapTypeIndex(const char *name);
@@ -0,0 +1,178 @@
+/*
+ * @Description: Modbus RTU slave - mappa registri e gestione richieste
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <mutex>
+
+#include "config.h"
+#include "engine_data.h"
+#include "j1939_command.h"
+#include "modbus_map.h"
+
+// Codici funzione Modbus
+#define MB_FC_READ_HOLDING_REGISTERS 0x03
+#define MB_FC_READ_INPUT_REGISTERS   0x04
+#define MB_FC_WRITE_SINGLE_REGISTER  0x06
+#define MB_FC_DIAGNOSTICS            0x08
+#define MB_FC_WRITE_MULTIPLE_REGISTERS 0x10
+
+// Mappa registri di default (holding e input, vedi modbus_map.h)
+#define MB_REG_ENGINE_RPM           0   // 2 registri (32-bit)
+#define MB_REG_ENGINE_TEMP          2   // 1 registro (16-bit) 
+#define MB_REG_OIL_PRESSURE         3   // 1 registro (16-bit)
+#define MB_REG_FUEL_RATE            4   // 2 registri (32-bit)
+#define MB_REG_ENGINE_HOURS         6   // 2 registri (32-bit)
+#define MB_REG_COOLANT_TEMP         8   // 1 registro (16-bit)
+#define MB_REG_INTAKE_TEMP          9   // 1 registro (16-bit)
+#define MB_REG_EXHAUST_TEMP         10  // 1 registro (16-bit)
+#define MB_REG_ENGINE_LOAD          11  // 1 registro (16-bit)
+#define MB_REG_THROTTLE_POS         12  // 1 registro (16-bit)
+#define MB_REG_ENGINE_TORQUE        13  // 2 registri (32-bit)
+#define MB_REG_BATTERY_VOLTAGE      15  // 1 registro (16-bit)
+#define MB_REG_STATUS_FLAGS         16  // 1 registro (16-bit)
+#define MB_REG_ERROR_FLAGS          17  // 1 registro (16-bit)
+#define MB_REG_DTC_COUNT            18  // 1 registro (16-bit)
+#define MB_REG_LAST_UPDATE          19  // 2 registri (32-bit timestamp)
+#define MB_REG_VALID_FLAGS          21  // 1 registro (bit = segnale valido)
+#define MB_REG_SPN_ERROR_FLAGS      22  // 1 registro (bit = segnale in errore)
+#define MB_REG_SOURCE_ADDRESS       23  // 1 registro (SA J1939 della ECU, 0xFFFF = banco vuoto)
+
+#define MODBUS_REGISTERS_COUNT      24
+
+// Un banco di registri per data set (ECU), ordinati per indirizzo sorgente:
+// banco N = slave ID base + N (MODBUS_MAP_UNIT_ID) oppure registri da
+// N * passo dei banchi sullo slave ID base (MODBUS_MAP_REGISTER_BANK).
+// MODBUS_BANK_SIZE è il passo della mappa di default. L'immagine contiene
+// per ogni banco le word dei registri mappati, MODBUS_BANK_WORDS al massimo
+#define MODBUS_BANK_SIZE            32
+#define MODBUS_IMAGE_SIZE           (ENGINE_DATA_MAX_SOURCES * MODBUS_BANK_WORDS)
+#define MODBUS_MAX_READ_QUANTITY    125
+#define MODBUS_MAX_WRITE_QUANTITY   123
+
+// Registri di configurazione (holding, solo slave ID base): letti con FC 0x03,
+// scritti con FC 0x10. Fuori dall'area dati dei banchi
+#define MODBUS_CONFIG_BASE          0xF000
+#define MB_CFG_SLAVE_ID             0   // 1-247
+#define MB_CFG_BAUDRATE             1   // 2 registri (32-bit), scritti insieme
+#define MB_CFG_SET_MAPPING          3   // MODBUS_MAP_UNIT_ID / MODBUS_MAP_REGISTER_BANK
+#define MB_CFG_MAP_ENTRIES          4   // Sola lettura: voci della mappa registri
+#define MB_CFG_COUNT                5
+
+// Comandi J1939 (j1939_command.h): holding sullo slave ID base, letti con
+// FC 0x03 e scritti con FC 0x06 o 0x10. Registri MB_CMD_*, fuori dall'area
+// dati dei banchi come i blocchi seguenti
+#define MODBUS_COMMAND_BASE         0xD000
+
+// Registro DTC (dtc_store.h): FC 0x03 o 0x04 sullo slave ID base, fuori
+// dall'area dati dei banchi. Intestazione, poi un record da
+// MB_DTC_RECORD_WORDS registri per DTC: attivi da MB_DTC_ACTIVE, precedenti
+// da MB_DTC_PREVIOUS. Una pagina (MB_DTC_PAGE_RECORDS record) sta in una
+// lettura; i record oltre la fine della lista valgono 0xFFFF. Se
+// MB_DTC_CHANGES cambia tra due pagine la lista va riletta
+#define MODBUS_DTC_BASE             0xE000
+#define MB_DTC_ACTIVE_COUNT         0
+#define MB_DTC_PREVIOUS_COUNT       1
+#define MB_DTC_CHANGES              2   // 16 bit bassi
+#define MB_DTC_DROPPED              3   // DTC persi a registro pieno (16 bit bassi)
+#define MB_DTC_CAPACITY             4   // Record per lista
+#define MB_DTC_HEADER_COUNT         5
+#define MB_DTC_ACTIVE               0x0100
+#define MB_DTC_PREVIOUS             0x0800
+#define MB_DTC_RECORD_WORDS         10
+#define MB_DTC_PAGE_RECORDS         (MODBUS_MAX_READ_QUANTITY / MB_DTC_RECORD_WORDS)
+
+// Registri di un record
+#define MB_DTC_REC_SOURCE_ADDRESS   0
+#define MB_DTC_REC_SPN              1   // 2 registri (32-bit)
+#define MB_DTC_REC_FMI              3
+#define MB_DTC_REC_OCCURRENCE       4
+#define MB_DTC_REC_CONVERSION       5
+#define MB_DTC_REC_FIRST_SEEN       6   // 2 registri (32-bit timestamp)
+#define MB_DTC_REC_LAST_SEEN        8   // 2 registri (32-bit timestamp)
+
+// Sotto-funzioni FC 0x08 (Modbus over serial line): i contatori 0x0B-0x12
+// vengono restituiti nel campo dati della risposta (16 bit, troncati)
+#define MB_DIAG_RETURN_QUERY_DATA       0x00
+#define MB_DIAG_RESTART_COMMUNICATIONS  0x01  // Azzera i contatori
+#define MB_DIAG_RETURN_REGISTER         0x02  // Registro diagnostico, sempre 0
+#define MB_DIAG_CLEAR_COUNTERS          0x0A
+#define MB_DIAG_BUS_MESSAGE_COUNT       0x0B
+#define MB_DIAG_BUS_COMM_ERROR_COUNT    0x0C
+#define MB_DIAG_BUS_EXCEPTION_COUNT     0x0D
+#define MB_DIAG_SERVER_MESSAGE_COUNT    0x0E
+#define MB_DIAG_SERVER_NO_RESPONSE      0x0F  // Sempre 0: nessun broadcast
+#define MB_DIAG_SERVER_NAK_COUNT        0x10  // Sempre 0
+#define MB_DIAG_SERVER_BUSY_COUNT       0x11  // Sempre 0
+#define MB_DIAG_BUS_CHAR_OVERRUN_COUNT  0x12
+
+#define MODBUS_MAP_UNIT_ID          0
+#define MODBUS_MAP_REGISTER_BANK    1
+
+static_assert(MODBUS_REGISTERS_COUNT <= MODBUS_BANK_SIZE, "Mappa registri oltre il banco");
+static_assert(DTC_STORE_CAPACITY * MB_DTC_RECORD_WORDS <= MB_DTC_PREVIOUS - MB_DTC_ACTIVE &&
+              MB_DTC_PREVIOUS + DTC_STORE_CAPACITY * MB_DTC_RECORD_WORDS <= MODBUS_CONFIG_BASE - MODBUS_DTC_BASE,
+              "Registro DTC oltre i registri riservati");
+static_assert(MB_CMD_COUNT <= MODBUS_DTC_BASE - MODBUS_COMMAND_BASE, "Comandi J1939 oltre il loro blocco");
+
+// Dimensione massima frame RTU
+#define MODBUS_RTU_MAX_FRAME        256
+
+// Risposte complete memorizzate per richieste di lettura ripetute
+#ifndef MODBUS_RESPONSE_CACHE_SIZE
+#define MODBUS_RESPONSE_CACHE_SIZE  4
+#endif
+
+// Buffer registri Modbus (tutti i banchi) e generazione (incrementata a ogni modifica)
+extern uint16_t modbusRegisters[MODBUS_IMAGE_SIZE];
+extern uint32_t modbusImageGeneration;
+
+struct ModbusCacheStats {
+    uint32_t hits;
+    uint32_t misses;
+};
+
+extern ModbusCacheStats modbusCacheStats;
+
+// Contatori diagnostici (FC 0x08 e /metrics), aggiornati con modbusMutex
+// acquisito tranne quelli di ricezione RTU (solo task RTU)
+struct ModbusDiagCounters {
+    uint32_t busMessages;        // Frame RTU con CRC valido, anche per altri slave
+    uint32_t busCrcErrors;       // Frame RTU scartati (CRC errato o troppo corti)
+    uint32_t busExceptions;      // Risposte di eccezione (RTU e TCP)
+    uint32_t serverMessages;     // Richieste per il gateway (RTU e TCP)
+    uint32_t charOverruns;       // Frame RTU oltre MODBUS_RTU_MAX_FRAME
+    uint32_t rtuRequests;        // Richieste RTU per il gateway
+    uint32_t exceptionCodes[4];  // Eccezioni per codice 0x01-0x04
+};
+
+extern ModbusDiagCounters modbusDiag;
+
+// Variabili configurazione
+extern uint8_t currentSlaveId;
+extern uint32_t currentBaudrate;
+extern uint8_t modbusSetMapping;
+
+// Da acquisire per modbusExecute/updateModbusRegisters (task RTU e server TCP)
+extern std::mutex modbusMutex;
+
+// Chiamata (con modbusMutex acquisito) dopo una scrittura FC 0x06/0x10 dei
+// registri di configurazione, per salvarli e applicarli
+extern void (*modbusConfigChanged)();
+
+// Avvia la UART RS485 con il baudrate corrente
+void modbusRtuBegin();
+
+// Applica la configurazione (con modbusMutex acquisito), false se un valore
+// non è valido. Slave ID e mappatura valgono dalla richiesta successiva, il
+// baudrate dal confine del frame RTU successivo, dopo la risposta in corso
+bool modbusConfigApply(uint16_t slaveId, uint32_t baudrate, uint16_t setMapping);
+
+uint16_t calculateCRC16(uint8_t *data, uint16_t length);
+bool updateModbusRegisters();
+void modbusMapChanged();  // Nuova mappa attiva: immagine da ricostruire, cache da svuotare
+uint16_t modbusExecute(const uint8_t *request, uint16_t length, const uint8_t **frame);
+void processModbusRequest(uint32_t timeoutMs = 0);
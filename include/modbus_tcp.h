@@ -0,0 +1,40 @@
+/*
+ * @Description: Modbus TCP server - framing MBAP e sessioni client sulla
+ * stessa immagine registri (e cache risposte) dello slave RTU
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MODBUS_TCP_MBAP_SIZE      7     // Transaction ID, Protocol ID, Length, Unit ID
+#define MODBUS_TCP_MAX_ADU        260
+#define MODBUS_TCP_RX_BUFFER      1024  // Richieste in pipeline ancora da servire
+
+// Invia una risposta: header MBAP + PDU. Restituisce false se il buffer di
+// trasmissione del client è pieno (la richiesta resta in coda)
+typedef bool (*ModbusTcpWrite)(void *context, const uint8_t *header, const uint8_t *pdu, uint16_t pduLength);
+
+// Stato di un client: byte ricevuti non ancora elaborati
+struct ModbusTcpSession {
+    void *client;    // Connessione associata (NULL = sessione libera)
+    uint16_t rxLength;
+    uint8_t rx[MODBUS_TCP_RX_BUFFER];
+};
+
+struct ModbusTcpStats {
+    uint32_t connections;
+    uint32_t rejected;        // Client oltre MODBUS_TCP_MAX_CLIENTS
+    uint32_t requests;
+    uint32_t protocolErrors;  // Header MBAP non valido o buffer pieno: connessione chiusa
+};
+
+extern ModbusTcpStats modbusTcpStats;
+
+// Accoda i byte ricevuti ed esegue tutte le richieste complete, in ordine.
+// Restituisce false se la connessione va chiusa
+bool modbusTcpReceive(ModbusTcpSession &session, const uint8_t *data, size_t length,
+                      ModbusTcpWrite write, void *context);
+
+void modbusTcpBegin();
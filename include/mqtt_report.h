@@ -0,0 +1,57 @@
+/*
+ * @Description: Pubblicazione MQTT report-by-exception dei segnali
+ * decodificati. A ogni intervallo di flush i data set pubblicati vengono
+ * confrontati con l'ultimo valore riportato: un segnale entra nel messaggio
+ * della sua ECU se si è spostato oltre la banda morta, se il valore
+ * riportato è più vecchio dell'età massima o se è diventato non valido
+ * (null). I cambiamenti di una ECU nello stesso intervallo finiscono in un
+ * solo messaggio, accodato in una coda a dimensione fissa che si svuota
+ * quando il client è connesso; a coda piena si perde il messaggio più
+ * vecchio e il flush successivo riporta di nuovo tutti i segnali.
+ *
+ * Il modulo non conosce la rete: mqttReportService riceve la funzione che
+ * consegna i messaggi al client. Tutte le funzioni vanno chiamate dallo
+ * stesso task (mai dal task CAN o Modbus: legge i data set pubblicati).
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config.h"
+#include "engine_data.h"
+
+struct MqttReportConfig {
+    uint32_t deadband[FIELD_COUNT];  // Unità di EngineData, 0 = ogni variazione
+    uint32_t maxAgeMs;               // Ripubblicazione di un valore invariato, 0 = mai
+    uint32_t flushIntervalMs;
+};
+
+struct MqttReportStats {
+    uint32_t messages;          // Messaggi accodati
+    uint32_t published;         // Messaggi consegnati al client
+    uint32_t dropped;           // Messaggi persi per coda piena
+    uint32_t signals;           // Valori riportati (null compresi)
+    uint32_t queueHighWater;    // Massima occupazione della coda
+};
+
+// Consegna un messaggio al client MQTT (topic <prefisso>/ecu/<sa>); false
+// se il client non può accettarlo ora (verrà ritentato)
+typedef bool (*MqttPublishFn)(uint8_t sourceAddress, const char *payload, size_t length, void *context);
+
+extern MqttReportStats mqttReportStats;
+extern const MqttReportConfig MQTT_REPORT_DEFAULTS;
+
+// Azzera lo stato riportato e la coda: il primo flush riporta tutto. La
+// coda (MQTT_QUEUE_MESSAGES x MQTT_PAYLOAD_MAX) è allocata alla prima
+// chiamata: solo con un broker configurato. false senza memoria, report
+// disattivato
+bool mqttReportBegin(const MqttReportConfig &config);
+
+// Flush alla scadenza dell'intervallo, poi svuota la coda tramite publish
+// (NULL = client non connesso, i messaggi restano in coda). Nulla prima di
+// mqttReportBegin
+void mqttReportService(uint32_t nowMs, MqttPublishFn publish, void *context);
+
+uint16_t mqttReportQueued();
@@ -0,0 +1,78 @@
+/*
+ * @Description: Profiler dei task - tempo di esecuzione per sezione
+ * (istogramma e massimo, dal contatore di cicli), jitter di attivazione delle
+ * sezioni periodiche, stack libero minimo dei task e attesa in coda dei frame
+ * CAN. Costo per sezione: due letture del contatore di cicli e qualche
+ * incremento, più una lettura di hal_micros per le sezioni periodiche;
+ * sempre attivo anche in produzione.
+ *
+ * Ogni sezione ha un solo scrittore (il suo task); l'azzeramento è chiesto
+ * con un contatore di generazione ed eseguito dallo scrittore stesso.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hal.h"
+#include "metrics.h"
+
+enum ProfileSection : uint8_t {
+    PROFILE_CAN,        // CAN_Task: lotto di frame, timeout TP, nodo, pubblicazione
+    PROFILE_MODBUS,     // processModbusRequest con byte ricevuti
+    PROFILE_WEB,        // Invio dei campi cambiati ai client WebSocket
+    PROFILE_LOG,        // canLogService
+    PROFILE_MQTT,       // Report MQTT e svuotamento della coda
+    PROFILE_STATUS,     // Stampa di stato su seriale in loop()
+    PROFILE_COMMAND,    // Scheduler dei comandi J1939, a ogni tick del timer
+    PROFILE_SECTIONS
+};
+
+struct ProfileStats {
+    MetricsHistogram time;
+    uint32_t maxNs;
+    uint32_t lastActivationUs;   // Solo sezioni periodiche
+    uint32_t minIntervalUs;      // Intervallo tra due attivazioni: jitter = max - min
+    uint32_t maxIntervalUs;
+    uint32_t generation;         // Ultimo azzeramento eseguito
+};
+
+extern ProfileStats profileStats[PROFILE_SECTIONS];
+
+// Attesa in coda dei frame CAN trovati al rientro nel task CAN (limite
+// superiore: tempo dall'ultima volta che la coda è stata vista vuota)
+extern MetricsHistogram profileCanBacklog;
+extern uint32_t profileCanBacklogMaxUs;
+
+const char *profileSectionName(uint8_t section);
+bool profileSectionPeriodic(uint8_t section);
+
+// Inizio sezione: restituisce i cicli da passare a profileEnd
+uint32_t profileBegin(ProfileSection section);
+
+static inline void profileEnd(ProfileSection section, uint32_t startCycles) {
+    uint32_t ns = metricsCyclesToNs(hal_cycles() - startCycles);
+    ProfileStats &stats = profileStats[section];
+    metricsObserve(stats.time, ns);
+    if (ns > stats.maxNs) stats.maxNs = ns;
+}
+
+void profileCanBacklogObserve(uint32_t ageUs);  // Task CAN
+
+// Azzera tutte le statistiche alla prossima attivazione di ogni sezione
+void profileReset();
+
+// Task di cui riportare lo stack libero minimo (registrati all'avvio)
+#define PROFILE_MAX_TASKS 8
+
+bool profileTaskRegister(const char *name, void *task, uint32_t stackSize);
+uint8_t profileTaskCount();
+const char *profileTaskName(uint8_t index);
+uint32_t profileTaskStackSize(uint8_t index);
+uint32_t profileTaskStackFree(uint8_t index);  // Minimo dall'avvio, byte
+
+// Tabella di testo (seriale e /profile): una riga per sezione e per task
+#define PROFILE_REPORT_SIZE 1024
+
+size_t profileReport(char *buffer, size_t size);
@@ -0,0 +1,37 @@
+/*
+ * @Description: Risorse dell'interfaccia web incorporate nel firmware:
+ * file di web/ compressi con gzip da tools/web_assets.py in array costanti,
+ * che restano in flash (DROM mappata in memoria) e sono inviati a pezzi
+ * senza copia in RAM. Ogni risorsa ha un ETag forte (hash del contenuto)
+ * per le risposte 304; JS e CSS sono richiesti da index.html con URL
+ * versionati e possono essere tenuti in cache senza riconvalida.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct WebAsset {
+    const char *path;          // URL ("/" per index.html)
+    const char *contentType;
+    const char *etag;          // Tag forte, tra virgolette
+    const uint8_t *data;       // Contenuto gzip
+    uint32_t length;
+    bool immutable;            // URL versionato: Cache-Control immutable
+};
+
+extern const WebAsset WEB_ASSETS[];
+extern const uint8_t WEB_ASSET_COUNT;
+
+// Cache-Control delle risorse: la pagina si riconvalida sempre (ETag)
+#define WEB_CACHE_IMMUTABLE "public, max-age=31536000, immutable"
+#define WEB_CACHE_REVALIDATE "no-cache"
+
+const WebAsset *webAssetFind(const char *path);  // NULL se assente
+
+// If-None-Match (lista di tag, anche deboli W/"..." o *) soddisfatto dal tag
+bool webEtagMatches(const char *ifNoneMatch, const char *etag);
+
+// Accept-Encoding con gzip non escluso (q=0)
+bool webAcceptsGzip(const char *acceptEncoding);
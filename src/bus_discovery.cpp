@@ -0,0 +1,182 @@
+/*
+ * @Description: Inventario passivo del bus (vedi bus_discovery.h)
+ */
+
+#include "bus_discovery.h"
+
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+
+#define DISCOVERY_EMPTY 0   // Tabella libera anche senza inizializzazione
+#define DISCOVERY_BITS (31 - __builtin_clz(BUS_DISCOVERY_SLOTS))
+
+struct DiscoverySlot {
+    uint32_t key;                 // (PGN << 8 | SA) + 1, DISCOVERY_EMPTY se libero
+    uint32_t lastUs;              // Ultimo frame, per l'intervallo
+    std::atomic<uint32_t> seq;    // Dispari durante una modifica
+    BusDiscoveryEntry entry;
+};
+
+BusDiscoveryStats busDiscoveryStats;
+
+static DiscoverySlot slots[BUS_DISCOVERY_SLOTS];
+static std::atomic<bool> resetPending(false);
+
+static inline uint32_t discoveryHash(uint32_t key) {
+    return (uint32_t)(key * 2654435761U) >> (32 - DISCOVERY_BITS);
+}
+
+static void discoveryClear() {
+    for (uint16_t i = 0; i < BUS_DISCOVERY_SLOTS; i++) {
+        DiscoverySlot &slot = slots[i];
+        uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+        slot.seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.key = DISCOVERY_EMPTY;
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.seq.store(seq + 2, std::memory_order_relaxed);
+    }
+    busDiscoveryStats.pairs = 0;
+    busDiscoveryStats.untracked = 0;
+}
+
+void busDiscoveryReset() {
+    resetPending.store(true, std::memory_order_relaxed);
+}
+
+// Slot della chiave o primo slot libero della sequenza di sondaggio;
+// -1 se la chiave manca e la tabella è piena
+static int32_t discoveryFind(uint32_t key) {
+    uint32_t index = discoveryHash(key);
+    for (;;) {
+        uint32_t slotKey = slots[index].key;
+        if (slotKey == key) return index;
+        if (slotKey == DISCOVERY_EMPTY) {
+            return (busDiscoveryStats.pairs < BUS_DISCOVERY_CAPACITY) ? (int32_t)index : -1;
+        }
+        index = (index + 1) & (BUS_DISCOVERY_SLOTS - 1);
+    }
+}
+
+void busDiscoveryRecord(const twai_message_t &message, uint32_t pgn, bool handled,
+                        uint32_t nowUs, uint32_t nowMs) {
+    if (resetPending.load(std::memory_order_relaxed)) {
+        resetPending.store(false, std::memory_order_relaxed);
+        discoveryClear();
+    }
+    uint8_t sourceAddress = message.identifier & 0xFF;
+    uint32_t key = ((pgn << 8) | sourceAddress) + 1;
+    int32_t index = discoveryFind(key);
+    if (index < 0) {
+        busDiscoveryStats.untracked++;
+        return;
+    }
+
+    DiscoverySlot &slot = slots[index];
+    BusDiscoveryEntry &entry = slot.entry;
+    uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+    slot.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    if (slot.key == DISCOVERY_EMPTY) {
+        slot.key = key;
+        memset(&entry, 0, sizeof(entry));
+        entry.pgn = pgn;
+        entry.sourceAddress = sourceAddress;
+        entry.firstSeenMs = nowMs;
+        busDiscoveryStats.pairs++;
+    } else {
+        // Medie mobili: periodo con peso 1/8, jitter |intervallo - periodo| con 1/16
+        int32_t interval = nowUs - slot.lastUs;
+        if (entry.periodUs == 0) {
+            entry.periodUs = interval;
+        } else {
+            int32_t deviation = interval - (int32_t)entry.periodUs;
+            entry.periodUs += deviation / 8;
+            if (deviation < 0) deviation = -deviation;
+            entry.jitterUs += (deviation - (int32_t)entry.jitterUs) / 16;
+        }
+    }
+    entry.identifier = message.identifier;
+    entry.frames++;
+    slot.lastUs = nowUs;
+    entry.lastSeenMs = nowMs;
+    entry.dlc = message.data_length_code;
+    entry.handled = handled;
+    memcpy(entry.data, message.data, sizeof(entry.data));
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.seq.store(seq + 2, std::memory_order_relaxed);
+}
+
+bool busDiscoveryRead(uint16_t index, BusDiscoveryEntry &entry) {
+    if (index >= BUS_DISCOVERY_SLOTS) return false;
+    const DiscoverySlot &slot = slots[index];
+    uint32_t before;
+    uint32_t after;
+    bool used;
+    do {
+        before = slot.seq.load(std::memory_order_acquire);
+        used = slot.key != DISCOVERY_EMPTY;
+        if (used) entry = slot.entry;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = slot.seq.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+    return used;
+}
+
+void busDiscoveryQueryBegin(BusDiscoveryQuery &query, uint16_t sourceAddress, bool filterOpen, uint32_t nowMs) {
+    query.sourceAddress = sourceAddress;
+    query.next = 0;
+    query.stage = 0;
+    query.first = true;
+    query.filterOpen = filterOpen;
+    query.nowMs = nowMs;
+}
+
+size_t busDiscoveryQueryRead(BusDiscoveryQuery &query, char *buffer, size_t size) {
+    size_t length = 0;
+    if (query.stage == 0) {
+        int written = snprintf(buffer, size, "{\"pairs\":%u,\"untracked\":%u,\"capacity\":%u,\"filterOpen\":%s,\"entries\":[",
+                               (unsigned)busDiscoveryStats.pairs, (unsigned)busDiscoveryStats.untracked,
+                               (unsigned)BUS_DISCOVERY_CAPACITY, query.filterOpen ? "true" : "false");
+        if (written < 0 || (size_t)written >= size) return 0;
+        length = written;
+        query.stage = 1;
+    }
+    while (query.stage == 1) {
+        if (query.next >= BUS_DISCOVERY_SLOTS) {
+            if (length + 2 >= size) return length;
+            memcpy(buffer + length, "]}", 2);
+            length += 2;
+            query.stage = 2;
+            break;
+        }
+        BusDiscoveryEntry entry;
+        if (!busDiscoveryRead(query.next, entry) ||
+            (query.sourceAddress != BUS_DISCOVERY_ALL && entry.sourceAddress != query.sourceAddress)) {
+            query.next++;
+            continue;
+        }
+        char data[17];
+        uint8_t dlc = (entry.dlc < 8) ? entry.dlc : 8;
+        for (uint8_t i = 0; i < dlc; i++) snprintf(&data[i * 2], 3, "%02X", entry.data[i]);
+        data[dlc * 2] = '\0';
+        // Destinazione solo per i PGN PDU1 (PF < 240)
+        char destination[5] = "null";
+        if (((entry.pgn >> 8) & 0xFF) < 240) snprintf(destination, sizeof(destination), "%u", (unsigned)((entry.identifier >> 8) & 0xFF));
+        char item[BUS_DISCOVERY_MIN_CHUNK];
+        int written = snprintf(item, sizeof(item),
+            "%s{\"pgn\":%u,\"sa\":%u,\"priority\":%u,\"da\":%s,\"frames\":%u,\"periodUs\":%u,\"jitterUs\":%u,"
+            "\"ageMs\":%u,\"dlc\":%u,\"data\":\"%s\",\"handled\":%s}",
+            query.first ? "" : ",", (unsigned)entry.pgn, (unsigned)entry.sourceAddress,
+            (unsigned)((entry.identifier >> 26) & 0x07), destination, (unsigned)entry.frames,
+            (unsigned)entry.periodUs, (unsigned)entry.jitterUs, (unsigned)(query.nowMs - entry.lastSeenMs),
+            (unsigned)entry.dlc, data, entry.handled ? "true" : "false");
+        if (written < 0 || length + written >= size) return length;
+        memcpy(buffer + length, item, written);
+        length += written;
+        query.next++;
+        query.first = false;
+    }
+    return length;
+}
@@ -0,0 +1,213 @@
+/*
+ * @Description: Logger CAN su SD - ring buffer SPSC alimentato dal task CAN e
+ * codifica/scrittura a blocchi nel task di log
+ */
+
+#include "can_log.h"
+#include "config.h"
+
+#include <atomic>
+#include <new>
+#include <stdio.h>
+#include <string.h>
+
+#define CAN_LOG_RING_MASK (CAN_LOG_RING_RECORDS - 1)
+
+static_assert((CAN_LOG_RING_RECORDS & CAN_LOG_RING_MASK) == 0, "CAN_LOG_RING_RECORDS deve essere una potenza di 2");
+static_assert(CAN_LOG_HEADER_SIZE + CAN_LOG_RECORD_MAX <= CAN_LOG_BLOCK_SIZE, "Blocco troppo piccolo");
+
+// Frame come copiato dal task CAN, senza codifica
+struct CanLogRecord {
+    uint32_t timestamp;
+    uint32_t identifier;
+    uint8_t flags;
+    uint8_t data[8];
+};
+
+CanLogStats canLogStats;
+
+// Ring e buffer di scrittura allocati da canLogBegin solo con lo storage
+// montato, mai liberati (il task CAN può essere in canLogRecord durante
+// canLogStop)
+static CanLogRecord *ring = NULL;
+static std::atomic<uint32_t> ringHead(0);  // Scritto solo dal task CAN
+static std::atomic<uint32_t> ringTail(0);  // Scritto solo dal task di log
+static std::atomic<bool> logActive(false);
+
+// Stato del task di log
+static uint8_t *writeBuffer = NULL;
+static uint16_t writeBlocks = 0;    // Blocchi completi in writeBuffer
+static uint16_t blockUsed = 0;      // Byte usati nel blocco corrente (0 = non aperto)
+static uint16_t blockRecords = 0;
+static uint32_t blockSequence = 0;
+static uint32_t lastTimestamp = 0;
+static uint32_t lastWriteMs = 0;
+static uint32_t fileBytes = 0;
+
+static void putLe(uint8_t *out, uint32_t value, uint8_t size) {
+    for (uint8_t i = 0; i < size; i++) {
+        out[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+static bool openNextFile() {
+    char path[32];
+    hal_log_close();
+    for (;;) {
+        snprintf(path, sizeof(path), CAN_LOG_DIRECTORY "/%05u.bin", (unsigned)canLogStats.fileIndex);
+        if (!hal_storage_exists(path)) break;
+        canLogStats.fileIndex++;
+    }
+    fileBytes = 0;
+    if (!hal_log_open(path)) {
+        HAL_LOG("CAN log: cannot create %s\n", path);
+        return false;
+    }
+    HAL_LOG("CAN log: writing %s\n", path);
+    return true;
+}
+
+// Monta lo storage e apre il primo file libero. Senza SD il logger resta
+// disattivato e canLogRecord non costa nulla al task CAN
+bool canLogBegin() {
+    if (!hal_storage_begin() || !hal_storage_mkdir(CAN_LOG_DIRECTORY)) {
+        HAL_LOG("CAN log disabled: no storage\n");
+        return false;
+    }
+    if (ring == NULL) ring = new (std::nothrow) CanLogRecord[CAN_LOG_RING_RECORDS];
+    if (writeBuffer == NULL) writeBuffer = new (std::nothrow) uint8_t[CAN_LOG_WRITE_BLOCKS * CAN_LOG_BLOCK_SIZE];
+    if (ring == NULL || writeBuffer == NULL) {
+        HAL_LOG("CAN log disabled: no memory for the ring\n");
+        return false;
+    }
+    canLogStats.fileIndex = 0;
+    if (!openNextFile()) return false;
+    writeBlocks = 0;
+    blockUsed = 0;
+    blockRecords = 0;
+    lastWriteMs = hal_millis();
+    ringTail.store(ringHead.load(std::memory_order_relaxed), std::memory_order_release);
+    logActive.store(true, std::memory_order_release);
+    return true;
+}
+
+bool canLogActive() {
+    return logActive.load(std::memory_order_relaxed);
+}
+
+// Produttore (task CAN): copia il frame nel ring o lo conta come perso
+void canLogRecord(const twai_message_t &message, uint32_t timestampUs) {
+    if (!logActive.load(std::memory_order_relaxed)) return;
+    uint32_t head = ringHead.load(std::memory_order_relaxed);
+    uint32_t used = head - ringTail.load(std::memory_order_acquire);
+    if (used >= CAN_LOG_RING_RECORDS) {
+        canLogStats.dropped++;
+        return;
+    }
+    if (used + 1 > canLogStats.ringHighWater) canLogStats.ringHighWater = used + 1;
+
+    CanLogRecord &record = ring[head & CAN_LOG_RING_MASK];
+    uint8_t dlc = (message.data_length_code > 8) ? 8 : message.data_length_code;
+    record.timestamp = timestampUs;
+    record.identifier = message.identifier;
+    record.flags = dlc | (message.extd ? CAN_LOG_FLAG_EXTENDED : 0) | (message.rtr ? CAN_LOG_FLAG_RTR : 0);
+    memcpy(record.data, message.data, 8);
+    canLogStats.frames++;
+    ringHead.store(head + 1, std::memory_order_release);
+}
+
+// Scrive i blocchi completi; un errore li scarta per non bloccare il ring
+static void writePending() {
+    if (writeBlocks == 0) return;
+    size_t length = (size_t)writeBlocks * CAN_LOG_BLOCK_SIZE;
+    if (fileBytes + length > CAN_LOG_FILE_MAX_BYTES) {
+        canLogStats.fileIndex++;
+        openNextFile();
+    }
+    if (hal_log_write(writeBuffer, length) == length) {
+        canLogStats.blocks += writeBlocks;
+        fileBytes += length;
+    } else {
+        canLogStats.writeErrors += writeBlocks;
+    }
+    writeBlocks = 0;
+}
+
+// Chiude il blocco corrente: header e padding a zero
+static void closeBlock() {
+    if (blockUsed == 0) return;
+    uint8_t *block = writeBuffer + (size_t)writeBlocks * CAN_LOG_BLOCK_SIZE;
+    putLe(block + 16, blockUsed, 2);
+    putLe(block + 18, blockRecords, 2);
+    memset(block + blockUsed, 0, CAN_LOG_BLOCK_SIZE - blockUsed);
+    blockUsed = 0;
+    writeBlocks++;
+    if (writeBlocks == CAN_LOG_WRITE_BLOCKS) writePending();
+}
+
+static void openBlock(uint32_t timestamp) {
+    uint8_t *block = writeBuffer + (size_t)writeBlocks * CAN_LOG_BLOCK_SIZE;
+    putLe(block, CAN_LOG_MAGIC, 4);
+    putLe(block + 4, blockSequence++, 4);
+    putLe(block + 8, timestamp, 4);
+    putLe(block + 12, canLogStats.dropped, 4);
+    blockUsed = CAN_LOG_HEADER_SIZE;
+    blockRecords = 0;
+    lastTimestamp = timestamp;
+}
+
+static void encodeRecord(const CanLogRecord &record) {
+    uint8_t dlc = record.flags & CAN_LOG_FLAG_DLC;
+    bool extended = record.flags & CAN_LOG_FLAG_EXTENDED;
+    uint8_t size = 1 + (extended ? 4 : 2) + ((record.flags & CAN_LOG_FLAG_RTR) ? 0 : dlc);
+
+    uint32_t delta = record.timestamp - lastTimestamp;
+    uint8_t deltaSize = (delta < 0x100) ? 1 : (delta < 0x10000) ? 2 : (delta < 0x1000000) ? 3 : 4;
+    if (blockUsed != 0 && blockUsed + size + deltaSize > CAN_LOG_BLOCK_SIZE) closeBlock();
+    if (blockUsed == 0) {
+        openBlock(record.timestamp);
+        delta = 0;
+        deltaSize = 1;
+    }
+
+    uint8_t *out = writeBuffer + (size_t)writeBlocks * CAN_LOG_BLOCK_SIZE + blockUsed;
+    *out++ = record.flags | ((deltaSize - 1) << CAN_LOG_DELTA_SHIFT);
+    putLe(out, delta, deltaSize);
+    out += deltaSize;
+    putLe(out, record.identifier, extended ? 4 : 2);
+    out += extended ? 4 : 2;
+    memcpy(out, record.data, size - 1 - (extended ? 4 : 2));
+    blockUsed += size + deltaSize;
+    blockRecords++;
+    lastTimestamp = record.timestamp;
+}
+
+// Consumatore (task di log): svuota il ring e scrive a blocchi interi.
+// Un blocco parziale viene chiuso e scritto dopo CAN_LOG_FLUSH_MS
+void canLogService(uint32_t nowMs) {
+    if (!logActive.load(std::memory_order_acquire)) return;
+
+    uint32_t tail = ringTail.load(std::memory_order_relaxed);
+    uint32_t head = ringHead.load(std::memory_order_acquire);
+    while (tail != head) {
+        encodeRecord(ring[tail & CAN_LOG_RING_MASK]);
+        tail++;
+        ringTail.store(tail, std::memory_order_release);
+    }
+
+    if (nowMs - lastWriteMs >= CAN_LOG_FLUSH_MS) {
+        closeBlock();
+        writePending();
+        lastWriteMs = nowMs;
+    }
+}
+
+// Ferma la registrazione scrivendo quanto è ancora in RAM
+void canLogStop() {
+    if (!logActive.load(std::memory_order_acquire)) return;
+    canLogService(hal_millis());
+    closeBlock();
+    writePending();
+    logActive.store(false, std::memory_order_release);
+    hal_log_close();
+}
@@ -0,0 +1,235 @@
+/*
+ * @Description: Decodifica dei blocchi del logger CAN e formattazione candump/ASC
+ */
+
+#include "can_log_reader.h"
+#include "can_log.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t getLe(const uint8_t *in, uint8_t size) {
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < size; i++) {
+        value |= (uint32_t)in[i] << (8 * i);
+    }
+    return value;
+}
+
+void canLogReaderInit(CanLogReader &reader) {
+    memset(&reader, 0, sizeof(reader));
+}
+
+// Timestamp a 64 bit: micros() gira ogni ~71 minuti
+static uint64_t extendTimestamp(CanLogReader &reader, uint32_t raw) {
+    if (!reader.started) {
+        reader.started = true;
+        reader.timestamp = raw;
+    } else {
+        reader.timestamp += (uint32_t)(raw - reader.lastRaw);
+    }
+    reader.lastRaw = raw;
+    return reader.timestamp;
+}
+
+size_t canLogReadBlock(CanLogReader &reader, const uint8_t *block, CanLogFrameHandler handler, void *ctx) {
+    uint16_t used = (uint16_t)getLe(block + 16, 2);
+    uint16_t count = (uint16_t)getLe(block + 18, 2);
+    if (getLe(block, 4) != CAN_LOG_MAGIC || used < CAN_LOG_HEADER_SIZE || used > CAN_LOG_BLOCK_SIZE) {
+        reader.badBlocks++;
+        return 0;
+    }
+
+    uint32_t sequence = getLe(block + 4, 4);
+    if (reader.started && sequence != reader.sequence) reader.gaps++;
+    reader.sequence = sequence + 1;
+    reader.dropped = getLe(block + 12, 4);
+
+    uint32_t raw = getLe(block + 8, 4);
+    size_t position = CAN_LOG_HEADER_SIZE;
+    size_t frames = 0;
+    while (frames < count && position < used) {
+        uint8_t flags = block[position++];
+        uint8_t deltaSize = (flags >> CAN_LOG_DELTA_SHIFT) + 1;
+        CanLogFrame frame;
+        frame.extended = flags & CAN_LOG_FLAG_EXTENDED;
+        frame.rtr = flags & CAN_LOG_FLAG_RTR;
+        frame.dlc = flags & CAN_LOG_FLAG_DLC;
+        uint8_t idSize = frame.extended ? 4 : 2;
+        uint8_t dataSize = frame.rtr ? 0 : frame.dlc;
+        if (frame.dlc > 8 || position + deltaSize + idSize + dataSize > used) {
+            reader.badBlocks++;
+            break;
+        }
+        raw += getLe(block + position, deltaSize);
+        position += deltaSize;
+        frame.identifier = getLe(block + position, idSize);
+        position += idSize;
+        memset(frame.data, 0, sizeof(frame.data));
+        memcpy(frame.data, block + position, dataSize);
+        position += dataSize;
+        frame.timestamp = extendTimestamp(reader, raw);
+        handler(frame, ctx);
+        frames++;
+    }
+    return frames;
+}
+
+// "(1700000000.123456) can0 18FEF100#0102030405060708"
+size_t canLogFormatCandump(char *line, size_t size, const CanLogFrame &frame, const char *interface) {
+    int length = snprintf(line, size, "(%llu.%06u) %s %0*X#",
+        (unsigned long long)(frame.timestamp / 1000000), (unsigned)(frame.timestamp % 1000000),
+        interface, frame.extended ? 8 : 3, (unsigned)frame.identifier);
+    if (length < 0 || (size_t)length >= size) return 0;
+    if (frame.rtr) {
+        length += snprintf(line + length, size - length, "R");
+    } else {
+        for (uint8_t i = 0; i < frame.dlc && (size_t)length + 2 < size; i++) {
+            length += snprintf(line + length, size - length, "%02X", frame.data[i]);
+        }
+    }
+    return ((size_t)length < size) ? (size_t)length : size - 1;
+}
+
+// "   0.012345 1  18FEF100x       Rx   d 8 01 02 03 04 05 06 07 08"
+size_t canLogFormatAsc(char *line, size_t size, const CanLogFrame &frame, uint64_t startTimestamp, uint8_t channel) {
+    uint64_t relative = frame.timestamp - startTimestamp;
+    char id[16];
+    snprintf(id, sizeof(id), frame.extended ? "%Xx" : "%X", (unsigned)frame.identifier);
+    int length = snprintf(line, size, "%4llu.%06u %u  %-15s Rx   %s %u",
+        (unsigned long long)(relative / 1000000), (unsigned)(relative % 1000000),
+        (unsigned)channel, id, frame.rtr ? "r" : "d", (unsigned)frame.dlc);
+    if (length < 0 || (size_t)length >= size) return 0;
+    if (!frame.rtr) {
+        for (uint8_t i = 0; i < frame.dlc && (size_t)length + 3 < size; i++) {
+            length += snprintf(line + length, size - length, " %02X", frame.data[i]);
+        }
+    }
+    return ((size_t)length < size) ? (size_t)length : size - 1;
+}
+
+// "0.012345,18FEF100,1,0,8,0102030405060708"
+size_t canLogFormatCsv(char *line, size_t size, const CanLogFrame &frame, uint64_t startTimestamp) {
+    uint64_t relative = frame.timestamp - startTimestamp;
+    int length = snprintf(line, size, "%llu.%06u,%0*X,%u,%u,%u,",
+        (unsigned long long)(relative / 1000000), (unsigned)(relative % 1000000),
+        frame.extended ? 8 : 3, (unsigned)frame.identifier, (unsigned)frame.extended, (unsigned)frame.rtr,
+        (unsigned)frame.dlc);
+    if (length < 0 || (size_t)length >= size) return 0;
+    if (!frame.rtr) {
+        for (uint8_t i = 0; i < frame.dlc && (size_t)length + 2 < size; i++) {
+            length += snprintf(line + length, size - length, "%02X", frame.data[i]);
+        }
+    }
+    return ((size_t)length < size) ? (size_t)length : size - 1;
+}
+
+static const char *skipSpaces(const char *p) {
+    while (*p == ' ' || *p == '\t') p++;
+    return p;
+}
+
+static const char *skipToken(const char *p) {
+    while (*p != '\0' && !isspace((unsigned char)*p)) p++;
+    return skipSpaces(p);
+}
+
+// "secondi.frazione" in µs (frazione di lunghezza qualsiasi)
+static const char *parseSeconds(const char *p, uint64_t &micros) {
+    char *end;
+    micros = strtoull(p, &end, 10) * 1000000;
+    if (*end == '.') {
+        uint32_t scale = 100000;
+        for (end++; isdigit((unsigned char)*end); end++) {
+            micros += (*end - '0') * scale;
+            scale /= 10;
+        }
+    }
+    return end;
+}
+
+// Identificatore esadecimale: esteso con 'x' finale (ASC) o oltre 3 cifre
+static const char *parseIdentifier(const char *p, CanLogFrame &frame) {
+    char *end;
+    frame.identifier = strtoul(p, &end, 16);
+    frame.extended = (end - p) > 3 || frame.identifier > 0x7FF;
+    if (*end == 'x') {
+        frame.extended = true;
+        end++;
+    }
+    return (end == p) ? NULL : end;
+}
+
+// Byte separati da spazi ("01 02") o contigui ("0102")
+static uint8_t parseBytes(const char *p, uint8_t *data, uint8_t max) {
+    uint8_t count = 0;
+    while (count < max) {
+        p = skipSpaces(p);
+        if (!isxdigit((unsigned char)p[0]) || !isxdigit((unsigned char)p[1])) break;
+        char hex[3] = { p[0], p[1], '\0' };
+        data[count++] = (uint8_t)strtoul(hex, NULL, 16);
+        p += 2;
+    }
+    return count;
+}
+
+bool canLogParseLine(const char *line, CanLogFrame &frame) {
+    memset(&frame, 0, sizeof(frame));
+    const char *p = skipSpaces(line);
+    
+    if (*p == '(') {
+        // candump -L: (1700000000.123456) can0 18FEF100#0102030405060708
+        p = parseSeconds(p + 1, frame.timestamp);
+        if (*p != ')') return false;
+        p = skipToken(skipSpaces(p + 1));
+        p = parseIdentifier(p, frame);
+        if (p == NULL || *p != '#') return false;
+        p++;
+        if (*p == 'R') {
+            frame.rtr = true;
+            frame.dlc = isdigit((unsigned char)p[1]) ? p[1] - '0' : 0;
+            return true;
+        }
+        frame.dlc = parseBytes(p, frame.data, 8);
+        return true;
+    }
+    
+    if (isdigit((unsigned char)*p)) {
+        // ASC: 0.012345 1  18FEF100x       Rx   d 8 01 02 03 04 05 06 07 08
+        p = skipSpaces(parseSeconds(p, frame.timestamp));
+        if (!isdigit((unsigned char)*p)) return false;  // "date", eventi senza canale
+        p = skipToken(p);
+        p = parseIdentifier(p, frame);
+        if (p == NULL || !isspace((unsigned char)*p)) return false;  // ErrorFrame ecc.
+        p = skipSpaces(p);
+        if (strncmp(p, "Rx", 2) != 0 && strncmp(p, "Tx", 2) != 0) return false;
+        p = skipSpaces(p + 2);
+        if (*p != 'd' && *p != 'r') return false;
+        frame.rtr = (*p == 'r');
+        p = skipSpaces(p + 1);
+        char *end;
+        frame.dlc = (uint8_t)strtoul(p, &end, 10);
+        if (frame.dlc > 8) frame.dlc = 8;
+        if (!frame.rtr && parseBytes(end, frame.data, frame.dlc) != frame.dlc) return false;
+        return true;
+    }
+    
+    // candump: can0  18FEF100   [8]  01 02 03 04 05 06 07 08
+    if (*p == '\0' || *p == '#') return false;
+    p = skipToken(p);
+    p = parseIdentifier(p, frame);
+    if (p == NULL) return false;
+    p = skipSpaces(p);
+    if (*p != '[') return false;
+    char *end;
+    frame.dlc = (uint8_t)strtoul(p + 1, &end, 10);
+    if (*end != ']' || frame.dlc > 8) return false;
+    p = skipSpaces(end + 1);
+    if (strncmp(p, "remote request", 14) == 0) {
+        frame.rtr = true;
+        return true;
+    }
+    return parseBytes(p, frame.data, frame.dlc) == frame.dlc;
+}
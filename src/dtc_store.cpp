@@ -0,0 +1,295 @@
+/*
+ * @Description: Registro dei codici errore J1939 (vedi dtc_store.h)
+ */
+
+#include "dtc_store.h"
+
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+
+#define DTC_NONE            0xFF
+#define DTC_FREE            DTC_LIST_COUNT   // Voce non in uso
+#define DTC_SPN_NONE        0
+#define DTC_SPN_UNAVAILABLE 0x7FFFF
+
+// Tabella hash: potenza di 2 almeno doppia della capacità
+static constexpr uint8_t dtcHashBits(uint32_t capacity) {
+    uint8_t bits = 1;
+    while ((1UL << bits) < 2 * capacity) bits++;
+    return bits;
+}
+
+#define DTC_HASH_BITS dtcHashBits(DTC_STORE_CAPACITY)
+#define DTC_HASH_SIZE (1UL << DTC_HASH_BITS)
+
+struct DtcEntry {
+    DtcRecord record;
+    uint32_t key;        // SA << 24 | SPN << 5 | FMI
+    uint8_t next;        // Voce successiva nella catena hash
+    uint8_t list;        // DtcList o DTC_FREE
+    bool seen;           // Presente nel DM1 in elaborazione
+};
+
+static DtcEntry entries[DTC_STORE_CAPACITY];
+static uint8_t buckets[DTC_HASH_SIZE];
+static uint8_t lists[DTC_LIST_COUNT][DTC_STORE_CAPACITY];
+static uint8_t listCounts[DTC_LIST_COUNT];
+static uint8_t freeEntries[DTC_STORE_CAPACITY];
+static uint8_t freeCount = 0;
+static uint32_t changes = 0;
+static uint32_t dropped = 0;
+
+// Dispari durante una modifica (vedi engine_data.cpp)
+static std::atomic<uint32_t> storeSeq(0);
+
+static inline uint32_t dtcKey(uint8_t sourceAddress, uint32_t spn, uint8_t fmi) {
+    return ((uint32_t)sourceAddress << 24) | (spn << 5) | fmi;
+}
+
+static inline uint32_t dtcHash(uint32_t key) {
+    return (uint32_t)(key * 2654435761U) >> (32 - DTC_HASH_BITS);
+}
+
+static void dtcWriteBegin() {
+    uint32_t seq = storeSeq.load(std::memory_order_relaxed);
+    storeSeq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+static void dtcWriteEnd() {
+    std::atomic_thread_fence(std::memory_order_release);
+    storeSeq.store(storeSeq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+void dtcStoreReset() {
+    dtcWriteBegin();
+    memset(buckets, DTC_NONE, sizeof(buckets));
+    memset(listCounts, 0, sizeof(listCounts));
+    for (uint8_t i = 0; i < DTC_STORE_CAPACITY; i++) {
+        entries[i].list = DTC_FREE;
+        freeEntries[i] = DTC_STORE_CAPACITY - 1 - i;
+    }
+    freeCount = DTC_STORE_CAPACITY;
+    changes++;
+    dropped = 0;
+    dtcWriteEnd();
+}
+
+static uint8_t dtcFind(uint32_t key) {
+    uint8_t index = buckets[dtcHash(key)];
+    while (index != DTC_NONE && entries[index].key != key) index = entries[index].next;
+    return index;
+}
+
+static void dtcListAppend(uint8_t list, uint8_t index) {
+    lists[list][listCounts[list]++] = index;
+    entries[index].list = list;
+    changes++;
+}
+
+static void dtcListRemove(uint8_t index) {
+    uint8_t list = entries[index].list;
+    uint8_t *items = lists[list];
+    uint8_t count = listCounts[list];
+    uint8_t position = 0;
+    while (position < count && items[position] != index) position++;
+    memmove(&items[position], &items[position + 1], count - position - 1);
+    listCounts[list] = count - 1;
+    entries[index].list = DTC_FREE;
+    changes++;
+}
+
+// Voce libera per la chiave; a tabella piena si sacrifica il precedente più
+// vecchio, DTC_NONE se sono tutti attivi
+static uint8_t dtcAllocate(uint32_t key) {
+    uint8_t index;
+    if (freeCount > 0) {
+        index = freeEntries[--freeCount];
+    } else if (listCounts[DTC_LIST_PREVIOUS] > 0) {
+        index = lists[DTC_LIST_PREVIOUS][0];
+        dtcListRemove(index);
+        uint8_t *link = &buckets[dtcHash(entries[index].key)];
+        while (*link != index) link = &entries[*link].next;
+        *link = entries[index].next;
+    } else {
+        dropped++;
+        return DTC_NONE;
+    }
+    DtcEntry &entry = entries[index];
+    uint32_t bucket = dtcHash(key);
+    entry.key = key;
+    entry.next = buckets[bucket];
+    entry.seen = false;
+    buckets[bucket] = index;
+    return index;
+}
+
+// DTC J1939-73: SPN bit 0-15 nei byte 0-1, bit 16-18 nei 3 bit alti del
+// byte 2; FMI nei 5 bit bassi del byte 2; byte 3: CM (bit 7) e OC
+static inline void dtcDecode(const uint8_t *dtc, DtcRecord &record) {
+    record.spn = dtc[0] | ((uint32_t)dtc[1] << 8) | ((uint32_t)(dtc[2] & 0xE0) << 11);
+    record.fmi = dtc[2] & 0x1F;
+    record.conversion = dtc[3] >> 7;
+    record.occurrence = dtc[3] & 0x7F;
+}
+
+static inline bool dtcValid(const DtcRecord &record) {
+    return record.spn != DTC_SPN_NONE && record.spn != DTC_SPN_UNAVAILABLE;
+}
+
+uint8_t dtcStoreActive(uint8_t sourceAddress, const uint8_t *dtcs, uint16_t length, uint32_t nowMs) {
+    dtcWriteBegin();
+    uint8_t valid = 0;
+    for (uint16_t offset = 0; offset + 4 <= length; offset += 4) {
+        DtcRecord decoded;
+        dtcDecode(&dtcs[offset], decoded);
+        if (!dtcValid(decoded)) continue;
+        valid++;
+
+        uint32_t key = dtcKey(sourceAddress, decoded.spn, decoded.fmi);
+        uint8_t index = dtcFind(key);
+        if (index == DTC_NONE) {
+            index = dtcAllocate(key);
+            if (index == DTC_NONE) continue;
+            entries[index].record = decoded;
+            entries[index].record.sourceAddress = sourceAddress;
+            entries[index].record.firstSeenMs = nowMs;
+            dtcListAppend(DTC_LIST_ACTIVE, index);
+        } else if (entries[index].list == DTC_LIST_PREVIOUS) {
+            // Di nuovo attivo: torna in coda agli attivi
+            dtcListRemove(index);
+            dtcListAppend(DTC_LIST_ACTIVE, index);
+        }
+        DtcEntry &entry = entries[index];
+        entry.record.occurrence = decoded.occurrence;
+        entry.record.conversion = decoded.conversion;
+        entry.record.lastSeenMs = nowMs;
+        entry.seen = true;
+    }
+
+    // Attivi della ECU assenti dal DM1: rientrati
+    for (uint8_t position = 0; position < listCounts[DTC_LIST_ACTIVE];) {
+        DtcEntry &entry = entries[lists[DTC_LIST_ACTIVE][position]];
+        if (entry.record.sourceAddress != sourceAddress || entry.seen) {
+            entry.seen = false;
+            position++;
+            continue;
+        }
+        uint8_t index = lists[DTC_LIST_ACTIVE][position];
+        dtcListRemove(index);
+        dtcListAppend(DTC_LIST_PREVIOUS, index);
+    }
+    dtcWriteEnd();
+    return valid;
+}
+
+uint8_t dtcStorePrevious(uint8_t sourceAddress, const uint8_t *dtcs, uint16_t length, uint32_t nowMs) {
+    dtcWriteBegin();
+    uint8_t valid = 0;
+    for (uint16_t offset = 0; offset + 4 <= length; offset += 4) {
+        DtcRecord decoded;
+        dtcDecode(&dtcs[offset], decoded);
+        if (!dtcValid(decoded)) continue;
+        valid++;
+
+        uint32_t key = dtcKey(sourceAddress, decoded.spn, decoded.fmi);
+        uint8_t index = dtcFind(key);
+        if (index == DTC_NONE) {
+            // Mai visto attivo: noto solo dal DM2
+            index = dtcAllocate(key);
+            if (index == DTC_NONE) continue;
+            entries[index].record = decoded;
+            entries[index].record.sourceAddress = sourceAddress;
+            entries[index].record.firstSeenMs = nowMs;
+            entries[index].record.lastSeenMs = nowMs;
+            dtcListAppend(DTC_LIST_PREVIOUS, index);
+            continue;
+        }
+        entries[index].record.occurrence = decoded.occurrence;
+        entries[index].record.conversion = decoded.conversion;
+        entries[index].record.lastSeenMs = nowMs;
+    }
+    dtcWriteEnd();
+    return valid;
+}
+
+uint8_t dtcStoreRead(uint8_t list, uint8_t first, DtcRecord *records, uint8_t max, DtcStoreInfo &info) {
+    uint32_t before;
+    uint32_t after;
+    uint8_t copied;
+    do {
+        before = storeSeq.load(std::memory_order_acquire);
+        for (uint8_t i = 0; i < DTC_LIST_COUNT; i++) info.count[i] = listCounts[i];
+        info.changes = changes;
+        info.dropped = dropped;
+        copied = 0;
+        uint8_t count = (list < DTC_LIST_COUNT) ? info.count[list] : 0;
+        if (count > DTC_STORE_CAPACITY) count = DTC_STORE_CAPACITY;
+        for (uint16_t position = first; position < count && copied < max; position++) {
+            // Indice letto durante una modifica: scartato dalla verifica
+            uint8_t index = lists[list][position];
+            if (index < DTC_STORE_CAPACITY) records[copied++] = entries[index].record;
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = storeSeq.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+    return copied;
+}
+
+void dtcQueryBegin(DtcQuery &query, uint16_t sourceAddress) {
+    query.sourceAddress = sourceAddress;
+    query.list = DTC_LIST_ACTIVE;
+    query.next = 0;
+    query.stage = 0;
+    query.first = true;
+}
+
+size_t dtcQueryRead(DtcQuery &query, char *buffer, size_t size) {
+    static const char *const LIST_NAMES[DTC_LIST_COUNT] = { "active", "previous" };
+    size_t length = 0;
+    DtcStoreInfo info;
+    if (query.stage == 0) {
+        dtcStoreRead(DTC_LIST_ACTIVE, 0, NULL, 0, info);
+        int written = snprintf(buffer, size, "{\"changes\":%u,\"dropped\":%u,\"active\":[",
+                               (unsigned)info.changes, (unsigned)info.dropped);
+        if (written < 0 || (size_t)written >= size) return 0;
+        length = written;
+        query.stage = 1;
+    }
+    while (query.stage == 1) {
+        // Un record alla volta: le liste possono cambiare tra due pezzi
+        DtcRecord record;
+        char item[160];
+        int written;
+        if (dtcStoreRead(query.list, query.next, &record, 1, info) == 0) {
+            if (query.list + 1 < DTC_LIST_COUNT) {
+                written = snprintf(item, sizeof(item), "],\"%s\":[", LIST_NAMES[query.list + 1]);
+            } else {
+                written = snprintf(item, sizeof(item), "]}");
+            }
+            if (length + written >= size) return length;
+            memcpy(buffer + length, item, written);
+            length += written;
+            query.next = 0;
+            query.first = true;
+            if (++query.list == DTC_LIST_COUNT) query.stage = 2;
+            continue;
+        }
+        if (query.sourceAddress != DTC_QUERY_ALL && record.sourceAddress != query.sourceAddress) {
+            query.next++;
+            continue;
+        }
+        written = snprintf(item, sizeof(item),
+            "%s{\"sa\":%u,\"spn\":%u,\"fmi\":%u,\"oc\":%u,\"cm\":%u,\"firstSeenMs\":%u,\"lastSeenMs\":%u}",
+            query.first ? "" : ",", (unsigned)record.sourceAddress, (unsigned)record.spn,
+            (unsigned)record.fmi, (unsigned)record.occurrence, (unsigned)record.conversion,
+            (unsigned)record.firstSeenMs, (unsigned)record.lastSeenMs);
+        if (length + written >= size) return length;
+        memcpy(buffer + length, item, written);
+        length += written;
+        query.next++;
+        query.first = false;
+    }
+    return length;
+}
@@ -0,0 +1,147 @@
+/*
+ * @Description: Modello dati motore - data set per indirizzo sorgente,
+ * copie pubblicate con seqlock. Un solo scrittore (task CAN) e più lettori
+ * (Modbus, web): il contatore di sequenza dello slot è dispari durante la
+ * copia, il lettore ripete se lo ha visto dispari o cambiato.
+ */
+
+#include "engine_data.h"
+#include "j1939_spn.h"
+
+#include <atomic>
+#include <string.h>
+
+static const char *const FIELD_NAMES[FIELD_COUNT] = {
+    "rpm",
+    "engineTemp",
+    "oilPressure",
+    "fuelRate",
+    "engineHours",
+    "coolantTemp",
+    "intakeTemp",
+    "exhaustTemp",
+    "engineLoad",
+    "throttlePos",
+    "engineTorque",
+    "batteryVoltage",
+};
+
+// Data set per slot
+EngineData engineDataSets[ENGINE_DATA_MAX_SOURCES];
+
+// SA -> slot + 1 (0 = nessuno slot): una lettura per frame, 256 byte
+static uint8_t sourceSlots[256];
+static uint8_t slotSources[ENGINE_DATA_MAX_SOURCES];
+static std::atomic<uint8_t> sourceCount(0);
+static uint32_t dirtySlots = 0;
+
+static EngineData publishedData[ENGINE_DATA_MAX_SOURCES];
+static std::atomic<uint32_t> publishedSeq[ENGINE_DATA_MAX_SOURCES];
+static std::atomic<uint32_t> publishedVersion(0);
+
+EngineData *engineDataForSource(uint8_t sourceAddress) {
+    uint8_t slot = sourceSlots[sourceAddress];
+    if (slot == 0) {
+        // Nuova ECU: assegna lo slot successivo
+        uint8_t count = sourceCount.load(std::memory_order_relaxed);
+        if (count >= ENGINE_DATA_MAX_SOURCES) return NULL;
+        memset(&engineDataSets[count], 0, sizeof(EngineData));
+        engineDataSets[count].sourceAddress = sourceAddress;
+        sourceSlots[sourceAddress] = count + 1;
+        slotSources[count] = sourceAddress;
+        slot = count + 1;
+        
+        // Lo slot diventa visibile ai lettori solo dopo la prima pubblicazione
+        dirtySlots |= 1UL << count;
+        engineDataPublish();
+        sourceCount.store(count + 1, std::memory_order_release);
+    }
+    dirtySlots |= 1UL << (slot - 1);
+    return &engineDataSets[slot - 1];
+}
+
+void engineDataTouch(uint8_t slot) {
+    dirtySlots |= 1UL << slot;
+}
+
+uint8_t engineDataSourceCount() {
+    return sourceCount.load(std::memory_order_acquire);
+}
+
+uint8_t engineDataSourceAddress(uint8_t slot) {
+    return slotSources[slot];
+}
+
+// Ordine stabile tra riavvii (non dipende da quale ECU si è presentata prima),
+// usato per numerare banchi Modbus e data set esposti
+uint8_t engineDataSlotsBySource(uint8_t *slots) {
+    uint8_t count = engineDataSourceCount();
+    for (uint8_t slot = 0; slot < count; slot++) {
+        uint8_t i = slot;
+        for (; i > 0 && slotSources[slots[i - 1]] > slotSources[slot]; i--) {
+            slots[i] = slots[i - 1];
+        }
+        slots[i] = slot;
+    }
+    return count;
+}
+
+void engineDataPublish() {
+    uint32_t pending = dirtySlots;
+    dirtySlots = 0;
+    while (pending) {
+        uint8_t slot = __builtin_ctz(pending);
+        pending &= pending - 1;
+        
+        uint32_t seq = publishedSeq[slot].load(std::memory_order_relaxed);
+        publishedSeq[slot].store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(&publishedData[slot], &engineDataSets[slot], sizeof(EngineData));
+        std::atomic_thread_fence(std::memory_order_release);
+        publishedSeq[slot].store(seq + 2, std::memory_order_relaxed);
+        publishedVersion.fetch_add(1, std::memory_order_release);
+    }
+}
+
+void engineDataRead(uint8_t slot, EngineData &snapshot) {
+    uint32_t before;
+    uint32_t after;
+    do {
+        before = publishedSeq[slot].load(std::memory_order_acquire);
+        memcpy(&snapshot, &publishedData[slot], sizeof(EngineData));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = publishedSeq[slot].load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+}
+
+uint32_t engineDataVersion() {
+    return publishedVersion.load(std::memory_order_acquire);
+}
+
+uint32_t engineDataVersion(uint8_t slot) {
+    return publishedSeq[slot].load(std::memory_order_acquire);
+}
+
+const char *engineFieldName(EngineField field) {
+    return (field < FIELD_COUNT) ? FIELD_NAMES[field] : "";
+}
+
+int engineFieldIndex(const char *name) {
+    for (uint8_t field = 0; field < FIELD_COUNT; field++) {
+        if (strcmp(name, FIELD_NAMES[field]) == 0) return field;
+    }
+    return -1;
+}
+
+int64_t engineFieldValue(const EngineData &data, EngineField field) {
+    const uint8_t *base = reinterpret_cast<const uint8_t *>(&data) + FIELD_LAYOUT[field].offset;
+    bool isSigned = ENGINE_SIGNED_FIELDS & FIELD_BIT(field);
+    if (FIELD_LAYOUT[field].size == 4) {
+        uint32_t value;
+        memcpy(&value, base, 4);
+        return isSigned ? (int64_t)(int32_t)value : (int64_t)value;
+    }
+    uint16_t value;
+    memcpy(&value, base, 2);
+    return isSigned ? (int64_t)(int16_t)value : (int64_t)value;
+}
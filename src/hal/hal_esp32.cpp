@@ -0,0 +1,320 @@
+/*
+ * @Description: HAL per ESP32 - TWAI, UART1 (RS485), clock Arduino e SD su SPI
+ */
+
+#include "hal.h"
+#include "config.h"
+
+#include "driver/uart.h"
+#include "esp_timer.h"
+#include <SD.h>
+#include <SPI.h>
+
+#define MODBUS_UART_NUM     UART_NUM_1
+#define MODBUS_UART_BUFFER  512
+#define MODBUS_UART_EVENTS  16
+
+// Inizializza driver TWAI (250 kbps, J1939)
+bool hal_can_begin(uint32_t acceptanceCode, uint32_t acceptanceMask, bool singleFilter) {
+    twai_general_config_t g_config = TWAI_GENERAL_CONFIG_DEFAULT((gpio_num_t)CAN_TX, (gpio_num_t)CAN_RX, TWAI_MODE_NORMAL);
+    g_config.rx_queue_len = CAN_RX_QUEUE_LEN;
+    twai_timing_config_t t_config = TWAI_TIMING_CONFIG_250KBITS();
+
+    // Filtra solo PGN di interesse
+    twai_filter_config_t f_config = {
+        .acceptance_code = acceptanceCode,
+        .acceptance_mask = acceptanceMask,
+        .single_filter = singleFilter
+    };
+
+    // Installa driver TWAI
+    if (twai_driver_install(&g_config, &t_config, &f_config) == ESP_OK) {
+        Serial.println("CAN driver installed");
+    } else {
+        Serial.println("Failed to install CAN driver");
+        return false;
+    }
+
+    // Avvia driver (rimosso se non parte: si può ripetere hal_can_begin)
+    if (twai_start() == ESP_OK) {
+        Serial.println("CAN driver started");
+    } else {
+        Serial.println("Failed to start CAN driver");
+        twai_driver_uninstall();
+        return false;
+    }
+
+    // Configura alert (la ricezione usa twai_receive bloccante, non l'alert RX_DATA)
+    uint32_t alerts_to_enable = TWAI_ALERT_BUS_ERROR | TWAI_ALERT_ERR_PASS |
+                                TWAI_ALERT_TX_FAILED | TWAI_ALERT_RX_QUEUE_FULL;
+    twai_reconfigure_alerts(alerts_to_enable, NULL);
+    return true;
+}
+
+// Il filtro TWAI si imposta solo all'installazione: driver fermato,
+// rimosso e reinstallato (frame in coda persi, alert riconfigurati). Con
+// driver già rimosso da un tentativo fallito si reinstalla soltanto
+bool hal_can_set_filter(uint32_t acceptanceCode, uint32_t acceptanceMask, bool singleFilter) {
+    twai_status_info_t status;
+    if (twai_get_status_info(&status) == ESP_OK) {
+        // Fermo in bus-off o dopo uno stop: si rimuove senza twai_stop
+        bool running = status.state == TWAI_STATE_RUNNING;
+        if (running && twai_stop() != ESP_OK) {
+            Serial.println("Failed to stop CAN driver");
+            return false;
+        }
+        if (twai_driver_uninstall() != ESP_OK) {
+            Serial.println("Failed to uninstall CAN driver");
+            if (running) twai_start();
+            return false;
+        }
+    }
+    return hal_can_begin(acceptanceCode, acceptanceMask, singleFilter);
+}
+
+uint32_t hal_can_read_alerts(uint32_t timeoutMs) {
+    uint32_t alerts_triggered = 0;
+    if (twai_read_alerts(&alerts_triggered, pdMS_TO_TICKS(timeoutMs)) != ESP_OK) {
+        return 0;
+    }
+    return alerts_triggered;
+}
+
+bool hal_can_receive(twai_message_t *message, uint32_t timeoutMs) {
+    esp_err_t result = twai_receive(message, pdMS_TO_TICKS(timeoutMs));
+    // Driver rimosso: twai_receive torna subito, il task CAN non deve girare a vuoto
+    if (result == ESP_ERR_INVALID_STATE && timeoutMs > 0) vTaskDelay(pdMS_TO_TICKS(timeoutMs));
+    return result == ESP_OK;
+}
+
+bool hal_can_transmit(const twai_message_t *message, uint32_t timeoutMs) {
+    return twai_transmit(message, pdMS_TO_TICKS(timeoutMs)) == ESP_OK;
+}
+
+uint32_t hal_can_bus_error_count() {
+    twai_status_info_t status;
+    if (twai_get_status_info(&status) != ESP_OK) return 0;
+    return status.bus_error_count;
+}
+
+uint32_t hal_can_rx_missed() {
+    twai_status_info_t status;
+    if (twai_get_status_info(&status) != ESP_OK) return 0;
+    return status.rx_missed_count + status.rx_overrun_count;
+}
+
+// Il controller TWAI non conta i frame scartati dal filtro di accettazione
+uint32_t hal_can_filter_rejected() {
+    return 0;
+}
+
+// Modbus RTU slave su UART1 in modalità RS485 half-duplex: RTS (RS485_EN)
+// pilota il driver del transceiver, il timeout RX della UART segnala T3.5
+static QueueHandle_t uartQueue = NULL;
+
+void hal_uart_begin(uint32_t baudrate) {
+    if (uartQueue != NULL) {
+        uart_driver_delete(MODBUS_UART_NUM);
+        uartQueue = NULL;
+    }
+    
+    uart_config_t uart_config = {};
+    uart_config.baud_rate = (int)baudrate;
+    uart_config.data_bits = UART_DATA_8_BITS;
+    uart_config.parity = UART_PARITY_DISABLE;
+    uart_config.stop_bits = UART_STOP_BITS_1;
+    uart_config.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+    uart_config.source_clk = UART_SCLK_APB;
+    
+    uart_driver_install(MODBUS_UART_NUM, MODBUS_UART_BUFFER, MODBUS_UART_BUFFER,
+                        MODBUS_UART_EVENTS, &uartQueue, 0);
+    uart_param_config(MODBUS_UART_NUM, &uart_config);
+    uart_set_pin(MODBUS_UART_NUM, RS485_TX, RS485_RX, RS485_EN, UART_PIN_NO_CHANGE);
+    uart_set_mode(MODBUS_UART_NUM, UART_MODE_RS485_HALF_DUPLEX);
+    uart_set_rx_timeout(MODBUS_UART_NUM, MODBUS_RX_TIMEOUT_CHARS);
+}
+
+// La risposta già accodata esce al baudrate vecchio: attesa fine trasmissione
+void hal_uart_set_baudrate(uint32_t baudrate) {
+    if (uartQueue == NULL) return;
+    uart_wait_tx_done(MODBUS_UART_NUM, portMAX_DELAY);
+    uart_set_baudrate(MODBUS_UART_NUM, baudrate);
+}
+
+size_t hal_uart_receive(uint8_t *data, size_t maxLength, uint32_t timeoutMs, bool *frameEnd) {
+    uart_event_t event;
+    *frameEnd = false;
+    if (uartQueue == NULL || xQueueReceive(uartQueue, &event, pdMS_TO_TICKS(timeoutMs)) != pdTRUE) {
+        return 0;
+    }
+    
+    switch (event.type) {
+        case UART_DATA: {
+            size_t length = (event.size < maxLength) ? event.size : maxLength;
+            int read = uart_read_bytes(MODBUS_UART_NUM, data, length, 0);
+            if (event.size > length) {
+                // Frame oltre la dimensione massima: scarta il resto
+                uint8_t discard[64];
+                size_t remaining = event.size - length;
+                while (remaining > 0) {
+                    size_t chunk = (remaining < sizeof(discard)) ? remaining : sizeof(discard);
+                    uart_read_bytes(MODBUS_UART_NUM, discard, chunk, 0);
+                    remaining -= chunk;
+                }
+            }
+            *frameEnd = event.timeout_flag;
+            return (read > 0) ? (size_t)read : 0;
+        }
+        
+        case UART_FIFO_OVF:
+        case UART_BUFFER_FULL:
+            // Overflow: il frame in corso è perso
+            uart_flush_input(MODBUS_UART_NUM);
+            xQueueReset(uartQueue);
+            *frameEnd = true;
+            return 0;
+        
+        default:
+            return 0;
+    }
+}
+
+size_t hal_uart_write(const uint8_t *data, size_t length) {
+    int written = uart_write_bytes(MODBUS_UART_NUM, (const char *)data, length);
+    return (written > 0) ? (size_t)written : 0;
+}
+
+uint32_t hal_millis() {
+    return millis();
+}
+
+uint32_t hal_micros() {
+    return micros();
+}
+
+uint32_t hal_cycles() {
+    return ESP.getCycleCount();
+}
+
+uint32_t hal_cycles_per_us() {
+    return ESP.getCpuFreqMHz();
+}
+
+// Tick: esp_timer periodico (timer hardware a 64 bit), la callback nel task
+// di dispatch di esp_timer sblocca il task in attesa con un semaforo binario
+static esp_timer_handle_t tickTimer = NULL;
+static SemaphoreHandle_t tickSemaphore = NULL;
+
+static void tickCallback(void *arg) {
+    xSemaphoreGive(tickSemaphore);
+}
+
+bool hal_tick_begin(uint32_t periodUs) {
+    if (tickTimer != NULL) return false;
+    tickSemaphore = xSemaphoreCreateBinary();
+    if (tickSemaphore == NULL) return false;
+    esp_timer_create_args_t args = {};
+    args.callback = tickCallback;
+    args.name = "tick";
+    if (esp_timer_create(&args, &tickTimer) != ESP_OK) return false;
+    return esp_timer_start_periodic(tickTimer, periodUs) == ESP_OK;
+}
+
+bool hal_tick_wait(uint32_t timeoutMs) {
+    return tickSemaphore != NULL && xSemaphoreTake(tickSemaphore, pdMS_TO_TICKS(timeoutMs)) == pdTRUE;
+}
+
+// Su ESP-IDF lo stack è in byte (StackType_t a 8 bit)
+uint32_t hal_task_stack_free(void *task) {
+    return (task != NULL) ? uxTaskGetStackHighWaterMark((TaskHandle_t)task) : 0;
+}
+
+// SD su bus SPI dedicato (HSPI), pin da config.h
+static SPIClass sdSpi(HSPI);
+static File logFile;
+
+static void storagePath(char *full, size_t size, const char *path) {
+    snprintf(full, size, "/%s", path);
+}
+
+bool hal_storage_begin() {
+    sdSpi.begin(SD_SCLK, SD_MISO, SD_MOSI, SD_CS);
+    if (!SD.begin(SD_CS, sdSpi, SD_SPI_FREQUENCY)) {
+        Serial.println("SD card not found");
+        return false;
+    }
+    Serial.printf("SD card: %llu MB\n", SD.cardSize() / (1024 * 1024));
+    return true;
+}
+
+bool hal_storage_exists(const char *path) {
+    char full[64];
+    storagePath(full, sizeof(full), path);
+    return SD.exists(full);
+}
+
+bool hal_storage_mkdir(const char *path) {
+    char full[64];
+    storagePath(full, sizeof(full), path);
+    return SD.exists(full) || SD.mkdir(full);
+}
+
+bool hal_log_open(const char *path) {
+    char full[64];
+    storagePath(full, sizeof(full), path);
+    if (logFile) logFile.close();
+    logFile = SD.open(full, FILE_WRITE);
+    return (bool)logFile;
+}
+
+size_t hal_log_write(const uint8_t *data, size_t length) {
+    if (!logFile) return 0;
+    size_t written = logFile.write(data, length);
+    logFile.flush();
+    return written;
+}
+
+void hal_log_close() {
+    if (logFile) logFile.close();
+}
+
+void *hal_file_open(const char *path) {
+    char full[64];
+    storagePath(full, sizeof(full), path);
+    File file = SD.open(full, FILE_READ);
+    if (!file || file.isDirectory()) return NULL;
+    return new File(file);
+}
+
+uint32_t hal_file_size(void *file) {
+    return ((File *)file)->size();
+}
+
+bool hal_file_seek(void *file, uint32_t offset) {
+    return ((File *)file)->seek(offset);
+}
+
+size_t hal_file_read(void *file, uint8_t *data, size_t length) {
+    int read = ((File *)file)->read(data, length);
+    return (read > 0) ? (size_t)read : 0;
+}
+
+void hal_file_close(void *file) {
+    File *handle = (File *)file;
+    handle->close();
+    delete handle;
+}
+
+bool hal_storage_size(const char *path, uint32_t *size) {
+    char full[64];
+    storagePath(full, sizeof(full), path);
+    File file = SD.open(full, FILE_READ);
+    if (!file) return false;
+    if (file.isDirectory()) {
+        file.close();
+        return false;
+    }
+    *size = file.size();
+    file.close();
+    return true;
+}
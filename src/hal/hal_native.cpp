@@ -0,0 +1,352 @@
+/*
+ * @Description: HAL host (env:native) - bus CAN e linea RS485 virtuali in
+ * memoria, storage dei log in una directory locale.
+ * Il simulatore inietta frame/byte dal lato "bus" e il gateway li consuma
+ * tramite le stesse API usate su ESP32.
+ */
+
+#include "hal.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <sys/stat.h>
+
+#define NATIVE_CAN_QUEUE_LEN   256
+#define NATIVE_CAN_TX_QUEUE_LEN 64
+#define NATIVE_UART_BUFFER_LEN 1024
+
+static twai_message_t canQueue[NATIVE_CAN_QUEUE_LEN];
+static uint32_t canHead = 0;
+static uint32_t canTail = 0;
+
+// Frame trasmessi dal gateway, letti dal simulatore, e alert in attesa
+static twai_message_t canTxQueue[NATIVE_CAN_TX_QUEUE_LEN];
+static uint32_t canTxHead = 0;
+static uint32_t canTxTail = 0;
+static uint32_t canAlerts = 0;
+
+// Filtro di accettazione emulato con la semantica TWAI (bit di maschera a 1 = indifferente)
+static uint32_t filterCode = 0;
+static uint32_t filterMask = 0xFFFFFFFF;
+static bool filterSingle = true;
+static uint32_t filterRejected = 0;
+static uint32_t canMissed = 0;
+
+// Driver rimosso dopo un'installazione fallita (hal_native_can_fail)
+static bool canInstalled = true;
+static uint8_t canFailures = 0;
+
+// Ring buffer di byte per una direzione della linea RS485
+struct ByteRing {
+    uint8_t data[NATIVE_UART_BUFFER_LEN];
+    uint32_t head;
+    uint32_t tail;
+};
+
+static ByteRing uartRx;  // master -> gateway
+static ByteRing uartTx;  // gateway -> master
+
+// Fine dei frame iniettati (posizioni in uartRx): emulano il silenzio T3.5
+#define NATIVE_UART_MAX_GAPS 64
+static uint32_t uartGaps[NATIVE_UART_MAX_GAPS];
+static uint32_t gapHead = 0;
+static uint32_t gapTail = 0;
+
+static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+static bool ringPush(ByteRing &ring, uint8_t value) {
+    if (ring.head - ring.tail >= NATIVE_UART_BUFFER_LEN) return false;
+    ring.data[ring.head++ % NATIVE_UART_BUFFER_LEN] = value;
+    return true;
+}
+
+// Installazione fallita richiesta dal simulatore: driver rimosso
+static bool canInstallFails() {
+    if (canFailures == 0) {
+        canInstalled = true;
+        return false;
+    }
+    canFailures--;
+    canInstalled = false;
+    return true;
+}
+
+bool hal_can_begin(uint32_t acceptanceCode, uint32_t acceptanceMask, bool singleFilter) {
+    if (canInstallFails()) return false;
+    canHead = canTail = 0;
+    canTxHead = canTxTail = 0;
+    canAlerts = 0;
+    filterCode = acceptanceCode;
+    filterMask = acceptanceMask;
+    filterSingle = singleFilter;
+    filterRejected = 0;
+    canMissed = 0;
+    return true;
+}
+
+bool hal_can_set_filter(uint32_t acceptanceCode, uint32_t acceptanceMask, bool singleFilter) {
+    if (canInstallFails()) return false;
+    canHead = canTail = 0;
+    filterCode = acceptanceCode;
+    filterMask = acceptanceMask;
+    filterSingle = singleFilter;
+    return true;
+}
+
+// Confronto del filtro per frame estesi: singolo su ID[28:0] + RTR,
+// doppio su ID[28:13] per ciascuna metà
+static bool filterAccepts(const twai_message_t &message) {
+    if (filterSingle) {
+        uint32_t value = (message.identifier << 3) | (message.rtr << 2);
+        return ((value ^ filterCode) & ~filterMask) == 0;
+    }
+    uint32_t value = (message.identifier >> 13) & 0xFFFF;
+    bool first = ((value ^ (filterCode >> 16)) & ~(filterMask >> 16) & 0xFFFF) == 0;
+    bool second = ((value ^ filterCode) & ~filterMask & 0xFFFF) == 0;
+    return first || second;
+}
+
+uint32_t hal_can_read_alerts(uint32_t timeoutMs) {
+    (void)timeoutMs;
+    uint32_t alerts = canAlerts;
+    canAlerts = 0;
+    return alerts;
+}
+
+bool hal_can_receive(twai_message_t *message, uint32_t timeoutMs) {
+    (void)timeoutMs;
+    if (!canInstalled || canHead == canTail) return false;
+    *message = canQueue[canTail++ % NATIVE_CAN_QUEUE_LEN];
+    return true;
+}
+
+bool hal_can_transmit(const twai_message_t *message, uint32_t timeoutMs) {
+    (void)timeoutMs;
+    if (!canInstalled || canTxHead - canTxTail >= NATIVE_CAN_TX_QUEUE_LEN) return false;
+    canTxQueue[canTxHead++ % NATIVE_CAN_TX_QUEUE_LEN] = *message;
+    return true;
+}
+
+uint32_t hal_can_bus_error_count() {
+    return 0;
+}
+
+uint32_t hal_can_rx_missed() {
+    return canMissed;
+}
+
+uint32_t hal_can_filter_rejected() {
+    return filterRejected;
+}
+
+static uint32_t uartBaudrate = 0;
+
+void hal_uart_begin(uint32_t baudrate) {
+    uartBaudrate = baudrate;
+    uartRx.head = uartRx.tail = 0;
+    uartTx.head = uartTx.tail = 0;
+    gapHead = gapTail = 0;
+}
+
+void hal_uart_set_baudrate(uint32_t baudrate) {
+    uartBaudrate = baudrate;
+}
+
+size_t hal_uart_receive(uint8_t *data, size_t maxLength, uint32_t timeoutMs, bool *frameEnd) {
+    (void)timeoutMs;
+    *frameEnd = false;
+    
+    // Byte fino al prossimo silenzio T3.5
+    uint32_t end = (gapHead != gapTail) ? uartGaps[gapTail % NATIVE_UART_MAX_GAPS] : uartRx.head;
+    size_t count = 0;
+    while (count < maxLength && uartRx.tail != end) {
+        data[count++] = uartRx.data[uartRx.tail++ % NATIVE_UART_BUFFER_LEN];
+    }
+    if (gapHead != gapTail && uartRx.tail == end) {
+        gapTail++;
+        *frameEnd = true;
+    }
+    return count;
+}
+
+size_t hal_uart_write(const uint8_t *data, size_t length) {
+    size_t written = 0;
+    while (written < length && ringPush(uartTx, data[written])) {
+        written++;
+    }
+    return written;
+}
+
+uint32_t hal_millis() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - startTime).count();
+}
+
+uint32_t hal_micros() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - startTime).count();
+}
+
+uint32_t hal_cycles() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - startTime).count();
+}
+
+uint32_t hal_cycles_per_us() {
+    return 1000;
+}
+
+// Tick in tempo reale con sleep_until: il simulatore chiama di norma lo
+// scheduler con un orologio proprio
+static uint32_t tickPeriodUs = 0;
+static std::chrono::steady_clock::time_point nextTick;
+
+bool hal_tick_begin(uint32_t periodUs) {
+    tickPeriodUs = periodUs;
+    nextTick = std::chrono::steady_clock::now() + std::chrono::microseconds(periodUs);
+    return true;
+}
+
+bool hal_tick_wait(uint32_t timeoutMs) {
+    if (tickPeriodUs == 0) return false;
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (nextTick - now > std::chrono::milliseconds(timeoutMs)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+        return false;
+    }
+    std::this_thread::sleep_until(nextTick);
+    // Tick scaduti nel frattempo: uno solo
+    now = std::chrono::steady_clock::now();
+    while (nextTick <= now) nextTick += std::chrono::microseconds(tickPeriodUs);
+    return true;
+}
+
+uint32_t hal_task_stack_free(void *task) {
+    (void)task;
+    return 0;
+}
+
+bool hal_native_can_inject(const twai_message_t &message) {
+    if (!canInstalled) return false;  // Nessun driver: frame perso
+    if (message.extd && !filterAccepts(message)) {
+        filterRejected++;
+        return true;  // Scartato dal filtro, come sul bus reale
+    }
+    if (canHead - canTail >= NATIVE_CAN_QUEUE_LEN) {
+        canMissed++;
+        canAlerts |= TWAI_ALERT_RX_QUEUE_FULL;
+        return false;  // RX queue piena
+    }
+    canQueue[canHead++ % NATIVE_CAN_QUEUE_LEN] = message;
+    return true;
+}
+
+bool hal_native_can_take(twai_message_t *message) {
+    if (canTxHead == canTxTail) return false;
+    *message = canTxQueue[canTxTail++ % NATIVE_CAN_TX_QUEUE_LEN];
+    return true;
+}
+
+void hal_native_can_alert(uint32_t alerts) {
+    canAlerts |= alerts;
+}
+
+void hal_native_can_fail(uint8_t count) {
+    canFailures = count;
+}
+
+void hal_native_uart_inject(const uint8_t *data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        if (!ringPush(uartRx, data[i])) break;
+    }
+    // Ogni chiamata è un frame seguito da un silenzio sulla linea
+    if (gapHead - gapTail < NATIVE_UART_MAX_GAPS) {
+        uartGaps[gapHead++ % NATIVE_UART_MAX_GAPS] = uartRx.head;
+    }
+}
+
+uint32_t hal_native_uart_baudrate() {
+    return uartBaudrate;
+}
+
+size_t hal_native_uart_take(uint8_t *data, size_t maxLength) {
+    size_t count = 0;
+    while (count < maxLength && uartTx.head != uartTx.tail) {
+        data[count++] = uartTx.data[uartTx.tail++ % NATIVE_UART_BUFFER_LEN];
+    }
+    return count;
+}
+
+// Storage: file sotto una directory locale scelta dal simulatore
+static std::string storageRoot = ".";
+static FILE *logFile = NULL;
+
+static std::string storagePath(const char *path) {
+    return storageRoot + "/" + path;
+}
+
+void hal_native_storage_root(const char *path) {
+    storageRoot = path;
+    mkdir(path, 0755);
+}
+
+bool hal_storage_begin() {
+    struct stat info;
+    return stat(storageRoot.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+bool hal_storage_exists(const char *path) {
+    struct stat info;
+    return stat(storagePath(path).c_str(), &info) == 0;
+}
+
+bool hal_storage_mkdir(const char *path) {
+    return mkdir(storagePath(path).c_str(), 0755) == 0 || hal_storage_exists(path);
+}
+
+bool hal_log_open(const char *path) {
+    if (logFile != NULL) fclose(logFile);
+    logFile = fopen(storagePath(path).c_str(), "wb");
+    return logFile != NULL;
+}
+
+size_t hal_log_write(const uint8_t *data, size_t length) {
+    if (logFile == NULL) return 0;
+    size_t written = fwrite(data, 1, length, logFile);
+    fflush(logFile);
+    return written;
+}
+
+void hal_log_close() {
+    if (logFile != NULL) fclose(logFile);
+    logFile = NULL;
+}
+
+void *hal_file_open(const char *path) {
+    return fopen(storagePath(path).c_str(), "rb");
+}
+
+uint32_t hal_file_size(void *file) {
+    struct stat info;
+    return (fstat(fileno((FILE *)file), &info) == 0) ? (uint32_t)info.st_size : 0;
+}
+
+bool hal_file_seek(void *file, uint32_t offset) {
+    return fseek((FILE *)file, offset, SEEK_SET) == 0;
+}
+
+size_t hal_file_read(void *file, uint8_t *data, size_t length) {
+    return fread(data, 1, length, (FILE *)file);
+}
+
+void hal_file_close(void *file) {
+    fclose((FILE *)file);
+}
+
+bool hal_storage_size(const char *path, uint32_t *size) {
+    struct stat info;
+    if (stat(storagePath(path).c_str(), &info) != 0 || !S_ISREG(info.st_mode)) return false;
+    *size = info.st_size;
+    return true;
+}
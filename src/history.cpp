@@ -0,0 +1,255 @@
+/*
+ * @Description: Storico multi-risoluzione dei segnali (vedi history.h)
+ */
+
+#include "history.h"
+
+#include <array>
+#include <atomic>
+#include <new>
+#include <stdio.h>
+#include <string.h>
+
+#define HISTORY_NO_INDEX 0xFF
+
+constexpr uint32_t historyFieldMask() {
+    uint32_t mask = 0;
+    for (size_t i = 0; i < HISTORY_FIELD_COUNT; i++) mask |= FIELD_BIT(HISTORY_FIELDS[i]);
+    return mask;
+}
+
+constexpr std::array<uint8_t, FIELD_COUNT> historyMakeFieldIndex() {
+    std::array<uint8_t, FIELD_COUNT> index = {};
+    for (size_t i = 0; i < FIELD_COUNT; i++) index[i] = HISTORY_NO_INDEX;
+    for (size_t i = 0; i < HISTORY_FIELD_COUNT; i++) index[HISTORY_FIELDS[i]] = (uint8_t)i;
+    return index;
+}
+
+constexpr uint32_t HISTORY_FIELD_MASK = historyFieldMask();
+constexpr std::array<uint8_t, FIELD_COUNT> HISTORY_FIELD_INDEX = historyMakeFieldIndex();
+constexpr uint32_t HISTORY_TIER_OFFSET[HISTORY_TIER_COUNT] = { 0, HISTORY_SECONDS, HISTORY_SECONDS + HISTORY_MINUTES };
+
+static_assert(HISTORY_FIELD_COUNT <= FIELD_COUNT, "Campo storicizzato ripetuto");
+
+// Intervallo in corso per segnale e livello
+struct HistoryAccumulator {
+    int32_t min;
+    int32_t max;
+    int64_t sum;
+    uint32_t count;
+};
+
+// Fine dell'intervallo in corso e bucket chiusi (indice assoluto)
+struct HistoryTierState {
+    bool started;
+    std::atomic<uint32_t> endMs;
+    std::atomic<uint32_t> closed;
+};
+
+// Ring dallo heap (historyBegin), per slot e segnale HISTORY_BUCKETS_PER_FIELD
+// bucket; senza memoria lo storico resta vuoto
+static HistoryBucket *buckets = NULL;
+static HistoryAccumulator accumulators[HISTORY_SOURCES][HISTORY_FIELD_COUNT][HISTORY_TIER_COUNT];
+static HistoryTierState tierStates[HISTORY_SOURCES][HISTORY_TIER_COUNT];
+
+static inline HistoryBucket &historyBucket(uint8_t slot, size_t field, uint32_t position) {
+    return buckets[((size_t)slot * HISTORY_FIELD_COUNT + field) * HISTORY_BUCKETS_PER_FIELD + position];
+}
+
+bool historyBegin() {
+    if (buckets == NULL) buckets = new (std::nothrow) HistoryBucket[HISTORY_MEMORY_BYTES / sizeof(HistoryBucket)];
+    return buckets != NULL;
+}
+
+static int32_t historySample(const EngineData &data, EngineField field) {
+    int64_t value = engineFieldValue(data, field);
+    return (value > INT32_MAX) ? INT32_MAX : (int32_t)value;
+}
+
+static int16_t saturate16(int32_t value) {
+    if (value > INT16_MAX) return INT16_MAX;
+    if (value < INT16_MIN) return INT16_MIN;
+    return (int16_t)value;
+}
+
+static void resetAccumulator(HistoryAccumulator &acc) {
+    acc.min = INT32_MAX;
+    acc.max = INT32_MIN;
+    acc.sum = 0;
+    acc.count = 0;
+}
+
+// Scrive nel ring il bucket 'closed' di tutti i segnali: dall'intervallo in
+// corso (e lo azzera) o vuoto. L'indice assoluto diventa visibile ai lettori
+// dopo la scrittura: il bucket più vecchio, nella posizione che si sta
+// sovrascrivendo, non è leggibile (ne restano length - 1)
+static void closeBucket(uint8_t slot, uint8_t tier, bool empty) {
+    HistoryTierState &state = tierStates[slot][tier];
+    uint32_t index = state.closed.load(std::memory_order_relaxed);
+    uint32_t position = HISTORY_TIER_OFFSET[tier] + index % HISTORY_TIERS[tier].length;
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t f = 0; f < HISTORY_FIELD_COUNT; f++) {
+        HistoryAccumulator &acc = accumulators[slot][f][tier];
+        HistoryBucket &bucket = historyBucket(slot, f, position);
+        if (empty || acc.count == 0) {
+            bucket.min = INT16_MAX;
+            bucket.max = INT16_MIN;
+            bucket.mean = 0;
+        } else {
+            int64_t half = (acc.sum >= 0) ? acc.count / 2 : -(int64_t)(acc.count / 2);
+            bucket.min = saturate16(acc.min);
+            bucket.max = saturate16(acc.max);
+            bucket.mean = saturate16((int32_t)((acc.sum + half) / (int64_t)acc.count));
+        }
+        if (!empty) resetAccumulator(acc);
+    }
+    state.closed.store(index + 1, std::memory_order_release);
+}
+
+// Chiude gli intervalli terminati; gli intervalli interi senza campioni
+// diventano bucket vuoti (al massimo un ring intero)
+static void historyAdvance(uint8_t slot, uint32_t nowMs) {
+    for (uint8_t tier = 0; tier < HISTORY_TIER_COUNT; tier++) {
+        HistoryTierState &state = tierStates[slot][tier];
+        uint32_t period = HISTORY_TIERS[tier].periodMs;
+        uint32_t endMs = state.endMs.load(std::memory_order_relaxed);
+        if (!state.started) {
+            state.started = true;
+            state.endMs.store(nowMs - nowMs % period + period, std::memory_order_relaxed);
+            continue;
+        }
+        if ((int32_t)(nowMs - endMs) < 0) continue;
+
+        uint32_t elapsed = (nowMs - endMs) / period;
+        closeBucket(slot, tier, false);
+        uint32_t empty = (elapsed < HISTORY_TIERS[tier].length) ? elapsed : HISTORY_TIERS[tier].length;
+        for (uint32_t i = 0; i < empty; i++) {
+            closeBucket(slot, tier, true);
+        }
+        state.endMs.store(endMs + (elapsed + 1) * period, std::memory_order_relaxed);
+    }
+}
+
+void historyRecord(uint8_t slot, const EngineData &data, uint32_t fields, uint32_t nowMs) {
+    fields &= HISTORY_FIELD_MASK;
+    if (slot >= HISTORY_SOURCES || fields == 0 || buckets == NULL) return;
+    historyAdvance(slot, nowMs);
+    while (fields) {
+        EngineField field = (EngineField)__builtin_ctz(fields);
+        fields &= fields - 1;
+        int32_t value = historySample(data, field);
+        HistoryAccumulator *acc = accumulators[slot][HISTORY_FIELD_INDEX[field]];
+        for (uint8_t tier = 0; tier < HISTORY_TIER_COUNT; tier++) {
+            if (value < acc[tier].min) acc[tier].min = value;
+            if (value > acc[tier].max) acc[tier].max = value;
+            acc[tier].sum += value;
+            acc[tier].count++;
+        }
+    }
+}
+
+void historyTick(uint32_t nowMs) {
+    if (buckets == NULL) return;
+    uint8_t count = engineDataSourceCount();
+    for (uint8_t slot = 0; slot < count && slot < HISTORY_SOURCES; slot++) {
+        historyAdvance(slot, nowMs);
+    }
+}
+
+void historyReset() {
+    for (uint8_t slot = 0; slot < HISTORY_SOURCES; slot++) {
+        for (uint8_t tier = 0; tier < HISTORY_TIER_COUNT; tier++) {
+            tierStates[slot][tier].started = false;
+            tierStates[slot][tier].closed.store(0, std::memory_order_release);
+            for (size_t f = 0; f < HISTORY_FIELD_COUNT; f++) {
+                resetAccumulator(accumulators[slot][f][tier]);
+            }
+        }
+    }
+}
+
+int historyFieldIndex(const char *name) {
+    for (size_t i = 0; i < HISTORY_FIELD_COUNT; i++) {
+        if (strcmp(name, engineFieldName(HISTORY_FIELDS[i])) == 0) return (int)i;
+    }
+    return -1;
+}
+
+int historyTierIndex(const char *name) {
+    for (uint8_t tier = 0; tier < HISTORY_TIER_COUNT; tier++) {
+        if (strcmp(name, HISTORY_TIERS[tier].name) == 0) return tier;
+    }
+    return -1;
+}
+
+bool historyQueryBegin(HistoryQuery &query, uint8_t set, uint8_t field, uint8_t tier,
+                       uint32_t count, uint32_t nowMs) {
+    uint8_t slots[ENGINE_DATA_MAX_SOURCES];
+    uint8_t sources = engineDataSlotsBySource(slots);
+    if (buckets == NULL || set >= sources || slots[set] >= HISTORY_SOURCES ||
+        field >= HISTORY_FIELD_COUNT || tier >= HISTORY_TIER_COUNT) {
+        return false;
+    }
+
+    HistoryTierState &state = tierStates[slots[set]][tier];
+    uint32_t end = state.closed.load(std::memory_order_acquire);
+    uint32_t available = (end < HISTORY_TIERS[tier].length) ? end : HISTORY_TIERS[tier].length - 1;
+    if (count > available) count = available;
+    query.set = set;
+    query.slot = slots[set];
+    query.field = field;
+    query.tier = tier;
+    query.first = end - count;
+    query.end = end;
+    query.next = query.first;
+    query.ageMs = nowMs - (state.endMs.load(std::memory_order_relaxed) - HISTORY_TIERS[tier].periodMs);
+    query.stage = 0;
+    return true;
+}
+
+// Copia del bucket assoluto 'index', false se sovrascritto durante la lettura
+static bool historyReadBucket(const HistoryQuery &query, uint32_t index, HistoryBucket &bucket) {
+    const HistoryTierState &state = tierStates[query.slot][query.tier];
+    uint32_t length = HISTORY_TIERS[query.tier].length;
+    if (state.closed.load(std::memory_order_acquire) - index >= length) return false;
+    bucket = historyBucket(query.slot, query.field, HISTORY_TIER_OFFSET[query.tier] + index % length);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return state.closed.load(std::memory_order_relaxed) - index < length;
+}
+
+size_t historyQueryRead(HistoryQuery &query, char *buffer, size_t size) {
+    size_t length = 0;
+    if (query.stage == 0) {
+        int written = snprintf(buffer, size,
+            "{\"set\":%u,\"sa\":%u,\"field\":\"%s\",\"tier\":\"%s\",\"periodMs\":%u,\"ageMs\":%u,\"points\":[",
+            (unsigned)query.set, (unsigned)engineDataSourceAddress(query.slot),
+            engineFieldName(HISTORY_FIELDS[query.field]), HISTORY_TIERS[query.tier].name,
+            (unsigned)HISTORY_TIERS[query.tier].periodMs, (unsigned)query.ageMs);
+        if (written < 0 || (size_t)written >= size) return 0;
+        length = written;
+        query.stage = 1;
+    }
+    while (query.stage == 1 && query.next != query.end) {
+        char point[32];
+        HistoryBucket bucket;
+        const char *separator = (query.next == query.first) ? "" : ",";
+        int written;
+        if (!historyReadBucket(query, query.next, bucket) || bucket.min > bucket.max) {
+            written = snprintf(point, sizeof(point), "%snull", separator);
+        } else {
+            written = snprintf(point, sizeof(point), "%s[%d,%d,%d]", separator,
+                               bucket.min, bucket.max, bucket.mean);
+        }
+        if (length + written >= size) return length;
+        memcpy(buffer + length, point, written);
+        length += written;
+        query.next++;
+    }
+    if (query.stage == 1) {
+        if (length + 2 >= size) return length;
+        memcpy(buffer + length, "]}", 2);
+        length += 2;
+        query.stage = 2;
+    }
+    return length;
+}
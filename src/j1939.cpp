@@ -0,0 +1,322 @@
+/*
+ * @Description: Decoder CAN J1939 - ricezione frame e aggiornamento dei data
+ * set EngineData per indirizzo sorgente
+ */
+
+#include "j1939.h"
+#include "bus_discovery.h"
+#include "can_log.h"
+#include "config.h"
+#include "dtc_store.h"
+#include "engine_data.h"
+#include "history.h"
+#include "j1939_command.h"
+#include "j1939_filter.h"
+#include "j1939_node.h"
+#include "j1939_spn.h"
+#include "j1939_tp.h"
+#include "metrics.h"
+#include "profiler.h"
+
+// Filtro dei PGN decodificati e filtro aperto a tutto il traffico (inventario
+// del bus): richiesta dal web, cambio eseguito dal task CAN
+static J1939AcceptanceFilter decodedFilter;
+static volatile bool filterOpenRequest = false;
+static bool filterOpen = false;
+// Driver TWAI rimosso (installazione fallita): il task CAN ritenta il filtro
+// corrente ogni CAN_RESTART_RETRY_MS
+static bool canDown = false;
+static uint32_t canRestartAt = 0;
+
+// Inizializza CAN bus per J1939
+void CAN_J1939_Init() {
+    // PGN gestiti: tabella SPN, DM1/DM2, Transport Protocol, Request e
+    // Address Claimed per il nodo J1939 (ordinati)
+    uint32_t pgns[SPN_PGN_COUNT + 6];
+    size_t count = 0;
+    pgns[count++] = PGN_REQUEST;
+    pgns[count++] = PGN_TP_DT;
+    pgns[count++] = PGN_TP_CM;
+    pgns[count++] = PGN_ADDRESS_CLAIMED;
+    for (size_t i = 0; i < SPN_PGN_COUNT; i++) {
+        pgns[count++] = SPN_PGN_TABLE[i].pgn;
+    }
+    pgns[count++] = PGN_DIAGNOSTIC_MESSAGE_1;
+    pgns[count++] = PGN_DIAGNOSTIC_MESSAGE_2;
+    for (size_t i = 1; i < count; i++) {
+        for (size_t j = i; j > 0 && pgns[j - 1] > pgns[j]; j--) {
+            uint32_t tmp = pgns[j];
+            pgns[j] = pgns[j - 1];
+            pgns[j - 1] = tmp;
+        }
+    }
+    
+    dtcStoreReset();
+    busDiscoveryReset();
+    
+    // Filtro hardware più stretto per questi PGN
+    // (con CAN_LOG_ALL_FRAMES il logger registra l'intero traffico del bus)
+    decodedFilter = j1939ComputeAcceptanceFilter(pgns, CAN_LOG_ALL_FRAMES ? 0 : count);
+    filterOpen = filterOpenRequest = CAN_LOG_ALL_FRAMES;
+    const J1939AcceptanceFilter &filter = decodedFilter;
+    HAL_LOG("CAN filter: %s, code 0x%08X mask 0x%08X (%u IDs accepted)\n",
+            filter.singleFilter ? "single" : "dual",
+            (unsigned)filter.acceptanceCode, (unsigned)filter.acceptanceMask,
+            (unsigned)filter.acceptedIds);
+    
+    // Configura per J1939 (250 kbps)
+    canDown = !hal_can_begin(filter.acceptanceCode, filter.acceptanceMask, filter.singleFilter);
+    canRestartAt = hal_millis();
+}
+
+void j1939SetFilterOpen(bool open) {
+    filterOpenRequest = open;
+}
+
+bool j1939FilterOpen() {
+    return filterOpen;
+}
+
+static bool j1939InstallFilter(bool open) {
+    J1939AcceptanceFilter filter = open ? j1939ComputeAcceptanceFilter(NULL, 0) : decodedFilter;
+    return hal_can_set_filter(filter.acceptanceCode, filter.acceptanceMask, filter.singleFilter);
+}
+
+// Task CAN: filtro richiesto da j1939SetFilterOpen (riavvia il controller).
+// Se il nuovo filtro non si installa torna il precedente; se manca anche
+// quello il driver resta rimosso e si ritenta ai giri successivi
+static void j1939ApplyFilter() {
+    uint32_t now = hal_millis();
+    if (canDown) {
+        if (now - canRestartAt < CAN_RESTART_RETRY_MS) return;
+        canRestartAt = now;
+        if (!j1939InstallFilter(filterOpen)) return;
+        HAL_LOG("CAN driver restarted\n");
+        canDown = false;
+    }
+    bool open = filterOpenRequest;
+    if (open == filterOpen) return;
+    if (j1939InstallFilter(open)) {
+        HAL_LOG("CAN filter %s\n", open ? "opened to all frames" : "restored to decoded PGNs");
+        filterOpen = open;
+        return;
+    }
+    filterOpenRequest = filterOpen;
+    if (!j1939InstallFilter(filterOpen)) {
+        HAL_LOG("CAN driver down, retry in %u ms\n", (unsigned)CAN_RESTART_RETRY_MS);
+        canDown = true;
+        canRestartAt = now;
+    }
+}
+
+// Estrai PGN dal CAN ID (formato J1939): 18 bit con EDP e DP (bit 25 e 24)
+uint32_t getPGN(uint32_t canId) {
+    // J1939 usa extended ID (29-bit)
+    // PGN è nei bit 8-25 del CAN ID
+    uint32_t pgn = (canId >> 8) & 0x3FF00;  // EDP, DP e PDU Format
+    uint32_t pf = (canId >> 16) & 0xFF;
+    
+    if (pf < 240) {
+        // PDU1 format - PS è destination address
+        return pgn;
+    } else {
+        // PDU2 format - PS fa parte del PGN
+        return pgn | ((canId >> 8) & 0xFF);
+    }
+}
+
+// Estrai indirizzo di destinazione (PDU1) o global 0xFF (PDU2)
+uint8_t getDestinationAddress(uint32_t canId) {
+    uint32_t pf = (canId >> 16) & 0xFF;
+    return (pf < 240) ? ((canId >> 8) & 0xFF) : J1939_GLOBAL_ADDRESS;
+}
+
+// Primi 8 byte del payload come intero little endian a 64 bit; i byte oltre
+// la lunghezza valgono 0xFF, quindi gli SPN mancanti risultano "non disponibili"
+static inline uint64_t j1939Payload(const uint8_t *data, uint16_t length) {
+    uint64_t payload = 0;
+    uint8_t count = (length < 8) ? length : 8;
+    for (uint8_t i = 0; i < count; i++) {
+        payload |= (uint64_t)data[i] << (8 * i);
+    }
+    uint64_t padding = (count >= 8) ? 0 : (~0ULL << (8 * count));
+    return payload | padding;
+}
+
+// Cerca il decoder generato per il PGN: hash perfetto, un solo confronto
+static inline const SpnPgnEntry *findPgnDecoder(uint32_t pgn) {
+    uint8_t index = SPN_HASH_SLOTS[spnHash(pgn, SPN_HASH_MULTIPLIER)];
+    if (index == SPN_HASH_EMPTY || SPN_PGN_TABLE[index].pgn != pgn) return NULL;
+    return &SPN_PGN_TABLE[index];
+}
+
+// Contatore per PGN del frame ricevuto (vedi MetricsPgnSlot)
+static inline uint8_t metricsPgnSlot(uint32_t pgn) {
+    switch (pgn) {
+        case PGN_DIAGNOSTIC_MESSAGE_1: return METRICS_PGN_DM1;
+        case PGN_DIAGNOSTIC_MESSAGE_2: return METRICS_PGN_DM2;
+        case PGN_TP_CM:                return METRICS_PGN_TP_CM;
+        case PGN_TP_DT:                return METRICS_PGN_TP_DT;
+        case PGN_REQUEST:              return METRICS_PGN_REQUEST;
+        case PGN_ADDRESS_CLAIMED:      return METRICS_PGN_ADDRESS_CLAIMED;
+    }
+    const SpnPgnEntry *entry = findPgnDecoder(pgn);
+    return (entry != NULL) ? (uint8_t)(entry - SPN_PGN_TABLE.data()) : (uint8_t)METRICS_PGN_OTHER;
+}
+
+// Decodifica un PGN completo, da frame singolo o riassemblato dal Transport Protocol.
+// Restituisce false se il PGN non ha un decoder
+bool j1939DispatchPgn(uint32_t pgn, uint8_t sa, const uint8_t *data, uint16_t length) {
+    const SpnPgnEntry *entry = NULL;
+    bool diagnostic = (pgn == PGN_DIAGNOSTIC_MESSAGE_1 || pgn == PGN_DIAGNOSTIC_MESSAGE_2);
+    if (!diagnostic) {
+        // PGN descritti in SPN_TABLE
+        entry = findPgnDecoder(pgn);
+        if (entry == NULL) return false;
+    }
+    
+    // DM1: DTC attivi; DM2 (su richiesta): DTC non più attivi. I DTC seguono
+    // dal byte 2 in poi (4 byte ciascuno) e vanno nel registro DTC anche per
+    // le ECU senza data set
+    uint32_t now = hal_millis();
+    uint8_t dtcCount = 0;
+    if (diagnostic && length >= 2) {
+        if (pgn == PGN_DIAGNOSTIC_MESSAGE_1) {
+            dtcCount = dtcStoreActive(sa, data + 2, length - 2, now);
+        } else {
+            dtcCount = dtcStorePrevious(sa, data + 2, length - 2, now);
+        }
+    }
+    
+    // Data set della ECU mittente (slot assegnato solo per PGN decodificati)
+    EngineData *target = engineDataForSource(sa);
+    if (target == NULL) {
+        j1939RxStats.sourcesDropped++;
+        return true;
+    }
+    
+    if (entry == NULL) {
+        if (length >= 2) {
+            if (pgn == PGN_DIAGNOSTIC_MESSAGE_1) {
+                // Byte 0-1: Lamp status e flash codes
+                target->errorFlags = (data[0] << 8) | data[1];
+                target->dtcCount = dtcCount;
+            } else {
+                target->previousDtcCount = dtcCount;
+            }
+            target->lastUpdate = now;
+        }
+        return true;
+    }
+    
+    entry->decode(j1939Payload(data, length), *target);
+    target->lastUpdate = now;
+    historyRecord(target - engineDataSets, *target, entry->fields & target->validFlags, now);
+    return true;
+}
+
+// Processa messaggio J1939: i dati vanno nel data set dell'indirizzo sorgente
+void processJ1939Message(twai_message_t &message) {
+    j1939RxStats.accepted++;
+    if (!message.extd) {
+        j1939RxStats.softwareRejected++;
+        return;  // J1939 usa solo extended frame
+    }
+    
+    uint32_t pgn = getPGN(message.identifier);
+    uint8_t sa = message.identifier & 0xFF;  // Source Address
+    uint8_t length = (message.data_length_code < 8) ? message.data_length_code : 8;
+    uint8_t slot = metricsPgnSlot(pgn);
+    metricsPgnFrames[slot]++;
+    busDiscoveryRecord(message, pgn, slot != METRICS_PGN_OTHER, hal_micros(), hal_millis());
+    
+    // EDP = 1: ISO 15765 (diagnostica su CAN), non J1939
+    if (pgn & J1939_PGN_EDP) {
+        j1939RxStats.softwareRejected++;
+        return;
+    }
+    
+    // Gestione rete: richieste a noi e indirizzi rivendicati dagli altri nodi
+    if (pgn == PGN_REQUEST || pgn == PGN_ADDRESS_CLAIMED) {
+        j1939NodeProcessFrame(pgn, sa, getDestinationAddress(message.identifier),
+                              message.data, length, hal_millis());
+        return;
+    }
+    
+    // Messaggi multi-pacchetto: riassemblati e poi decodificati da j1939DispatchPgn
+    if (pgn == PGN_TP_CM || pgn == PGN_TP_DT) {
+        j1939TpProcessFrame(pgn, sa, getDestinationAddress(message.identifier),
+                            message.data, length, hal_millis());
+        return;
+    }
+    
+    if (!j1939DispatchPgn(pgn, sa, message.data, length)) {
+        j1939RxStats.softwareRejected++;
+    }
+}
+
+// Task per gestione CAN: attende il primo frame fino a timeoutMs (bloccante
+// nel task dedicato, 0 = polling), svuota la coda RX e pubblica i dati
+void CAN_Task(uint32_t timeoutMs) {
+    static uint32_t drainedAt = 0;  // µs, coda RX vista vuota
+    twai_message_t message;
+    j1939ApplyFilter();
+    // Frame già in coda al rientro: in attesa al massimo da drainedAt. Se il
+    // task si blocca, il primo frame lo risveglia appena ricevuto
+    bool received = hal_can_receive(&message, 0);
+    if (received) {
+        profileCanBacklogObserve(hal_micros() - drainedAt);
+    } else {
+        received = hal_can_receive(&message, timeoutMs);
+    }
+    uint32_t profileStart = profileBegin(PROFILE_CAN);
+    if (received) {
+        do {
+            // Timestamp all'uscita dalla coda TWAI (il controller non ne fornisce)
+            if (canLogActive()) canLogRecord(message, hal_micros());
+            uint32_t start = hal_cycles();
+            processJ1939Message(message);
+            metricsObserve(metricsDecodeTime, metricsCyclesToNs(hal_cycles() - start));
+        } while (hal_can_receive(&message, 0));
+    }
+    drainedAt = hal_micros();
+    
+    // Controlla alert
+    uint32_t alerts_triggered = hal_can_read_alerts(0);
+    
+    if (alerts_triggered & TWAI_ALERT_RX_QUEUE_FULL) j1939RxStats.rxQueueFull++;
+    if (alerts_triggered & TWAI_ALERT_ERR_PASS) j1939RxStats.errorPassive++;
+    
+    // Gestione errori bus
+    if (alerts_triggered & TWAI_ALERT_BUS_ERROR) {
+        j1939RxStats.busErrors++;
+        HAL_LOG("CAN Bus Error! Error count: %u\n", (unsigned)hal_can_bus_error_count());
+    }
+    
+    // Scadenza sessioni Transport Protocol (T1-T4)
+    uint32_t now = hal_millis();
+    j1939TpPoll(now);
+    j1939NodePoll(now, alerts_triggered);
+    j1939CommandSetSource(j1939NodeState() == J1939_CLAIM_DONE ? j1939NodeAddress() : J1939_NULL_ADDRESS);
+    historyTick(now);
+    j1939RxStats.hardwareRejected = hal_can_filter_rejected();
+    
+    // Timeout dati - marca come non validi se troppo vecchi, per ogni ECU
+    uint8_t sources = engineDataSourceCount();
+    for (uint8_t slot = 0; slot < sources; slot++) {
+        EngineData &data = engineDataSets[slot];
+        uint16_t flags = data.statusFlags;
+        if (now - data.lastUpdate > 5000) {
+            flags |= 0x8000;  // Set bit errore comunicazione
+        } else {
+            flags &= ~0x8000;  // Clear bit errore
+        }
+        if (flags != data.statusFlags) {
+            data.statusFlags = flags;
+            engineDataTouch(slot);
+        }
+    }
+    
+    engineDataPublish();
+    profileEnd(PROFILE_CAN, profileStart);
+}
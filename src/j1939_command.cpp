@@ -0,0 +1,256 @@
+/*
+ * @Description: Uscita comandi J1939 (vedi j1939_command.h)
+ */
+
+#include "j1939_command.h"
+#include "hal.h"
+#include "j1939.h"
+
+#include <atomic>
+#include <string.h>
+
+#define TSC1_PRIORITY 3
+#define TSC1_PERIOD_MS 10
+
+struct CommandConfig {
+    uint32_t pgn;
+    uint16_t periodMs;
+    uint8_t priority;
+    uint8_t destination;
+    uint8_t length;
+    bool enabled;
+    uint8_t data[8];
+};
+
+// Stato dello scheduler, solo task comandi
+struct CommandSchedule {
+    uint32_t nextDueUs;
+    uint16_t periodMs;       // Periodo della scadenza corrente
+    bool running;
+};
+
+J1939CommandStats j1939CommandStats;
+
+// Slot 0 pronto per TSC1 verso il motore (indirizzo 0), payload da scrivere;
+// gli altri slot partono vuoti
+static CommandConfig configs[J1939_COMMAND_SLOTS] = {
+    { 0x0000, TSC1_PERIOD_MS, TSC1_PRIORITY, 0x00, 8, false,
+      { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF } },
+};
+static uint32_t writtenMs[J1939_COMMAND_SLOTS];          // Ultima scrittura, per il timeout
+static std::atomic<uint32_t> configSeq[J1939_COMMAND_SLOTS];  // Dispari durante una scrittura
+static std::atomic<uint16_t> commandTimeoutMs(J1939_COMMAND_TIMEOUT_MS);
+static std::atomic<uint32_t> enabledMask(0);
+static std::atomic<uint32_t> activeMask(0);
+static std::atomic<uint8_t> sourceAddress(J1939_NULL_ADDRESS);
+
+static CommandSchedule schedules[J1939_COMMAND_SLOTS];
+
+// Word di uno slot nel formato dei registri
+static uint16_t commandWord(const CommandConfig &config, uint8_t word) {
+    switch (word) {
+        case MB_CMD_SLOT_ENABLE:       return config.enabled;
+        case MB_CMD_SLOT_PGN:          return config.pgn >> 16;
+        case MB_CMD_SLOT_PGN + 1:      return config.pgn & 0xFFFF;
+        case MB_CMD_SLOT_PRIORITY:     return config.priority;
+        case MB_CMD_SLOT_DESTINATION:  return config.destination;
+        case MB_CMD_SLOT_PERIOD:       return config.periodMs;
+        case MB_CMD_SLOT_LENGTH:       return config.length;
+        default: {
+            uint8_t byte = (word - MB_CMD_SLOT_DATA) * 2;
+            return (config.data[byte] << 8) | config.data[byte + 1];
+        }
+    }
+}
+
+// Scrittura di una word, false se il valore è fuori dal suo intervallo
+static bool commandSetWord(CommandConfig &config, uint8_t word, uint16_t value) {
+    switch (word) {
+        case MB_CMD_SLOT_ENABLE:
+            if (value > 1) return false;
+            config.enabled = value;
+            return true;
+        case MB_CMD_SLOT_PGN:
+            if (value > 0x03) return false;
+            config.pgn = ((uint32_t)value << 16) | (config.pgn & 0xFFFF);
+            return true;
+        case MB_CMD_SLOT_PGN + 1:
+            config.pgn = (config.pgn & 0x30000) | value;
+            return true;
+        case MB_CMD_SLOT_PRIORITY:
+            if (value > 7) return false;
+            config.priority = value;
+            return true;
+        case MB_CMD_SLOT_DESTINATION:
+            if (value > 0xFF) return false;
+            config.destination = value;
+            return true;
+        case MB_CMD_SLOT_PERIOD:
+            config.periodMs = value;
+            return true;
+        case MB_CMD_SLOT_LENGTH:
+            if (value > 8) return false;
+            config.length = value;
+            return true;
+        default: {
+            uint8_t byte = (word - MB_CMD_SLOT_DATA) * 2;
+            config.data[byte] = value >> 8;
+            config.data[byte + 1] = value & 0xFF;
+            return true;
+        }
+    }
+}
+
+// Coerenza dello slot completo: PGN PDU1 senza byte di destinazione, periodo
+// multiplo del tick se abilitato
+static bool commandValid(const CommandConfig &config) {
+    if (((config.pgn >> 8) & 0xFF) < 240 && (config.pgn & 0xFF) != 0) return false;
+    if (!config.enabled) return true;
+    return config.periodMs > 0 && ((uint32_t)config.periodMs * 1000) % J1939_COMMAND_TICK_US == 0;
+}
+
+uint8_t j1939CommandWrite(uint16_t offset, uint16_t quantity, const uint8_t *values, uint32_t nowMs) {
+    if (quantity == 0 || offset + quantity > MB_CMD_COUNT) return 0x02;
+
+    // Copia modificata e verificata prima di pubblicarla: tutto o niente
+    CommandConfig updated[J1939_COMMAND_SLOTS];
+    memcpy(updated, configs, sizeof(updated));
+    uint32_t timeout = commandTimeoutMs.load(std::memory_order_relaxed);
+    uint32_t touched = 0;
+    for (uint16_t i = 0; i < quantity; i++) {
+        uint16_t address = offset + i;
+        uint16_t value = (values[i * 2] << 8) | values[i * 2 + 1];
+        if (address < MB_CMD_SLOTS) {
+            if (address != MB_CMD_TIMEOUT) return 0x02;  // Stato in sola lettura
+            timeout = value;
+            continue;
+        }
+        uint16_t slot = (address - MB_CMD_SLOTS) / MB_CMD_SLOT_STRIDE;
+        uint8_t word = (address - MB_CMD_SLOTS) % MB_CMD_SLOT_STRIDE;
+        if (word >= MB_CMD_SLOT_WORDS) return 0x02;
+        if (!commandSetWord(updated[slot], word, value)) return 0x03;
+        touched |= 1UL << slot;
+    }
+    if (timeout < J1939_COMMAND_TIMEOUT_MIN_MS || timeout > J1939_COMMAND_TIMEOUT_MAX_MS) return 0x03;
+    for (uint8_t slot = 0; slot < J1939_COMMAND_SLOTS; slot++) {
+        if ((touched & (1UL << slot)) && !commandValid(updated[slot])) return 0x03;
+    }
+
+    uint32_t enabled = 0;
+    for (uint8_t slot = 0; slot < J1939_COMMAND_SLOTS; slot++) {
+        if (touched & (1UL << slot)) {
+            uint32_t seq = configSeq[slot].load(std::memory_order_relaxed);
+            configSeq[slot].store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            configs[slot] = updated[slot];
+            writtenMs[slot] = nowMs;
+            std::atomic_thread_fence(std::memory_order_release);
+            configSeq[slot].store(seq + 2, std::memory_order_relaxed);
+        }
+        if (configs[slot].enabled) enabled |= 1UL << slot;
+    }
+    commandTimeoutMs.store(timeout, std::memory_order_relaxed);
+    enabledMask.store(enabled, std::memory_order_relaxed);
+    j1939CommandStats.writes++;
+    return 0;
+}
+
+bool j1939CommandRead(uint16_t offset, uint16_t quantity, uint16_t *words) {
+    if (offset + quantity > MB_CMD_COUNT) return false;
+    for (uint16_t i = 0; i < quantity; i++) {
+        uint16_t address = offset + i;
+        uint16_t value = 0;
+        if (address == MB_CMD_TIMEOUT) {
+            value = commandTimeoutMs.load(std::memory_order_relaxed);
+        } else if (address == MB_CMD_ACTIVE) {
+            value = activeMask.load(std::memory_order_relaxed);
+        } else if (address == MB_CMD_SOURCE_ADDRESS) {
+            value = sourceAddress.load(std::memory_order_relaxed);
+        } else if (address >= MB_CMD_SLOTS) {
+            uint16_t slot = (address - MB_CMD_SLOTS) / MB_CMD_SLOT_STRIDE;
+            uint8_t word = (address - MB_CMD_SLOTS) % MB_CMD_SLOT_STRIDE;
+            if (word < MB_CMD_SLOT_WORDS) value = commandWord(configs[slot], word);
+        }
+        words[i] = value;
+    }
+    return true;
+}
+
+void j1939CommandSetSource(uint8_t address) {
+    sourceAddress.store(address, std::memory_order_relaxed);
+}
+
+// Copia coerente di uno slot e dell'istante dell'ultima scrittura
+static void commandSnapshot(uint8_t slot, CommandConfig &config, uint32_t &written) {
+    uint32_t before;
+    uint32_t after;
+    do {
+        before = configSeq[slot].load(std::memory_order_acquire);
+        config = configs[slot];
+        written = writtenMs[slot];
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = configSeq[slot].load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+}
+
+static bool commandTransmit(const CommandConfig &config, uint8_t source) {
+    twai_message_t message;
+    memset(&message, 0, sizeof(message));
+    message.extd = 1;
+    uint32_t pf = (config.pgn >> 8) & 0xFF;
+    uint32_t ps = (pf < 240) ? config.destination : (config.pgn & 0xFF);
+    message.identifier = ((uint32_t)config.priority << 26) | ((config.pgn & 0x3FF00) << 8) | (ps << 8) | source;
+    message.data_length_code = config.length;
+    memcpy(message.data, config.data, config.length);
+    return hal_can_transmit(&message, 0);
+}
+
+void j1939CommandService(uint32_t nowUs, uint32_t nowMs) {
+    uint8_t source = sourceAddress.load(std::memory_order_relaxed);
+    uint32_t timeout = commandTimeoutMs.load(std::memory_order_relaxed);
+    uint32_t enabled = enabledMask.load(std::memory_order_relaxed);
+    uint32_t active = 0;
+    for (uint8_t slot = 0; slot < J1939_COMMAND_SLOTS; slot++) {
+        CommandSchedule &schedule = schedules[slot];
+        if (!(enabled & (1UL << slot))) {
+            schedule.running = false;
+            continue;
+        }
+        CommandConfig config;
+        uint32_t written;
+        commandSnapshot(slot, config, written);
+        bool fresh = nowMs - written <= timeout;
+        if (!config.enabled || !fresh || source == J1939_NULL_ADDRESS) {
+            if (schedule.running && !fresh) j1939CommandStats.timeouts++;
+            schedule.running = false;
+            continue;
+        }
+        active |= 1UL << slot;
+
+        // Prima trasmissione o periodo cambiato: subito, poi a passo fisso
+        if (!schedule.running || schedule.periodMs != config.periodMs) {
+            schedule.running = true;
+            schedule.periodMs = config.periodMs;
+            schedule.nextDueUs = nowUs;
+        }
+        // Vale il tick più vicino alla scadenza, anche se di poco in anticipo
+        int32_t late = (int32_t)(nowUs - schedule.nextDueUs);
+        if (late < -(int32_t)(J1939_COMMAND_TICK_US / 2)) continue;
+
+        if (commandTransmit(config, source)) {
+            j1939CommandStats.frames++;
+        } else {
+            j1939CommandStats.txFailed++;
+        }
+        uint32_t lateUs = (late < 0) ? -late : late;
+        if (lateUs > j1939CommandStats.maxLateUs) j1939CommandStats.maxLateUs = lateUs;
+        // Scadenze dalla precedente, senza deriva; dopo un ritardo di un
+        // periodo intero si riparte da ora invece di recuperare
+        schedule.nextDueUs += (uint32_t)config.periodMs * 1000;
+        if ((int32_t)(nowUs - schedule.nextDueUs) >= 0) {
+            j1939CommandStats.overruns++;
+            schedule.nextDueUs = nowUs + (uint32_t)config.periodMs * 1000;
+        }
+    }
+    activeMask.store(active, std::memory_order_relaxed);
+}
@@ -0,0 +1,140 @@
+/*
+ * @Description: Calcolo del filtro di accettazione TWAI più stretto (singolo o
+ * doppio) per un insieme di PGN. Priorità e indirizzo sorgente sono sempre
+ * indifferenti; per i PGN PDU1 lo è anche il PDU Specific (destinazione).
+ */
+
+#include "j1939_filter.h"
+
+#define J1939_ID_MASK          0x1FFFFFFF
+#define J1939_ID_DONT_CARE     0x1C0000FF  // Priorità (bit 26-28) e SA (bit 0-7)
+#define J1939_PS_MASK          0x0000FF00
+#define DUAL_FILTER_ID_SHIFT   13          // In modalità doppia si confrontano solo ID[28:13]
+#define EXHAUSTIVE_SPLIT_MAX   16          // Oltre, partizioni contigue sui PGN ordinati
+
+J1939RxStats j1939RxStats;
+
+// Gruppo di PGN ridotto a (bit comuni, bit indifferenti) nello spazio ID
+struct FilterTerm {
+    uint32_t code;
+    uint32_t dontCare;
+};
+
+static uint32_t popcount32(uint32_t value) {
+    uint32_t count = 0;
+    while (value) {
+        value &= value - 1;
+        count++;
+    }
+    return count;
+}
+
+static uint32_t pgnDontCare(uint32_t pgn) {
+    uint32_t dontCare = J1939_ID_DONT_CARE;
+    if (((pgn >> 8) & 0xFF) < 240) dontCare |= J1939_PS_MASK;  // PDU1
+    return dontCare;
+}
+
+// Unisce i PGN selezionati da 'members' (bit i = pgns[i]) in un unico termine
+static FilterTerm mergeTerms(const uint32_t *pgns, size_t count, uint64_t members) {
+    uint32_t andId = J1939_ID_MASK;
+    uint32_t orId = 0;
+    uint32_t dontCare = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (!(members & (1ULL << i))) continue;
+        uint32_t id = (pgns[i] << 8) & J1939_ID_MASK;
+        andId &= id;
+        orId |= id;
+        dontCare |= pgnDontCare(pgns[i]);
+    }
+    dontCare |= andId ^ orId;
+    FilterTerm term = { andId & ~dontCare, dontCare & J1939_ID_MASK };
+    return term;
+}
+
+static uint32_t singleCost(const FilterTerm &term) {
+    return 1UL << popcount32(term.dontCare);
+}
+
+static uint32_t dualCost(const FilterTerm &term) {
+    uint32_t dontCare = term.dontCare | ((1UL << DUAL_FILTER_ID_SHIFT) - 1);
+    return 1UL << popcount32(dontCare);
+}
+
+// Costo di una partizione in due filtri (ID accettati, sovrapposizioni incluse)
+static uint32_t splitCost(const uint32_t *pgns, size_t count, uint64_t groupA,
+                          FilterTerm &termA, FilterTerm &termB) {
+    uint64_t all = (count >= 64) ? ~0ULL : ((1ULL << count) - 1);
+    termA = mergeTerms(pgns, count, groupA);
+    termB = mergeTerms(pgns, count, all & ~groupA);
+    return dualCost(termA) + dualCost(termB);
+}
+
+// Calcola il filtro più selettivo che accetta tutti i PGN richiesti
+J1939AcceptanceFilter j1939ComputeAcceptanceFilter(const uint32_t *pgns, size_t count) {
+    J1939AcceptanceFilter filter;
+
+    if (count == 0 || count > 64) {
+        // Nessun vincolo calcolabile: accetta tutto
+        filter.acceptanceCode = 0;
+        filter.acceptanceMask = 0xFFFFFFFF;
+        filter.singleFilter = true;
+        filter.acceptedIds = J1939_ID_MASK;
+        return filter;
+    }
+
+    uint64_t all = (count >= 64) ? ~0ULL : ((1ULL << count) - 1);
+    FilterTerm single = mergeTerms(pgns, count, all);
+    uint32_t bestCost = singleCost(single);
+    FilterTerm bestA = single;
+    FilterTerm bestB = single;
+    bool dual = false;
+
+    if (count >= 2) {
+        FilterTerm termA;
+        FilterTerm termB;
+        if (count <= EXHAUSTIVE_SPLIT_MAX) {
+            // Tutte le partizioni con pgns[0] nel primo gruppo
+            for (uint64_t rest = 0; rest < (1ULL << (count - 1)) - 1; rest++) {
+                uint64_t groupA = 1 | (rest << 1);
+                uint32_t cost = splitCost(pgns, count, groupA, termA, termB);
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestA = termA;
+                    bestB = termB;
+                    dual = true;
+                }
+            }
+        } else {
+            // Partizioni contigue: pgns deve essere ordinato
+            for (size_t split = 1; split < count; split++) {
+                uint64_t groupA = (1ULL << split) - 1;
+                uint32_t cost = splitCost(pgns, count, groupA, termA, termB);
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestA = termA;
+                    bestB = termB;
+                    dual = true;
+                }
+            }
+        }
+    }
+
+    if (dual) {
+        // Doppio filtro, frame estesi: ogni metà confronta ID[28:13]
+        uint32_t codeA = (bestA.code >> DUAL_FILTER_ID_SHIFT) & 0xFFFF;
+        uint32_t maskA = (bestA.dontCare >> DUAL_FILTER_ID_SHIFT) & 0xFFFF;
+        uint32_t codeB = (bestB.code >> DUAL_FILTER_ID_SHIFT) & 0xFFFF;
+        uint32_t maskB = (bestB.dontCare >> DUAL_FILTER_ID_SHIFT) & 0xFFFF;
+        filter.acceptanceCode = (codeA << 16) | codeB;
+        filter.acceptanceMask = (maskA << 16) | maskB;
+        filter.singleFilter = false;
+    } else {
+        // Filtro singolo, frame estesi: ID[28:0] in bit 31-3, RTR in bit 2 (solo data frame)
+        filter.acceptanceCode = single.code << 3;
+        filter.acceptanceMask = (single.dontCare << 3) | 0x3;
+        filter.singleFilter = true;
+    }
+    filter.acceptedIds = bestCost;
+    return filter;
+}
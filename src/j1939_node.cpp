@@ -0,0 +1,266 @@
+/*
+ * @Description: Nodo J1939 del gateway - address claim e richieste
+ * periodiche (vedi j1939_node.h)
+ */
+
+#include "j1939_node.h"
+#include "config.h"
+#include "hal.h"
+#include "j1939.h"
+
+#include <string.h>
+
+#define J1939_PRIORITY_DEFAULT      6
+#define J1939_ADDRESS_FIRST_DYNAMIC 128
+#define J1939_ADDRESS_LAST_DYNAMIC  247
+
+// Richieste periodiche. Con destinazione globale le risposte multi-pacchetto
+// arrivano in BAM, l'unico TP che il gateway riceve senza rispondere
+static const J1939RequestEntry REQUEST_SCHEDULE[] = {
+    { PGN_ENGINE_HOURS, J1939_REQUEST_HOURS_MS, J1939_GLOBAL_ADDRESS, 1 },
+    { PGN_DIAGNOSTIC_MESSAGE_2, J1939_REQUEST_DM2_MS, J1939_GLOBAL_ADDRESS, 4 },
+};
+
+#define REQUEST_COUNT (sizeof(REQUEST_SCHEDULE) / sizeof(REQUEST_SCHEDULE[0]))
+
+// Bit sul bus di un frame esteso con dlc byte, bit stuffing nel caso peggiore
+constexpr uint32_t j1939FrameBits(uint8_t dlc) {
+    return 67 + 8 * dlc + (54 + 8 * dlc - 1) / 4;
+}
+
+// Costo di una richiesta e delle risposte attese, in millesimi di bit
+constexpr uint32_t j1939RequestCost(const J1939RequestEntry &entry) {
+    return (j1939FrameBits(3) + entry.responseFrames * j1939FrameBits(8)) * 1000;
+}
+
+constexpr uint32_t j1939MaxRequestCost() {
+    uint32_t cost = 0;
+    for (size_t i = 0; i < REQUEST_COUNT; i++) {
+        if (j1939RequestCost(REQUEST_SCHEDULE[i]) > cost) cost = j1939RequestCost(REQUEST_SCHEDULE[i]);
+    }
+    return cost;
+}
+
+// Budget: millesimi di bit accumulati per ms. Il secchio contiene al più una
+// richiesta, così dopo una pausa lunga non parte una raffica
+constexpr uint32_t BUDGET_RATE = (uint64_t)J1939_BITRATE * J1939_TX_BUDGET_PERMILLE / 1000;
+constexpr uint32_t BUDGET_CAPACITY = j1939MaxRequestCost();
+
+static_assert(BUDGET_RATE > 0, "J1939_TX_BUDGET_PERMILLE troppo basso");
+
+J1939NodeStats j1939NodeStats;
+
+static J1939ClaimState claimState = J1939_CLAIM_OFF;
+static uint64_t nodeName = 0;
+static uint8_t nodeAddress = J1939_NULL_ADDRESS;
+static bool claimPending = false;
+static uint32_t claimSentMs = 0;
+static uint32_t claimedByOthers[256 / 32];
+
+static uint32_t nextDueMs[REQUEST_COUNT];
+static bool deferred[REQUEST_COUNT];
+static uint32_t budgetTokens = 0;
+static uint32_t budgetUpdateMs = 0;
+static uint32_t lastRequestMs = 0;
+static uint32_t holdUntilMs = 0;
+static uint32_t lastFailureMs = 0;
+
+uint64_t j1939MakeName(uint32_t identity) {
+    return (uint64_t)(identity & 0x1FFFFF) |
+           ((uint64_t)(J1939_NAME_MANUFACTURER & 0x7FF) << 21) |
+           ((uint64_t)(J1939_NAME_FUNCTION & 0xFF) << 40) |
+           (1ULL << 63);  // Arbitrary Address Capable
+}
+
+static bool j1939Send(uint32_t pgn, uint8_t da, uint8_t sa, const uint8_t *data, uint8_t length) {
+    twai_message_t message;
+    memset(&message, 0, sizeof(message));
+    message.extd = 1;
+    uint32_t pf = (pgn >> 8) & 0xFF;
+    uint32_t ps = (pf < 240) ? da : (pgn & 0xFF);
+    message.identifier = ((uint32_t)J1939_PRIORITY_DEFAULT << 26) | ((pgn & 0x3FF00) << 8) | (ps << 8) | sa;
+    message.data_length_code = length;
+    memcpy(message.data, data, length);
+    return hal_can_transmit(&message, 0);
+}
+
+// Errore di trasmissione: pausa raddoppiata se ripetuto entro due pause,
+// altrimenti si riparte dalla minima
+static void j1939TxFailed(uint32_t nowMs) {
+    j1939NodeStats.txFailed++;
+    uint32_t backoff = j1939NodeStats.backoffMs;
+    if (backoff == 0 || nowMs - lastFailureMs > 2 * backoff) {
+        backoff = J1939_TX_BACKOFF_MIN_MS;
+    } else {
+        backoff = (backoff * 2 < J1939_TX_BACKOFF_MAX_MS) ? backoff * 2 : J1939_TX_BACKOFF_MAX_MS;
+    }
+    j1939NodeStats.backoffMs = backoff;
+    lastFailureMs = nowMs;
+    holdUntilMs = nowMs + backoff;
+}
+
+// Address Claimed con il nostro NAME, o Cannot Claim dall'indirizzo nullo
+static bool j1939SendClaim() {
+    uint8_t data[8];
+    for (uint8_t i = 0; i < 8; i++) data[i] = (nodeName >> (8 * i)) & 0xFF;
+    uint8_t sa = (claimState == J1939_CLAIM_FAILED) ? J1939_NULL_ADDRESS : nodeAddress;
+    return j1939Send(PGN_ADDRESS_CLAIMED, J1939_GLOBAL_ADDRESS, sa, data, sizeof(data));
+}
+
+static inline bool addressClaimedByOthers(uint8_t address) {
+    return claimedByOthers[address / 32] & (1UL << (address % 32));
+}
+
+// Indirizzo perso: il successivo libero nell'intervallo dinamico
+static void j1939ClaimNextAddress() {
+    j1939NodeStats.claimsLost++;
+    for (uint16_t address = J1939_ADDRESS_FIRST_DYNAMIC; address <= J1939_ADDRESS_LAST_DYNAMIC; address++) {
+        if (address != nodeAddress && !addressClaimedByOthers(address)) {
+            nodeAddress = address;
+            claimState = J1939_CLAIM_PENDING;
+            claimPending = true;
+            return;
+        }
+    }
+    nodeAddress = J1939_NULL_ADDRESS;
+    claimState = J1939_CLAIM_FAILED;
+    claimPending = true;
+}
+
+void j1939NodeBegin(uint64_t name, uint32_t nowMs) {
+    nodeName = name;
+    nodeAddress = J1939_PREFERRED_ADDRESS;
+    claimState = J1939_CLAIM_PENDING;
+    claimPending = true;
+    claimSentMs = nowMs;
+    memset(claimedByOthers, 0, sizeof(claimedByOthers));
+    budgetTokens = 0;
+    budgetUpdateMs = nowMs;
+    lastRequestMs = nowMs - J1939_REQUEST_MIN_GAP_MS;
+    holdUntilMs = nowMs;
+    j1939NodeStats.backoffMs = 0;
+}
+
+void j1939NodeStop() {
+    claimState = J1939_CLAIM_OFF;
+    claimPending = false;
+    nodeAddress = J1939_NULL_ADDRESS;
+}
+
+uint8_t j1939NodeAddress() {
+    return (claimState == J1939_CLAIM_DONE || claimState == J1939_CLAIM_PENDING) ? nodeAddress : J1939_NULL_ADDRESS;
+}
+
+J1939ClaimState j1939NodeState() {
+    return claimState;
+}
+
+void j1939NodeProcessFrame(uint32_t pgn, uint8_t sa, uint8_t da,
+                           const uint8_t *data, uint8_t length, uint32_t nowMs) {
+    if (claimState == J1939_CLAIM_OFF) return;
+
+    if (pgn == PGN_ADDRESS_CLAIMED && length >= 8) {
+        uint64_t name = 0;
+        for (uint8_t i = 0; i < 8; i++) name |= (uint64_t)data[i] << (8 * i);
+        if (sa == J1939_NULL_ADDRESS || name == nodeName) return;
+        claimedByOthers[sa / 32] |= 1UL << (sa % 32);
+        if (sa != nodeAddress || claimState == J1939_CLAIM_FAILED) return;
+        // Contesa: vince il NAME numericamente più basso
+        if (nodeName < name) {
+            claimPending = true;
+        } else {
+            j1939ClaimNextAddress();
+        }
+        return;
+    }
+
+    if (pgn == PGN_REQUEST && length >= 3) {
+        if (da != J1939_GLOBAL_ADDRESS && da != nodeAddress) return;
+        uint32_t requested = data[0] | (data[1] << 8) | ((uint32_t)data[2] << 16);
+        if (requested == PGN_ADDRESS_CLAIMED) {
+            claimPending = true;
+        } else if (da == nodeAddress && claimState == J1939_CLAIM_DONE) {
+            // Richiesta diretta a noi di un PGN che non trasmettiamo: NACK
+            uint8_t nack[8] = { 0x01, 0xFF, 0xFF, 0xFF, sa,
+                                (uint8_t)(requested & 0xFF), (uint8_t)((requested >> 8) & 0xFF),
+                                (uint8_t)((requested >> 16) & 0xFF) };
+            j1939NodeStats.nacks++;
+            if (!j1939Send(PGN_ACKNOWLEDGMENT, J1939_GLOBAL_ADDRESS, nodeAddress, nack, sizeof(nack))) {
+                j1939TxFailed(nowMs);
+            }
+        }
+    }
+}
+
+// Richiesta scaduta da più tempo (REQUEST_COUNT se nessuna)
+static size_t j1939MostOverdue(uint32_t nowMs) {
+    size_t selected = REQUEST_COUNT;
+    int32_t latest = -1;
+    for (size_t i = 0; i < REQUEST_COUNT; i++) {
+        if (REQUEST_SCHEDULE[i].periodMs == 0) continue;
+        int32_t overdue = (int32_t)(nowMs - nextDueMs[i]);
+        if (overdue > latest) {
+            latest = overdue;
+            selected = i;
+        }
+    }
+    return selected;
+}
+
+void j1939NodePoll(uint32_t nowMs, uint32_t alerts) {
+    if (claimState == J1939_CLAIM_OFF) return;
+    if (alerts & TWAI_ALERT_TX_FAILED) j1939TxFailed(nowMs);
+
+    if (claimPending) {
+        if (!j1939SendClaim()) {
+            j1939TxFailed(nowMs);
+            return;
+        }
+        claimPending = false;
+        if (claimState == J1939_CLAIM_PENDING) claimSentMs = nowMs;
+    }
+    if (claimState == J1939_CLAIM_PENDING && nowMs - claimSentMs >= J1939_CLAIM_WAIT_MS) {
+        // Indirizzo acquisito: prima richiesta di ogni PGN sfalsata nel suo periodo
+        claimState = J1939_CLAIM_DONE;
+        for (size_t i = 0; i < REQUEST_COUNT; i++) {
+            nextDueMs[i] = nowMs + REQUEST_SCHEDULE[i].periodMs * i / REQUEST_COUNT;
+            deferred[i] = false;
+        }
+    }
+    if (claimState != J1939_CLAIM_DONE) return;
+
+    // Budget: accumulo dal tempo trascorso, al più un secchio pieno
+    uint32_t elapsed = nowMs - budgetUpdateMs;
+    budgetUpdateMs = nowMs;
+    if (elapsed > BUDGET_CAPACITY / BUDGET_RATE + 1) elapsed = BUDGET_CAPACITY / BUDGET_RATE + 1;
+    budgetTokens += elapsed * BUDGET_RATE;
+    if (budgetTokens > BUDGET_CAPACITY) budgetTokens = BUDGET_CAPACITY;
+
+    if ((int32_t)(nowMs - holdUntilMs) < 0) return;                 // Pausa dopo errori
+    if (nowMs - lastRequestMs < J1939_REQUEST_MIN_GAP_MS) return;   // Mai due richieste di fila
+
+    size_t i = j1939MostOverdue(nowMs);
+    if (i == REQUEST_COUNT || (int32_t)(nowMs - nextDueMs[i]) < 0) return;
+    const J1939RequestEntry &entry = REQUEST_SCHEDULE[i];
+    uint32_t cost = j1939RequestCost(entry);
+    if (budgetTokens < cost) {
+        if (!deferred[i]) j1939NodeStats.budgetDeferred++;
+        deferred[i] = true;
+        return;
+    }
+
+    uint8_t data[3] = { (uint8_t)(entry.pgn & 0xFF), (uint8_t)((entry.pgn >> 8) & 0xFF),
+                        (uint8_t)((entry.pgn >> 16) & 0xFF) };
+    if (!j1939Send(PGN_REQUEST, entry.destination, nodeAddress, data, sizeof(data))) {
+        j1939TxFailed(nowMs);
+        return;
+    }
+    j1939NodeStats.requests++;
+    budgetTokens -= cost;
+    lastRequestMs = nowMs;
+    deferred[i] = false;
+    // Periodo rispettato in media; dopo un ritardo di un periodo intero si
+    // riparte da ora invece di recuperare le richieste perse
+    nextDueMs[i] += entry.periodMs;
+    if ((int32_t)(nowMs - nextDueMs[i]) >= 0) nextDueMs[i] = nowMs + entry.periodMs;
+}
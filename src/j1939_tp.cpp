@@ -0,0 +1,199 @@
+/*
+ * @Description: J1939 Transport Protocol - riassemblaggio multi-pacchetto.
+ * Ogni sessione è identificata dalla coppia (sorgente, destinazione): un
+ * BAM per SA e una connessione RTS/CTS per coppia SA/DA possono procedere
+ * in parallelo. Il costo per frame è costante e non ci sono attese, quindi
+ * più BAM simultanei non rallentano il loop CAN.
+ */
+
+#include "j1939_tp.h"
+#include "j1939.h"
+
+#include <string.h>
+
+enum TpState : uint8_t {
+    TP_FREE,
+    TP_RX_BAM,          // Broadcast in corso
+    TP_RX_CM_DATA,      // Connessione: TP.DT attesi
+    TP_RX_CM_WAIT       // Connessione: in attesa di CTS (dopo RTS o fine blocco)
+};
+
+struct TpSession {
+    TpState state;
+    uint8_t sa;
+    uint8_t da;
+    uint8_t packets;       // Pacchetti totali annunciati
+    uint8_t nextSeq;       // Prossimo numero di sequenza atteso (1..255)
+    uint8_t blockEnd;      // Ultimo pacchetto del blocco autorizzato dal CTS
+    uint16_t size;         // Byte totali annunciati
+    uint32_t pgn;
+    uint32_t deadline;     // Scadenza timeout corrente (ms)
+    uint8_t data[J1939_TP_MAX_SIZE];
+};
+
+J1939TpStats j1939TpStats;
+
+static TpSession tpSessions[J1939_TP_MAX_SESSIONS];
+
+static inline uint32_t tpPgn(const uint8_t *data) {
+    return data[5] | (data[6] << 8) | ((uint32_t)data[7] << 16);
+}
+
+static TpSession *tpFind(uint8_t sa, uint8_t da) {
+    for (uint8_t i = 0; i < J1939_TP_MAX_SESSIONS; i++) {
+        TpSession &session = tpSessions[i];
+        if (session.state != TP_FREE && session.sa == sa && session.da == da) {
+            return &session;
+        }
+    }
+    return NULL;
+}
+
+// Apre una sessione; un nuovo annuncio dalla stessa coppia sostituisce il precedente
+static TpSession *tpOpen(uint8_t sa, uint8_t da, const uint8_t *data, uint32_t now) {
+    uint16_t size = data[1] | (data[2] << 8);
+    uint8_t packets = data[3];
+
+    if (size <= 8 || size > J1939_TP_MAX_SIZE || packets < (size + 6) / 7) return NULL;
+
+    TpSession *session = tpFind(sa, da);
+    if (session != NULL) {
+        j1939TpStats.aborted++;
+    } else {
+        for (uint8_t i = 0; i < J1939_TP_MAX_SESSIONS && session == NULL; i++) {
+            if (tpSessions[i].state == TP_FREE) session = &tpSessions[i];
+        }
+        if (session == NULL) {
+            j1939TpStats.poolFull++;
+            return NULL;
+        }
+    }
+
+    session->sa = sa;
+    session->da = da;
+    session->size = size;
+    session->packets = packets;
+    session->nextSeq = 1;
+    session->blockEnd = packets;
+    session->pgn = tpPgn(data);
+    session->deadline = now;
+    return session;
+}
+
+static void tpClose(TpSession *session) {
+    session->state = TP_FREE;
+}
+
+// Gestione TP.CM (annunci, controllo flusso, chiusura)
+static void tpConnectionManagement(uint8_t sa, uint8_t da, const uint8_t *data, uint32_t now) {
+    TpSession *session;
+
+    switch (data[0]) {
+        case TP_CM_BAM:
+            session = tpOpen(sa, da, data, now);
+            if (session == NULL) return;
+            session->state = TP_RX_BAM;
+            session->deadline = now + TP_TIMEOUT_T1;
+            break;
+
+        case TP_CM_RTS:
+            session = tpOpen(sa, da, data, now);
+            if (session == NULL) return;
+            session->state = TP_RX_CM_WAIT;
+            session->deadline = now + TP_TIMEOUT_T3;
+            break;
+
+        case TP_CM_CTS:
+            // Il CTS viaggia dal ricevente verso il mittente della sessione
+            session = tpFind(da, sa);
+            if (session == NULL || session->state == TP_RX_BAM) return;
+            if (data[1] == 0) {
+                // Richiesta di attesa
+                session->state = TP_RX_CM_WAIT;
+                session->deadline = now + TP_TIMEOUT_T4;
+            } else {
+                // Ritrasmissioni incluse: si riparte dal pacchetto richiesto
+                uint16_t blockEnd = data[2] + data[1] - 1;
+                session->nextSeq = data[2];
+                session->blockEnd = (blockEnd > session->packets) ? session->packets : blockEnd;
+                session->state = TP_RX_CM_DATA;
+                session->deadline = now + TP_TIMEOUT_T2;
+            }
+            break;
+
+        case TP_CM_END_OF_MSG_ACK:
+            // Messaggio già consegnato all'arrivo dell'ultimo TP.DT
+            break;
+
+        case TP_CM_ABORT:
+            // L'abort può arrivare da entrambe le parti
+            session = tpFind(sa, da);
+            if (session == NULL) session = tpFind(da, sa);
+            if (session != NULL && session->state != TP_RX_BAM) {
+                j1939TpStats.aborted++;
+                tpClose(session);
+            }
+            break;
+    }
+}
+
+// Gestione TP.DT (7 byte di dati per pacchetto)
+static void tpDataTransfer(uint8_t sa, uint8_t da, const uint8_t *data, uint8_t length, uint32_t now) {
+    TpSession *session = tpFind(sa, da);
+    if (session == NULL || session->state == TP_RX_CM_WAIT || length < 2) return;
+
+    uint8_t seq = data[0];
+    if (seq != session->nextSeq) {
+        // Duplicato di una ritrasmissione RTS/CTS: ignorato
+        if (session->state == TP_RX_CM_DATA && seq < session->nextSeq) return;
+        j1939TpStats.aborted++;
+        tpClose(session);
+        return;
+    }
+
+    uint16_t offset = (uint16_t)(seq - 1) * 7;
+    if (offset < session->size) {
+        uint16_t chunk = session->size - offset;
+        if (chunk > 7) chunk = 7;
+        if (chunk > length - 1) chunk = length - 1;
+        memcpy(&session->data[offset], &data[1], chunk);
+    }
+
+    if (seq >= session->packets) {
+        // Messaggio completo: stesso percorso di decodifica dei frame singoli
+        j1939TpStats.completed++;
+        j1939DispatchPgn(session->pgn, session->sa, session->data, session->size);
+        tpClose(session);
+        return;
+    }
+
+    session->nextSeq = seq + 1;
+    if (session->state == TP_RX_CM_DATA && seq >= session->blockEnd) {
+        session->state = TP_RX_CM_WAIT;
+        session->deadline = now + TP_TIMEOUT_T3;
+    } else {
+        session->deadline = now + TP_TIMEOUT_T1;
+    }
+}
+
+// Processa un frame TP.CM o TP.DT
+void j1939TpProcessFrame(uint32_t pgn, uint8_t sa, uint8_t da,
+                         const uint8_t *data, uint8_t length, uint32_t now) {
+    if (pgn == PGN_TP_CM) {
+        if (length < 8) return;
+        tpConnectionManagement(sa, da, data, now);
+    } else {
+        tpDataTransfer(sa, da, data, length, now);
+    }
+}
+
+// Chiude le sessioni scadute
+void j1939TpPoll(uint32_t now) {
+    for (uint8_t i = 0; i < J1939_TP_MAX_SESSIONS; i++) {
+        TpSession &session = tpSessions[i];
+        if (session.state != TP_FREE && (int32_t)(now - session.deadline) > 0) {
+            j1939TpStats.timeouts++;
+            tpClose(&session);
+        }
+    }
+}
@@ -0,0 +1,106 @@
+/*
+ * @Description: Encoder JSON su buffer preallocato (vedi json_writer.h)
+ */
+
+#include "json_writer.h"
+
+#include <string.h>
+
+static void jsonPut(JsonWriter &writer, const char *text, size_t length) {
+    // Un byte sempre riservato al terminatore
+    if (writer.overflow || writer.length + length >= writer.size) {
+        writer.overflow = true;
+        return;
+    }
+    memcpy(&writer.buffer[writer.length], text, length);
+    writer.length += length;
+}
+
+static void jsonChar(JsonWriter &writer, char c) {
+    jsonPut(writer, &c, 1);
+}
+
+static void jsonNumber(JsonWriter &writer, uint32_t value) {
+    char digits[10];
+    size_t count = 0;
+    do {
+        digits[sizeof(digits) - 1 - count++] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    jsonPut(writer, &digits[sizeof(digits) - count], count);
+}
+
+// Separatore e chiave (le chiavi sono costanti, senza caratteri da escape)
+static void jsonKey(JsonWriter &writer, const char *key) {
+    if (writer.needComma) jsonChar(writer, ',');
+    writer.needComma = true;
+    if (key == NULL) return;
+    jsonChar(writer, '"');
+    jsonPut(writer, key, strlen(key));
+    jsonPut(writer, "\":", 2);
+}
+
+void jsonBegin(JsonWriter &writer, char *buffer, size_t size) {
+    writer.buffer = buffer;
+    writer.size = size;
+    writer.length = 0;
+    writer.needComma = false;
+    writer.overflow = (size == 0);
+    jsonChar(writer, '{');
+}
+
+size_t jsonEnd(JsonWriter &writer) {
+    jsonChar(writer, '}');
+    if (writer.overflow) {
+        if (writer.size > 0) writer.buffer[0] = '\0';
+        return 0;
+    }
+    writer.buffer[writer.length] = '\0';
+    return writer.length;
+}
+
+void jsonUint(JsonWriter &writer, const char *key, uint32_t value) {
+    jsonKey(writer, key);
+    jsonNumber(writer, value);
+}
+
+void jsonInt(JsonWriter &writer, const char *key, int64_t value) {
+    jsonKey(writer, key);
+    if (value < 0) {
+        jsonChar(writer, '-');
+        value = -value;
+    }
+    jsonNumber(writer, (uint32_t)value);
+}
+
+void jsonNull(JsonWriter &writer, const char *key) {
+    jsonKey(writer, key);
+    jsonPut(writer, "null", 4);
+}
+
+void jsonObjectBegin(JsonWriter &writer, const char *key) {
+    jsonKey(writer, key);
+    jsonChar(writer, '{');
+    writer.needComma = false;
+}
+
+void jsonObjectEnd(JsonWriter &writer) {
+    jsonChar(writer, '}');
+    writer.needComma = true;
+}
+
+void jsonArrayBegin(JsonWriter &writer, const char *key) {
+    jsonKey(writer, key);
+    jsonChar(writer, '[');
+    writer.needComma = false;
+}
+
+void jsonArrayUint(JsonWriter &writer, uint32_t value) {
+    jsonKey(writer, NULL);
+    jsonNumber(writer, value);
+}
+
+void jsonArrayEnd(JsonWriter &writer) {
+    jsonChar(writer, ']');
+    writer.needComma = true;
+}
@@ -0,0 +1,142 @@
+/*
+ * @Description: Codifica JSON dei data set per la dashboard (vedi live_data.h)
+ */
+
+#include "live_data.h"
+#include "json_writer.h"
+
+#include <stddef.h>
+#include <string.h>
+
+// Oltre ai segnali (EngineField, con segno da engineFieldValue), i campi di
+// stato senza segno, letti per offset (lastUpdate cambia a ogni frame ed è
+// escluso dai messaggi differenziali)
+struct LiveDataField {
+    const char *name;
+    uint8_t offset;
+    uint8_t size;
+};
+
+#define LIVE_FIELD(member) { #member, offsetof(EngineData, member), sizeof(EngineData::member) }
+
+static const LiveDataField LIVE_FIELDS[] = {
+    LIVE_FIELD(statusFlags),
+    LIVE_FIELD(errorFlags),
+    LIVE_FIELD(dtcCount),
+    LIVE_FIELD(previousDtcCount),
+    LIVE_FIELD(validFlags),
+    LIVE_FIELD(spnErrorFlags),
+};
+
+static uint32_t liveFieldValue(const EngineData &data, const LiveDataField &field) {
+    const uint8_t *base = reinterpret_cast<const uint8_t *>(&data) + field.offset;
+    if (field.size == 4) {
+        uint32_t value;
+        memcpy(&value, base, 4);
+        return value;
+    }
+    uint16_t value;
+    memcpy(&value, base, 2);
+    return value;
+}
+
+// Scrive i campi di data; con previous solo quelli diversi. Restituisce quanti
+static uint8_t liveDataFields(JsonWriter &writer, const EngineData &data, const EngineData *previous) {
+    uint8_t written = 0;
+    for (uint8_t field = 0; field < FIELD_COUNT; field++) {
+        int64_t value = engineFieldValue(data, (EngineField)field);
+        if (previous != NULL && value == engineFieldValue(*previous, (EngineField)field)) continue;
+        jsonInt(writer, engineFieldName((EngineField)field), value);
+        written++;
+    }
+    for (size_t i = 0; i < sizeof(LIVE_FIELDS) / sizeof(LIVE_FIELDS[0]); i++) {
+        uint32_t value = liveFieldValue(data, LIVE_FIELDS[i]);
+        if (previous != NULL && value == liveFieldValue(*previous, LIVE_FIELDS[i])) continue;
+        jsonUint(writer, LIVE_FIELDS[i].name, value);
+        written++;
+    }
+    return written;
+}
+
+void liveDataReset(LiveDataState &state) {
+    state.count = 0xFF;
+}
+
+size_t liveDataEncodeChanges(LiveDataState &state, char *buffer, size_t size) {
+    uint8_t slots[ENGINE_DATA_MAX_SOURCES];
+    uint8_t count = engineDataSlotsBySource(slots);
+    
+    // Nuova ECU (o primo messaggio): indici dei set cambiati, tutto da reinviare
+    bool renumbered = (count != state.count);
+    for (uint8_t set = 0; set < count && !renumbered; set++) {
+        renumbered = (engineDataSourceAddress(slots[set]) != state.sources[set]);
+    }
+    
+    JsonWriter writer;
+    jsonBegin(writer, buffer, size);
+    bool changed = renumbered;
+    if (renumbered) {
+        jsonArrayBegin(writer, "sources");
+        for (uint8_t set = 0; set < count; set++) {
+            state.sources[set] = engineDataSourceAddress(slots[set]);
+            jsonArrayUint(writer, state.sources[set]);
+        }
+        jsonArrayEnd(writer);
+        state.count = count;
+    }
+    
+    jsonArrayBegin(writer, "sets");
+    for (uint8_t set = 0; set < count; set++) {
+        EngineData data;
+        engineDataRead(slots[set], data);
+        const EngineData *previous = renumbered ? NULL : &state.sent[set];
+        
+        // Oggetto aperto solo se almeno un campo è cambiato
+        size_t mark = writer.length;
+        bool needComma = writer.needComma;
+        jsonObjectBegin(writer, NULL);
+        jsonUint(writer, "set", set);
+        if (previous == NULL) jsonUint(writer, "sa", data.sourceAddress);
+        if (liveDataFields(writer, data, previous) == 0 && previous != NULL) {
+            writer.length = mark;
+            writer.needComma = needComma;
+            continue;
+        }
+        jsonObjectEnd(writer);
+        state.sent[set] = data;
+        changed = true;
+    }
+    jsonArrayEnd(writer);
+    
+    size_t length = jsonEnd(writer);
+    if (length == 0) {
+        // Buffer insufficiente: i client non hanno ricevuto le modifiche
+        liveDataReset(state);
+        return 0;
+    }
+    return changed ? length : 0;
+}
+
+size_t liveDataEncodeSet(char *buffer, size_t size, uint8_t set) {
+    uint8_t slots[ENGINE_DATA_MAX_SOURCES];
+    uint8_t count = engineDataSlotsBySource(slots);
+    if (set >= count) set = 0;
+    
+    EngineData data;
+    memset(&data, 0, sizeof(data));
+    data.statusFlags = 0x8000;  // Nessuna ECU ancora vista
+    if (count > 0) engineDataRead(slots[set], data);
+    
+    JsonWriter writer;
+    jsonBegin(writer, buffer, size);
+    jsonUint(writer, "set", set);
+    jsonUint(writer, "sa", data.sourceAddress);
+    jsonArrayBegin(writer, "sources");
+    for (uint8_t i = 0; i < count; i++) {
+        jsonArrayUint(writer, engineDataSourceAddress(slots[i]));
+    }
+    jsonArrayEnd(writer);
+    liveDataFields(writer, data, NULL);
+    jsonUint(writer, "lastUpdate", data.lastUpdate);
+    return jsonEnd(writer);
+}
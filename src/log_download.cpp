@@ -0,0 +1,289 @@
+/*
+ * @Description: Download dei log CAN della SD (vedi log_download.h)
+ */
+
+#include "log_download.h"
+#include "hal.h"
+
+#include <atomic>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CSV_LINE_SIZE 64
+
+static std::atomic<uint8_t> activeDownloads(0);
+
+static void logFilePath(char *path, size_t size, uint32_t index) {
+    snprintf(path, size, CAN_LOG_DIRECTORY "/%05u.bin", (unsigned)index);
+}
+
+LogDownloadResult logDownloadBegin(LogDownload &download, uint32_t index, LogDownloadFormat format,
+                                   uint64_t fromUs, uint64_t toUs) {
+    if (activeDownloads.fetch_add(1, std::memory_order_relaxed) >= LOG_DOWNLOAD_MAX_ACTIVE) {
+        activeDownloads.fetch_sub(1, std::memory_order_relaxed);
+        return LOG_DOWNLOAD_BUSY;
+    }
+    char path[32];
+    logFilePath(path, sizeof(path), index);
+    download.file = hal_file_open(path);
+    if (download.file == NULL) {
+        activeDownloads.fetch_sub(1, std::memory_order_relaxed);
+        return LOG_DOWNLOAD_NOT_FOUND;
+    }
+    // Il file corrente cresce durante il download: vale la parte già scritta
+    download.size = hal_file_size(download.file);
+    download.position = 0;
+    download.end = download.size;
+    download.fromUs = fromUs;
+    download.toUs = toUs;
+    download.startUs = 0;
+    canLogReaderInit(download.reader);
+    download.blockFrames = 0;
+    download.format = format;
+    download.stage = (format == LOG_FORMAT_CSV) ? 0 : 1;
+    download.started = false;
+    download.blockLoaded = false;
+    return LOG_DOWNLOAD_OK;
+}
+
+bool logDownloadRaw(const LogDownload &download) {
+    return download.format == LOG_FORMAT_BINARY && download.fromUs == 0 && download.toUs == LOG_DOWNLOAD_END_US;
+}
+
+void logDownloadSetRange(LogDownload &download, uint32_t first, uint32_t end) {
+    download.position = first;
+    download.end = (end < download.size) ? end : download.size;
+    if (!hal_file_seek(download.file, first)) download.end = first;
+}
+
+void logDownloadEnd(LogDownload &download) {
+    if (download.file == NULL) return;
+    hal_file_close(download.file);
+    download.file = NULL;
+    activeDownloads.fetch_sub(1, std::memory_order_relaxed);
+}
+
+// Blocco successivo in download.block, false a fine file (anche blocco parziale,
+// il logger lo sta scrivendo)
+static bool loadBlock(LogDownload &download) {
+    if (download.position + CAN_LOG_BLOCK_SIZE > download.end) return false;
+    if (hal_file_read(download.file, download.block, CAN_LOG_BLOCK_SIZE) != CAN_LOG_BLOCK_SIZE) return false;
+    download.position += CAN_LOG_BLOCK_SIZE;
+    return true;
+}
+
+// Tempo dal primo frame del file
+static uint64_t frameOffset(LogDownload &download, const CanLogFrame &frame) {
+    if (!download.started) {
+        download.started = true;
+        download.startUs = frame.timestamp;
+    }
+    return frame.timestamp - download.startUs;
+}
+
+// Binario con intervallo: primo e ultimo frame del blocco
+struct BlockSpan {
+    LogDownload *download;
+    uint64_t firstUs;
+    uint64_t lastUs;
+    bool any;
+};
+
+static void spanFrame(const CanLogFrame &frame, void *ctx) {
+    BlockSpan &span = *(BlockSpan *)ctx;
+    uint64_t offset = frameOffset(*span.download, frame);
+    if (!span.any) span.firstUs = offset;
+    span.lastUs = offset;
+    span.any = true;
+}
+
+static size_t readBlocks(LogDownload &download, uint8_t *buffer, size_t size) {
+    size_t length = 0;
+    for (uint16_t scanned = 0; scanned < LOG_DOWNLOAD_SCAN_BLOCKS && length + CAN_LOG_BLOCK_SIZE <= size; scanned++) {
+        if (!loadBlock(download)) {
+            download.stage = 2;
+            break;
+        }
+        BlockSpan span = { &download, 0, 0, false };
+        canLogReadBlock(download.reader, download.block, spanFrame, &span);
+        if (!span.any || span.lastUs < download.fromUs) continue;
+        if (span.firstUs > download.toUs) {
+            download.stage = 2;
+            break;
+        }
+        memcpy(buffer + length, download.block, CAN_LOG_BLOCK_SIZE);
+        length += CAN_LOG_BLOCK_SIZE;
+    }
+    return length;
+}
+
+// CSV: righe del blocco in download.block; i frame già elaborati in una
+// chiamata precedente (buffer pieno a metà blocco) sono saltati
+struct CsvWriter {
+    LogDownload *download;
+    char *buffer;
+    size_t size;
+    size_t length;
+    uint16_t index;       // Frame del blocco
+    uint16_t done;        // Frame elaborati (scritti o fuori intervallo)
+    bool full;
+    bool past;            // Frame oltre la fine dell'intervallo
+};
+
+static void csvFrame(const CanLogFrame &frame, void *ctx) {
+    CsvWriter &writer = *(CsvWriter *)ctx;
+    LogDownload &download = *writer.download;
+    uint64_t offset = frameOffset(download, frame);
+    if (writer.index++ < download.blockFrames || writer.full || writer.past) return;
+    if (offset > download.toUs) {
+        writer.past = true;
+        return;
+    }
+    if (offset >= download.fromUs) {
+        char line[CSV_LINE_SIZE];
+        size_t length = canLogFormatCsv(line, sizeof(line) - 1, frame, download.startUs);
+        line[length++] = '\n';
+        if (writer.length + length > writer.size) {
+            writer.full = true;
+            return;
+        }
+        memcpy(writer.buffer + writer.length, line, length);
+        writer.length += length;
+    }
+    writer.done = writer.index;
+}
+
+static size_t readCsv(LogDownload &download, uint8_t *buffer, size_t size) {
+    CsvWriter writer = { &download, (char *)buffer, size, 0, 0, 0, false, false };
+    for (uint16_t scanned = 0; scanned < LOG_DOWNLOAD_SCAN_BLOCKS; scanned++) {
+        if (!download.blockLoaded) {
+            if (!loadBlock(download)) {
+                download.stage = 2;
+                break;
+            }
+            download.blockLoaded = true;
+            download.blockFrames = 0;
+        }
+        // Si decodifica da una copia: lo stato avanza solo a blocco finito
+        CanLogReader reader = download.reader;
+        writer.index = 0;
+        writer.done = download.blockFrames;
+        canLogReadBlock(reader, download.block, csvFrame, &writer);
+        if (writer.full) {
+            download.blockFrames = writer.done;
+            break;
+        }
+        download.reader = reader;
+        download.blockLoaded = false;
+        if (writer.past) {
+            download.stage = 2;
+            break;
+        }
+    }
+    return writer.length;
+}
+
+size_t logDownloadRead(LogDownload &download, uint8_t *buffer, size_t size) {
+    if (download.stage == 0) {
+        size_t length = sizeof(CAN_LOG_CSV_HEADER) - 1;
+        if (size < length) return 0;
+        memcpy(buffer, CAN_LOG_CSV_HEADER, length);
+        download.stage = 1;
+        return length;
+    }
+    if (download.stage != 1) return 0;
+    if (download.format == LOG_FORMAT_CSV) return readCsv(download, buffer, size);
+    if (!logDownloadRaw(download)) return readBlocks(download, buffer, size);
+
+    uint32_t remaining = download.end - download.position;
+    size_t length = (size < remaining) ? size : remaining;
+    if (length > LOG_DOWNLOAD_READ_MAX) length = LOG_DOWNLOAD_READ_MAX;
+    length = (length > 0) ? hal_file_read(download.file, buffer, length) : 0;
+    download.position += length;
+    if (length == 0 || download.position >= download.end) download.stage = 2;
+    return length;
+}
+
+// Numero decimale senza segno, NULL se assente o oltre 32 bit
+static const char *parseNumber(const char *p, uint32_t &value) {
+    if (!isdigit((unsigned char)*p)) return NULL;
+    char *end;
+    unsigned long long parsed = strtoull(p, &end, 10);
+    if (parsed > UINT32_MAX) return NULL;
+    value = (uint32_t)parsed;
+    return end;
+}
+
+LogRangeResult logDownloadParseRange(const char *header, uint32_t size, uint32_t &first, uint32_t &end) {
+    if (header == NULL || strncmp(header, "bytes=", 6) != 0 || strchr(header, ',') != NULL) return LOG_RANGE_NONE;
+    const char *p = header + 6;
+    uint32_t a;
+    uint32_t b;
+    if (*p == '-') {
+        // Ultimi n byte
+        p = parseNumber(p + 1, b);
+        if (p == NULL || *p != '\0') return LOG_RANGE_NONE;
+        if (b == 0 || size == 0) return LOG_RANGE_INVALID;
+        first = (b < size) ? size - b : 0;
+        end = size;
+        return LOG_RANGE_OK;
+    }
+    p = parseNumber(p, a);
+    if (p == NULL || *p != '-') return LOG_RANGE_NONE;
+    p++;
+    b = UINT32_MAX;
+    if (*p != '\0') {
+        p = parseNumber(p, b);
+        if (p == NULL || *p != '\0' || b < a) return LOG_RANGE_NONE;
+    }
+    if (a >= size) return LOG_RANGE_INVALID;
+    first = a;
+    end = (b < size - 1) ? b + 1 : size;
+    return LOG_RANGE_OK;
+}
+
+void logListQueryBegin(LogListQuery &query, uint32_t currentIndex, bool logging) {
+    query.next = 0;
+    query.last = currentIndex;
+    query.stage = 0;
+    query.first = true;
+    query.logging = logging;
+}
+
+size_t logListQueryRead(LogListQuery &query, char *buffer, size_t size) {
+    size_t length = 0;
+    if (query.stage == 0) {
+        int written = snprintf(buffer, size, "{\"logging\":%s,\"current\":%u,\"files\":[",
+                               query.logging ? "true" : "false", (unsigned)query.last);
+        if (written < 0 || (size_t)written >= size) return 0;
+        length = written;
+        query.stage = 1;
+    }
+    while (query.stage == 1) {
+        if (query.next > query.last) {
+            if (length + 2 >= size) return length;
+            memcpy(buffer + length, "]}", 2);
+            length += 2;
+            query.stage = 2;
+            break;
+        }
+        char path[32];
+        logFilePath(path, sizeof(path), query.next);
+        uint32_t bytes;
+        if (!hal_storage_size(path, &bytes)) {
+            query.next++;
+            continue;
+        }
+        char item[LOG_LIST_MIN_CHUNK];
+        int written = snprintf(item, sizeof(item), "%s{\"file\":%u,\"name\":\"%05u.bin\",\"bytes\":%u}",
+                               query.first ? "" : ",", (unsigned)query.next, (unsigned)query.next, (unsigned)bytes);
+        if (written < 0 || length + written >= size) return length;
+        memcpy(buffer + length, item, written);
+        length += written;
+        query.next++;
+        query.first = false;
+    }
+    return length;
+}
@@ -9,717 +9,733 @@
 #include "driver/twai.h"
 
 #include <WiFi.h>
-#include <WebServer.h>
+#include <ESPAsyncWebServer.h>
 #include <Preferences.h>
 #include <ArduinoJson.h>
+#include <AsyncMqttClient.h>
+#include <memory>
 
-
-// RS485
-#define RS485_TX 22
-#define RS485_RX 21
-#define RS485_CALLBACK 17
-#define RS485_EN 19
-
-// WS2812B
-#define WS2812B_DATA 4
-
-// CAN
-#define CAN_TX 27
-#define CAN_RX 26
-#define CAN_SPEED_MODE 23
-
-// RS485 and CAN Boost power supply
-#define ME2107_EN 16 
-
-//SD
-#define SD_MISO 2
-#define SD_MOSI 15
-#define SD_SCLK 14
-#define SD_CS 13
-
-// Configurazione Modbus
-#define MODBUS_SLAVE_ID 1
-#define MODBUS_BAUDRATE 19200
-#define MODBUS_SERIAL_MODE SERIAL_8N1
-
-// Configurazione Access Point per provisioning
-#define AP_SSID "Gateway_Setup"
-#define AP_PASSWORD "12345678"
-
-// Codici funzione Modbus
-#define MB_FC_READ_HOLDING_REGISTERS 0x03
-#define MB_FC_READ_INPUT_REGISTERS   0x04
-
-// Registri Modbus (Holding Registers)
-#define MB_REG_ENGINE_RPM           0   // 2 registri (32-bit)
-#define MB_REG_ENGINE_TEMP          2   // 1 registro (16-bit) 
-#define MB_REG_OIL_PRESSURE         3   // 1 registro (16-bit)
-#define MB_REG_FUEL_RATE            4   // 2 registri (32-bit)
-#define MB_REG_ENGINE_HOURS         6   // 2 registri (32-bit)
-#define MB_REG_COOLANT_TEMP         8   // 1 registro (16-bit)
-#define MB_REG_INTAKE_TEMP          9   // 1 registro (16-bit)
-#define MB_REG_EXHAUST_TEMP         10  // 1 registro (16-bit)
-#define MB_REG_ENGINE_LOAD          11  // 1 registro (16-bit)
-#define MB_REG_THROTTLE_POS         12  // 1 registro (16-bit)
-#define MB_REG_ENGINE_TORQUE        13  // 2 registri (32-bit)
-#define MB_REG_BATTERY_VOLTAGE      15  // 1 registro (16-bit)
-#define MB_REG_STATUS_FLAGS         16  // 1 registro (16-bit)
-#define MB_REG_ERROR_FLAGS          17  // 1 registro (16-bit)
-#define MB_REG_DTC_COUNT            18  // 1 registro (16-bit)
-#define MB_REG_LAST_UPDATE          19  // 2 registri (32-bit timestamp)
-
-#define MODBUS_REGISTERS_COUNT      21
-
-// J1939 PGN comuni per motori
-#define PGN_ENGINE_SPEED            0xF004  // 61444 - Engine Speed
-#define PGN_ENGINE_TEMP             0xFEEE  // 65262 - Engine Temperature
-#define PGN_ENGINE_FLUID_LEVEL      0xFEFC  // 65276 - Engine Fluid Level/Pressure
-#define PGN_ENGINE_HOURS            0xFEE5  // 65253 - Engine Hours
-#define PGN_FUEL_ECONOMY            0xFEF2  // 65266 - Fuel Economy
-#define PGN_INTAKE_EXHAUST_COND     0xFEB4  // 65204 - Intake/Exhaust Conditions
-#define PGN_ELECTRONIC_ENGINE_1     0xF003  // 61443 - Electronic Engine Controller 1
-#define PGN_ELECTRONIC_ENGINE_2     0xF004  // 61444 - Electronic Engine Controller 2
-#define PGN_VEHICLE_ELECTRICAL      0xFEF7  // 65271 - Vehicle Electrical Power
-#define PGN_DIAGNOSTIC_MESSAGE_1    0xFECA  // 65226 - DM1 Active Diagnostic Trouble Codes
-
-// Struttura dati motore
-struct EngineData {
-    uint32_t rpm;              // Giri motore
-    uint16_t engineTemp;       // Temperatura motore (°C * 10)
-    uint16_t oilPressure;      // Pressione olio (kPa)
-    uint32_t fuelRate;         // Consumo carburante (L/h * 100)
-    uint32_t engineHours;      // Ore di funzionamento
-    uint16_t coolantTemp;      // Temperatura liquido raffreddamento (°C * 10)
-    uint16_t intakeTemp;       // Temperatura aria aspirazione (°C * 10)
-    uint16_t exhaustTemp;      // Temperatura gas scarico (°C * 10)
-    uint16_t engineLoad;       // Carico motore (%)
-    uint16_t throttlePos;      // Posizione acceleratore (%)
-    uint32_t engineTorque;     // Coppia motore (Nm)
-    uint16_t batteryVoltage;   // Tensione batteria (V * 10)
-    uint16_t statusFlags;      // Flag di stato
-    uint16_t errorFlags;       // Flag errori
-    uint16_t dtcCount;         // Numero codici errore attivi
-    uint32_t lastUpdate;       // Timestamp ultimo aggiornamento
-} engineData;
+#include "bus_discovery.h"
+#include "can_log.h"
+#include "config.h"
+#include "dtc_store.h"
+#include "engine_data.h"
+#include "hal.h"
+#include "history.h"
+#include "j1939.h"
+#include "j1939_command.h"
+#include "j1939_filter.h"
+#include "j1939_node.h"
+#include "live_data.h"
+#include "log_download.h"
+#include "metrics.h"
+#include "modbus_rtu.h"
+#include "modbus_tcp.h"
+#include "mqtt_report.h"
+#include "profiler.h"
+#include "web_assets.h"
 
 // Oggetti globali
-WebServer server(80);
+AsyncWebServer server(80);
+AsyncWebSocket liveSocket("/ws");
+AsyncMqttClient mqttClient;
 Preferences preferences;
 
-// Buffer registri Modbus
-uint16_t modbusRegisters[MODBUS_REGISTERS_COUNT];
-
 // Variabili configurazione
-uint8_t currentSlaveId = MODBUS_SLAVE_ID;
-uint32_t currentBaudrate = MODBUS_BAUDRATE;
-bool wifiConfigured = false;
 String ssid = "";
 String password = "";
+uint32_t livePushIntervalMs = LIVE_PUSH_INTERVAL_MS;
+
+// Nuova rete WiFi dalla pagina di configurazione: riconnessione eseguita da
+// loop dopo l'invio della risposta, non dalla callback del server asincrono
+volatile uint32_t wifiRestartAt = 0;
+
+void canTask(void *param);
+void commandTask(void *param);
+void modbusTask(void *param);
+void webTask(void *param);
+void logTask(void *param);
+void mqttTask(void *param);
+
+// Task pinnato a un core, registrato nel profiler per lo stack libero
+static void startTask(TaskFunction_t function, const char *name, uint32_t stackSize,
+                      UBaseType_t priority, BaseType_t core) {
+    TaskHandle_t task = NULL;
+    xTaskCreatePinnedToCore(function, name, stackSize, NULL, priority, &task, core);
+    profileTaskRegister(name, task, stackSize);
+}
 
 // Buffer Modbus
 uint8_t modbusBuffer[256];
 
-// HTML per pagina web
-const char index_html[] PROGMEM = R"rawliteral(
-<!DOCTYPE HTML>
-<html>
-<head>
-    <title>Gateway Modbus-CAN J1939</title>
-    <meta name="viewport" content="width=device-width, initial-scale=1">
-    <style>
-        body { 
-            font-family: Arial; 
-            margin: 20px;
-            background-color: #f0f0f0;
-        }
-        .container {
-            max-width: 800px;
-            margin: 0 auto;
-            background-color: white;
-            padding: 20px;
-            border-radius: 10px;
-            box-shadow: 0 0 10px rgba(0,0,0,0.1);
-        }
-        h1 { 
-            color: #333;
-            text-align: center;
-        }
-        .data-grid {
-            display: grid;
-            grid-template-columns: repeat(auto-fit, minmax(250px, 1fr));
-            gap: 15px;
-            margin-top: 20px;
-        }
-        .data-item {
-            background-color: #f8f8f8;
-            padding: 15px;
-            border-radius: 5px;
-            border: 1px solid #ddd;
-        }
-        .data-label {
-            font-weight: bold;
-            color: #555;
-            margin-bottom: 5px;
-        }
-        .data-value {
-            font-size: 1.2em;
-            color: #333;
-        }
-        .status {
-            padding: 5px 10px;
-            border-radius: 3px;
-            display: inline-block;
-            margin-top: 10px;
-        }
-        .status-ok { background-color: #4CAF50; color: white; }
-        .status-warning { background-color: #ff9800; color: white; }
-        .status-error { background-color: #f44336; color: white; }
-        .config-section {
-            margin-top: 30px;
-            padding: 20px;
-            background-color: #f0f0f0;
-            border-radius: 5px;
-        }
-        input[type="text"], input[type="password"], input[type="number"] {
-            width: 100%;
-            padding: 8px;
-            margin: 5px 0;
-            box-sizing: border-box;
-        }
-        button {
-            background-color: #4CAF50;
-            color: white;
-            padding: 10px 20px;
-            border: none;
-            border-radius: 4px;
-            cursor: pointer;
-            margin-top: 10px;
-        }
-        button:hover {
-            background-color: #45a049;
-        }
-    </style>
-</head>
-<body>
-    <div class="container">
-        <h1>Gateway Modbus-CAN J1939</h1>
-        
-        <div id="connectionStatus"></div>
-        
-        <h2>Dati Motore in Tempo Reale</h2>
-        <div class="data-grid" id="engineData">
-            <div class="data-item">
-                <div class="data-label">RPM Motore</div>
-                <div class="data-value" id="rpm">-</div>
-            </div>
-            <div class="data-item">
-                <div class="data-label">Temperatura Motore</div>
-                <div class="data-value" id="engineTemp">-</div>
-            </div>
-            <div class="data-item">
-                <div class="data-label">Pressione Olio</div>
-                <div class="data-value" id="oilPressure">-</div>
-            </div>
-            <div class="data-item">
-                <div class="data-label">Consumo Carburante</div>
-                <div class="data-value" id="fuelRate">-</div>
-            </div>
-            <div class="data-item">
-                <div class="data-label">Ore di Funzionamento</div>
-                <div class="data-value" id="engineHours">-</div>
-            </div>
-            <div class="data-item">
-                <div class="data-label">Temp. Liquido Raff.</div>
-                <div class="data-value" id="coolantTemp">-</div>
-            </div>
-            <div class="data-item">
-                <div class="data-label">Carico Motore</div>
-                <div class="data-value" id="engineLoad">-</div>
-            </div>
-            <div class="data-item">
-                <div class="data-label">Tensione Batteria</div>
-                <div class="data-value" id="batteryVoltage">-</div>
-            </div>
-            <div class="data-item">
-                <div class="data-label">Codici Errore Attivi</div>
-                <div class="data-value" id="dtcCount">-</div>
-            </div>
-        </div>
-        
-        <div class="config-section">
-            <h3>Configurazione WiFi</h3>
-            <form action="/wifi" method="POST">
-                <label>SSID:</label>
-                <input type="text" name="ssid" required>
-                
-                <label>Password:</label>
-                <input type="password" name="password">
-                
-                <button type="submit">Salva Configurazione WiFi</button>
-            </form>
-        </div>
-        
-        <div class="config-section">
-            <h3>Configurazione Modbus</h3>
-            <form action="/modbus" method="POST">
-                <label>Slave ID:</label>
-                <input type="number" name="slaveId" min="1" max="247" value="1">
-                
-                <label>Baudrate:</label>
-                <select name="baudrate">
-                    <option value="9600">9600</option>
-                    <option value="19200" selected>19200</option>
-                    <option value="38400">38400</option>
-                    <option value="57600">57600</option>
-                    <option value="115200">115200</option>
-                </select>
-                
-                <button type="submit">Salva Configurazione Modbus</button>
-            </form>
-        </div>
-    </div>
-    
-    <script>
-        // Aggiorna dati ogni 2 secondi
-        setInterval(updateData, 2000);
-        
-        function updateData() {
-            fetch('/data')
-                .then(response => response.json())
-                .then(data => {
-                    document.getElementById('rpm').textContent = data.rpm + ' RPM';
-                    document.getElementById('engineTemp').textContent = (data.engineTemp / 10).toFixed(1) + ' °C';
-                    document.getElementById('oilPressure').textContent = data.oilPressure + ' kPa';
-                    document.getElementById('fuelRate').textContent = (data.fuelRate / 100).toFixed(2) + ' L/h';
-                    document.getElementById('engineHours').textContent = data.engineHours + ' h';
-                    document.getElementById('coolantTemp').textContent = (data.coolantTemp / 10).toFixed(1) + ' °C';
-                    document.getElementById('engineLoad').textContent = data.engineLoad + ' %';
-                    document.getElementById('batteryVoltage').textContent = (data.batteryVoltage / 10).toFixed(1) + ' V';
-                    document.getElementById('dtcCount').textContent = data.dtcCount;
-                    
-                    let statusText = '';
-                    let statusClass = '';
-                    
-                    if (data.statusFlags & 0x8000) {
-                        statusText = 'Errore Comunicazione CAN';
-                        statusClass = 'status-error';
-                    } else {
-                        statusText = 'Connesso';
-                        statusClass = 'status-ok';
-                    }
-                    
-                    document.getElementById('connectionStatus').innerHTML = 
-                        '<span class="status ' + statusClass + '">' + statusText + '</span>';
-                })
-                .catch(error => console.error('Error:', error));
-        }
-        
-        // Carica dati iniziali
-        updateData();
-    </script>
-</body>
-</html>
-)rawliteral";
-
-// Calcola CRC16 Modbus
-uint16_t calculateCRC16(uint8_t *data, uint16_t length) {
-    uint16_t crc = 0xFFFF;
-    for (uint16_t i = 0; i < length; i++) {
-        crc ^= (uint16_t)data[i];
-        for (uint8_t j = 0; j < 8; j++) {
-            if (crc & 0x0001) {
-                crc >>= 1;
-                crc ^= 0xA001;
-            } else {
-                crc >>= 1;
-            }
-        }
+// Pagina di conferma: la configurazione è già attiva, nessun riavvio
+static void sendSaved(AsyncWebServerRequest *request, const char *detail) {
+    String page = String("<h1>Configurazione salvata!</h1><p>") + detail + "</p>";
+    request->send(200, "text/html", page);
+}
+
+// Risorsa web gzip servita direttamente dalla flash, 304 se il browser ha
+// già la versione corrente
+static void sendWebAsset(AsyncWebServerRequest *request, const WebAsset &asset) {
+    const char *cacheControl = asset.immutable ? WEB_CACHE_IMMUTABLE : WEB_CACHE_REVALIDATE;
+    AsyncWebServerResponse *response;
+    if (request->hasHeader("If-None-Match") &&
+        webEtagMatches(request->getHeader("If-None-Match")->value().c_str(), asset.etag)) {
+        response = request->beginResponse(304);
+    } else if (request->hasHeader("Accept-Encoding") &&
+               webAcceptsGzip(request->getHeader("Accept-Encoding")->value().c_str())) {
+        response = request->beginResponse_P(200, asset.contentType, asset.data, asset.length);
+        response->addHeader("Content-Encoding", "gzip");
+    } else {
+        // Nessuna copia non compressa a bordo
+        request->send(406, "text/plain", "Il browser non accetta contenuti gzip");
+        return;
     }
-    return crc;
+    response->addHeader("ETag", asset.etag);
+    response->addHeader("Cache-Control", cacheControl);
+    response->addHeader("Vary", "Accept-Encoding");
+    request->send(response);
 }
 
-// Aggiorna registri Modbus con dati motore
-void updateModbusRegisters() {
-    // RPM motore (32-bit)
-    modbusRegisters[MB_REG_ENGINE_RPM] = (engineData.rpm >> 16) & 0xFFFF;
-    modbusRegisters[MB_REG_ENGINE_RPM + 1] = engineData.rpm & 0xFFFF;
-    
-    // Temperature e pressioni (16-bit)
-    modbusRegisters[MB_REG_ENGINE_TEMP] = engineData.engineTemp;
-    modbusRegisters[MB_REG_OIL_PRESSURE] = engineData.oilPressure;
-    
-    // Consumo carburante (32-bit)
-    modbusRegisters[MB_REG_FUEL_RATE] = (engineData.fuelRate >> 16) & 0xFFFF;
-    modbusRegisters[MB_REG_FUEL_RATE + 1] = engineData.fuelRate & 0xFFFF;
-    
-    // Ore motore (32-bit)
-    modbusRegisters[MB_REG_ENGINE_HOURS] = (engineData.engineHours >> 16) & 0xFFFF;
-    modbusRegisters[MB_REG_ENGINE_HOURS + 1] = engineData.engineHours & 0xFFFF;
-    
-    // Altri parametri
-    modbusRegisters[MB_REG_COOLANT_TEMP] = engineData.coolantTemp;
-    modbusRegisters[MB_REG_INTAKE_TEMP] = engineData.intakeTemp;
-    modbusRegisters[MB_REG_EXHAUST_TEMP] = engineData.exhaustTemp;
-    modbusRegisters[MB_REG_ENGINE_LOAD] = engineData.engineLoad;
-    modbusRegisters[MB_REG_THROTTLE_POS] = engineData.throttlePos;
-    
-    // Coppia motore (32-bit)
-    modbusRegisters[MB_REG_ENGINE_TORQUE] = (engineData.engineTorque >> 16) & 0xFFFF;
-    modbusRegisters[MB_REG_ENGINE_TORQUE + 1] = engineData.engineTorque & 0xFFFF;
-    
-    // Tensione e flag
-    modbusRegisters[MB_REG_BATTERY_VOLTAGE] = engineData.batteryVoltage;
-    modbusRegisters[MB_REG_STATUS_FLAGS] = engineData.statusFlags;
-    modbusRegisters[MB_REG_ERROR_FLAGS] = engineData.errorFlags;
-    modbusRegisters[MB_REG_DTC_COUNT] = engineData.dtcCount;
-    
-    // Timestamp ultimo aggiornamento (32-bit)
-    modbusRegisters[MB_REG_LAST_UPDATE] = (engineData.lastUpdate >> 16) & 0xFFFF;
-    modbusRegisters[MB_REG_LAST_UPDATE + 1] = engineData.lastUpdate & 0xFFFF;
+// Mappa registri in JSON:
+// {"bankStride":32,"registers":[{"address":0,"table":"holding|input|both",
+//  "signal":"rpm","type":"u16|i16|u32|i32|f32","order":"hi|lo","gain":1,"offset":0}]}
+static const char *const REGMAP_TABLES[] = { "", "holding", "input", "both" };
+
+static const char *regmapLoadJson(const char *json) {
+    static ModbusMapEntry entries[MODBUS_MAP_MAX_ENTRIES];
+    JsonDocument doc;
+    if (deserializeJson(doc, json) != DeserializationError::Ok) return "JSON non valido";
+    JsonArrayConst registers = doc["registers"];
+    if (registers.size() > MODBUS_MAP_MAX_ENTRIES) return "Troppi registri nella mappa";
+    
+    size_t count = 0;
+    for (JsonObjectConst reg : registers) {
+        ModbusMapEntry &entry = entries[count++];
+        int signal = modbusMapSignalIndex(reg["signal"] | "");
+        int type = modbusMapTypeIndex(reg["type"] | "u16");
+        const char *table = reg["table"] | "both";
+        const char *order = reg["order"] | "hi";
+        if (signal < 0 || type < 0 || !reg["address"].is<uint16_t>()) return "Voce della mappa non valida";
+        entry.address = reg["address"];
+        entry.signal = signal;
+        entry.type = type;
+        entry.tables = 0;
+        for (uint8_t t = MODBUS_TABLE_HOLDING; t <= MODBUS_TABLE_BOTH; t++) {
+            if (strcmp(table, REGMAP_TABLES[t]) == 0) entry.tables = t;
+        }
+        entry.wordOrder = (strcmp(order, "lo") == 0) ? MODBUS_ORDER_LOW_FIRST : MODBUS_ORDER_HIGH_FIRST;
+        entry.gain = reg["gain"] | 1.0f;
+        entry.offset = reg["offset"] | 0.0f;
+    }
+    return modbusMapLoad(entries, count, doc["bankStride"] | MODBUS_BANK_SIZE);
 }
 
-// Processa richiesta Modbus
-void processModbusRequest() {
-    if (Serial1.available() < 8) return;  // Minimo 8 byte per una richiesta valida
-    
-    uint8_t request[256];
-    int len = 0;
-    
-    // Leggi tutti i byte disponibili
-    while (Serial1.available() && len < 256) {
-        request[len++] = Serial1.read();
+static String regmapToJson() {
+    ModbusMap *map = new ModbusMap;
+    {
+        std::lock_guard<std::mutex> lock(modbusMutex);
+        *map = modbusMap;
     }
-    
-    // Verifica CRC
-    uint16_t receivedCRC = (request[len-1] << 8) | request[len-2];
-    uint16_t calculatedCRC = calculateCRC16(request, len-2);
-    
-    if (receivedCRC != calculatedCRC) return;  // CRC errato
-    
-    // Verifica slave ID
-    if (request[0] != currentSlaveId) return;  // Non per noi
-    
-    // Processa in base al codice funzione
-    uint8_t functionCode = request[1];
-    uint16_t startAddress = (request[2] << 8) | request[3];
-    uint16_t quantity = (request[4] << 8) | request[5];
-    
-    switch (functionCode) {
-        case MB_FC_READ_HOLDING_REGISTERS:
-        case MB_FC_READ_INPUT_REGISTERS: {
-            // Verifica limiti
-            if (startAddress + quantity > MODBUS_REGISTERS_COUNT) {
-                // Invia eccezione
-                uint8_t exception[5];
-                exception[0] = currentSlaveId;
-                exception[1] = functionCode | 0x80;
-                exception[2] = 0x02;  // Illegal data address
-                uint16_t exceptionCrc = calculateCRC16(exception, 3);
-                exception[3] = exceptionCrc & 0xFF;
-                exception[4] = (exceptionCrc >> 8) & 0xFF;
-                Serial1.write(exception, 5);
-                return;
-            }
-            
-            // Aggiorna registri
-            updateModbusRegisters();
-            
-            // Prepara risposta
-            uint8_t response[256];
-            response[0] = currentSlaveId;
-            response[1] = functionCode;
-            response[2] = quantity * 2;  // Byte count
-            
-            // Copia dati registri
-            for (uint16_t i = 0; i < quantity; i++) {
-                uint16_t value = modbusRegisters[startAddress + i];
-                response[3 + i*2] = (value >> 8) & 0xFF;
-                response[3 + i*2 + 1] = value & 0xFF;
-            }
-            
-            // Calcola e aggiungi CRC
-            uint16_t responseCrc = calculateCRC16(response, 3 + quantity * 2);
-            response[3 + quantity * 2] = responseCrc & 0xFF;
-            response[3 + quantity * 2 + 1] = (responseCrc >> 8) & 0xFF;
-            
-            // Invia risposta
-            Serial1.write(response, 5 + quantity * 2);
-            break;
-        }
-            
-        default: {
-            // Funzione non supportata
-            uint8_t exception[5];
-            exception[0] = currentSlaveId;
-            exception[1] = functionCode | 0x80;
-            exception[2] = 0x01;  // Illegal function
-            uint16_t exceptionCrc = calculateCRC16(exception, 3);
-            exception[3] = exceptionCrc & 0xFF;
-            exception[4] = (exceptionCrc >> 8) & 0xFF;
-            Serial1.write(exception, 5);
-            break;
-        }
+    JsonDocument doc;
+    doc["bankStride"] = map->bankStride;
+    JsonArray registers = doc["registers"].to<JsonArray>();
+    for (uint8_t i = 0; i < map->count; i++) {
+        const ModbusMapEntry &entry = map->entries[i];
+        JsonObject reg = registers.add<JsonObject>();
+        reg["address"] = entry.address;
+        reg["table"] = REGMAP_TABLES[entry.tables];
+        reg["signal"] = modbusMapSignalName(entry.signal);
+        reg["type"] = modbusMapTypeName(entry.type);
+        reg["order"] = (entry.wordOrder == MODBUS_ORDER_LOW_FIRST) ? "lo" : "hi";
+        reg["gain"] = entry.gain;
+        reg["offset"] = entry.offset;
     }
+    delete map;
+    String json;
+    serializeJson(doc, json);
+    return json;
 }
 
-// Inizializza CAN bus per J1939
-void CAN_J1939_Init() {
-    // Configura per J1939 (250 kbps)
-    twai_general_config_t g_config = TWAI_GENERAL_CONFIG_DEFAULT((gpio_num_t)CAN_TX, (gpio_num_t)CAN_RX, TWAI_MODE_NORMAL);
-    twai_timing_config_t t_config = TWAI_TIMING_CONFIG_250KBITS();
-    
-    // Filtra solo PGN di interesse
-    twai_filter_config_t f_config = {
-        .acceptance_code = 0x00000000,
-        .acceptance_mask = 0x00000000,  // Accetta tutti per ora
-        .single_filter = true
-    };
-    
-    // Installa driver TWAI
-    if (twai_driver_install(&g_config, &t_config, &f_config) == ESP_OK) {
-        Serial.println("CAN driver installed");
-    } else {
-        Serial.println("Failed to install CAN driver");
-        return;
+// Mappa attiva in NVS come voci binarie (il JSON supera il limite delle stringhe)
+static void regmapSave() {
+    std::lock_guard<std::mutex> lock(modbusMutex);
+    preferences.putBytes("regmap", modbusMap.entries, modbusMap.count * sizeof(ModbusMapEntry));
+    preferences.putUShort("regstride", modbusMap.bankStride);
+}
+
+static void regmapRestore() {
+    static ModbusMapEntry entries[MODBUS_MAP_MAX_ENTRIES];
+    size_t size = preferences.getBytesLength("regmap");
+    if (size == 0 || size % sizeof(ModbusMapEntry) != 0 || size > sizeof(entries)) return;
+    preferences.getBytes("regmap", entries, size);
+    const char *error = modbusMapLoad(entries, size / sizeof(ModbusMapEntry),
+                                      preferences.getUShort("regstride", MODBUS_BANK_SIZE));
+    if (error != NULL) Serial.printf("Saved register map rejected (%s), using default\n", error);
+}
+
+// Registri di configurazione scritti dal master (task Modbus, con
+// modbusMutex acquisito): salvataggio rimandato a loop
+static volatile bool modbusConfigPending = false;
+
+static void onModbusConfigChanged() {
+    modbusConfigPending = true;
+}
+
+static void saveModbusConfig() {
+    modbusConfigPending = false;
+    preferences.putInt("slaveId", currentSlaveId);
+    preferences.putInt("baudrate", currentBaudrate);
+    preferences.putInt("setMapping", modbusSetMapping);
+}
+
+// Nuovo client WebSocket: il prossimo invio sarà lo stato completo di tutte
+// le ECU (per tutti i client, così nessuno resta con campi non aggiornati)
+static volatile bool liveFullPending = true;
+
+static void onLiveSocketEvent(AsyncWebSocket *socket, AsyncWebSocketClient *client,
+                              AwsEventType type, void *arg, uint8_t *data, size_t len) {
+    if (type == WS_EVT_CONNECT) liveFullPending = true;
+}
+
+// MQTT: il client asincrono gira nel task async_tcp, le callback impostano
+// solo lo stato; report, coda e configurazione sono gestiti da mqttTask
+static volatile bool mqttConnected = false;
+static volatile bool mqttReconfigure = true;  // Configurazione da (ri)leggere da NVS
+static char mqttStatusTopic[64];
+static char mqttClientId[32];
+
+// Broker in uso: scritto solo da mqttTask, a client disconnesso (setServer
+// tiene il puntatore a host). Gli altri task ne leggono una copia con mqttBrokerRead
+struct MqttBrokerConfig {
+    char host[64];       // Vuoto: MQTT disattivato
+    uint16_t port;
+    char topic[41];
+};
+
+static MqttBrokerConfig mqttBroker = { "", MQTT_DEFAULT_PORT, MQTT_TOPIC_PREFIX };
+static std::mutex mqttBrokerMutex;
+
+static void mqttBrokerRead(MqttBrokerConfig &broker) {
+    std::lock_guard<std::mutex> lock(mqttBrokerMutex);
+    broker = mqttBroker;
+}
+
+static void mqttConfigRestore(MqttReportConfig &config) {
+    config = MQTT_REPORT_DEFAULTS;
+    if (preferences.getBytesLength("mqttDb") == sizeof(config.deadband)) {
+        preferences.getBytes("mqttDb", config.deadband, sizeof(config.deadband));
+    }
+    config.maxAgeMs = preferences.getUInt("mqttAgeMs", MQTT_MAX_AGE_MS);
+    config.flushIntervalMs = preferences.getUInt("mqttFlushMs", MQTT_FLUSH_INTERVAL_MS);
+}
+
+static bool mqttPublish(uint8_t sourceAddress, const char *payload, size_t length, void *context) {
+    char topic[64];
+    snprintf(topic, sizeof(topic), "%s/ecu/%u", mqttBroker.topic, sourceAddress);
+    return mqttClient.publish(topic, 1, false, payload, length) != 0;
+}
+
+// Broker e report dalla configurazione salvata (task MQTT, client disconnesso).
+// Coda dei report allocata solo con un broker
+static void mqttApplyConfig() {
+    MqttBrokerConfig broker = {};
+    broker.port = preferences.getUShort("mqttPort", MQTT_DEFAULT_PORT);
+    preferences.getString("mqttHost", broker.host, sizeof(broker.host));
+    if (preferences.getString("mqttTopic", broker.topic, sizeof(broker.topic)) == 0) {
+        strlcpy(broker.topic, MQTT_TOPIC_PREFIX, sizeof(broker.topic));
     }
     
-    // Avvia driver
-    if (twai_start() == ESP_OK) {
-        Serial.println("CAN driver started");
-    } else {
-        Serial.println("Failed to start CAN driver");
+    MqttReportConfig config;
+    mqttConfigRestore(config);
+    if (broker.host[0] != '\0' && !mqttReportBegin(config)) {
+        Serial.println("MQTT disabled: no memory for the report queue");
+        broker.host[0] = '\0';
+    }
+    {
+        std::lock_guard<std::mutex> lock(mqttBrokerMutex);
+        mqttBroker = broker;
     }
     
-    // Configura alert
-    uint32_t alerts_to_enable = TWAI_ALERT_RX_DATA | TWAI_ALERT_BUS_ERROR | 
-                                TWAI_ALERT_ERR_PASS | TWAI_ALERT_TX_FAILED;
-    twai_reconfigure_alerts(alerts_to_enable, NULL);
+    // Stato del gateway: "online" alla connessione, "offline" dal broker (will)
+    snprintf(mqttStatusTopic, sizeof(mqttStatusTopic), "%s/status", mqttBroker.topic);
+    mqttClient.setServer(mqttBroker.host, mqttBroker.port);
+    mqttClient.setWill(mqttStatusTopic, 1, true, "offline");
 }
 
-// Estrai PGN dal CAN ID (formato J1939)
-uint32_t getPGN(uint32_t canId) {
-    // J1939 usa extended ID (29-bit)
-    // PGN è nei bit 8-25 del CAN ID
-    uint32_t pf = (canId >> 16) & 0xFF;  // PDU Format
-    uint32_t ps = (canId >> 8) & 0xFF;   // PDU Specific
-    
-    if (pf < 240) {
-        // PDU1 format - PS è destination address
-        return (pf << 8);
-    } else {
-        // PDU2 format - PS fa parte del PGN
-        return (pf << 8) | ps;
+static void setupMqtt() {
+    snprintf(mqttClientId, sizeof(mqttClientId), "j1939gw-%012llx", (unsigned long long)ESP.getEfuseMac());
+    mqttClient.setClientId(mqttClientId);
+    mqttClient.onConnect([](bool sessionPresent) {
+        mqttClient.publish(mqttStatusTopic, 1, true, "online");
+        mqttConnected = true;
+    });
+    mqttClient.onDisconnect([](AsyncMqttClientDisconnectReason reason) {
+        mqttConnected = false;
+    });
+    startTask(mqttTask, "mqtt", MQTT_TASK_STACK, MQTT_TASK_PRIORITY, MQTT_TASK_CORE);
+}
+
+static String mqttToJson() {
+    MqttReportConfig config;
+    mqttConfigRestore(config);
+    MqttBrokerConfig broker;
+    mqttBrokerRead(broker);
+    JsonDocument doc;
+    doc["host"] = broker.host;
+    doc["port"] = broker.port;
+    doc["topic"] = broker.topic;
+    doc["connected"] = (bool)mqttConnected;
+    doc["flushMs"] = config.flushIntervalMs;
+    doc["maxAgeMs"] = config.maxAgeMs;
+    JsonObject deadbands = doc["deadband"].to<JsonObject>();
+    for (uint8_t field = 0; field < FIELD_COUNT; field++) {
+        deadbands[engineFieldName((EngineField)field)] = config.deadband[field];
     }
+    doc["queued"] = mqttReportQueued();
+    doc["messages"] = mqttReportStats.messages;
+    doc["published"] = mqttReportStats.published;
+    doc["dropped"] = mqttReportStats.dropped;
+    String json;
+    serializeJson(doc, json);
+    return json;
 }
 
-// Processa messaggio J1939
-void processJ1939Message(twai_message_t &message) {
-    if (!message.extd) return;  // J1939 usa solo extended frame
+// Setup server web
+void setupWebServer() {
+    // Interfaccia: pagina, script e stile compressi in flash (web_assets.h)
+    for (uint8_t i = 0; i < WEB_ASSET_COUNT; i++) {
+        const WebAsset *asset = &WEB_ASSETS[i];
+        server.on(asset->path, HTTP_GET, [asset](AsyncWebServerRequest *request){
+            sendWebAsset(request, *asset);
+        });
+    }
     
-    uint32_t pgn = getPGN(message.identifier);
-    uint8_t sa = message.identifier & 0xFF;  // Source Address
+    // Dati in tempo reale: push via WebSocket
+    liveSocket.onEvent(onLiveSocketEvent);
+    server.addHandler(&liveSocket);
+    
+    // API per lettura singola: ?set=N seleziona la N-esima ECU per
+    // indirizzo sorgente (stesso ordine dei banchi Modbus)
+    server.on("/data", HTTP_GET, [](AsyncWebServerRequest *request){
+        char json[LIVE_DATA_BUFFER / ENGINE_DATA_MAX_SOURCES + 128];
+        uint8_t set = request->hasParam("set") ? request->getParam("set")->value().toInt() : 0;
+        liveDataEncodeSet(json, sizeof(json), set);
+        request->send(200, "application/json", json);
+    });
     
-    switch (pgn) {
-        case PGN_ENGINE_SPEED:
-            // Byte 3-4: Engine Speed (0.125 rpm/bit)
-            if (message.data_length_code >= 4) {
-                engineData.rpm = ((message.data[3] << 8) | message.data[2]) * 0.125;
-                engineData.lastUpdate = millis();
-            }
-            break;
-            
-        case PGN_ENGINE_TEMP:
-            // Byte 0: Engine Coolant Temperature (1°C/bit, -40°C offset)
-            if (message.data_length_code >= 1) {
-                int16_t temp = message.data[0] - 40;
-                engineData.coolantTemp = (temp * 10);  // Memorizza in °C * 10
-                engineData.lastUpdate = millis();
-            }
-            break;
-            
-        case PGN_ENGINE_FLUID_LEVEL:
-            // Byte 3: Engine Oil Pressure (4 kPa/bit)
-            if (message.data_length_code >= 4) {
-                engineData.oilPressure = message.data[3] * 4;
-                engineData.lastUpdate = millis();
+    // Storico: /history?set=N&field=rpm&tier=1s|1m|1h&count=K, ultimi K
+    // intervalli. Risposta a pezzi generata dallo storico senza buffer intero
+    server.on("/history", HTTP_GET, [](AsyncWebServerRequest *request){
+        int field = request->hasParam("field") ? historyFieldIndex(request->getParam("field")->value().c_str()) : -1;
+        int tier = historyTierIndex(request->hasParam("tier") ? request->getParam("tier")->value().c_str() : "1s");
+        uint8_t set = request->hasParam("set") ? request->getParam("set")->value().toInt() : 0;
+        uint32_t count = request->hasParam("count") ? request->getParam("count")->value().toInt() : 0xFFFFFFFF;
+        HistoryQuery query;
+        if (field < 0 || tier < 0) {
+            request->send(400, "text/plain", "Parametri non validi");
+            return;
+        }
+        if (!historyQueryBegin(query, set, field, tier, count, millis())) {
+            request->send(404, "text/plain", "Data set senza storico");
+            return;
+        }
+        request->send(request->beginChunkedResponse("application/json",
+            [query](uint8_t *buffer, size_t maxLen, size_t index) mutable -> size_t {
+                if (query.stage == 2) return 0;
+                if (maxLen < HISTORY_QUERY_MIN_CHUNK) return RESPONSE_TRY_AGAIN;
+                return historyQueryRead(query, (char *)buffer, maxLen);
+            }));
+    });
+    
+    // Codici errore decodificati: /dtc (tutte le ECU) o /dtc?sa=S, attivi e
+    // precedentemente attivi, a pezzi dal registro DTC
+    server.on("/dtc", HTTP_GET, [](AsyncWebServerRequest *request){
+        uint16_t sa = DTC_QUERY_ALL;
+        if (request->hasParam("sa")) {
+            long value = request->getParam("sa")->value().toInt();
+            if (value < 0 || value > 0xFF) {
+                request->send(400, "text/plain", "Indirizzo sorgente non valido");
+                return;
             }
-            break;
-            
-        case PGN_ENGINE_HOURS:
-            // Byte 0-3: Engine Total Hours of Operation (0.05 hr/bit)
-            if (message.data_length_code >= 4) {
-                uint32_t hours = (message.data[3] << 24) | (message.data[2] << 16) | 
-                                (message.data[1] << 8) | message.data[0];
-                engineData.engineHours = hours * 0.05;
-                engineData.lastUpdate = millis();
+            sa = value;
+        }
+        DtcQuery query;
+        dtcQueryBegin(query, sa);
+        request->send(request->beginChunkedResponse("application/json",
+            [query](uint8_t *buffer, size_t maxLen, size_t index) mutable -> size_t {
+                if (query.stage == 2) return 0;
+                if (maxLen < DTC_QUERY_MIN_CHUNK) return RESPONSE_TRY_AGAIN;
+                return dtcQueryRead(query, (char *)buffer, maxLen);
+            }));
+    });
+    
+    // Inventario del bus: /discovery (tutte le coppie PGN/SA viste) o
+    // /discovery?sa=S, a pezzi dalla tabella
+    server.on("/discovery", HTTP_GET, [](AsyncWebServerRequest *request){
+        uint16_t sa = BUS_DISCOVERY_ALL;
+        if (request->hasParam("sa")) {
+            long value = request->getParam("sa")->value().toInt();
+            if (value < 0 || value > 0xFF) {
+                request->send(400, "text/plain", "Indirizzo sorgente non valido");
+                return;
             }
-            break;
-            
-        case PGN_FUEL_ECONOMY:
-            // Byte 0-1: Fuel Rate (0.05 L/h per bit)
-            if (message.data_length_code >= 2) {
-                uint16_t rate = (message.data[1] << 8) | message.data[0];
-                engineData.fuelRate = rate * 5;  // Memorizza in L/h * 100
-                engineData.lastUpdate = millis();
+            sa = value;
+        }
+        BusDiscoveryQuery query;
+        busDiscoveryQueryBegin(query, sa, j1939FilterOpen(), millis());
+        request->send(request->beginChunkedResponse("application/json",
+            [query](uint8_t *buffer, size_t maxLen, size_t index) mutable -> size_t {
+                if (query.stage == 2) return 0;
+                if (maxLen < BUS_DISCOVERY_MIN_CHUNK) return RESPONSE_TRY_AGAIN;
+                return busDiscoveryQueryRead(query, (char *)buffer, maxLen);
+            }));
+    });
+    
+    // open=1 apre il filtro di accettazione a tutto il traffico (open=0 lo
+    // riporta ai PGN decodificati), reset=1 svuota la tabella
+    server.on("/discovery", HTTP_POST, [](AsyncWebServerRequest *request){
+        if (!request->hasParam("open", true) && !request->hasParam("reset", true)) {
+            request->send(400, "text/plain", "Parametri mancanti");
+            return;
+        }
+        if (request->hasParam("open", true)) {
+            j1939SetFilterOpen(request->getParam("open", true)->value().toInt() != 0);
+        }
+        if (request->hasParam("reset", true) && request->getParam("reset", true)->value().toInt() != 0) {
+            busDiscoveryReset();
+        }
+        request->send(200, "text/plain", "OK");
+    });
+    
+    // Log CAN della SD: elenco dei file canlog/NNNNN.bin con la dimensione
+    server.on("/logs", HTTP_GET, [](AsyncWebServerRequest *request){
+        if (!canLogActive()) {
+            request->send(503, "text/plain", "SD non disponibile");
+            return;
+        }
+        LogListQuery query;
+        logListQueryBegin(query, canLogStats.fileIndex, true);
+        request->send(request->beginChunkedResponse("application/json",
+            [query](uint8_t *buffer, size_t maxLen, size_t index) mutable -> size_t {
+                if (query.stage == 2) return 0;
+                if (maxLen < LOG_LIST_MIN_CHUNK) return RESPONSE_TRY_AGAIN;
+                return logListQueryRead(query, (char *)buffer, maxLen);
+            }));
+    });
+
+    // Download: /log?file=N (con Range per riprendere), &from=ms&to=ms per
+    // i soli blocchi dell'intervallo, &format=csv per la conversione. Letto a
+    // pezzi dalla SD nel buffer di invio, mai intero in RAM
+    server.on("/log", HTTP_GET, [](AsyncWebServerRequest *request){
+        long file = request->hasParam("file") ? request->getParam("file")->value().toInt() : -1;
+        long from = request->hasParam("from") ? request->getParam("from")->value().toInt() : 0;
+        long to = request->hasParam("to") ? request->getParam("to")->value().toInt() : -1;
+        if (file < 0 || from < 0 || (request->hasParam("to") && to < from)) {
+            request->send(400, "text/plain", "Parametri non validi");
+            return;
+        }
+        LogDownloadFormat format = LOG_FORMAT_BINARY;
+        if (request->hasParam("format")) {
+            const String &name = request->getParam("format")->value();
+            if (name == "csv") {
+                format = LOG_FORMAT_CSV;
+            } else if (name != "bin") {
+                request->send(400, "text/plain", "Formato non valido");
+                return;
             }
-            break;
-            
-        case PGN_VEHICLE_ELECTRICAL:
-            // Byte 4-5: Battery Potential (0.05 V/bit)
-            if (message.data_length_code >= 6) {
-                uint16_t voltage = (message.data[5] << 8) | message.data[4];
-                engineData.batteryVoltage = voltage * 0.5;  // Memorizza in V * 10
-                engineData.lastUpdate = millis();
+        }
+        uint64_t toUs = (to < 0) ? LOG_DOWNLOAD_END_US : (uint64_t)to * 1000;
+        LogDownload *state = new LogDownload;
+        LogDownloadResult result = logDownloadBegin(*state, file, format, (uint64_t)from * 1000, toUs);
+        if (result != LOG_DOWNLOAD_OK) {
+            delete state;
+            if (result == LOG_DOWNLOAD_BUSY) {
+                request->send(503, "text/plain", "Troppi download in corso");
+            } else {
+                request->send(404, "text/plain", "File non trovato");
             }
-            break;
-            
-        case PGN_ELECTRONIC_ENGINE_1:
-            // Byte 2: Engine Percent Load At Current Speed (1%/bit)
-            // Byte 1: Driver's Demand Engine - Percent Torque (1%/bit, -125 offset)
-            if (message.data_length_code >= 3) {
-                engineData.engineLoad = message.data[2];
-                int16_t torque = message.data[1] - 125;
-                engineData.throttlePos = max(0, (int)torque);  // Usa come indicazione acceleratore
-                engineData.lastUpdate = millis();
+            return;
+        }
+        // Chiuso con l'ultima copia della callback, anche a connessione persa
+        std::shared_ptr<LogDownload> download(state, [](LogDownload *d) {
+            logDownloadEnd(*d);
+            delete d;
+        });
+        char disposition[64];
+        snprintf(disposition, sizeof(disposition), "attachment; filename=\"%05u.%s\"",
+                 (unsigned)file, (format == LOG_FORMAT_CSV) ? "csv" : "bin");
+
+        AsyncWebServerResponse *response;
+        if (logDownloadRaw(*download)) {
+            // Lunghezza nota: Content-Length e intervalli di byte
+            uint32_t size = download->size;
+            uint32_t first = 0;
+            uint32_t end = size;
+            LogRangeResult range = logDownloadParseRange(
+                request->hasHeader("Range") ? request->getHeader("Range")->value().c_str() : NULL, size, first, end);
+            if (range == LOG_RANGE_INVALID) {
+                response = request->beginResponse(416, "text/plain", "Intervallo non valido");
+                char contentRange[32];
+                snprintf(contentRange, sizeof(contentRange), "bytes */%u", (unsigned)size);
+                response->addHeader("Content-Range", contentRange);
+                request->send(response);
+                return;
             }
-            break;
-            
-        case PGN_DIAGNOSTIC_MESSAGE_1:
-            // Conta DTC attivi
-            if (message.data_length_code >= 2) {
-                // Byte 0-1: Lamp status e flash codes
-                engineData.errorFlags = (message.data[0] << 8) | message.data[1];
-                // I DTC seguono dal byte 2 in poi (ogni DTC è 4 byte)
-                engineData.dtcCount = (message.data_length_code - 2) / 4;
-                engineData.lastUpdate = millis();
+            logDownloadSetRange(*download, first, end);
+            response = request->beginResponse("application/octet-stream", end - first,
+                [download](uint8_t *buffer, size_t maxLen, size_t index) mutable -> size_t {
+                    return logDownloadRead(*download, buffer, maxLen);
+                });
+            response->addHeader("Accept-Ranges", "bytes");
+            if (range == LOG_RANGE_OK) {
+                char contentRange[48];
+                snprintf(contentRange, sizeof(contentRange), "bytes %u-%u/%u",
+                         (unsigned)first, (unsigned)(end - 1), (unsigned)size);
+                response->setCode(206);
+                response->addHeader("Content-Range", contentRange);
             }
-            break;
-    }
-}
-
-// Task per gestione CAN
-void CAN_Task() {
-    // Controlla alert
-    uint32_t alerts_triggered;
-    twai_read_alerts(&alerts_triggered, 0);
-    
-    // Se ci sono dati disponibili
-    if (alerts_triggered & TWAI_ALERT_RX_DATA) {
-        twai_message_t message;
-        while (twai_receive(&message, 0) == ESP_OK) {
-            processJ1939Message(message);
+        } else {
+            // Lunghezza nota solo alla fine: risposta chunked
+            response = request->beginChunkedResponse(
+                (format == LOG_FORMAT_CSV) ? "text/csv" : "application/octet-stream",
+                [download](uint8_t *buffer, size_t maxLen, size_t index) mutable -> size_t {
+                    if (download->stage == 2) return 0;
+                    if (maxLen < LOG_DOWNLOAD_MIN_CHUNK) return RESPONSE_TRY_AGAIN;
+                    size_t length = logDownloadRead(*download, buffer, maxLen);
+                    return (length == 0 && download->stage != 2) ? RESPONSE_TRY_AGAIN : length;
+                });
         }
-    }
-    
-    // Gestione errori bus
-    if (alerts_triggered & TWAI_ALERT_BUS_ERROR) {
-        twai_status_info_t status;
-        twai_get_status_info(&status);
-        Serial.printf("CAN Bus Error! Error count: %d\n", status.bus_error_count);
-    }
-}
+        response->addHeader("Content-Disposition", disposition);
+        request->send(response);
+    });
 
-// Setup server web
-void setupWebServer() {
-    // Pagina principale
-    server.on("/", [](){
-        server.send_P(200, "text/html", index_html);
+    // Metriche in formato testo Prometheus, generate a pezzi
+    server.on("/metrics", HTTP_GET, [](AsyncWebServerRequest *request){
+        MetricsCursor cursor;
+        metricsBegin(cursor);
+        request->send(request->beginChunkedResponse("text/plain; version=0.0.4",
+            [cursor](uint8_t *buffer, size_t maxLen, size_t index) mutable -> size_t {
+                if (maxLen < METRICS_MIN_CHUNK) return RESPONSE_TRY_AGAIN;
+                return metricsRead(cursor, (char *)buffer, maxLen);
+            }));
     });
     
-    // API per dati in tempo reale
-    server.on("/data", [](){
-        String json = "{";
-        json += "\"rpm\":" + String(engineData.rpm) + ",";
-        json += "\"engineTemp\":" + String(engineData.engineTemp) + ",";
-        json += "\"oilPressure\":" + String(engineData.oilPressure) + ",";
-        json += "\"fuelRate\":" + String(engineData.fuelRate) + ",";
-        json += "\"engineHours\":" + String(engineData.engineHours) + ",";
-        json += "\"coolantTemp\":" + String(engineData.coolantTemp) + ",";
-        json += "\"intakeTemp\":" + String(engineData.intakeTemp) + ",";
-        json += "\"exhaustTemp\":" + String(engineData.exhaustTemp) + ",";
-        json += "\"engineLoad\":" + String(engineData.engineLoad) + ",";
-        json += "\"throttlePos\":" + String(engineData.throttlePos) + ",";
-        json += "\"engineTorque\":" + String(engineData.engineTorque) + ",";
-        json += "\"batteryVoltage\":" + String(engineData.batteryVoltage) + ",";
-        json += "\"statusFlags\":" + String(engineData.statusFlags) + ",";
-        json += "\"errorFlags\":" + String(engineData.errorFlags) + ",";
-        json += "\"dtcCount\":" + String(engineData.dtcCount) + ",";
-        json += "\"lastUpdate\":" + String(engineData.lastUpdate);
-        json += "}";
-        
-        server.send(200, "application/json", json);
+    // Profiler dei task: tempi per sezione, jitter, stack libero (POST azzera)
+    server.on("/profile", HTTP_GET, [](AsyncWebServerRequest *request){
+        char report[PROFILE_REPORT_SIZE];
+        profileReport(report, sizeof(report));
+        request->send(200, "text/plain", report);
+    });
+    server.on("/profile", HTTP_POST, [](AsyncWebServerRequest *request){
+        profileReset();
+        request->send(200, "text/plain", "Statistiche azzerate");
     });
     
     // Configurazione WiFi
-    server.on("/wifi", HTTP_POST, [](){
-        if (server.hasArg("ssid")) {
-            ssid = server.arg("ssid");
-            password = server.hasArg("password") ? server.arg("password") : "";
-            
-            preferences.putString("ssid", ssid);
-            preferences.putString("password", password);
+    server.on("/wifi", HTTP_POST, [](AsyncWebServerRequest *request){
+        if (request->hasParam("ssid", true)) {
+            // Solo NVS: ssid e password sono di loop, che li rilegge in wifiBegin
+            preferences.putString("ssid", request->getParam("ssid", true)->value());
+            preferences.putString("password", request->hasParam("password", true)
+                ? request->getParam("password", true)->value() : String());
             
-            server.send(200, "text/html", "<h1>Configurazione salvata!</h1><p>Il dispositivo si riavvierà...</p>");
-            delay(2000);
-            ESP.restart();
+            // La risposta parte prima di lasciare la rete (o l'AP) corrente
+            sendSaved(request, "Connessione alla nuova rete in corso.");
+            wifiRestartAt = millis() + 1000;
         } else {
-            server.send(400, "text/plain", "Parametri mancanti");
+            request->send(400, "text/plain", "Parametri mancanti");
         }
     });
     
-    // Configurazione Modbus
-    server.on("/modbus", HTTP_POST, [](){
-        if (server.hasArg("slaveId") && server.hasArg("baudrate")) {
-            currentSlaveId = server.arg("slaveId").toInt();
-            currentBaudrate = server.arg("baudrate").toInt();
-            
-            preferences.putInt("slaveId", currentSlaveId);
-            preferences.putInt("baudrate", currentBaudrate);
+    // Configurazione Modbus, applicata subito: slave ID dalla richiesta
+    // successiva, baudrate al confine del frame RTU successivo
+    server.on("/modbus", HTTP_POST, [](AsyncWebServerRequest *request){
+        if (request->hasParam("slaveId", true) && request->hasParam("baudrate", true)) {
+            long slaveId = request->getParam("slaveId", true)->value().toInt();
+            long baudrate = request->getParam("baudrate", true)->value().toInt();
+            if (slaveId < 1 || slaveId > 247) {
+                request->send(400, "text/plain", "Slave ID non valido");
+                return;
+            }
+            if (baudrate < 1200 || baudrate > MODBUS_MAX_BAUDRATE) {
+                request->send(400, "text/plain", "Baudrate non valido");
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(modbusMutex);
+                uint16_t setMapping = modbusSetMapping;
+                if (request->hasParam("setMapping", true)) {
+                    setMapping = request->getParam("setMapping", true)->value().toInt() ? MODBUS_MAP_REGISTER_BANK : MODBUS_MAP_UNIT_ID;
+                }
+                modbusConfigApply(slaveId, baudrate, setMapping);
+            }
             
-            server.send(200, "text/html", "<h1>Configurazione salvata!</h1><p>Il dispositivo si riavvierà...</p>");
-            delay(2000);
-            ESP.restart();
+            saveModbusConfig();
+            sendSaved(request, "Nuova configurazione Modbus attiva.");
         } else {
-            server.send(400, "text/plain", "Parametri mancanti");
+            request->send(400, "text/plain", "Parametri mancanti");
         }
     });
     
-    server.begin();
-}
-
-// Setup WiFi
-void setupWiFi() {
-    // Leggi configurazione salvata
-    ssid = preferences.getString("ssid", "");
-    password = preferences.getString("password", "");
+    // Mappa registri Modbus: lettura e sostituzione senza riavvio (map vuota =
+    // mappa di default)
+    server.on("/regmap", HTTP_GET, [](AsyncWebServerRequest *request){
+        request->send(200, "application/json", regmapToJson());
+    });
     
-    if (ssid.length() > 0) {
-        // Prova a connettersi
-        Serial.printf("Connecting to WiFi: %s\n", ssid.c_str());
-        WiFi.mode(WIFI_STA);
-        WiFi.begin(ssid.c_str(), password.c_str());
-        
-        // Timeout 20 secondi
-        unsigned long startTime = millis();
-        while (WiFi.status() != WL_CONNECTED && millis() - startTime < 20000) {
-            delay(500);
-            Serial.print(".");
+    server.on("/regmap", HTTP_POST, [](AsyncWebServerRequest *request){
+        if (!request->hasParam("map", true)) {
+            request->send(400, "text/plain", "Parametri mancanti");
+            return;
         }
-        
-        if (WiFi.status() == WL_CONNECTED) {
-            wifiConfigured = true;
-            Serial.printf("\nConnected! IP: %s\n", WiFi.localIP().toString().c_str());
+        const String &json = request->getParam("map", true)->value();
+        const char *error = (json.length() == 0)
+            ? modbusMapLoad(MODBUS_DEFAULT_MAP, MODBUS_DEFAULT_MAP_COUNT, MODBUS_BANK_SIZE)
+            : regmapLoadJson(json.c_str());
+        if (error != NULL) {
+            request->send(400, "text/plain", error);
             return;
         }
-    }
+        if (json.length() == 0) {
+            preferences.remove("regmap");
+            preferences.remove("regstride");
+        } else {
+            regmapSave();
+        }
+        request->send(200, "application/json", regmapToJson());
+    });
     
-    // Se non configurato o fallito, avvia AP
-    Serial.println("\nStarting Access Point...");
-    WiFi.mode(WIFI_AP);
-    WiFi.softAP(AP_SSID, AP_PASSWORD);
+    // MQTT report-by-exception: broker, intervallo di flush, età massima e
+    // bande morte per segnale (db_<campo>, unità di /data). host vuoto = disattivato
+    server.on("/mqtt", HTTP_GET, [](AsyncWebServerRequest *request){
+        request->send(200, "application/json", mqttToJson());
+    });
+    
+    server.on("/mqtt", HTTP_POST, [](AsyncWebServerRequest *request){
+        if (!request->hasParam("host", true)) {
+            request->send(400, "text/plain", "Parametri mancanti");
+            return;
+        }
+        MqttReportConfig config;
+        mqttConfigRestore(config);
+        if (request->hasParam("flushMs", true)) {
+            config.flushIntervalMs = request->getParam("flushMs", true)->value().toInt();
+            if (config.flushIntervalMs < MQTT_MIN_FLUSH_INTERVAL_MS) config.flushIntervalMs = MQTT_MIN_FLUSH_INTERVAL_MS;
+        }
+        if (request->hasParam("maxAgeMs", true)) {
+            config.maxAgeMs = request->getParam("maxAgeMs", true)->value().toInt();
+        }
+        for (uint8_t field = 0; field < FIELD_COUNT; field++) {
+            String name = String("db_") + engineFieldName((EngineField)field);
+            if (request->hasParam(name, true)) {
+                config.deadband[field] = request->getParam(name, true)->value().toInt();
+            }
+        }
+        String topic = request->hasParam("topic", true) ? request->getParam("topic", true)->value()
+                                                        : preferences.getString("mqttTopic", MQTT_TOPIC_PREFIX);
+        if (topic.length() == 0 || topic.length() >= sizeof(MqttBrokerConfig::topic)) {
+            request->send(400, "text/plain", "Topic non valido");
+            return;
+        }
+        const String &host = request->getParam("host", true)->value();
+        if (host.length() >= sizeof(MqttBrokerConfig::host)) {
+            request->send(400, "text/plain", "Host non valido");
+            return;
+        }
+        
+        preferences.putString("mqttHost", host);
+        preferences.putUShort("mqttPort", request->hasParam("port", true)
+            ? request->getParam("port", true)->value().toInt() : MQTT_DEFAULT_PORT);
+        preferences.putString("mqttTopic", topic);
+        preferences.putUInt("mqttFlushMs", config.flushIntervalMs);
+        preferences.putUInt("mqttAgeMs", config.maxAgeMs);
+        preferences.putBytes("mqttDb", config.deadband, sizeof(config.deadband));
+        
+        mqttReconfigure = true;
+        sendSaved(request, "Riconnessione al broker MQTT in corso.");
+    });
+    
+    // Frequenza di aggiornamento della dashboard
+    server.on("/web", HTTP_POST, [](AsyncWebServerRequest *request){
+        if (request->hasParam("pushMs", true)) {
+            uint32_t interval = request->getParam("pushMs", true)->value().toInt();
+            if (interval < LIVE_PUSH_MIN_INTERVAL_MS) interval = LIVE_PUSH_MIN_INTERVAL_MS;
+            livePushIntervalMs = interval;
+            preferences.putUInt("pushMs", livePushIntervalMs);
+            request->redirect("/");
+        } else {
+            request->send(400, "text/plain", "Parametri mancanti");
+        }
+    });
     
+    server.begin();
+}
+
+// WiFi: connessione in background, CAN e Modbus sono già in servizio. Senza
+// rete configurata, o se la rete non risponde entro WIFI_CONNECT_TIMEOUT_MS,
+// si apre l'Access Point di provisioning; la stazione continua a riprovare e
+// l'AP si chiude alla prima connessione
+enum WifiState : uint8_t {
+    WIFI_STATE_CONNECTING,
+    WIFI_STATE_CONNECTED,
+    WIFI_STATE_AP
+};
+
+static WifiState wifiState = WIFI_STATE_AP;
+static uint32_t wifiStartedAt = 0;
+
+static void wifiStartAp() {
+    Serial.println("Starting Access Point...");
+    WiFi.mode(ssid.length() > 0 ? WIFI_AP_STA : WIFI_AP);
+    WiFi.softAP(AP_SSID, AP_PASSWORD);
+    wifiState = WIFI_STATE_AP;
     Serial.printf("AP Started. Connect to %s\n", AP_SSID);
-    Serial.printf("IP: %s\n", WiFi.softAPIP().toString().c_str());
+    Serial.printf("Configure WiFi at: http://%s\n", WiFi.softAPIP().toString().c_str());
+}
+
+// Avvio o nuova configurazione (da loop): non attende la connessione
+void wifiBegin() {
+    ssid = preferences.getString("ssid", "");
+    password = preferences.getString("password", "");
+    WiFi.disconnect();
+    if (ssid.length() == 0) {
+        wifiStartAp();
+        return;
+    }
+    Serial.printf("Connecting to WiFi: %s\n", ssid.c_str());
+    WiFi.mode(WIFI_STA);
+    WiFi.setAutoReconnect(true);
+    WiFi.begin(ssid.c_str(), password.c_str());
+    wifiState = WIFI_STATE_CONNECTING;
+    wifiStartedAt = millis();
+}
+
+void wifiService(uint32_t now) {
+    bool connected = WiFi.status() == WL_CONNECTED;
+    switch (wifiState) {
+        case WIFI_STATE_CONNECTING:
+            if (!connected && now - wifiStartedAt >= WIFI_CONNECT_TIMEOUT_MS) wifiStartAp();
+            break;
+        case WIFI_STATE_AP:
+            if (!connected) break;
+            WiFi.softAPdisconnect(true);
+            WiFi.mode(WIFI_STA);
+            break;
+        case WIFI_STATE_CONNECTED:
+            // Connessione persa: riconnessione automatica, AP dopo il timeout
+            if (!connected) {
+                Serial.println("WiFi connection lost");
+                wifiState = WIFI_STATE_CONNECTING;
+                wifiStartedAt = now;
+            }
+            return;
+    }
+    if (connected && wifiState != WIFI_STATE_CONNECTED) {
+        wifiState = WIFI_STATE_CONNECTED;
+        Serial.printf("Connected! IP: %s\n", WiFi.localIP().toString().c_str());
+        Serial.printf("Web interface: http://%s\n", WiFi.localIP().toString().c_str());
+    }
 }
 
 void setup() {
@@ -729,13 +745,14 @@ void setup() {
     // Inizializza preferences
     preferences.begin("gateway", false);
     
+    // setup() e loop() girano nel task loopTask del core Arduino
+    profileTaskRegister("loop", xTaskGetCurrentTaskHandle(), CONFIG_ARDUINO_LOOP_STACK_SIZE);
+    
     // Abilita alimentazione periferiche
     pinMode(ME2107_EN, OUTPUT);
     digitalWrite(ME2107_EN, HIGH);
     
-    // Configura RS485
-    pinMode(RS485_EN, OUTPUT);
-    digitalWrite(RS485_EN, HIGH);  // Abilita RS485
+    // Configura RS485 (RS485_EN è pilotato dalla UART in modalità half-duplex)
     pinMode(RS485_CALLBACK, OUTPUT);
     digitalWrite(RS485_CALLBACK, HIGH);  // Disabilita callback
     
@@ -743,60 +760,216 @@ void setup() {
     pinMode(CAN_SPEED_MODE, OUTPUT);
     digitalWrite(CAN_SPEED_MODE, LOW);  // High speed mode
     
-    // Inizializza struttura dati motore
-    memset(&engineData, 0, sizeof(engineData));
-    
-    // Inizializza CAN per J1939
+    // Inizializza CAN per J1939; nodo con identità dal MAC (unica per scheda)
     CAN_J1939_Init();
+    j1939NodeBegin(j1939MakeName((uint32_t)ESP.getEfuseMac()), millis());
     
     // Leggi configurazione Modbus
     currentSlaveId = preferences.getInt("slaveId", MODBUS_SLAVE_ID);
     currentBaudrate = preferences.getInt("baudrate", MODBUS_BAUDRATE);
+    modbusSetMapping = preferences.getInt("setMapping", MODBUS_SET_MAPPING);
+    livePushIntervalMs = preferences.getUInt("pushMs", LIVE_PUSH_INTERVAL_MS);
+    regmapRestore();
+    modbusConfigChanged = onModbusConfigChanged;
+    
+    // Inizializza Modbus RTU slave su UART1 (RS485)
+    modbusRtuBegin();
+    
+    // Storico dallo heap prima del task CAN che lo alimenta
+    bool historyReady = historyBegin();
+    
+    // CAN e Modbus RTU in servizio subito, prima di SD e rete: non dipendono
+    // dai tempi del web server né dalla connessione WiFi
+    startTask(canTask, "can", CAN_TASK_STACK, CAN_TASK_PRIORITY, CAN_TASK_CORE);
+    startTask(modbusTask, "modbus", MODBUS_TASK_STACK, MODBUS_TASK_PRIORITY, MODBUS_TASK_CORE);
+    startTask(commandTask, "command", COMMAND_TASK_STACK, COMMAND_TASK_PRIORITY, COMMAND_TASK_CORE);
+    
+    // Logger CAN su SD (disattivato se la scheda manca), attivato a task CAN avviato
+    if (canLogBegin()) {
+        startTask(logTask, "canlog", LOG_TASK_STACK, LOG_TASK_PRIORITY, LOG_TASK_CORE);
+    }
     
-    // Inizializza Modbus RTU slave su Serial1 (RS485)
-    Serial1.begin(currentBaudrate, MODBUS_SERIAL_MODE, RS485_RX, RS485_TX);
-    
-    // Setup WiFi e Web Server
-    setupWiFi();
+    // WiFi in background, Web Server, Modbus TCP e MQTT
+    wifiBegin();
     setupWebServer();
+    modbusTcpBegin();
+    setupMqtt();
+    startTask(webTask, "web", WEB_TASK_STACK, WEB_TASK_PRIORITY, WEB_TASK_CORE);
     
     Serial.println("Gateway ready!");
     Serial.printf("Modbus Slave ID: %d\n", currentSlaveId);
     Serial.printf("Modbus Baudrate: %d\n", currentBaudrate);
-    Serial.println("CAN J1939: 250 kbps");
-    
-    if (wifiConfigured) {
-        Serial.printf("Web interface: http://%s\n", WiFi.localIP().toString().c_str());
+    Serial.printf("Modbus data sets: %s\n",
+        modbusSetMapping == MODBUS_MAP_UNIT_ID ? "one slave ID per ECU" : "register banks");
+    Serial.printf("Modbus TCP port: %d\n", MODBUS_TCP_PORT);
+    Serial.printf("Modbus register map: %u entries, bank stride %u, config registers at 0x%04X\n",
+        (unsigned)modbusMap.count, (unsigned)modbusMap.bankStride, MODBUS_CONFIG_BASE);
+    if (historyReady) {
+        Serial.printf("History: %u signals x %u sets, %u bytes\n",
+            (unsigned)HISTORY_FIELD_COUNT, (unsigned)HISTORY_SOURCES, (unsigned)HISTORY_MEMORY_BYTES);
     } else {
-        Serial.printf("Configure WiFi at: http://%s\n", WiFi.softAPIP().toString().c_str());
+        Serial.printf("History disabled: %u bytes not available\n", (unsigned)HISTORY_MEMORY_BYTES);
     }
+    Serial.println("CAN J1939: 250 kbps");
 }
 
-void loop() {
-    // Gestisci comunicazione CAN
-    CAN_Task();
-    
-    // Gestisci richieste Modbus
-    processModbusRequest();
-    
-    // Gestisci server web
-    server.handleClient();
-    
-    // Timeout dati - marca come non validi se troppo vecchi
-    if (millis() - engineData.lastUpdate > 5000) {
-        engineData.statusFlags |= 0x8000;  // Set bit errore comunicazione
-    } else {
-        engineData.statusFlags &= ~0x8000;  // Clear bit errore
+// Task CAN: bloccato su twai_receive finché non arrivano frame
+void canTask(void *param) {
+    for (;;) {
+        CAN_Task(CAN_RX_TIMEOUT_MS);
     }
-    
+}
+
+// Task comandi J1939: risvegliato dal tick del timer hardware, trasmette gli
+// slot scaduti. Prelaziona il task CAN sullo stesso core, lavoro breve
+void commandTask(void *param) {
+    if (!hal_tick_begin(J1939_COMMAND_TICK_US)) {
+        Serial.println("J1939 command timer unavailable, command output disabled");
+        vTaskDelete(NULL);
+    }
+    for (;;) {
+        if (!hal_tick_wait(100)) continue;
+        uint32_t profileStart = profileBegin(PROFILE_COMMAND);
+        j1939CommandService(micros(), millis());
+        profileEnd(PROFILE_COMMAND, profileStart);
+    }
+}
+
+// Task Modbus RTU: risvegliato dagli eventi UART, indipendente dal web server
+void modbusTask(void *param) {
+    for (;;) {
+        processModbusRequest(MODBUS_RX_TIMEOUT_MS);
+    }
+}
+
+// Task web: il server asincrono gira nel task async_tcp, qui si inviano a
+// tutti i client WebSocket i campi cambiati. textAll condivide un solo
+// buffer tra tutti i client, quindi un'allocazione per invio
+void webTask(void *param) {
+    static char buffer[LIVE_DATA_BUFFER];
+    static LiveDataState state;
+    for (;;) {
+        vTaskDelay(pdMS_TO_TICKS(livePushIntervalMs));
+        uint32_t profileStart = profileBegin(PROFILE_WEB);
+        liveSocket.cleanupClients();
+        if (liveSocket.count() > 0) {
+            if (liveFullPending) {
+                liveFullPending = false;
+                liveDataReset(state);
+            }
+            size_t length = liveDataEncodeChanges(state, buffer, sizeof(buffer));
+            if (length > 0) liveSocket.textAll(buffer, length);
+        }
+        profileEnd(PROFILE_WEB, profileStart);
+    }
+}
+
+// Task logger: svuota il ring dei frame CAN e scrive sulla SD. A bassa
+// priorità sul core 0, le latenze della scheda non toccano il task CAN
+void logTask(void *param) {
+    for (;;) {
+        uint32_t profileStart = profileBegin(PROFILE_LOG);
+        canLogService(millis());
+        profileEnd(PROFILE_LOG, profileStart);
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+}
+
+// Task MQTT: report-by-exception e svuotamento della coda, con riconnessione
+// non bloccante. Legge solo i data set pubblicati, mai i task CAN e Modbus
+void mqttTask(void *param) {
+    uint32_t lastAttempt = 0;
+    for (;;) {
+        vTaskDelay(pdMS_TO_TICKS(MQTT_POLL_MS));
+        uint32_t profileStart = profileBegin(PROFILE_MQTT);
+        uint32_t now = millis();
+        if (mqttReconfigure) {
+            // Nuova configurazione da /mqtt: chiude la sessione e riparte
+            mqttReconfigure = false;
+            if (mqttClient.connected()) mqttClient.disconnect(true);
+            mqttConnected = false;
+            mqttApplyConfig();
+            lastAttempt = now - MQTT_RECONNECT_MS;
+        }
+        if (mqttBroker.host[0] != '\0') {
+            if (!mqttConnected && WiFi.isConnected() && now - lastAttempt >= MQTT_RECONNECT_MS) {
+                lastAttempt = now;
+                mqttClient.connect();
+            }
+            mqttReportService(now, mqttConnected ? mqttPublish : NULL, NULL);
+        }
+        profileEnd(PROFILE_MQTT, profileStart);
+    }
+}
+
+void loop() {
     // Debug periodico (opzionale)
-    static uint32_t lastDebug = 0;
-    if (millis() - lastDebug > 5000) {
-        lastDebug = millis();
-        Serial.printf("RPM: %d, Temp: %.1f°C, Oil: %d kPa, Load: %d%%\n", 
-            engineData.rpm, 
-            engineData.coolantTemp / 10.0, 
-            engineData.oilPressure,
-            engineData.engineLoad);
+    uint32_t profileStart = profileBegin(PROFILE_STATUS);
+    uint8_t count = engineDataSourceCount();
+    for (uint8_t slot = 0; slot < count; slot++) {
+        EngineData data;
+        engineDataRead(slot, data);
+        Serial.printf("SA %u - RPM: %d, Temp: %.1f°C, Oil: %d kPa, Load: %d%%\n",
+            data.sourceAddress,
+            data.rpm, 
+            (int16_t)data.coolantTemp / 10.0, 
+            data.oilPressure,
+            data.engineLoad);
+    }
+    Serial.printf("CAN frames: %u accepted, %u rejected in software, %u from untracked ECUs\n",
+        j1939RxStats.accepted,
+        j1939RxStats.softwareRejected,
+        j1939RxStats.sourcesDropped);
+    Serial.printf("J1939 node: address 0x%02X, %u requests, %u deferred by budget, %u TX failed, backoff %u ms\n",
+        j1939NodeAddress(),
+        j1939NodeStats.requests,
+        j1939NodeStats.budgetDeferred,
+        j1939NodeStats.txFailed,
+        j1939NodeStats.backoffMs);
+    Serial.printf("J1939 commands: %u frames, %u TX failed, %u overruns, %u timeouts, max late %u us\n",
+        j1939CommandStats.frames,
+        j1939CommandStats.txFailed,
+        j1939CommandStats.overruns,
+        j1939CommandStats.timeouts,
+        j1939CommandStats.maxLateUs);
+    Serial.printf("Bus discovery: %u PGN/SA pairs, %u frames untracked, filter %s\n",
+        busDiscoveryStats.pairs,
+        busDiscoveryStats.untracked,
+        j1939FilterOpen() ? "open" : "decoded PGNs");
+    MqttBrokerConfig broker;
+    mqttBrokerRead(broker);
+    if (broker.host[0] != '\0') {
+        Serial.printf("MQTT: %s, %u messages, %u published, %u dropped, %u queued\n",
+            mqttConnected ? "connected" : "disconnected",
+            mqttReportStats.messages,
+            mqttReportStats.published,
+            mqttReportStats.dropped,
+            mqttReportQueued());
+    }
+    if (canLogActive()) {
+        Serial.printf("CAN log: file %u, %u frames, %u dropped, %u blocks, %u write errors, ring peak %u/%u\n",
+            canLogStats.fileIndex,
+            canLogStats.frames,
+            canLogStats.dropped,
+            canLogStats.blocks,
+            canLogStats.writeErrors,
+            canLogStats.ringHighWater,
+            CAN_LOG_RING_RECORDS);
+    }
+    profileEnd(PROFILE_STATUS, profileStart);
+    static char profile[PROFILE_REPORT_SIZE];
+    profileReport(profile, sizeof(profile));
+    Serial.print(profile);
+    
+    // Configurazione Modbus scritta dal master, stato WiFi e nuova rete
+    for (uint8_t i = 0; i < 50; i++) {
+        if (modbusConfigPending) saveModbusConfig();
+        uint32_t now = millis();
+        if (wifiRestartAt != 0 && (int32_t)(now - wifiRestartAt) >= 0) {
+            wifiRestartAt = 0;
+            wifiBegin();
+        }
+        wifiService(now);
+        delay(100);
     }
 }
\ No newline at end of file
@@ -0,0 +1,327 @@
+/*
+ * @Description: Strumentazione del gateway ed esportazione Prometheus
+ * (vedi metrics.h)
+ */
+
+#include "metrics.h"
+#include "bus_discovery.h"
+#include "can_log.h"
+#include "hal.h"
+#include "j1939.h"
+#include "j1939_command.h"
+#include "j1939_filter.h"
+#include "j1939_node.h"
+#include "j1939_tp.h"
+#include "modbus_rtu.h"
+#include "modbus_tcp.h"
+#include "mqtt_report.h"
+#include "profiler.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#define METRICS_PREFIX "j1939gw_"
+
+uint32_t metricsPgnFrames[METRICS_PGN_SLOTS];
+MetricsHistogram metricsDecodeTime;
+MetricsHistogram metricsRtuTurnaround;
+
+// Fattore ns/ciclo in virgola fissa Q16: moltiplicazione senza divisione a
+// 64 bit (chiamata di libreria sullo Xtensa) nel percorso di ricezione
+uint32_t metricsCyclesToNs(uint32_t cycles) {
+    static const uint32_t nsPerCycleQ16 = (1000UL << 16) / hal_cycles_per_us();
+    return (uint32_t)(((uint64_t)cycles * nsPerCycleQ16) >> 16);
+}
+
+// Contatori semplici: voci consecutive con lo stesso nome condividono
+// HELP/TYPE e si distinguono per etichette
+struct MetricsCounter {
+    const char *name;
+    const char *help;
+    const char *labels;
+    uint32_t (*read)();
+};
+
+static const MetricsCounter COUNTERS[] = {
+    { "can_frames_accepted_total", "CAN frames passed by the acceptance filter", "",
+      [] { return j1939RxStats.accepted; } },
+    { "can_frames_rejected_total", "CAN frames discarded by the hardware filter or without decoder", "{stage=\"hardware\"}",
+      [] { return j1939RxStats.hardwareRejected; } },
+    { "can_frames_rejected_total", NULL, "{stage=\"software\"}",
+      [] { return j1939RxStats.softwareRejected; } },
+    { "can_sources_dropped_total", "Decodable frames from ECUs beyond the data set slots", "",
+      [] { return j1939RxStats.sourcesDropped; } },
+    { "can_rx_queue_full_total", "TWAI RX queue full alerts", "",
+      [] { return j1939RxStats.rxQueueFull; } },
+    { "can_rx_missed_total", "CAN frames lost to RX queue or controller FIFO overrun", "",
+      [] { return hal_can_rx_missed(); } },
+    { "can_error_passive_total", "Transitions of the CAN controller to error passive", "",
+      [] { return j1939RxStats.errorPassive; } },
+    { "can_bus_errors_total", "CAN bus error alerts", "",
+      [] { return j1939RxStats.busErrors; } },
+    { "j1939_tp_messages_total", "Transport Protocol sessions by outcome", "{result=\"completed\"}",
+      [] { return j1939TpStats.completed; } },
+    { "j1939_tp_messages_total", NULL, "{result=\"timeout\"}",
+      [] { return j1939TpStats.timeouts; } },
+    { "j1939_tp_messages_total", NULL, "{result=\"aborted\"}",
+      [] { return j1939TpStats.aborted; } },
+    { "j1939_tp_messages_total", NULL, "{result=\"pool_full\"}",
+      [] { return j1939TpStats.poolFull; } },
+    { "j1939_requests_total", "Request PGNs transmitted by the gateway", "",
+      [] { return j1939NodeStats.requests; } },
+    { "j1939_tx_failed_total", "Failed CAN transmissions", "",
+      [] { return j1939NodeStats.txFailed; } },
+    { "j1939_command_frames_total", "Command PGNs written over Modbus by transmit outcome", "{result=\"sent\"}",
+      [] { return j1939CommandStats.frames; } },
+    { "j1939_command_frames_total", NULL, "{result=\"tx_failed\"}",
+      [] { return j1939CommandStats.txFailed; } },
+    { "j1939_command_overruns_total", "Command deadlines skipped after a delay of a whole period", "",
+      [] { return j1939CommandStats.overruns; } },
+    { "j1939_command_timeouts_total", "Command slots stopped because the Modbus master stopped writing", "",
+      [] { return j1939CommandStats.timeouts; } },
+    { "modbus_requests_total", "Modbus requests addressed to the gateway", "{transport=\"rtu\"}",
+      [] { return modbusDiag.rtuRequests; } },
+    { "modbus_requests_total", NULL, "{transport=\"tcp\"}",
+      [] { return modbusTcpStats.requests; } },
+    { "modbus_bus_messages_total", "Modbus RTU frames with valid CRC seen on the bus", "",
+      [] { return modbusDiag.busMessages; } },
+    { "modbus_crc_errors_total", "Modbus RTU frames discarded for CRC errors", "",
+      [] { return modbusDiag.busCrcErrors; } },
+    { "modbus_exceptions_total", "Modbus exception responses by code", "{code=\"1\"}",
+      [] { return modbusDiag.exceptionCodes[0]; } },
+    { "modbus_exceptions_total", NULL, "{code=\"2\"}",
+      [] { return modbusDiag.exceptionCodes[1]; } },
+    { "modbus_exceptions_total", NULL, "{code=\"3\"}",
+      [] { return modbusDiag.exceptionCodes[2]; } },
+    { "modbus_exceptions_total", NULL, "{code=\"4\"}",
+      [] { return modbusDiag.exceptionCodes[3]; } },
+    { "modbus_cache_total", "Modbus read responses served from or added to the cache", "{result=\"hit\"}",
+      [] { return modbusCacheStats.hits; } },
+    { "modbus_cache_total", NULL, "{result=\"miss\"}",
+      [] { return modbusCacheStats.misses; } },
+    { "mqtt_messages_total", "MQTT report-by-exception messages by outcome", "{result=\"queued\"}",
+      [] { return mqttReportStats.messages; } },
+    { "mqtt_messages_total", NULL, "{result=\"published\"}",
+      [] { return mqttReportStats.published; } },
+    { "mqtt_messages_total", NULL, "{result=\"dropped\"}",
+      [] { return mqttReportStats.dropped; } },
+    { "bus_discovery_untracked_total", "CAN frames of new PGN/source pairs with the discovery table full", "",
+      [] { return busDiscoveryStats.untracked; } },
+    { "canlog_frames_total", "CAN frames queued to the SD logger", "",
+      [] { return canLogStats.frames; } },
+    { "canlog_dropped_total", "CAN frames lost by the SD logger", "",
+      [] { return canLogStats.dropped; } },
+};
+
+#define COUNTER_COUNT (sizeof(COUNTERS) / sizeof(COUNTERS[0]))
+
+enum MetricsFamily : uint8_t {
+    FAMILY_PGN_FRAMES,
+    FAMILY_COUNTERS,
+    FAMILY_DECODE_TIME,
+    FAMILY_RTU_TURNAROUND,
+    FAMILY_SECTION_TIME,
+    FAMILY_SECTION_MAX,
+    FAMILY_SECTION_JITTER,
+    FAMILY_CAN_BACKLOG,
+    FAMILY_CAN_BACKLOG_MAX,
+    FAMILY_STACK_FREE,
+    FAMILY_COUNT
+};
+
+static uint32_t metricsPgnValue(uint8_t slot) {
+    if (slot < SPN_PGN_COUNT) return SPN_PGN_TABLE[slot].pgn;
+    switch (slot) {
+        case METRICS_PGN_DM1:             return PGN_DIAGNOSTIC_MESSAGE_1;
+        case METRICS_PGN_DM2:             return PGN_DIAGNOSTIC_MESSAGE_2;
+        case METRICS_PGN_TP_CM:           return PGN_TP_CM;
+        case METRICS_PGN_TP_DT:           return PGN_TP_DT;
+        case METRICS_PGN_REQUEST:         return PGN_REQUEST;
+        case METRICS_PGN_ADDRESS_CLAIMED: return PGN_ADDRESS_CLAIMED;
+        default:                          return 0;
+    }
+}
+
+// snprintf che restituisce 0 se la riga non entra
+static size_t metricsPrintf(char *out, size_t size, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(out, size, format, args);
+    va_end(args);
+    return (written < 0 || (size_t)written >= size) ? 0 : written;
+}
+
+static size_t metricsHeader(char *out, size_t size, const char *name, const char *help, const char *type) {
+    return metricsPrintf(out, size, "# HELP " METRICS_PREFIX "%s %s\n# TYPE " METRICS_PREFIX "%s %s\n",
+                         name, help, name, type);
+}
+
+// Serie di un istogramma (item 0..METRICS_BUCKETS+1): bucket cumulativi,
+// somma e conteggio, con etichette aggiuntive (section="can") o senza. _count
+// è il totale dei bucket letti, coerente con +Inf anche durante un aggiornamento
+static size_t metricsHistogramSeries(const MetricsHistogram &histogram, const char *name, const char *labels,
+                                     uint16_t bucket, char *out, size_t size, bool *last) {
+    const char *separator = labels[0] ? "," : "";
+    uint32_t cumulative = 0;
+    for (uint16_t b = 0; b <= bucket && b < METRICS_BUCKETS; b++) cumulative += histogram.buckets[b];
+    if (bucket < METRICS_BUCKETS - 1) {
+        double bound = 256e-9 * (double)(1UL << (2 * bucket));
+        return metricsPrintf(out, size, METRICS_PREFIX "%s_bucket{%s%sle=\"%g\"} %u\n",
+                             name, labels, separator, bound, (unsigned)cumulative);
+    }
+    if (bucket == METRICS_BUCKETS - 1) {
+        return metricsPrintf(out, size, METRICS_PREFIX "%s_bucket{%s%sle=\"+Inf\"} %u\n",
+                             name, labels, separator, (unsigned)cumulative);
+    }
+    const char *open = labels[0] ? "{" : "";
+    const char *close = labels[0] ? "}" : "";
+    if (bucket == METRICS_BUCKETS) {
+        return metricsPrintf(out, size, METRICS_PREFIX "%s_sum%s%s%s %.9f\n",
+                             name, open, labels, close, histogram.sumNs * 1e-9);
+    }
+    *last = true;
+    return metricsPrintf(out, size, METRICS_PREFIX "%s_count%s%s%s %u\n",
+                         name, open, labels, close, (unsigned)cumulative);
+}
+
+#define METRICS_HISTOGRAM_SERIES (METRICS_BUCKETS + 2)
+
+// Istogramma senza etichette: intestazione, poi le serie
+static size_t metricsHistogramItem(const MetricsHistogram &histogram, const char *name, const char *help,
+                                   uint16_t item, char *out, size_t size, bool *last) {
+    if (item == 0) return metricsHeader(out, size, name, help, "histogram");
+    return metricsHistogramSeries(histogram, name, "", item - 1, out, size, last);
+}
+
+// Sezione periodica n-esima (il jitter ha senso solo per queste)
+static uint8_t metricsPeriodicSection(uint16_t index) {
+    for (uint8_t section = 0; section < PROFILE_SECTIONS; section++) {
+        if (profileSectionPeriodic(section) && index-- == 0) return section;
+    }
+    return PROFILE_SECTIONS;
+}
+
+static uint8_t metricsPeriodicCount() {
+    uint8_t count = 0;
+    for (uint8_t section = 0; section < PROFILE_SECTIONS; section++) count += profileSectionPeriodic(section);
+    return count;
+}
+
+// Famiglie del profiler (vedi profiler.h)
+static size_t metricsProfileItem(uint8_t family, uint16_t item, char *out, size_t size, bool *last) {
+    switch (family) {
+        case FAMILY_SECTION_TIME: {
+            if (item == 0) return metricsHeader(out, size, "section_seconds", "Task section execution time", "histogram");
+            uint8_t section = (item - 1) / METRICS_HISTOGRAM_SERIES;
+            char labels[32];
+            snprintf(labels, sizeof(labels), "section=\"%s\"", profileSectionName(section));
+            bool seriesLast = false;
+            size_t length = metricsHistogramSeries(profileStats[section].time, "section_seconds", labels,
+                                                   (item - 1) % METRICS_HISTOGRAM_SERIES, out, size, &seriesLast);
+            *last = seriesLast && section == PROFILE_SECTIONS - 1;
+            return length;
+        }
+        case FAMILY_SECTION_MAX: {
+            if (item == 0) return metricsHeader(out, size, "section_max_seconds", "Worst task section execution time", "gauge");
+            uint8_t section = item - 1;
+            *last = (section == PROFILE_SECTIONS - 1);
+            return metricsPrintf(out, size, METRICS_PREFIX "section_max_seconds{section=\"%s\"} %.9f\n",
+                                 profileSectionName(section), profileStats[section].maxNs * 1e-9);
+        }
+        case FAMILY_SECTION_JITTER: {
+            if (item == 0) {
+                return metricsHeader(out, size, "section_jitter_seconds",
+                                     "Activation interval spread of periodic task sections", "gauge");
+            }
+            uint8_t section = metricsPeriodicSection(item - 1);
+            *last = (item == metricsPeriodicCount());
+            const ProfileStats &stats = profileStats[section];
+            uint32_t jitter = stats.maxIntervalUs ? stats.maxIntervalUs - stats.minIntervalUs : 0;
+            return metricsPrintf(out, size, METRICS_PREFIX "section_jitter_seconds{section=\"%s\"} %.6f\n",
+                                 profileSectionName(section), jitter * 1e-6);
+        }
+        case FAMILY_CAN_BACKLOG:
+            return metricsHistogramItem(profileCanBacklog, "can_rx_backlog_seconds",
+                                        "Wait of queued CAN frames found when the CAN task resumes (upper bound)",
+                                        item, out, size, last);
+        case FAMILY_CAN_BACKLOG_MAX: {
+            if (item == 0) {
+                return metricsHeader(out, size, "can_rx_backlog_max_seconds",
+                                     "Worst wait of queued CAN frames (upper bound)", "gauge");
+            }
+            *last = true;
+            return metricsPrintf(out, size, METRICS_PREFIX "can_rx_backlog_max_seconds %.6f\n",
+                                 profileCanBacklogMaxUs * 1e-6);
+        }
+        default: {
+            uint8_t count = profileTaskCount();
+            if (item == 0) {
+                *last = (count == 0);
+                return metricsHeader(out, size, "task_stack_free_bytes", "Minimum free stack since boot", "gauge");
+            }
+            uint8_t task = item - 1;
+            *last = (task + 1 >= count);
+            return metricsPrintf(out, size, METRICS_PREFIX "task_stack_free_bytes{task=\"%s\"} %u\n",
+                                 profileTaskName(task), (unsigned)profileTaskStackFree(task));
+        }
+    }
+}
+
+// Riga 'item' della famiglia; *last se è l'ultima
+static size_t metricsItem(uint8_t family, uint16_t item, char *out, size_t size, bool *last) {
+    switch (family) {
+        case FAMILY_PGN_FRAMES: {
+            if (item == 0) return metricsHeader(out, size, "can_frames_total", "CAN frames received by PGN", "counter");
+            uint8_t slot = item - 1;
+            *last = (slot == METRICS_PGN_SLOTS - 1);
+            if (slot == METRICS_PGN_OTHER) {
+                return metricsPrintf(out, size, METRICS_PREFIX "can_frames_total{pgn=\"other\"} %u\n",
+                                     (unsigned)metricsPgnFrames[slot]);
+            }
+            return metricsPrintf(out, size, METRICS_PREFIX "can_frames_total{pgn=\"%u\"} %u\n",
+                                 (unsigned)metricsPgnValue(slot), (unsigned)metricsPgnFrames[slot]);
+        }
+        case FAMILY_COUNTERS: {
+            const MetricsCounter &counter = COUNTERS[item];
+            *last = (item == COUNTER_COUNT - 1);
+            size_t length = 0;
+            if (counter.help != NULL) {
+                length = metricsHeader(out, size, counter.name, counter.help, "counter");
+                if (length == 0) return 0;
+            }
+            size_t series = metricsPrintf(out + length, size - length, METRICS_PREFIX "%s%s %u\n",
+                                          counter.name, counter.labels, (unsigned)counter.read());
+            return series ? length + series : 0;
+        }
+        case FAMILY_DECODE_TIME:
+            return metricsHistogramItem(metricsDecodeTime, "decode_seconds",
+                                        "J1939 frame decode time in the CAN task", item, out, size, last);
+        case FAMILY_RTU_TURNAROUND:
+            return metricsHistogramItem(metricsRtuTurnaround, "modbus_rtu_turnaround_seconds",
+                                        "Modbus RTU request end to response queued to the UART", item, out, size, last);
+        default:
+            return metricsProfileItem(family, item, out, size, last);
+    }
+}
+
+void metricsBegin(MetricsCursor &cursor) {
+    cursor.family = 0;
+    cursor.item = 0;
+}
+
+size_t metricsRead(MetricsCursor &cursor, char *buffer, size_t size) {
+    size_t length = 0;
+    while (cursor.family < FAMILY_COUNT) {
+        bool last = false;
+        size_t written = metricsItem(cursor.family, cursor.item, buffer + length, size - length, &last);
+        if (written == 0) break;  // Riga nel prossimo pezzo
+        length += written;
+        cursor.item++;
+        if (last) {
+            cursor.family++;
+            cursor.item = 0;
+        }
+    }
+    return length;
+}
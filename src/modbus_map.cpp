@@ -0,0 +1,264 @@
+/*
+ * @Description: Mappa registri Modbus - validazione, compilazione dell'indice
+ * e costruzione dell'immagine di un data set (vedi modbus_map.h)
+ */
+
+#include "modbus_map.h"
+#include "j1939_spn.h"
+#include "modbus_rtu.h"
+
+#include <math.h>
+#include <string.h>
+
+// Mappa storica: registri MB_REG_* su entrambe le tabelle
+#define DEFAULT_ENTRY(address, signal, type) \
+    { address, MODBUS_TABLE_BOTH, signal, type, MODBUS_ORDER_HIGH_FIRST, 1.0f, 0.0f }
+
+const ModbusMapEntry MODBUS_DEFAULT_MAP[] = {
+    DEFAULT_ENTRY(MB_REG_ENGINE_RPM, FIELD_RPM, MODBUS_TYPE_U32),
+    DEFAULT_ENTRY(MB_REG_ENGINE_TEMP, FIELD_ENGINE_TEMP, MODBUS_TYPE_U16),
+    DEFAULT_ENTRY(MB_REG_OIL_PRESSURE, FIELD_OIL_PRESSURE, MODBUS_TYPE_U16),
+    DEFAULT_ENTRY(MB_REG_FUEL_RATE, FIELD_FUEL_RATE, MODBUS_TYPE_U32),
+    DEFAULT_ENTRY(MB_REG_ENGINE_HOURS, FIELD_ENGINE_HOURS, MODBUS_TYPE_U32),
+    DEFAULT_ENTRY(MB_REG_COOLANT_TEMP, FIELD_COOLANT_TEMP, MODBUS_TYPE_U16),
+    DEFAULT_ENTRY(MB_REG_INTAKE_TEMP, FIELD_INTAKE_TEMP, MODBUS_TYPE_U16),
+    DEFAULT_ENTRY(MB_REG_EXHAUST_TEMP, FIELD_EXHAUST_TEMP, MODBUS_TYPE_U16),
+    DEFAULT_ENTRY(MB_REG_ENGINE_LOAD, FIELD_ENGINE_LOAD, MODBUS_TYPE_U16),
+    DEFAULT_ENTRY(MB_REG_THROTTLE_POS, FIELD_THROTTLE_POS, MODBUS_TYPE_U16),
+    DEFAULT_ENTRY(MB_REG_ENGINE_TORQUE, FIELD_ENGINE_TORQUE, MODBUS_TYPE_U32),
+    DEFAULT_ENTRY(MB_REG_BATTERY_VOLTAGE, FIELD_BATTERY_VOLTAGE, MODBUS_TYPE_U16),
+    DEFAULT_ENTRY(MB_REG_STATUS_FLAGS, MB_SIGNAL_STATUS_FLAGS, MODBUS_TYPE_U16),
+    DEFAULT_ENTRY(MB_REG_ERROR_FLAGS, MB_SIGNAL_ERROR_FLAGS, MODBUS_TYPE_U16),
+    DEFAULT_ENTRY(MB_REG_DTC_COUNT, MB_SIGNAL_DTC_COUNT, MODBUS_TYPE_U16),
+    DEFAULT_ENTRY(MB_REG_LAST_UPDATE, MB_SIGNAL_LAST_UPDATE, MODBUS_TYPE_U32),
+    DEFAULT_ENTRY(MB_REG_VALID_FLAGS, MB_SIGNAL_VALID_FLAGS, MODBUS_TYPE_U16),
+    DEFAULT_ENTRY(MB_REG_SPN_ERROR_FLAGS, MB_SIGNAL_SPN_ERROR_FLAGS, MODBUS_TYPE_U16),
+    DEFAULT_ENTRY(MB_REG_SOURCE_ADDRESS, MB_SIGNAL_SOURCE_ADDRESS, MODBUS_TYPE_U16),
+};
+
+const size_t MODBUS_DEFAULT_MAP_COUNT = sizeof(MODBUS_DEFAULT_MAP) / sizeof(MODBUS_DEFAULT_MAP[0]);
+
+ModbusMap modbusMap;
+
+static const char *modbusMapCompile(ModbusMap &map, const ModbusMapEntry *entries, size_t count,
+                                    uint16_t bankStride);
+
+// Mappa di default attiva dall'avvio, prima di qualsiasi richiesta
+[[maybe_unused]] static const bool defaultMapLoaded =
+    modbusMapCompile(modbusMap, MODBUS_DEFAULT_MAP, MODBUS_DEFAULT_MAP_COUNT, MODBUS_BANK_SIZE) == NULL;
+
+static const char *const SIGNAL_NAMES[MB_SIGNAL_COUNT - FIELD_COUNT] = {
+    "statusFlags",
+    "errorFlags",
+    "dtcCount",
+    "lastUpdate",
+    "validFlags",
+    "spnErrorFlags",
+    "sourceAddress",
+    "previousDtcCount",
+};
+
+// Posizione dei segnali di stato in EngineData. validFlags e spnErrorFlags
+// sono pubblicati a 16 bit: i 2 byte bassi (little endian, ESP32 e host)
+static const FieldLayout SIGNAL_LAYOUT[MB_SIGNAL_COUNT - FIELD_COUNT] = {
+    FIELD_LAYOUT_ENTRY(statusFlags),
+    FIELD_LAYOUT_ENTRY(errorFlags),
+    FIELD_LAYOUT_ENTRY(dtcCount),
+    FIELD_LAYOUT_ENTRY(lastUpdate),
+    { offsetof(EngineData, validFlags), 2 },
+    { offsetof(EngineData, spnErrorFlags), 2 },
+    FIELD_LAYOUT_ENTRY(sourceAddress),
+    FIELD_LAYOUT_ENTRY(previousDtcCount),
+};
+
+static const char *const TYPE_NAMES[MODBUS_TYPE_COUNT] = { "u16", "i16", "u32", "i32", "f32" };
+
+const char *modbusMapSignalName(uint8_t signal) {
+    if (signal < FIELD_COUNT) return engineFieldName((EngineField)signal);
+    return (signal < MB_SIGNAL_COUNT) ? SIGNAL_NAMES[signal - FIELD_COUNT] : "";
+}
+
+int modbusMapSignalIndex(const char *name) {
+    int field = engineFieldIndex(name);
+    if (field >= 0) return field;
+    for (uint8_t i = 0; i < MB_SIGNAL_COUNT - FIELD_COUNT; i++) {
+        if (strcmp(name, SIGNAL_NAMES[i]) == 0) return FIELD_COUNT + i;
+    }
+    return -1;
+}
+
+const char *modbusMapTypeName(uint8_t type) {
+    return (type < MODBUS_TYPE_COUNT) ? TYPE_NAMES[type] : "";
+}
+
+int modbusMapTypeIndex(const char *name) {
+    for (uint8_t type = 0; type < MODBUS_TYPE_COUNT; type++) {
+        if (strcmp(name, TYPE_NAMES[type]) == 0) return type;
+    }
+    return -1;
+}
+
+static inline uint8_t typeWords(uint8_t type) {
+    return (type == MODBUS_TYPE_U16 || type == MODBUS_TYPE_I16) ? 1 : 2;
+}
+
+static ModbusMapSource compileSource(const ModbusMapEntry &entry) {
+    ModbusMapSource source;
+    bool isField = entry.signal < FIELD_COUNT;
+    const FieldLayout &layout = isField ? FIELD_LAYOUT[entry.signal] : SIGNAL_LAYOUT[entry.signal - FIELD_COUNT];
+    source.offset = layout.offset;
+    source.size = layout.size;
+    source.flags = 0;
+    source.validBit = isField ? FIELD_BIT(entry.signal) : 0;
+    if (isField && (ENGINE_SIGNED_FIELDS & FIELD_BIT(entry.signal))) source.flags |= MODBUS_SOURCE_SIGNED;
+    if (entry.signal == MB_SIGNAL_SOURCE_ADDRESS) source.flags |= MODBUS_SOURCE_PRESENCE;
+    if (entry.type != MODBUS_TYPE_F32 && entry.gain == 1.0f && entry.offset == 0.0f) {
+        source.flags |= MODBUS_SOURCE_DIRECT;
+    }
+    return source;
+}
+
+// Compilazione in due passi: estensione delle tabelle, poi indice denso
+static const char *modbusMapCompile(ModbusMap &map, const ModbusMapEntry *entries, size_t count,
+                                    uint16_t bankStride) {
+    if (count > MODBUS_MAP_MAX_ENTRIES) return "Troppi registri nella mappa";
+    if ((uint32_t)bankStride * ENGINE_DATA_MAX_SOURCES > MODBUS_COMMAND_BASE) return "Passo dei banchi non valido";
+
+    uint32_t low[MODBUS_TABLE_COUNT] = { 0xFFFF, 0xFFFF };
+    uint32_t high[MODBUS_TABLE_COUNT] = { 0, 0 };
+    uint32_t words = 0;
+    for (size_t i = 0; i < count; i++) {
+        const ModbusMapEntry &entry = entries[i];
+        if (entry.signal >= MB_SIGNAL_COUNT || entry.type >= MODBUS_TYPE_COUNT ||
+            entry.tables == 0 || entry.tables > MODBUS_TABLE_BOTH || entry.wordOrder > MODBUS_ORDER_LOW_FIRST ||
+            !isfinite(entry.gain) || !isfinite(entry.offset)) {
+            return "Voce della mappa non valida";
+        }
+        uint32_t entryEnd = (uint32_t)entry.address + typeWords(entry.type);
+        if (entryEnd > MODBUS_COMMAND_BASE) return "Indirizzo nell'area comandi, DTC o di configurazione";
+        if (bankStride != 0 && entryEnd > bankStride) return "Registri oltre il passo dei banchi";
+        for (uint8_t table = 0; table < MODBUS_TABLE_COUNT; table++) {
+            if (!(entry.tables & (1 << table))) continue;
+            if (entry.address < low[table]) low[table] = entry.address;
+            if (entryEnd > high[table]) high[table] = entryEnd;
+        }
+        words += typeWords(entry.type);
+    }
+    if (words > MODBUS_BANK_WORDS) return "Mappa oltre MODBUS_BANK_WORDS word per data set";
+
+    memset(map.index, MODBUS_MAP_UNMAPPED, sizeof(map.index));
+    for (uint8_t table = 0; table < MODBUS_TABLE_COUNT; table++) {
+        if (high[table] == 0) {
+            map.base[table] = 0;
+            map.end[table] = 0;
+            continue;
+        }
+        if (high[table] - low[table] > MODBUS_MAP_INDEX_SIZE) return "Indirizzi troppo distanti";
+        map.base[table] = low[table];
+        map.end[table] = high[table];
+    }
+
+    uint8_t word = 0;
+    for (size_t i = 0; i < count; i++) {
+        const ModbusMapEntry &entry = entries[i];
+        for (uint8_t table = 0; table < MODBUS_TABLE_COUNT; table++) {
+            if (!(entry.tables & (1 << table))) continue;
+            for (uint8_t w = 0; w < typeWords(entry.type); w++) {
+                uint8_t &slot = map.index[table][entry.address + w - map.base[table]];
+                if (slot != MODBUS_MAP_UNMAPPED) return "Registri sovrapposti";
+                slot = word + w;
+            }
+        }
+        map.entries[i] = entry;
+        map.sources[i] = compileSource(entry);
+        map.entryWord[i] = word;
+        word += typeWords(entry.type);
+    }
+    map.count = count;
+    map.imageWords = word;
+    map.bankStride = bankStride;
+    return NULL;
+}
+
+const char *modbusMapLoad(const ModbusMapEntry *entries, size_t count, uint16_t bankStride) {
+    static ModbusMap staging;
+    const char *error = modbusMapCompile(staging, entries, count, bankStride);
+    if (error != NULL) return error;
+
+    std::lock_guard<std::mutex> lock(modbusMutex);
+    modbusMap = staging;
+    modbusMapChanged();
+    return NULL;
+}
+
+static int64_t saturate(double value, int64_t low, int64_t high) {
+    if (!(value >= (double)low)) return low;  // NaN compreso
+    if (value > (double)high) return high;
+    return llround(value);
+}
+
+// Word del registro a 32 bit con scala o float32
+static uint32_t encodeScaled(const ModbusMapEntry &entry, int64_t value, bool valid) {
+    if (entry.type == MODBUS_TYPE_F32) {
+        float result = valid ? (float)((double)value * entry.gain + entry.offset) : NAN;
+        uint32_t bits;
+        memcpy(&bits, &result, sizeof(bits));
+        return bits;
+    }
+    if (!valid) return 0xFFFFFFFF;
+
+    double result = (double)value * entry.gain + entry.offset;
+    switch (entry.type) {
+        case MODBUS_TYPE_U16: return (uint32_t)saturate(result, 0, 0xFFFF);
+        case MODBUS_TYPE_I16: return (uint32_t)saturate(result, INT16_MIN, INT16_MAX);
+        case MODBUS_TYPE_U32: return (uint32_t)saturate(result, 0, 0xFFFFFFFF);
+        default:              return (uint32_t)saturate(result, INT32_MIN, INT32_MAX);
+    }
+}
+
+// Segnale non valido (mai ricevuto, "non disponibile", in errore, banco
+// vuoto per l'indirizzo sorgente): sentinella J1939 troncata al tipo
+void modbusMapBuildImage(const ModbusMap &map, const EngineData *data, uint16_t *image) {
+    EngineData empty;
+    bool present = data != NULL;
+    if (!present) {
+        memset(&empty, 0, sizeof(empty));
+        data = &empty;
+    }
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+    for (uint8_t i = 0; i < map.count; i++) {
+        const ModbusMapSource &source = map.sources[i];
+        uint32_t raw;
+        if (source.size == 4) {
+            memcpy(&raw, bytes + source.offset, 4);
+        } else if (source.size == 2) {
+            uint16_t half;
+            memcpy(&half, bytes + source.offset, 2);
+            raw = (source.flags & MODBUS_SOURCE_SIGNED) ? (uint32_t)(int32_t)(int16_t)half : half;
+        } else {
+            raw = bytes[source.offset];
+        }
+        bool valid = (source.flags & MODBUS_SOURCE_PRESENCE) ? present
+                   : (source.validBit == 0 || (data->validFlags & source.validBit) != 0);
+
+        uint32_t encoded;
+        if (source.flags & MODBUS_SOURCE_DIRECT) {
+            encoded = valid ? raw : 0xFFFFFFFF;  // Troncato alla dimensione del tipo
+        } else {
+            int64_t value = (source.flags & MODBUS_SOURCE_SIGNED) ? (int64_t)(int32_t)raw : (int64_t)raw;
+            encoded = encodeScaled(map.entries[i], value, valid);
+        }
+
+        const ModbusMapEntry &entry = map.entries[i];
+        uint16_t *words = &image[map.entryWord[i]];
+        if (typeWords(entry.type) == 1) {
+            words[0] = encoded & 0xFFFF;
+        } else if (entry.wordOrder == MODBUS_ORDER_HIGH_FIRST) {
+            words[0] = encoded >> 16;
+            words[1] = encoded & 0xFFFF;
+        } else {
+            words[0] = encoded & 0xFFFF;
+            words[1] = encoded >> 16;
+        }
+    }
+}
@@ -0,0 +1,681 @@
+/*
+ * @Description: Modbus RTU slave - implementazione custom su RS485
+ */
+
+#include "modbus_rtu.h"
+#include "config.h"
+#include "crc16.h"
+#include "dtc_store.h"
+#include "engine_data.h"
+#include "hal.h"
+#include "metrics.h"
+#include "profiler.h"
+
+#include <string.h>
+
+// Buffer registri Modbus
+uint16_t modbusRegisters[MODBUS_IMAGE_SIZE];
+
+// Variabili configurazione
+uint8_t currentSlaveId = MODBUS_SLAVE_ID;
+uint32_t currentBaudrate = MODBUS_BAUDRATE;
+uint8_t modbusSetMapping = MODBUS_SET_MAPPING;
+void (*modbusConfigChanged)() = NULL;
+
+// Immagine registri e cache risposte condivise tra slave RTU e server TCP
+std::mutex modbusMutex;
+
+// Calcola CRC16 Modbus (tabella, vedi crc16.h)
+uint16_t calculateCRC16(uint8_t *data, uint16_t length) {
+    return crc16Compute(data, length);
+}
+
+// Generazione dell'immagine registri e bit dirty dei registri cambiati
+// dall'ultima rivalidazione della cache
+#define MODBUS_REGISTER_WORDS ((MODBUS_IMAGE_SIZE + 31) / 32)
+
+uint32_t modbusImageGeneration = 0;
+static uint32_t imageVersion = 0xFFFFFFFF;
+static uint32_t dirtyRegisters[MODBUS_REGISTER_WORDS];
+
+// Banco -> slot del data set e versione pubblicata da cui è stato costruito
+// (0 = banco vuoto, 0xFFFFFFFF = da ricostruire)
+static uint8_t bankSlots[ENGINE_DATA_MAX_SOURCES];
+static uint8_t bankCount = 0xFF;
+static uint32_t bankVersions[ENGINE_DATA_MAX_SOURCES];
+
+// Cache di risposte complete (CRC incluso) per richieste di lettura ripetute
+struct ModbusCachedResponse {
+    bool valid;
+    uint8_t slaveId;
+    uint8_t functionCode;
+    uint16_t start;
+    uint16_t quantity;
+    uint16_t length;
+    uint32_t generation;
+    uint32_t registerMask[MODBUS_REGISTER_WORDS];  // Registri coperti dalla risposta
+    uint8_t frame[MODBUS_RTU_MAX_FRAME];
+};
+
+ModbusCacheStats modbusCacheStats;
+ModbusDiagCounters modbusDiag;
+
+static ModbusCachedResponse responseCache[MODBUS_RESPONSE_CACHE_SIZE];
+static uint8_t responseCacheNext = 0;
+
+// Dopo una modifica: le risposte che non toccano registri dirty passano alla
+// nuova generazione, le altre vengono scartate
+static void modbusCacheRevalidate() {
+    for (uint8_t i = 0; i < MODBUS_RESPONSE_CACHE_SIZE; i++) {
+        ModbusCachedResponse &entry = responseCache[i];
+        if (!entry.valid) continue;
+        uint32_t overlap = 0;
+        for (uint8_t w = 0; w < MODBUS_REGISTER_WORDS; w++) {
+            overlap |= entry.registerMask[w] & dirtyRegisters[w];
+        }
+        if (overlap) {
+            entry.valid = false;
+        } else {
+            entry.generation = modbusImageGeneration;
+        }
+    }
+    memset(dirtyRegisters, 0, sizeof(dirtyRegisters));
+}
+
+// Cerca la risposta per la richiesta; se non è in cache restituisce lo slot
+// da riempire (quello con la stessa richiesta scaduta, altrimenti round robin)
+static ModbusCachedResponse *modbusCacheLookup(uint8_t slaveId, uint8_t functionCode,
+                                               uint16_t start, uint16_t quantity, bool *hit) {
+    for (uint8_t i = 0; i < MODBUS_RESPONSE_CACHE_SIZE; i++) {
+        ModbusCachedResponse &entry = responseCache[i];
+        if (entry.slaveId == slaveId && entry.functionCode == functionCode &&
+            entry.start == start && entry.quantity == quantity) {
+            *hit = entry.valid && entry.generation == modbusImageGeneration;
+            return &entry;
+        }
+    }
+    *hit = false;
+    ModbusCachedResponse &entry = responseCache[responseCacheNext];
+    responseCacheNext = (responseCacheNext + 1) % MODBUS_RESPONSE_CACHE_SIZE;
+    return &entry;
+}
+
+// Ricostruisce un banco dalla mappa attiva e segna i registri cambiati
+// (confronto senza salti: quali registri cambiano varia a ogni frame CAN)
+static uint32_t modbusUpdateBank(uint8_t bank, const EngineData *data) {
+    uint16_t image[MODBUS_BANK_WORDS];
+    modbusMapBuildImage(modbusMap, data, image);  // NULL: banco vuoto, nessuna sorgente
+    
+    uint32_t changed = 0;
+    uint16_t base = bank * MODBUS_BANK_WORDS;
+    for (uint16_t i = 0; i < modbusMap.imageWords; i++) {
+        uint16_t reg = base + i;
+        uint32_t differs = (image[i] != modbusRegisters[reg]);
+        dirtyRegisters[reg / 32] |= differs << (reg % 32);
+        changed |= differs;
+        modbusRegisters[reg] = image[i];
+    }
+    return changed;
+}
+
+// Aggiorna registri Modbus con dati motore: solo i banchi delle ECU che il
+// task CAN ha ripubblicato e solo i registri effettivamente cambiati (bit
+// dirty). Ogni modifica incrementa la generazione e invalida le risposte in
+// cache che coprono i registri cambiati. Restituisce true se l'immagine è cambiata
+bool updateModbusRegisters() {
+    uint32_t version = engineDataVersion();
+    if (version == imageVersion) return false;
+    imageVersion = version;
+    
+    uint8_t count = engineDataSourceCount();
+    if (count != bankCount) {
+        // Nuova ECU: banchi ordinati per indirizzo sorgente, così la mappa non
+        // dipende dall'ordine in cui le ECU si sono presentate sul bus
+        count = engineDataSlotsBySource(bankSlots);
+        for (uint8_t bank = 0; bank < ENGINE_DATA_MAX_SOURCES; bank++) {
+            bankVersions[bank] = 0xFFFFFFFF;
+        }
+        bankCount = count;
+    }
+    
+    uint32_t changed = 0;
+    for (uint8_t bank = 0; bank < ENGINE_DATA_MAX_SOURCES; bank++) {
+        uint32_t bankVersion = (bank < count) ? engineDataVersion(bankSlots[bank]) : 0;
+        if (bankVersion == bankVersions[bank]) continue;
+        bankVersions[bank] = bankVersion;
+        
+        if (bank < count) {
+            // Copia coerente dei dati pubblicati dal task CAN
+            EngineData data;
+            engineDataRead(bankSlots[bank], data);
+            changed |= modbusUpdateBank(bank, &data);
+        } else {
+            changed |= modbusUpdateBank(bank, NULL);
+        }
+    }
+    
+    if (changed) {
+        modbusImageGeneration++;
+        modbusCacheRevalidate();
+    }
+    return changed != 0;
+}
+
+// Nuova mappa o nuova interpretazione degli indirizzi: nessuna risposta in
+// cache è più valida e tutti i banchi vanno ricostruiti
+void modbusMapChanged() {
+    for (uint8_t i = 0; i < MODBUS_RESPONSE_CACHE_SIZE; i++) {
+        responseCache[i].valid = false;
+    }
+    memset(modbusRegisters, 0, sizeof(modbusRegisters));
+    memset(dirtyRegisters, 0, sizeof(dirtyRegisters));
+    imageVersion = 0xFFFFFFFF;
+    bankCount = 0xFF;
+    modbusImageGeneration++;
+}
+
+// Frame RTU in ricezione: delimitato dal silenzio T3.5 rilevato dalla UART
+// oppure, per le richieste a lunghezza fissa, dall'ultimo byte con CRC valido.
+// Il CRC è aggiornato a ogni byte: residuo 0 = frame valido fin qui
+static uint8_t rxFrame[MODBUS_RTU_MAX_FRAME];
+static uint16_t rxLength = 0;
+static uint16_t rxCrc = CRC16_MODBUS_INIT;
+static uint16_t rxExpected = 0;
+
+static inline void modbusRxReset() {
+    rxLength = 0;
+    rxCrc = CRC16_MODBUS_INIT;
+    rxExpected = 0;
+}
+
+// Lunghezza attesa della richiesta dal codice funzione (0 = non determinabile)
+static uint16_t modbusExpectedLength(const uint8_t *frame, uint16_t length) {
+    if (length < 2) return 0;
+    switch (frame[1]) {
+        case 0x01:
+        case 0x02:
+        case 0x03:
+        case 0x04:
+        case 0x05:
+        case 0x06:
+        case 0x08:
+            return 8;
+        case 0x0F:
+        case 0x10:
+            return (length >= 7) ? 9 + frame[6] : 0;
+        default:
+            return 0;
+    }
+}
+
+// Risposta di eccezione Modbus
+static uint8_t exceptionFrame[5];
+
+static uint16_t modbusException(uint8_t unitId, uint8_t functionCode, uint8_t exceptionCode,
+                                const uint8_t **frame) {
+    modbusDiag.busExceptions++;
+    if (exceptionCode >= 1 && exceptionCode <= 4) modbusDiag.exceptionCodes[exceptionCode - 1]++;
+    exceptionFrame[0] = unitId;
+    exceptionFrame[1] = functionCode | 0x80;
+    exceptionFrame[2] = exceptionCode;
+    uint16_t exceptionCrc = calculateCRC16(exceptionFrame, 3);
+    exceptionFrame[3] = exceptionCrc & 0xFF;
+    exceptionFrame[4] = (exceptionCrc >> 8) & 0xFF;
+    *frame = exceptionFrame;
+    return sizeof(exceptionFrame);
+}
+
+// Baudrate della UART: un nuovo currentBaudrate viene applicato dal task RTU
+// tra due frame
+static uint32_t uartBaudrate = 0;
+
+void modbusRtuBegin() {
+    uartBaudrate = currentBaudrate;
+    hal_uart_begin(uartBaudrate);
+    modbusRxReset();
+}
+
+bool modbusConfigApply(uint16_t slaveId, uint32_t baudrate, uint16_t setMapping) {
+    if (slaveId < 1 || slaveId > 247 || baudrate < 1200 || baudrate > MODBUS_MAX_BAUDRATE ||
+        setMapping > MODBUS_MAP_REGISTER_BANK) {
+        return false;
+    }
+    bool remap = slaveId != currentSlaveId || setMapping != modbusSetMapping;
+    currentSlaveId = slaveId;
+    currentBaudrate = baudrate;
+    modbusSetMapping = setMapping;
+    if (remap) modbusMapChanged();
+    return true;
+}
+
+// Registri di configurazione correnti
+static void modbusConfigRead(uint16_t *config) {
+    config[MB_CFG_SLAVE_ID] = currentSlaveId;
+    config[MB_CFG_BAUDRATE] = currentBaudrate >> 16;
+    config[MB_CFG_BAUDRATE + 1] = currentBaudrate & 0xFFFF;
+    config[MB_CFG_SET_MAPPING] = modbusSetMapping;
+    config[MB_CFG_MAP_ENTRIES] = modbusMap.count;
+}
+
+// Risposta costruita fuori dalla cache (configurazione, scritture)
+static uint8_t directFrame[MODBUS_RTU_MAX_FRAME];
+
+static uint16_t modbusConfigReadResponse(uint8_t unitId, uint16_t offset, uint16_t quantity,
+                                         const uint8_t **frame) {
+    uint16_t config[MB_CFG_COUNT];
+    modbusConfigRead(config);
+    directFrame[0] = unitId;
+    directFrame[1] = MB_FC_READ_HOLDING_REGISTERS;
+    directFrame[2] = quantity * 2;
+    for (uint16_t i = 0; i < quantity; i++) {
+        directFrame[3 + i*2] = config[offset + i] >> 8;
+        directFrame[3 + i*2 + 1] = config[offset + i] & 0xFF;
+    }
+    uint16_t crc = calculateCRC16(directFrame, 3 + quantity * 2);
+    directFrame[3 + quantity * 2] = crc & 0xFF;
+    directFrame[3 + quantity * 2 + 1] = (crc >> 8) & 0xFF;
+    *frame = directFrame;
+    return 5 + quantity * 2;
+}
+
+// Lettura dei registri comandi J1939 (fuori dalla cache: lo stato cambia
+// senza generazione dell'immagine)
+static uint16_t modbusCommandReadResponse(uint8_t unitId, uint16_t offset, uint16_t quantity,
+                                          const uint8_t **frame) {
+    uint16_t words[MODBUS_MAX_READ_QUANTITY];
+    if (!j1939CommandRead(offset, quantity, words)) {
+        return modbusException(unitId, MB_FC_READ_HOLDING_REGISTERS, 0x02, frame);  // Illegal data address
+    }
+    directFrame[0] = unitId;
+    directFrame[1] = MB_FC_READ_HOLDING_REGISTERS;
+    directFrame[2] = quantity * 2;
+    for (uint16_t i = 0; i < quantity; i++) {
+        directFrame[3 + i*2] = words[i] >> 8;
+        directFrame[3 + i*2 + 1] = words[i] & 0xFF;
+    }
+    uint16_t crc = calculateCRC16(directFrame, 3 + quantity * 2);
+    directFrame[3 + quantity * 2] = crc & 0xFF;
+    directFrame[3 + quantity * 2 + 1] = (crc >> 8) & 0xFF;
+    *frame = directFrame;
+    return 5 + quantity * 2;
+}
+
+static uint16_t modbusDtcRecordWord(const DtcRecord &record, uint8_t word) {
+    switch (word) {
+        case MB_DTC_REC_SOURCE_ADDRESS:  return record.sourceAddress;
+        case MB_DTC_REC_SPN:             return record.spn >> 16;
+        case MB_DTC_REC_SPN + 1:         return record.spn & 0xFFFF;
+        case MB_DTC_REC_FMI:             return record.fmi;
+        case MB_DTC_REC_OCCURRENCE:      return record.occurrence;
+        case MB_DTC_REC_CONVERSION:      return record.conversion;
+        case MB_DTC_REC_FIRST_SEEN:      return record.firstSeenMs >> 16;
+        case MB_DTC_REC_FIRST_SEEN + 1:  return record.firstSeenMs & 0xFFFF;
+        case MB_DTC_REC_LAST_SEEN:       return record.lastSeenMs >> 16;
+        default:                         return record.lastSeenMs & 0xFFFF;
+    }
+}
+
+// Lettura del registro DTC: intestazione o record di una lista, copiati in
+// un colpo solo dal registro (fuori dalla cache: nessuna generazione)
+static uint16_t modbusDtcReadResponse(uint8_t unitId, uint8_t functionCode, uint16_t startAddress,
+                                      uint16_t quantity, const uint8_t **frame) {
+    uint16_t offset = startAddress - MODBUS_DTC_BASE;
+    uint16_t listBase = (offset >= MB_DTC_PREVIOUS) ? MB_DTC_PREVIOUS : MB_DTC_ACTIVE;
+    uint8_t list = (offset >= MB_DTC_PREVIOUS) ? DTC_LIST_PREVIOUS : DTC_LIST_ACTIVE;
+    bool header = offset + quantity <= MB_DTC_HEADER_COUNT;
+    if (!header && (offset < MB_DTC_ACTIVE ||
+                    offset + quantity > listBase + DTC_STORE_CAPACITY * MB_DTC_RECORD_WORDS)) {
+        return modbusException(unitId, functionCode, 0x02, frame);  // Illegal data address
+    }
+    
+    DtcRecord records[MODBUS_MAX_READ_QUANTITY / MB_DTC_RECORD_WORDS + 2];
+    DtcStoreInfo info;
+    uint16_t first = header ? 0 : (offset - listBase) / MB_DTC_RECORD_WORDS;
+    uint16_t last = header ? 0 : (offset - listBase + quantity - 1) / MB_DTC_RECORD_WORDS;
+    uint8_t copied = dtcStoreRead(list, first, records, header ? 0 : last - first + 1, info);
+    uint16_t headerWords[MB_DTC_HEADER_COUNT] = {
+        info.count[DTC_LIST_ACTIVE], info.count[DTC_LIST_PREVIOUS],
+        (uint16_t)info.changes, (uint16_t)info.dropped, DTC_STORE_CAPACITY,
+    };
+    
+    directFrame[0] = unitId;
+    directFrame[1] = functionCode;
+    directFrame[2] = quantity * 2;
+    for (uint16_t i = 0; i < quantity; i++) {
+        uint16_t value;
+        if (header) {
+            value = headerWords[offset + i];
+        } else {
+            uint16_t word = offset - listBase + i;
+            uint16_t record = word / MB_DTC_RECORD_WORDS - first;
+            value = (record < copied) ? modbusDtcRecordWord(records[record], word % MB_DTC_RECORD_WORDS) : 0xFFFF;
+        }
+        directFrame[3 + i*2] = value >> 8;
+        directFrame[3 + i*2 + 1] = value & 0xFF;
+    }
+    uint16_t crc = calculateCRC16(directFrame, 3 + quantity * 2);
+    directFrame[3 + quantity * 2] = crc & 0xFF;
+    directFrame[3 + quantity * 2 + 1] = (crc >> 8) & 0xFF;
+    *frame = directFrame;
+    return 5 + quantity * 2;
+}
+
+// Scrittura di registri (FC 0x06 e 0x10) sullo slave ID base: comandi J1939
+// oppure configurazione. I valori di configurazione scritti vengono uniti a
+// quelli correnti e applicati solo se tutti validi. Restituisce 0 o il
+// codice di eccezione
+static uint8_t modbusWriteRegisters(uint8_t unitId, uint16_t startAddress, uint16_t quantity,
+                                    const uint8_t *values) {
+    if (unitId != currentSlaveId) return 0x02;  // Illegal data address
+    if (startAddress >= MODBUS_COMMAND_BASE && startAddress + quantity <= MODBUS_COMMAND_BASE + MB_CMD_COUNT) {
+        return j1939CommandWrite(startAddress - MODBUS_COMMAND_BASE, quantity, values, hal_millis());
+    }
+    if (startAddress < MODBUS_CONFIG_BASE || startAddress + quantity > MODBUS_CONFIG_BASE + MB_CFG_MAP_ENTRIES) {
+        return 0x02;  // Illegal data address
+    }
+    // Baud rate solo con entrambe le word nella stessa scrittura: una word
+    // nuova unita a quella vecchia darebbe un valore intermedio (da 9600 a
+    // 115200 scrivendo prima la word alta: 75136 baud) applicato subito
+    uint16_t offset = startAddress - MODBUS_CONFIG_BASE;
+    bool baudHigh = offset <= MB_CFG_BAUDRATE && offset + quantity > MB_CFG_BAUDRATE;
+    bool baudLow = offset <= MB_CFG_BAUDRATE + 1 && offset + quantity > MB_CFG_BAUDRATE + 1;
+    if (baudHigh != baudLow) return 0x02;  // Illegal data address
+    
+    uint16_t config[MB_CFG_COUNT];
+    modbusConfigRead(config);
+    for (uint16_t i = 0; i < quantity; i++) {
+        config[offset + i] = (values[i*2] << 8) | values[i*2 + 1];
+    }
+    uint32_t baudrate = ((uint32_t)config[MB_CFG_BAUDRATE] << 16) | config[MB_CFG_BAUDRATE + 1];
+    if (!modbusConfigApply(config[MB_CFG_SLAVE_ID], baudrate, config[MB_CFG_SET_MAPPING])) {
+        return 0x03;  // Illegal data value
+    }
+    if (modbusConfigChanged != NULL) modbusConfigChanged();
+    return 0;
+}
+
+// Risposta a una scrittura riuscita: i primi 6 byte della richiesta (per
+// FC 0x06 l'intera richiesta), con lo slave ID della richiesta anche se è
+// cambiato
+static uint16_t modbusWriteResponse(const uint8_t *request, const uint8_t **frame) {
+    memcpy(directFrame, request, 6);
+    uint16_t crc = calculateCRC16(directFrame, 6);
+    directFrame[6] = crc & 0xFF;
+    directFrame[7] = (crc >> 8) & 0xFF;
+    *frame = directFrame;
+    return 8;
+}
+
+static uint16_t modbusWriteMultiple(const uint8_t *request, uint16_t length, const uint8_t **frame) {
+    uint8_t unitId = request[0];
+    uint16_t startAddress = (request[2] << 8) | request[3];
+    uint16_t quantity = (request[4] << 8) | request[5];
+    if (quantity == 0 || quantity > MODBUS_MAX_WRITE_QUANTITY ||
+        request[6] != quantity * 2 || length != 7 + quantity * 2) {
+        return modbusException(unitId, MB_FC_WRITE_MULTIPLE_REGISTERS, 0x03, frame);  // Illegal data value
+    }
+    uint8_t exceptionCode = modbusWriteRegisters(unitId, startAddress, quantity, &request[7]);
+    if (exceptionCode != 0) return modbusException(unitId, MB_FC_WRITE_MULTIPLE_REGISTERS, exceptionCode, frame);
+    return modbusWriteResponse(request, frame);
+}
+
+static uint16_t modbusWriteSingle(const uint8_t *request, uint16_t length, const uint8_t **frame) {
+    uint8_t unitId = request[0];
+    if (length != 6) {
+        return modbusException(unitId, MB_FC_WRITE_SINGLE_REGISTER, 0x03, frame);  // Illegal data value
+    }
+    uint16_t address = (request[2] << 8) | request[3];
+    uint8_t exceptionCode = modbusWriteRegisters(unitId, address, 1, &request[4]);
+    if (exceptionCode != 0) return modbusException(unitId, MB_FC_WRITE_SINGLE_REGISTER, exceptionCode, frame);
+    return modbusWriteResponse(request, frame);
+}
+
+// FC 0x08: eco della richiesta, con i dati sostituiti dal contatore per le
+// sotto-funzioni di lettura. Azzerare i contatori azzera anche quelli di
+// /metrics (i reset dei counter sono gestiti da Prometheus)
+static uint16_t modbusDiagnostics(const uint8_t *request, uint16_t length, const uint8_t **frame) {
+    uint8_t unitId = request[0];
+    if (length != 6) {
+        return modbusException(unitId, MB_FC_DIAGNOSTICS, 0x03, frame);  // Illegal data value
+    }
+    uint16_t subFunction = (request[2] << 8) | request[3];
+    uint16_t data = (request[4] << 8) | request[5];
+    switch (subFunction) {
+        case MB_DIAG_RETURN_QUERY_DATA:
+            break;
+        case MB_DIAG_RESTART_COMMUNICATIONS:
+        case MB_DIAG_CLEAR_COUNTERS:
+            memset(&modbusDiag, 0, sizeof(modbusDiag));
+            break;
+        case MB_DIAG_RETURN_REGISTER:
+        case MB_DIAG_SERVER_NO_RESPONSE:
+        case MB_DIAG_SERVER_NAK_COUNT:
+        case MB_DIAG_SERVER_BUSY_COUNT:
+            data = 0;
+            break;
+        case MB_DIAG_BUS_MESSAGE_COUNT:      data = modbusDiag.busMessages; break;
+        case MB_DIAG_BUS_COMM_ERROR_COUNT:   data = modbusDiag.busCrcErrors; break;
+        case MB_DIAG_BUS_EXCEPTION_COUNT:    data = modbusDiag.busExceptions; break;
+        case MB_DIAG_SERVER_MESSAGE_COUNT:   data = modbusDiag.serverMessages; break;
+        case MB_DIAG_BUS_CHAR_OVERRUN_COUNT: data = modbusDiag.charOverruns; break;
+        default:
+            return modbusException(unitId, MB_FC_DIAGNOSTICS, 0x01, frame);  // Illegal function
+    }
+    
+    memcpy(directFrame, request, 4);
+    directFrame[4] = data >> 8;
+    directFrame[5] = data & 0xFF;
+    uint16_t crc = calculateCRC16(directFrame, 6);
+    directFrame[6] = crc & 0xFF;
+    directFrame[7] = (crc >> 8) & 0xFF;
+    *frame = directFrame;
+    return 8;
+}
+
+// Esegue una richiesta (unit ID + PDU, senza CRC) sull'immagine registri,
+// indipendente dal trasporto (RTU o TCP). La risposta è un frame RTU con CRC
+// in *frame, valido fino alla richiesta successiva: di norma è direttamente
+// lo slot della cache risposte. Restituisce 0 se la richiesta non è per noi
+uint16_t modbusExecute(const uint8_t *request, uint16_t length, const uint8_t **frame) {
+    if (length < 2) return 0;
+    
+    // Data set richiesto: per unit ID (slave ID base + banco, solo banchi con
+    // una ECU) oppure per banchi di registri sullo slave ID base
+    uint8_t unitId = request[0];
+    uint8_t firstBank = 0;
+    if (modbusSetMapping == MODBUS_MAP_UNIT_ID) {
+        if (unitId < currentSlaveId) return 0;  // Non per noi
+        uint16_t bank = unitId - currentSlaveId;
+        if (bank > 0 && bank >= engineDataSourceCount()) return 0;
+        firstBank = bank;
+    } else if (unitId != currentSlaveId) {
+        return 0;  // Non per noi
+    }
+    
+    // Processa in base al codice funzione
+    uint8_t functionCode = request[1];
+    modbusDiag.serverMessages++;
+    
+    switch (functionCode) {
+        case MB_FC_READ_HOLDING_REGISTERS:
+        case MB_FC_READ_INPUT_REGISTERS: {
+            // Verifica limiti
+            if (length != 6) {
+                return modbusException(unitId, functionCode, 0x03, frame);  // Illegal data value
+            }
+            uint16_t startAddress = (request[2] << 8) | request[3];
+            uint16_t quantity = (request[4] << 8) | request[5];
+            if (quantity == 0 || quantity > MODBUS_MAX_READ_QUANTITY) {
+                return modbusException(unitId, functionCode, 0x03, frame);  // Illegal data value
+            }
+            if (startAddress >= MODBUS_CONFIG_BASE && functionCode == MB_FC_READ_HOLDING_REGISTERS &&
+                unitId == currentSlaveId) {
+                if (startAddress + quantity > MODBUS_CONFIG_BASE + MB_CFG_COUNT) {
+                    return modbusException(unitId, functionCode, 0x02, frame);  // Illegal data address
+                }
+                return modbusConfigReadResponse(unitId, startAddress - MODBUS_CONFIG_BASE, quantity, frame);
+            }
+            if (startAddress >= MODBUS_COMMAND_BASE && startAddress < MODBUS_DTC_BASE &&
+                functionCode == MB_FC_READ_HOLDING_REGISTERS && unitId == currentSlaveId) {
+                return modbusCommandReadResponse(unitId, startAddress - MODBUS_COMMAND_BASE, quantity, frame);
+            }
+            if (startAddress >= MODBUS_DTC_BASE && startAddress < MODBUS_CONFIG_BASE && unitId == currentSlaveId) {
+                return modbusDtcReadResponse(unitId, functionCode, startAddress, quantity, frame);
+            }
+            
+            // Indirizzi validi: con i banchi di registri tutti i banchi (le
+            // lacune della mappa leggono 0), altrimenti i registri della tabella
+            uint8_t table = (functionCode == MB_FC_READ_HOLDING_REGISTERS) ? 0 : 1;
+            uint16_t stride = (modbusSetMapping == MODBUS_MAP_REGISTER_BANK) ? modbusMap.bankStride : 0;
+            uint16_t base = modbusMap.base[table];
+            uint16_t end = modbusMap.end[table];
+            if (stride != 0) {
+                if (startAddress + quantity > stride * ENGINE_DATA_MAX_SOURCES) {
+                    return modbusException(unitId, functionCode, 0x02, frame);  // Illegal data address
+                }
+            } else if (startAddress < base || startAddress + quantity > end) {
+                return modbusException(unitId, functionCode, 0x02, frame);  // Illegal data address
+            }
+            
+            // Aggiorna registri (solo se arrivati dati nuovi)
+            updateModbusRegisters();
+            
+            // Stessa richiesta e registri invariati: risposta già pronta
+            bool hit;
+            ModbusCachedResponse &entry = *modbusCacheLookup(unitId, functionCode, startAddress, quantity, &hit);
+            if (hit) {
+                modbusCacheStats.hits++;
+                *frame = entry.frame;
+                return entry.length;
+            }
+            modbusCacheStats.misses++;
+            
+            // Prepara risposta direttamente nello slot di cache, con CRC
+            // calcolato mentre si scrivono i byte
+            uint8_t *response = entry.frame;
+            response[0] = unitId;
+            response[1] = functionCode;
+            response[2] = quantity * 2;  // Byte count
+            uint16_t responseCrc = crc16Compute(response, 3);
+            memset(entry.registerMask, 0, sizeof(entry.registerMask));
+            
+            // Un passaggio sull'indice compilato: indirizzo -> word del banco
+            const uint8_t *index = modbusMap.index[table];
+            uint8_t bank = firstBank;
+            uint16_t offset = startAddress;
+            if (stride != 0) {
+                bank = startAddress / stride;
+                offset = startAddress % stride;
+            }
+            for (uint16_t i = 0; i < quantity; i++) {
+                uint16_t value = 0;
+                if (offset >= base && offset < end && index[offset - base] != MODBUS_MAP_UNMAPPED) {
+                    uint16_t reg = bank * MODBUS_BANK_WORDS + index[offset - base];
+                    value = modbusRegisters[reg];
+                    entry.registerMask[reg / 32] |= 1UL << (reg % 32);
+                }
+                uint8_t high = (value >> 8) & 0xFF;
+                uint8_t low = value & 0xFF;
+                response[3 + i*2] = high;
+                response[3 + i*2 + 1] = low;
+                responseCrc = crc16Update(crc16Update(responseCrc, high), low);
+                if (++offset == stride && stride != 0) {
+                    offset = 0;
+                    bank++;
+                }
+            }
+            
+            // Aggiungi CRC
+            response[3 + quantity * 2] = responseCrc & 0xFF;
+            response[3 + quantity * 2 + 1] = (responseCrc >> 8) & 0xFF;
+            
+            entry.valid = true;
+            entry.slaveId = unitId;
+            entry.functionCode = functionCode;
+            entry.start = startAddress;
+            entry.quantity = quantity;
+            entry.length = 5 + quantity * 2;
+            entry.generation = modbusImageGeneration;
+            
+            *frame = response;
+            return entry.length;
+        }
+        
+        case MB_FC_WRITE_MULTIPLE_REGISTERS:
+            if (length < 7) {
+                return modbusException(unitId, functionCode, 0x03, frame);  // Illegal data value
+            }
+            return modbusWriteMultiple(request, length, frame);
+            
+        case MB_FC_WRITE_SINGLE_REGISTER:
+            return modbusWriteSingle(request, length, frame);
+            
+        case MB_FC_DIAGNOSTICS:
+            return modbusDiagnostics(request, length, frame);
+            
+        default:
+            // Funzione non supportata
+            return modbusException(unitId, functionCode, 0x01, frame);  // Illegal function
+    }
+}
+
+// Gestisce una richiesta RTU completa con CRC già verificato; il turnaround
+// va dal frame completo alla risposta consegnata alla UART
+static void modbusHandleFrame(const uint8_t *request, uint16_t len) {
+    uint32_t start = hal_cycles();
+    modbusDiag.busMessages++;
+    std::lock_guard<std::mutex> lock(modbusMutex);
+    const uint8_t *frame;
+    uint16_t frameLength = modbusExecute(request, len - 2, &frame);
+    if (frameLength > 0) {
+        hal_uart_write(frame, frameLength);
+        modbusDiag.rtuRequests++;
+        metricsObserve(metricsRtuTurnaround, metricsCyclesToNs(hal_cycles() - start));
+    }
+}
+
+// Processa richieste Modbus: attende dati dalla UART fino a timeoutMs
+// (bloccante nel task dedicato, 0 = polling) e risponde a ogni frame completo
+void processModbusRequest(uint32_t timeoutMs) {
+    uint8_t chunk[MODBUS_RTU_MAX_FRAME];
+    bool frameEnd = false;
+    size_t received = hal_uart_receive(chunk, sizeof(chunk), timeoutMs, &frameEnd);
+    bool traffic = received > 0 || frameEnd;  // Timeout senza traffico: non profilato
+    uint32_t profileStart = traffic ? profileBegin(PROFILE_MODBUS) : 0;
+    
+    for (size_t i = 0; i < received; i++) {
+        if (rxLength >= sizeof(rxFrame)) {
+            modbusDiag.charOverruns++;  // Frame troppo lungo: scarta
+            modbusRxReset();
+        }
+        rxFrame[rxLength++] = chunk[i];
+        rxCrc = crc16Update(rxCrc, chunk[i]);
+        if (rxExpected == 0) rxExpected = modbusExpectedLength(rxFrame, rxLength);
+        
+        // Richiesta a lunghezza nota: risposta senza attendere il silenzio T3.5
+        // (più richieste accodate vengono separate qui)
+        if (rxLength == rxExpected && rxCrc == 0) {
+            modbusHandleFrame(rxFrame, rxLength);
+            modbusRxReset();
+        }
+    }
+    
+    // Fine frame (silenzio T3.5): gestisci se valido, altrimenti scarta
+    if (frameEnd) {
+        if (rxLength >= 4 && rxCrc == 0) {
+            modbusHandleFrame(rxFrame, rxLength);
+        } else if (rxLength > 0) {
+            modbusDiag.busCrcErrors++;
+        }
+        modbusRxReset();
+    }
+    
+    // Nuovo baudrate (FC 0x10 da RTU o TCP, pagina web): solo tra due frame,
+    // la risposta alla scrittura esce ancora al baudrate vecchio
+    uint32_t baudrate = currentBaudrate;
+    if (baudrate != uartBaudrate && rxLength == 0) {
+        hal_uart_set_baudrate(baudrate);
+        uartBaudrate = baudrate;
+    }
+    if (traffic) profileEnd(PROFILE_MODBUS, profileStart);
+}
@@ -0,0 +1,161 @@
+/*
+ * @Description: Modbus TCP server su porta 502. Più client contemporanei,
+ * ciascuno con la sua sessione; le richieste in pipeline vengono servite in
+ * ordine dall'immagine registri condivisa con lo slave RTU (modbusExecute),
+ * con la risposta RTU in cache riusata senza CRC dietro l'header MBAP.
+ */
+
+#include "modbus_tcp.h"
+#include "config.h"
+#include "hal.h"
+#include "modbus_rtu.h"
+
+#include <string.h>
+
+ModbusTcpStats modbusTcpStats;
+
+bool modbusTcpReceive(ModbusTcpSession &session, const uint8_t *data, size_t length,
+                      ModbusTcpWrite write, void *context) {
+    if (length > sizeof(session.rx) - session.rxLength) {
+        modbusTcpStats.protocolErrors++;
+        return false;
+    }
+    memcpy(&session.rx[session.rxLength], data, length);
+    session.rxLength += length;
+    
+    uint16_t consumed = 0;
+    while (session.rxLength - consumed >= MODBUS_TCP_MBAP_SIZE) {
+        uint8_t *adu = &session.rx[consumed];
+        uint16_t protocolId = (adu[2] << 8) | adu[3];
+        uint16_t aduLength = (adu[4] << 8) | adu[5];  // Unit ID + PDU
+        if (protocolId != 0 || aduLength < 2 || aduLength > MODBUS_TCP_MAX_ADU - 6) {
+            modbusTcpStats.protocolErrors++;
+            return false;
+        }
+        if (session.rxLength - consumed < 6 + aduLength) break;  // Richiesta incompleta
+        
+        // Unit ID 0 e 0xFF indicano il gateway stesso: slave ID base
+        uint8_t unitId = adu[6];
+        if (unitId == 0 || unitId == 0xFF) adu[6] = currentSlaveId;
+        
+        // Risposta copiata fuori dal lock: lo stack TCP non blocca lo slave RTU
+        uint8_t pdu[MODBUS_RTU_MAX_FRAME];
+        uint16_t pduLength;
+        {
+            std::lock_guard<std::mutex> lock(modbusMutex);
+            const uint8_t *frame;
+            uint16_t frameLength = modbusExecute(&adu[6], aduLength, &frame);
+            if (frameLength > 0) {
+                pduLength = frameLength - 3;  // Senza unit ID e CRC
+                memcpy(pdu, frame + 1, pduLength);
+            } else {
+                // Nessun data set per questo unit ID
+                pdu[0] = adu[7] | 0x80;
+                pdu[1] = 0x0B;  // Gateway target device failed to respond
+                pduLength = 2;
+            }
+        }
+        adu[6] = unitId;
+        
+        uint8_t header[MODBUS_TCP_MBAP_SIZE];
+        header[0] = adu[0];  // Transaction ID
+        header[1] = adu[1];
+        header[2] = 0;       // Protocol ID
+        header[3] = 0;
+        header[4] = (pduLength + 1) >> 8;
+        header[5] = (pduLength + 1) & 0xFF;
+        header[6] = unitId;
+        if (!write(context, header, pdu, pduLength)) break;  // Riprova quando il client legge
+        
+        modbusTcpStats.requests++;
+        consumed += 6 + aduLength;
+    }
+    
+    session.rxLength -= consumed;
+    memmove(session.rx, &session.rx[consumed], session.rxLength);
+    return true;
+}
+
+#ifdef ARDUINO
+
+#include <AsyncTCP.h>
+
+static AsyncServer *tcpServer = NULL;
+static ModbusTcpSession sessions[MODBUS_TCP_MAX_CLIENTS];
+
+static bool tcpWrite(void *context, const uint8_t *header, const uint8_t *pdu, uint16_t pduLength) {
+    AsyncClient *client = (AsyncClient *)context;
+    if (client->space() < MODBUS_TCP_MBAP_SIZE + pduLength) return false;
+    client->add((const char *)header, MODBUS_TCP_MBAP_SIZE);
+    client->add((const char *)pdu, pduLength);
+    return true;
+}
+
+static void tcpServe(ModbusTcpSession *session, AsyncClient *client, const uint8_t *data, size_t length) {
+    if (!modbusTcpReceive(*session, data, length, tcpWrite, client)) {
+        client->close(true);
+        return;
+    }
+    client->send();
+}
+
+static void tcpOnClient(void *arg, AsyncClient *client) {
+    ModbusTcpSession *session = NULL;
+    for (uint8_t i = 0; i < MODBUS_TCP_MAX_CLIENTS; i++) {
+        if (sessions[i].client == NULL) {
+            session = &sessions[i];
+            break;
+        }
+    }
+    if (session == NULL) {
+        modbusTcpStats.rejected++;
+        client->onDisconnect([](void *arg, AsyncClient *client) {
+            delete client;
+        }, NULL);
+        client->close(true);
+        return;
+    }
+    
+    session->client = client;
+    session->rxLength = 0;
+    modbusTcpStats.connections++;
+    client->setNoDelay(true);
+    client->setRxTimeout(MODBUS_TCP_IDLE_TIMEOUT_S);
+    
+    client->onData([](void *arg, AsyncClient *client, void *data, size_t length) {
+        tcpServe((ModbusTcpSession *)arg, client, (const uint8_t *)data, length);
+    }, session);
+    
+    // Spazio liberato nel buffer di trasmissione: riprende le richieste in coda
+    client->onAck([](void *arg, AsyncClient *client, size_t length, uint32_t time) {
+        ModbusTcpSession *session = (ModbusTcpSession *)arg;
+        if (session->rxLength > 0) tcpServe(session, client, NULL, 0);
+    }, session);
+    
+    client->onTimeout([](void *arg, AsyncClient *client, uint32_t time) {
+        client->close(true);
+    }, session);
+    
+    client->onDisconnect([](void *arg, AsyncClient *client) {
+        ((ModbusTcpSession *)arg)->client = NULL;
+        delete client;
+    }, session);
+}
+
+// Avvia il server Modbus TCP (chiamare con la rete configurata)
+void modbusTcpBegin() {
+    if (tcpServer != NULL) return;
+    tcpServer = new AsyncServer(MODBUS_TCP_PORT);
+    tcpServer->setNoDelay(true);
+    tcpServer->onClient(tcpOnClient, NULL);
+    tcpServer->begin();
+    HAL_LOG("Modbus TCP server on port %u\n", (unsigned)MODBUS_TCP_PORT);
+}
+
+#else
+
+// Harness native: le sessioni sono alimentate direttamente da modbusTcpReceive
+void modbusTcpBegin() {
+}
+
+#endif
@@ -0,0 +1,190 @@
+/*
+ * @Description: Report-by-exception MQTT dei data set (vedi mqtt_report.h)
+ */
+
+#include "mqtt_report.h"
+#include "json_writer.h"
+
+#include <new>
+#include <string.h>
+
+// Bande morte di default, nelle unità dei campi di EngineData
+const MqttReportConfig MQTT_REPORT_DEFAULTS = {
+    {
+        10,   // rpm
+        5,    // engineTemp (°C * 10)
+        4,    // oilPressure (kPa)
+        10,   // fuelRate (L/h * 100)
+        10,   // engineHours (h * 100)
+        5,    // coolantTemp (°C * 10)
+        5,    // intakeTemp (°C * 10)
+        20,   // exhaustTemp (°C * 10)
+        1,    // engineLoad (%)
+        1,    // throttlePos (%)
+        1,    // engineTorque (%)
+        1,    // batteryVoltage (V * 10)
+    },
+    MQTT_MAX_AGE_MS,
+    MQTT_FLUSH_INTERVAL_MS,
+};
+
+MqttReportStats mqttReportStats;
+
+// Ultimo valore riportato per segnale, per slot del data set
+struct MqttReportSet {
+    uint8_t sourceAddress;
+    uint32_t version;                 // Versione pubblicata già valutata
+    uint32_t reportedValid;           // Segnali con un valore riportato (bit = EngineField)
+    uint32_t oldestReport;            // Minimo di reportedAt sui segnali riportati
+    int64_t reported[FIELD_COUNT];
+    uint32_t reportedAt[FIELD_COUNT];
+};
+
+struct MqttQueuedMessage {
+    uint8_t sourceAddress;
+    uint16_t length;
+    char payload[MQTT_PAYLOAD_MAX];
+};
+
+static MqttReportConfig reportConfig;
+// Stato e coda dallo heap al primo mqttReportBegin (broker configurato),
+// poi riusati: nessuna memoria senza MQTT
+static MqttReportSet *reportSets = NULL;
+static uint8_t reportSetCount = 0;
+static bool resync = true;   // Riporta tutti i segnali al prossimo flush
+static uint32_t lastFlush = 0;
+static bool flushDue = true;
+static uint32_t sequence = 0;
+
+static MqttQueuedMessage *queue = NULL;
+static uint32_t queueHead = 0;
+static uint32_t queueTail = 0;
+
+bool mqttReportBegin(const MqttReportConfig &config) {
+    if (reportSets == NULL) reportSets = new (std::nothrow) MqttReportSet[ENGINE_DATA_MAX_SOURCES];
+    if (queue == NULL) queue = new (std::nothrow) MqttQueuedMessage[MQTT_QUEUE_MESSAGES];
+    if (reportSets == NULL || queue == NULL) return false;
+    reportConfig = config;
+    reportSetCount = 0;
+    resync = true;
+    flushDue = true;
+    sequence = 0;
+    queueHead = queueTail = 0;
+    return true;
+}
+
+uint16_t mqttReportQueued() {
+    return queueHead - queueTail;
+}
+
+// Accoda un messaggio: a coda piena si sacrifica il più vecchio e si chiede
+// un report completo per non lasciare valori superati
+static void mqttQueuePush(uint8_t sourceAddress, const char *payload, uint16_t length) {
+    if (queueHead - queueTail >= MQTT_QUEUE_MESSAGES) {
+        queueTail++;
+        mqttReportStats.dropped++;
+        resync = true;
+    }
+    MqttQueuedMessage &message = queue[queueHead % MQTT_QUEUE_MESSAGES];
+    message.sourceAddress = sourceAddress;
+    message.length = length;
+    memcpy(message.payload, payload, length + 1);
+    queueHead++;
+    mqttReportStats.messages++;
+    uint32_t queued = queueHead - queueTail;
+    if (queued > mqttReportStats.queueHighWater) mqttReportStats.queueHighWater = queued;
+}
+
+static bool mqttSignalDue(const MqttReportSet &set, uint8_t field, int64_t value, uint32_t nowMs) {
+    if (!(set.reportedValid & FIELD_BIT(field))) return true;
+    int64_t delta = value - set.reported[field];
+    if (delta < 0) delta = -delta;
+    if (delta > (int64_t)reportConfig.deadband[field]) return true;
+    return reportConfig.maxAgeMs != 0 && nowMs - set.reportedAt[field] >= reportConfig.maxAgeMs;
+}
+
+// Valuta un data set e accoda il messaggio dei segnali da riportare
+// (full: report completo, ignorando l'ultimo valore riportato)
+static void mqttReportSlot(uint8_t slot, uint32_t nowMs, bool full) {
+    MqttReportSet &set = reportSets[slot];
+    uint32_t version = engineDataVersion(slot);
+    bool aged = reportConfig.maxAgeMs != 0 && set.reportedValid != 0 &&
+                nowMs - set.oldestReport >= reportConfig.maxAgeMs;
+    if (!full && version == set.version && !aged && set.reportedValid != 0) return;
+
+    EngineData data;
+    engineDataRead(slot, data);
+    // Segnali riportati validi: null se non lo sono più (anche nei report completi)
+    uint32_t nullMask = set.reportedValid;
+    if (data.sourceAddress != set.sourceAddress) nullMask = 0;
+    if (full || data.sourceAddress != set.sourceAddress) {
+        set.sourceAddress = data.sourceAddress;
+        set.reportedValid = 0;
+    }
+    set.version = version;
+
+    char payload[MQTT_PAYLOAD_MAX];
+    JsonWriter writer;
+    jsonBegin(writer, payload, sizeof(payload));
+    jsonUint(writer, "seq", sequence);
+    uint8_t written = 0;
+    uint32_t oldest = nowMs;
+    for (uint8_t field = 0; field < FIELD_COUNT; field++) {
+        bool valid = data.validFlags & FIELD_BIT(field);
+        if (valid) {
+            int64_t value = engineFieldValue(data, (EngineField)field);
+            if (mqttSignalDue(set, field, value, nowMs)) {
+                jsonInt(writer, engineFieldName((EngineField)field), value);
+                set.reported[field] = value;
+                set.reportedAt[field] = nowMs;
+                set.reportedValid |= FIELD_BIT(field);
+                written++;
+            }
+            if (nowMs - set.reportedAt[field] > nowMs - oldest) oldest = set.reportedAt[field];
+        } else if (nullMask & FIELD_BIT(field)) {
+            jsonNull(writer, engineFieldName((EngineField)field));
+            set.reportedValid &= ~FIELD_BIT(field);
+            written++;
+        }
+    }
+    set.oldestReport = oldest;
+    if (written == 0) return;  // Niente da riportare
+    size_t length = jsonEnd(writer);
+    if (length == 0) return;
+
+    mqttQueuePush(data.sourceAddress, payload, length);
+    sequence++;
+    mqttReportStats.signals += written;
+}
+
+static void mqttQueueDrain(MqttPublishFn publish, void *context) {
+    while (publish != NULL && queueTail != queueHead) {
+        const MqttQueuedMessage &message = queue[queueTail % MQTT_QUEUE_MESSAGES];
+        if (!publish(message.sourceAddress, message.payload, message.length, context)) break;
+        queueTail++;
+        mqttReportStats.published++;
+    }
+}
+
+void mqttReportService(uint32_t nowMs, MqttPublishFn publish, void *context) {
+    if (queue == NULL) return;
+    // Prima la coda arretrata: il flush non deve scartare messaggi consegnabili
+    mqttQueueDrain(publish, context);
+    if (flushDue || nowMs - lastFlush >= reportConfig.flushIntervalMs) {
+        flushDue = false;
+        lastFlush = nowMs;
+        // Slot nuovi: stato da riportare per intero
+        uint8_t count = engineDataSourceCount();
+        for (; reportSetCount < count; reportSetCount++) {
+            reportSets[reportSetCount].reportedValid = 0;
+            reportSets[reportSetCount].version = 0;
+        }
+        // Un report completo chiesto durante il flush (coda piena) vale per il prossimo
+        bool full = resync;
+        resync = false;
+        for (uint8_t slot = 0; slot < count; slot++) {
+            mqttReportSlot(slot, nowMs, full);
+        }
+        mqttQueueDrain(publish, context);
+    }
+}
@@ -0,0 +1,148 @@
+/*
+ * @Description: Profiler dei task (vedi profiler.h)
+ */
+
+#include "profiler.h"
+
+#include <atomic>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+ProfileStats profileStats[PROFILE_SECTIONS];
+MetricsHistogram profileCanBacklog;
+uint32_t profileCanBacklogMaxUs = 0;
+
+struct ProfileSectionInfo {
+    const char *name;
+    bool periodic;       // Attivata da un ritardo fisso: jitter significativo
+};
+
+static const ProfileSectionInfo SECTIONS[PROFILE_SECTIONS] = {
+    { "can", false },
+    { "modbus", false },
+    { "web", true },
+    { "log", true },
+    { "mqtt", true },
+    { "status", true },
+    { "command", true },
+};
+
+struct ProfileTask {
+    const char *name;
+    void *task;
+    uint32_t stackSize;
+};
+
+static ProfileTask tasks[PROFILE_MAX_TASKS];
+static std::atomic<uint8_t> taskCount(0);
+static std::atomic<uint32_t> resetGeneration(0);
+
+const char *profileSectionName(uint8_t section) {
+    return (section < PROFILE_SECTIONS) ? SECTIONS[section].name : "";
+}
+
+bool profileSectionPeriodic(uint8_t section) {
+    return section < PROFILE_SECTIONS && SECTIONS[section].periodic;
+}
+
+uint32_t profileBegin(ProfileSection section) {
+    ProfileStats &stats = profileStats[section];
+    uint32_t generation = resetGeneration.load(std::memory_order_relaxed);
+    if (stats.generation != generation) {
+        memset(&stats, 0, sizeof(stats));
+        stats.generation = generation;
+        // Attesa dei frame CAN: stesso scrittore della sezione CAN
+        if (section == PROFILE_CAN) {
+            memset(&profileCanBacklog, 0, sizeof(profileCanBacklog));
+            profileCanBacklogMaxUs = 0;
+        }
+    }
+    if (SECTIONS[section].periodic) {
+        uint32_t now = hal_micros();
+        if (stats.time.count > 0) {
+            uint32_t interval = now - stats.lastActivationUs;
+            if (stats.minIntervalUs == 0 || interval < stats.minIntervalUs) stats.minIntervalUs = interval;
+            if (interval > stats.maxIntervalUs) stats.maxIntervalUs = interval;
+        }
+        stats.lastActivationUs = now;
+    }
+    return hal_cycles();
+}
+
+void profileCanBacklogObserve(uint32_t ageUs) {
+    metricsObserve(profileCanBacklog, ageUs < 4000000 ? ageUs * 1000 : 0xFFFFFFFF);
+    if (ageUs > profileCanBacklogMaxUs) profileCanBacklogMaxUs = ageUs;
+}
+
+void profileReset() {
+    resetGeneration.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool profileTaskRegister(const char *name, void *task, uint32_t stackSize) {
+    uint8_t count = taskCount.load(std::memory_order_relaxed);
+    if (count >= PROFILE_MAX_TASKS) return false;
+    tasks[count].name = name;
+    tasks[count].task = task;
+    tasks[count].stackSize = stackSize;
+    taskCount.store(count + 1, std::memory_order_release);
+    return true;
+}
+
+uint8_t profileTaskCount() {
+    return taskCount.load(std::memory_order_acquire);
+}
+
+const char *profileTaskName(uint8_t index) {
+    return tasks[index].name;
+}
+
+uint32_t profileTaskStackSize(uint8_t index) {
+    return tasks[index].stackSize;
+}
+
+uint32_t profileTaskStackFree(uint8_t index) {
+    return hal_task_stack_free(tasks[index].task);
+}
+
+// snprintf accodato: a buffer pieno il testo resta troncato a una riga intera
+static void profilePrintf(char *buffer, size_t size, size_t &length, const char *format, ...) {
+    if (length >= size) return;
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(buffer + length, size - length, format, args);
+    va_end(args);
+    if (written < 0 || (size_t)written >= size - length) {
+        buffer[length] = '\0';
+        length = size;
+        return;
+    }
+    length += written;
+}
+
+size_t profileReport(char *buffer, size_t size) {
+    if (size == 0) return 0;
+    buffer[0] = '\0';
+    size_t length = 0;
+    profilePrintf(buffer, size, length, "%-8s %10s %10s %10s %10s\n", "section", "count", "avg_us", "max_us", "jitter_us");
+    for (uint8_t section = 0; section < PROFILE_SECTIONS; section++) {
+        const ProfileStats &stats = profileStats[section];
+        uint32_t count = stats.time.count;
+        double average = count ? stats.time.sumNs / 1000.0 / count : 0;
+        profilePrintf(buffer, size, length, "%-8s %10u %10.1f %10.1f ", SECTIONS[section].name,
+                      (unsigned)count, average, stats.maxNs / 1000.0);
+        if (SECTIONS[section].periodic && stats.maxIntervalUs != 0) {
+            profilePrintf(buffer, size, length, "%10u\n", (unsigned)(stats.maxIntervalUs - stats.minIntervalUs));
+        } else {
+            profilePrintf(buffer, size, length, "%10s\n", "-");
+        }
+    }
+    profilePrintf(buffer, size, length, "can backlog: %u batches, max %u us\n",
+                  (unsigned)profileCanBacklog.count, (unsigned)profileCanBacklogMaxUs);
+    uint8_t count = profileTaskCount();
+    for (uint8_t i = 0; i < count; i++) {
+        profilePrintf(buffer, size, length, "stack %-8s %6u/%u bytes free\n", tasks[i].name,
+                      (unsigned)profileTaskStackFree(i), (unsigned)tasks[i].stackSize);
+    }
+    return (length < size) ? length : strlen(buffer);
+}
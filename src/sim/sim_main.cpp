@@ -0,0 +1,1748 @@
+/*
+ * @Description: Harness host (env:native) - ECU motore J1939 e master Modbus
+ * simulati sul loopback della HAL. Misura latenza frame CAN -> risposta
+ * Modbus e throughput del decoder senza banco prova.
+ *
+ * Uso: pio run -e native && .pio/build/native/program [iterazioni]
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "bus_discovery.h"
+#include "can_log.h"
+#include "can_log_reader.h"
+#include "crc16.h"
+#include "dtc_store.h"
+#include "engine_data.h"
+#include "hal.h"
+#include "history.h"
+#include "j1939.h"
+#include "j1939_command.h"
+#include "j1939_filter.h"
+#include "j1939_node.h"
+#include "j1939_tp.h"
+#include "live_data.h"
+#include "log_download.h"
+#include "metrics.h"
+#include "modbus_rtu.h"
+#include "modbus_tcp.h"
+#include "mqtt_report.h"
+#include "profiler.h"
+#include "web_assets.h"
+
+#define SIM_ECU_SA           0x00
+#define SIM_ECU2_SA          0x01
+#define SIM_TCU_SA           0x03
+#define SIM_DEFAULT_ITER     100000
+#define SIM_THROUGHPUT_BATCH 200
+#define SIM_ECU_COUNT        12
+#define SIM_LOG_FRAMES       20000
+#define SIM_LOG_RATE         40000  // ~10x un bus a 500 kbps al 100% di carico
+#define SIM_LOG_BATCH        32
+
+typedef std::chrono::steady_clock SimClock;
+
+// Costruisce un frame J1939 (priorità, PGN, SA) con payload 0xFF (non disponibile)
+static twai_message_t simFrame(uint8_t priority, uint32_t pgn, uint8_t sa) {
+    twai_message_t message;
+    memset(&message, 0, sizeof(message));
+    message.extd = 1;
+    message.identifier = ((uint32_t)priority << 26) | (pgn << 8) | sa;
+    message.data_length_code = 8;
+    memset(message.data, 0xFF, sizeof(message.data));
+    return message;
+}
+
+// ECU motore simulata: genera il frame i-esimo di un ciclo di broadcast
+static twai_message_t simEcuFrame(uint32_t i) {
+    twai_message_t message;
+    uint32_t value = i & 0x3FF;
+
+    switch (i % 7) {
+        case 0: {  // EEC1 - giri motore (0.125 rpm/bit)
+            message = simFrame(3, PGN_ELECTRONIC_ENGINE_1, SIM_ECU_SA);
+            uint16_t raw = (uint16_t)((800 + value) * 8);
+            message.data[3] = raw & 0xFF;
+            message.data[4] = raw >> 8;
+            break;
+        }
+        case 1:  // ET1 - temperatura refrigerante
+            message = simFrame(6, PGN_ENGINE_TEMP, SIM_ECU_SA);
+            message.data[0] = 40 + 80 + (value & 0x0F);
+            break;
+        case 2:  // EFL/P1 - pressione olio
+            message = simFrame(6, PGN_ENGINE_FLUID_LEVEL, SIM_ECU_SA);
+            message.data[3] = 100 + (value & 0x1F);
+            break;
+        case 3: {  // HOURS
+            message = simFrame(6, PGN_ENGINE_HOURS, SIM_ECU_SA);
+            uint32_t raw = 20000 + i;
+            message.data[0] = raw & 0xFF;
+            message.data[1] = (raw >> 8) & 0xFF;
+            message.data[2] = (raw >> 16) & 0xFF;
+            message.data[3] = (raw >> 24) & 0xFF;
+            break;
+        }
+        case 4:  // LFE - consumo
+            message = simFrame(6, PGN_FUEL_ECONOMY, SIM_ECU_SA);
+            message.data[0] = value & 0xFF;
+            message.data[1] = 0;
+            break;
+        case 5:  // VEP1 - tensione batteria
+            message = simFrame(6, PGN_VEHICLE_ELECTRICAL, SIM_ECU_SA);
+            message.data[4] = 0x1C;
+            message.data[5] = 0x02;
+            break;
+        default:  // EEC2 - pedale acceleratore e carico motore
+            message = simFrame(3, PGN_ELECTRONIC_ENGINE_2, SIM_ECU_SA);
+            message.data[1] = (value % 100) * 5 / 2;
+            message.data[2] = value % 100;
+            break;
+    }
+    return message;
+}
+
+// Traffico di fondo di un bus camion carico: PGN che il gateway non decodifica
+static twai_message_t simBackgroundFrame(uint32_t i) {
+    static const uint32_t pgns[] = { 0xF001, 0xF002, 0xFEF1, 0xFE6C, 0xFEC1, 0xEF00, 0xFF10, 0x0C00 };
+    return simFrame(6, pgns[i % (sizeof(pgns) / sizeof(pgns[0]))], 0x10 + (i & 0x0F));
+}
+
+// Trasmette un messaggio multi-pacchetto in BAM, restituisce i frame generati
+static size_t simBamFrames(twai_message_t *frames, uint32_t pgn, uint8_t sa,
+                           const uint8_t *payload, uint16_t size) {
+    uint8_t packets = (size + 6) / 7;
+    twai_message_t announce = simFrame(7, PGN_TP_CM | J1939_GLOBAL_ADDRESS, sa);
+    announce.data[0] = TP_CM_BAM;
+    announce.data[1] = size & 0xFF;
+    announce.data[2] = size >> 8;
+    announce.data[3] = packets;
+    announce.data[5] = pgn & 0xFF;
+    announce.data[6] = (pgn >> 8) & 0xFF;
+    announce.data[7] = (pgn >> 16) & 0xFF;
+    frames[0] = announce;
+
+    for (uint8_t seq = 1; seq <= packets; seq++) {
+        twai_message_t transfer = simFrame(7, PGN_TP_DT | J1939_GLOBAL_ADDRESS, sa);
+        transfer.data[0] = seq;
+        for (uint8_t i = 0; i < 7; i++) {
+            uint16_t offset = (seq - 1) * 7 + i;
+            if (offset < size) transfer.data[1 + i] = payload[offset];
+        }
+        frames[seq] = transfer;
+    }
+    return packets + 1;
+}
+
+// Traffico per il logger: frame ECU da più SA con DLC variabile, più frame
+// standard 11 bit e remote frame che il decoder J1939 scarta
+static twai_message_t simLogFrame(uint32_t i) {
+    twai_message_t message = simEcuFrame(i);
+    message.identifier = (message.identifier & ~0xFFUL) | (i % SIM_ECU_COUNT);
+    message.data[7] = i & 0xFF;
+    if (i % 13 == 0) message.data_length_code = i % 9;
+    if (i % 17 == 0) {
+        message.extd = 0;
+        message.identifier = 0x100 + (i & 0x3FF);
+    }
+    if (i % 29 == 0) message.rtr = 1;
+    return message;
+}
+
+struct SimLogCheck {
+    uint32_t next;
+    uint32_t mismatches;
+    uint64_t lastTimestamp;
+};
+
+static void simLogCheckFrame(const CanLogFrame &frame, void *ctx) {
+    SimLogCheck &check = *(SimLogCheck *)ctx;
+    twai_message_t expected = simLogFrame(check.next++);
+    uint8_t dataSize = expected.rtr ? 0 : expected.data_length_code;
+    if (frame.identifier != expected.identifier || frame.extended != (bool)expected.extd ||
+        frame.rtr != (bool)expected.rtr || frame.dlc != expected.data_length_code ||
+        memcmp(frame.data, expected.data, dataSize) != 0 || frame.timestamp < check.lastTimestamp) {
+        check.mismatches++;
+    }
+    check.lastTimestamp = frame.timestamp;
+}
+
+// Download completo a pezzi da chunk byte, come le callback del web server
+static std::string simDownload(LogDownload &download, size_t chunk) {
+    std::string out;
+    std::vector<uint8_t> buffer(chunk);
+    while (download.stage != 2) {
+        size_t length = logDownloadRead(download, buffer.data(), chunk);
+        out.append((const char *)buffer.data(), length);
+    }
+    return out;
+}
+
+// Master Modbus simulato: FC 0x03 su tutta la mappa registri
+static size_t simMasterRequest(uint8_t *frame, uint8_t slaveId, uint16_t start, uint16_t quantity) {
+    frame[0] = slaveId;
+    frame[1] = MB_FC_READ_HOLDING_REGISTERS;
+    frame[2] = start >> 8;
+    frame[3] = start & 0xFF;
+    frame[4] = quantity >> 8;
+    frame[5] = quantity & 0xFF;
+    uint16_t crc = calculateCRC16(frame, 6);
+    frame[6] = crc & 0xFF;
+    frame[7] = crc >> 8;
+    return 8;
+}
+
+// Master Modbus simulato: FC 0x10 su registri consecutivi
+static size_t simMasterWrite(uint8_t *frame, uint8_t slaveId, uint16_t start,
+                             const uint16_t *values, uint16_t quantity) {
+    frame[0] = slaveId;
+    frame[1] = MB_FC_WRITE_MULTIPLE_REGISTERS;
+    frame[2] = start >> 8;
+    frame[3] = start & 0xFF;
+    frame[4] = quantity >> 8;
+    frame[5] = quantity & 0xFF;
+    frame[6] = quantity * 2;
+    for (uint16_t i = 0; i < quantity; i++) {
+        frame[7 + i * 2] = values[i] >> 8;
+        frame[8 + i * 2] = values[i] & 0xFF;
+    }
+    uint16_t crc = calculateCRC16(frame, 7 + quantity * 2);
+    frame[7 + quantity * 2] = crc & 0xFF;
+    frame[8 + quantity * 2] = crc >> 8;
+    return 9 + quantity * 2;
+}
+
+// Master Modbus simulato: FC 0x06 su un registro
+static size_t simMasterWriteSingle(uint8_t *frame, uint8_t slaveId, uint16_t address, uint16_t value) {
+    frame[0] = slaveId;
+    frame[1] = MB_FC_WRITE_SINGLE_REGISTER;
+    frame[2] = address >> 8;
+    frame[3] = address & 0xFF;
+    frame[4] = value >> 8;
+    frame[5] = value & 0xFF;
+    uint16_t crc = calculateCRC16(frame, 6);
+    frame[6] = crc & 0xFF;
+    frame[7] = crc >> 8;
+    return 8;
+}
+
+// Master Modbus simulato: FC 0x08 con sotto-funzione e dati
+static size_t simMasterDiagnostics(uint8_t *frame, uint8_t slaveId, uint16_t subFunction, uint16_t data) {
+    frame[0] = slaveId;
+    frame[1] = MB_FC_DIAGNOSTICS;
+    frame[2] = subFunction >> 8;
+    frame[3] = subFunction & 0xFF;
+    frame[4] = data >> 8;
+    frame[5] = data & 0xFF;
+    uint16_t crc = calculateCRC16(frame, 6);
+    frame[6] = crc & 0xFF;
+    frame[7] = crc >> 8;
+    return 8;
+}
+
+// Client MQTT simulato: ultimo messaggio della ECU motore, rifiuta se pieno
+struct SimMqttCapture {
+    uint32_t messages;
+    uint32_t ecuMessages;
+    char ecuPayload[MQTT_PAYLOAD_MAX];
+};
+
+static bool simMqttPublish(uint8_t sourceAddress, const char *payload, size_t length, void *context) {
+    SimMqttCapture &capture = *static_cast<SimMqttCapture *>(context);
+    capture.messages++;
+    if (sourceAddress == SIM_ECU_SA) {
+        capture.ecuMessages++;
+        memcpy(capture.ecuPayload, payload, length + 1);
+    }
+    return true;
+}
+
+// EEC1 della ECU motore con giri dati (0xFFFF = non disponibile)
+static void simSendRpm(uint32_t rpm) {
+    twai_message_t message = simEcuFrame(0);
+    uint16_t raw = (rpm == 0xFFFF) ? 0xFFFF : (uint16_t)(rpm * 8);
+    message.data[3] = raw & 0xFF;
+    message.data[4] = raw >> 8;
+    hal_native_can_inject(message);
+    CAN_Task();
+}
+
+// Richiesta RTU completa e risposta del gateway
+static size_t simModbusTransaction(const uint8_t *request, size_t length, uint8_t *response, size_t size) {
+    hal_native_uart_inject(request, length);
+    processModbusRequest();
+    return hal_native_uart_take(response, size);
+}
+
+static uint32_t simConfigChanges = 0;
+
+static void simConfigChanged() {
+    simConfigChanges++;
+}
+
+// Verifica CRC e lunghezza della risposta ricevuta dal master
+static bool simMasterCheckResponse(uint8_t *response, size_t length, uint16_t quantity) {
+    if (length != (size_t)(5 + quantity * 2)) return false;
+    uint16_t crc = calculateCRC16(response, length - 2);
+    return response[length - 2] == (crc & 0xFF) && response[length - 1] == (crc >> 8);
+}
+
+// Implementazione bit a bit originale, riferimento per il benchmark CRC
+static uint16_t simCrc16Bitwise(const uint8_t *data, uint16_t length) {
+    uint16_t crc = 0xFFFF;
+    for (uint16_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i];
+        for (uint8_t j = 0; j < 8; j++) {
+            if (crc & 0x0001) {
+                crc >>= 1;
+                crc ^= 0xA001;
+            } else {
+                crc >>= 1;
+            }
+        }
+    }
+    return crc;
+}
+
+// Micro-benchmark CRC16: bit a bit contro tabella, su frame RTU di lunghezza massima
+static uint32_t simCrcBenchmark(uint32_t iterations) {
+    uint8_t frame[MODBUS_RTU_MAX_FRAME];
+    uint32_t mismatches = 0;
+    for (uint16_t i = 0; i < sizeof(frame); i++) {
+        frame[i] = (uint8_t)(i * 37 + 11);
+    }
+    for (uint16_t length = 0; length <= sizeof(frame); length++) {
+        uint16_t incremental = CRC16_MODBUS_INIT;
+        for (uint16_t i = 0; i < length; i++) {
+            incremental = crc16Update(incremental, frame[i]);
+        }
+        uint16_t reference = simCrc16Bitwise(frame, length);
+        if (crc16Compute(frame, length) != reference || incremental != reference) mismatches++;
+    }
+
+    volatile uint16_t sink = 0;
+    SimClock::time_point t0 = SimClock::now();
+    for (uint32_t i = 0; i < iterations; i++) {
+        frame[0] = (uint8_t)i;
+        sink ^= simCrc16Bitwise(frame, sizeof(frame));
+    }
+    SimClock::time_point t1 = SimClock::now();
+    for (uint32_t i = 0; i < iterations; i++) {
+        frame[0] = (uint8_t)i;
+        sink ^= crc16Compute(frame, sizeof(frame));
+    }
+    SimClock::time_point t2 = SimClock::now();
+    (void)sink;
+
+    double bytes = (double)iterations * sizeof(frame);
+    double bitwise = bytes / std::chrono::duration<double>(t1 - t0).count() / 1e6;
+    double table = bytes / std::chrono::duration<double>(t2 - t1).count() / 1e6;
+    HAL_LOG("CRC16: bitwise %.1f MB/s, table %.1f MB/s (x%.1f)\n", bitwise, table, table / bitwise);
+    return mismatches;
+}
+
+// Client Modbus TCP simulato: richiesta FC 0x03 con header MBAP
+static size_t simTcpRequest(uint8_t *adu, uint16_t transactionId, uint8_t unitId,
+                            uint16_t start, uint16_t quantity) {
+    adu[0] = transactionId >> 8;
+    adu[1] = transactionId & 0xFF;
+    adu[2] = 0;
+    adu[3] = 0;
+    adu[4] = 0;
+    adu[5] = 6;
+    adu[6] = unitId;
+    adu[7] = MB_FC_READ_HOLDING_REGISTERS;
+    adu[8] = start >> 8;
+    adu[9] = start & 0xFF;
+    adu[10] = quantity >> 8;
+    adu[11] = quantity & 0xFF;
+    return 12;
+}
+
+// Risposte raccolte dal server TCP; 'stalled' simula il buffer di trasmissione pieno
+struct SimTcpClient {
+    std::vector<uint8_t> received;
+    bool stalled;
+};
+
+static bool simTcpWrite(void *context, const uint8_t *header, const uint8_t *pdu, uint16_t pduLength) {
+    SimTcpClient *client = (SimTcpClient *)context;
+    if (client->stalled) return false;
+    client->received.insert(client->received.end(), header, header + MODBUS_TCP_MBAP_SIZE);
+    client->received.insert(client->received.end(), pdu, pdu + pduLength);
+    return true;
+}
+
+// Verifica una risposta TCP a FC 0x03; restituisce i byte consumati (0 = errata)
+static size_t simTcpCheckResponse(const uint8_t *adu, size_t length, uint16_t transactionId,
+                                  uint8_t unitId, uint16_t quantity) {
+    size_t expected = MODBUS_TCP_MBAP_SIZE + 2 + quantity * 2;
+    if (length < expected) return 0;
+    if (((adu[0] << 8) | adu[1]) != transactionId || adu[2] != 0 || adu[3] != 0) return 0;
+    if (((adu[4] << 8) | adu[5]) != 3 + quantity * 2 || adu[6] != unitId) return 0;
+    if (adu[7] != MB_FC_READ_HOLDING_REGISTERS || adu[8] != quantity * 2) return 0;
+    return expected;
+}
+
+static double percentile(std::vector<double> &samples, double p) {
+    size_t index = (size_t)(p * (samples.size() - 1));
+    return samples[index];
+}
+
+int main(int argc, char **argv) {
+    uint32_t iterations = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 10) : SIM_DEFAULT_ITER;
+    if (iterations == 0) iterations = SIM_DEFAULT_ITER;
+
+    CAN_J1939_Init();
+    modbusRtuBegin();
+    bool historyReady = historyBegin();
+
+    uint8_t request[8];
+    uint8_t response[256];
+    std::vector<double> latencies;
+    latencies.reserve(iterations);
+    uint32_t errors = 0;
+    if (!historyReady) {
+        HAL_LOG("History: %u bytes not available\n", (unsigned)HISTORY_MEMORY_BYTES);
+        errors++;
+    }
+
+    // Latenza: frame CAN ricevuto -> risposta Modbus completa sul bus
+    for (uint32_t i = 0; i < iterations; i++) {
+        twai_message_t frame = simEcuFrame(i);
+        size_t requestLength = simMasterRequest(request, currentSlaveId, 0, MODBUS_REGISTERS_COUNT);
+
+        SimClock::time_point t0 = SimClock::now();
+        hal_native_can_inject(frame);
+        CAN_Task();
+        hal_native_uart_inject(request, requestLength);
+        processModbusRequest();
+        size_t responseLength = hal_native_uart_take(response, sizeof(response));
+        SimClock::time_point t1 = SimClock::now();
+
+        if (!simMasterCheckResponse(response, responseLength, MODBUS_REGISTERS_COUNT)) {
+            errors++;
+        }
+        latencies.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+    }
+
+    // Coerenza: RPM trasmesso dalla ECU = registri 0-1, campi "non disponibili"
+    // della ECU (coppia a 0xFF) pubblicati come sentinella e non come letture
+    twai_message_t rpmFrame = simEcuFrame(0);
+    uint32_t expectedRpm = ((rpmFrame.data[4] << 8) | rpmFrame.data[3]) / 8;
+    hal_native_can_inject(rpmFrame);
+    CAN_Task();
+    simMasterRequest(request, currentSlaveId, MB_REG_ENGINE_RPM, MB_REG_ENGINE_TORQUE + 2);
+    hal_native_uart_inject(request, sizeof(request));
+    processModbusRequest();
+    size_t checkLength = hal_native_uart_take(response, sizeof(response));
+    uint32_t readRpm = ((uint32_t)response[3] << 24) | ((uint32_t)response[4] << 16) |
+                       ((uint32_t)response[5] << 8) | response[6];
+    uint8_t *torque = &response[3 + MB_REG_ENGINE_TORQUE * 2];
+    if (!simMasterCheckResponse(response, checkLength, MB_REG_ENGINE_TORQUE + 2) ||
+        readRpm != expectedRpm ||
+        torque[0] != 0xFF || torque[1] != 0xFF || torque[2] != 0xFF || torque[3] != 0xFF) {
+        HAL_LOG("Decode mismatch: expected %u rpm, read %u\n", (unsigned)expectedRpm, (unsigned)readRpm);
+        errors++;
+    }
+
+    // Framing RTU: due richieste separate da T3.5 ma lette in ritardo, e due
+    // richieste fuse senza silenzio, devono produrre due risposte ciascuna
+    uint8_t merged[16];
+    simMasterRequest(merged, currentSlaveId, 0, 1);
+    simMasterRequest(&merged[8], currentSlaveId, 2, 1);
+    hal_native_uart_inject(merged, 8);
+    hal_native_uart_inject(&merged[8], 8);
+    processModbusRequest();
+    processModbusRequest();
+    size_t framedLength = hal_native_uart_take(response, sizeof(response));
+    hal_native_uart_inject(merged, sizeof(merged));
+    processModbusRequest();
+    size_t mergedLength = hal_native_uart_take(response, sizeof(response));
+    if (framedLength != 2 * 7 || mergedLength != 2 * 7) {
+        HAL_LOG("RTU framing mismatch: %u and %u response bytes\n",
+                (unsigned)framedLength, (unsigned)mergedLength);
+        errors++;
+    }
+
+    // Cache risposte: poll ripetuti senza traffico CAN sono serviti dalla cache;
+    // un nuovo RPM invalida solo le risposte che coprono i registri RPM
+    uint8_t rpmRequest[8];
+    uint8_t batteryRequest[8];
+    uint8_t first[16];
+    simMasterRequest(rpmRequest, currentSlaveId, MB_REG_ENGINE_RPM, 2);
+    simMasterRequest(batteryRequest, currentSlaveId, MB_REG_BATTERY_VOLTAGE, 1);
+    ModbusCacheStats cacheBefore = modbusCacheStats;
+    uint32_t cacheMismatches = 0;
+    for (uint32_t k = 0; k < 50; k++) {
+        hal_native_uart_inject(rpmRequest, sizeof(rpmRequest));
+        hal_native_uart_inject(batteryRequest, sizeof(batteryRequest));
+        processModbusRequest();
+        processModbusRequest();
+        size_t length = hal_native_uart_take(response, sizeof(response));
+        if (k == 0) memcpy(first, response, sizeof(first));
+        if (length != 9 + 7 || memcmp(first, response, length) != 0) cacheMismatches++;
+    }
+    uint32_t cacheHits = modbusCacheStats.hits - cacheBefore.hits;
+    hal_native_can_inject(simEcuFrame(7));
+    CAN_Task();
+    cacheBefore = modbusCacheStats;
+    hal_native_uart_inject(rpmRequest, sizeof(rpmRequest));
+    hal_native_uart_inject(batteryRequest, sizeof(batteryRequest));
+    processModbusRequest();
+    processModbusRequest();
+    hal_native_uart_take(response, sizeof(response));
+    uint32_t newRpm = ((uint32_t)response[3] << 24) | ((uint32_t)response[4] << 16) |
+                      ((uint32_t)response[5] << 8) | response[6];
+    if (cacheMismatches || cacheHits < 98 || newRpm != 807 ||
+        modbusCacheStats.misses - cacheBefore.misses != 1 ||
+        modbusCacheStats.hits - cacheBefore.hits != 1) {
+        HAL_LOG("Response cache mismatch: %u hits, rpm %u after update\n",
+                (unsigned)cacheHits, (unsigned)newRpm);
+        errors++;
+    }
+
+    // Transport Protocol: DM1 con 3 DTC dalla ECU motore in BAM, interlacciato
+    // con un BAM contemporaneo della centralina cambio
+    // (SPN 100 FMI 1 OC 3, SPN 110 FMI 16 OC 1, SPN 520000 FMI 31 OC 126)
+    uint8_t dm1[2 + 3 * 4] = { 0x04, 0xFF, 0x64, 0x00, 0x01, 0x03, 0x6E, 0x00, 0x10, 0x01,
+                               0x40, 0xEF, 0xFF, 0x7E };
+    uint8_t componentId[20];
+    memset(componentId, '*', sizeof(componentId));
+    twai_message_t dm1Frames[8];
+    twai_message_t idFrames[8];
+    size_t dm1Count = simBamFrames(dm1Frames, PGN_DIAGNOSTIC_MESSAGE_1, SIM_ECU_SA, dm1, sizeof(dm1));
+    size_t idCount = simBamFrames(idFrames, 0xFEEB, SIM_TCU_SA, componentId, sizeof(componentId));
+    uint32_t completedBefore = j1939TpStats.completed;
+    for (size_t i = 0; i < dm1Count || i < idCount; i++) {
+        if (i < dm1Count) hal_native_can_inject(dm1Frames[i]);
+        if (i < idCount) hal_native_can_inject(idFrames[i]);
+    }
+    CAN_Task();
+    EngineData ecu;
+    engineDataRead(0, ecu);
+    if (ecu.dtcCount != 3 || j1939TpStats.completed - completedBefore != 2) {
+        HAL_LOG("TP mismatch: %u DTC, %u messages reassembled\n", (unsigned)ecu.dtcCount,
+                (unsigned)(j1939TpStats.completed - completedBefore));
+        errors++;
+    }
+
+    // Registro DTC: pagina dei record attivi via Modbus, poi DM1 a frame
+    // singolo con il solo SPN 100 (gli altri rientrano) e SPN 110 di nuovo attivo
+    uint8_t dtcRequest[8];
+    uint8_t dtcResponse[5 + MODBUS_MAX_READ_QUANTITY * 2];
+    simMasterRequest(dtcRequest, currentSlaveId, MODBUS_DTC_BASE + MB_DTC_ACTIVE, 3 * MB_DTC_RECORD_WORDS + 1);
+    size_t dtcLength = simModbusTransaction(dtcRequest, sizeof(dtcRequest), dtcResponse, sizeof(dtcResponse));
+    const uint8_t *third = &dtcResponse[3 + 2 * MB_DTC_RECORD_WORDS * 2];
+    uint32_t thirdSpn = ((uint32_t)third[MB_DTC_REC_SPN * 2] << 24) | ((uint32_t)third[MB_DTC_REC_SPN * 2 + 1] << 16) |
+                        (third[MB_DTC_REC_SPN * 2 + 2] << 8) | third[MB_DTC_REC_SPN * 2 + 3];
+    if (!simMasterCheckResponse(dtcResponse, dtcLength, 3 * MB_DTC_RECORD_WORDS + 1) || thirdSpn != 520000 ||
+        third[MB_DTC_REC_FMI * 2 + 1] != 31 || third[MB_DTC_REC_OCCURRENCE * 2 + 1] != 126 ||
+        dtcResponse[3 + 3 * MB_DTC_RECORD_WORDS * 2] != 0xFF) {
+        HAL_LOG("DTC page mismatch: SPN %u\n", (unsigned)thirdSpn);
+        errors++;
+    }
+    twai_message_t dm1Single = simFrame(6, PGN_DIAGNOSTIC_MESSAGE_1, SIM_ECU_SA);
+    memcpy(dm1Single.data, dm1, 6);
+    dm1Single.data[5] = 0x04;  // OC 4
+    dm1Single.data[6] = dm1Single.data[7] = 0xFF;
+    hal_native_can_inject(dm1Single);
+    CAN_Task();
+    DtcStoreInfo dtcInfo;
+    DtcRecord dtcRecords[3];
+    dtcStoreRead(DTC_LIST_ACTIVE, 0, dtcRecords, 3, dtcInfo);
+    bool dtcCleared = dtcInfo.count[DTC_LIST_ACTIVE] == 1 && dtcInfo.count[DTC_LIST_PREVIOUS] == 2 &&
+                      dtcRecords[0].spn == 100 && dtcRecords[0].occurrence == 4;
+    memcpy(&dm1Single.data[2], &dm1[6], 4);
+    hal_native_can_inject(dm1Single);
+    CAN_Task();
+    dtcStoreRead(DTC_LIST_PREVIOUS, 0, dtcRecords, 3, dtcInfo);
+    simMasterRequest(dtcRequest, currentSlaveId, MODBUS_DTC_BASE, MB_DTC_HEADER_COUNT);
+    dtcLength = simModbusTransaction(dtcRequest, sizeof(dtcRequest), dtcResponse, sizeof(dtcResponse));
+    if (!dtcCleared || !simMasterCheckResponse(dtcResponse, dtcLength, MB_DTC_HEADER_COUNT) ||
+        dtcResponse[4] != 1 || dtcResponse[6] != 2 || dtcRecords[0].spn != 520000 ||
+        dtcRecords[1].spn != 100 || dtcRecords[1].firstSeenMs > dtcRecords[1].lastSeenMs) {
+        HAL_LOG("DTC store mismatch: %u active, %u previous\n", (unsigned)dtcInfo.count[DTC_LIST_ACTIVE],
+                (unsigned)dtcInfo.count[DTC_LIST_PREVIOUS]);
+        errors++;
+    }
+    // /dtc a pezzi minimi: stesso documento di una lettura unica
+    DtcQuery dtcQuery;
+    std::string dtcJson;
+    dtcQueryBegin(dtcQuery, SIM_ECU_SA);
+    for (;;) {
+        char chunk[DTC_QUERY_MIN_CHUNK];
+        size_t written = dtcQueryRead(dtcQuery, chunk, sizeof(chunk));
+        if (written == 0) break;
+        dtcJson.append(chunk, written);
+    }
+    if (dtcJson.find("\"active\":[{\"sa\":0,\"spn\":110,\"fmi\":16,\"oc\":1,") == std::string::npos ||
+        dtcJson.find("{\"sa\":0,\"spn\":520000,\"fmi\":31,\"oc\":126,") == std::string::npos ||
+        dtcJson.back() != '}') {
+        HAL_LOG("DTC JSON mismatch: %s\n", dtcJson.c_str());
+        errors++;
+    }
+    // DM2 di un DTC già nel registro: OC e istante dell'ultima segnalazione
+    uint8_t dm2Dtc[4];
+    memcpy(dm2Dtc, &dm1[10], 4);
+    dm2Dtc[3] = (dm2Dtc[3] & 0x80) | 50;
+    uint32_t dm2Ms = dtcRecords[0].lastSeenMs + 5000;
+    dtcStorePrevious(SIM_ECU_SA, dm2Dtc, sizeof(dm2Dtc), dm2Ms);
+    dtcStoreRead(DTC_LIST_PREVIOUS, 0, dtcRecords, 3, dtcInfo);
+    if (dtcRecords[0].spn != 520000 || dtcRecords[0].occurrence != 50 || dtcRecords[0].lastSeenMs != dm2Ms) {
+        HAL_LOG("DM2 update mismatch: OC %u, last seen %u ms\n", (unsigned)dtcRecords[0].occurrence,
+                (unsigned)dtcRecords[0].lastSeenMs);
+        errors++;
+    }
+
+    // Più ECU: un secondo motore (SA 0x01) ha il suo data set, esposto come
+    // banco 1 (registri da MODBUS_BANK_SIZE) o come slave ID base + 1
+    twai_message_t secondEngine = simEcuFrame(7 * 100);
+    secondEngine.identifier = (secondEngine.identifier & ~0xFFUL) | SIM_ECU2_SA;
+    hal_native_can_inject(secondEngine);
+    CAN_Task();
+    uint32_t bankRpm[2];
+    uint16_t bankSa[2];
+    for (uint8_t bank = 0; bank < 2; bank++) {
+        simMasterRequest(request, currentSlaveId, bank * MODBUS_BANK_SIZE, MODBUS_REGISTERS_COUNT);
+        hal_native_uart_inject(request, sizeof(request));
+        processModbusRequest();
+        size_t length = hal_native_uart_take(response, sizeof(response));
+        if (!simMasterCheckResponse(response, length, MODBUS_REGISTERS_COUNT)) errors++;
+        bankRpm[bank] = ((uint32_t)response[3] << 24) | ((uint32_t)response[4] << 16) |
+                        ((uint32_t)response[5] << 8) | response[6];
+        bankSa[bank] = (response[3 + MB_REG_SOURCE_ADDRESS * 2] << 8) | response[4 + MB_REG_SOURCE_ADDRESS * 2];
+    }
+    modbusSetMapping = MODBUS_MAP_UNIT_ID;
+    simMasterRequest(request, currentSlaveId + 1, MB_REG_ENGINE_RPM, 2);
+    hal_native_uart_inject(request, sizeof(request));
+    processModbusRequest();
+    size_t unitLength = hal_native_uart_take(response, sizeof(response));
+    uint32_t unitRpm = ((uint32_t)response[3] << 24) | ((uint32_t)response[4] << 16) |
+                       ((uint32_t)response[5] << 8) | response[6];
+    simMasterRequest(request, currentSlaveId + 2, MB_REG_ENGINE_RPM, 2);  // Nessuna terza ECU
+    hal_native_uart_inject(request, sizeof(request));
+    processModbusRequest();
+    size_t absentLength = hal_native_uart_take(response, sizeof(response));
+    modbusSetMapping = MODBUS_MAP_REGISTER_BANK;
+    if (bankSa[0] != SIM_ECU_SA || bankSa[1] != SIM_ECU2_SA || bankRpm[0] != 807 ||
+        bankRpm[1] != 800 + ((7 * 100) & 0x3FF) || unitLength != 9 || unitRpm != bankRpm[1] ||
+        absentLength != 0) {
+        HAL_LOG("Multi-ECU mismatch: SA %u/%u, rpm %u/%u, unit rpm %u\n", (unsigned)bankSa[0],
+                (unsigned)bankSa[1], (unsigned)bankRpm[0], (unsigned)bankRpm[1], (unsigned)unitRpm);
+        errors++;
+    }
+
+    // Mappa registri configurabile: mappa sparsa con passo 16 (float32, scala,
+    // ordine word invertito, tabelle diverse), mappe non valide rifiutate
+    // senza toccare quella attiva, poi ritorno alla mappa di default
+    const ModbusMapEntry customMap[] = {
+        { 0, MODBUS_TABLE_HOLDING, FIELD_RPM, MODBUS_TYPE_F32, MODBUS_ORDER_HIGH_FIRST, 1.0f, 0.0f },
+        { 4, MODBUS_TABLE_INPUT, FIELD_COOLANT_TEMP, MODBUS_TYPE_I16, MODBUS_ORDER_HIGH_FIRST, 0.1f, -40.0f },
+        { 5, MODBUS_TABLE_BOTH, FIELD_ENGINE_HOURS, MODBUS_TYPE_U32, MODBUS_ORDER_LOW_FIRST, 1.0f, 0.0f },
+        { 10, MODBUS_TABLE_HOLDING, MB_SIGNAL_SOURCE_ADDRESS, MODBUS_TYPE_U16, MODBUS_ORDER_HIGH_FIRST, 1.0f, 0.0f },
+    };
+    const ModbusMapEntry overlapping[] = {
+        { 0, MODBUS_TABLE_HOLDING, FIELD_RPM, MODBUS_TYPE_U32, MODBUS_ORDER_HIGH_FIRST, 1.0f, 0.0f },
+        { 1, MODBUS_TABLE_BOTH, FIELD_ENGINE_LOAD, MODBUS_TYPE_U16, MODBUS_ORDER_HIGH_FIRST, 1.0f, 0.0f },
+    };
+    const char *mapError = modbusMapLoad(customMap, sizeof(customMap) / sizeof(customMap[0]), 16);
+    const char *overlapError = modbusMapLoad(overlapping, 2, 16);
+    const char *strideError = modbusMapLoad(customMap, sizeof(customMap) / sizeof(customMap[0]), 8);
+    uint8_t mapSlots[ENGINE_DATA_MAX_SOURCES];
+    engineDataSlotsBySource(mapSlots);
+    EngineData mapData[2];
+    engineDataRead(mapSlots[0], mapData[0]);
+    engineDataRead(mapSlots[1], mapData[1]);
+    uint32_t mapMismatches = 0;
+    for (uint8_t bank = 0; bank < 2; bank++) {
+        simMasterRequest(request, currentSlaveId, bank * 16, 11);
+        size_t length = simModbusTransaction(request, sizeof(request), response, sizeof(response));
+        uint32_t bits = ((uint32_t)response[3] << 24) | ((uint32_t)response[4] << 16) |
+                        ((uint32_t)response[5] << 8) | response[6];
+        float rpm;
+        memcpy(&rpm, &bits, sizeof(rpm));
+        uint32_t hours = ((uint32_t)response[15] << 24) | ((uint32_t)response[16] << 16) |
+                         ((uint32_t)response[13] << 8) | response[14];
+        uint16_t sa = (response[23] << 8) | response[24];
+        uint32_t expectedHours = (mapData[bank].validFlags & FIELD_BIT(FIELD_ENGINE_HOURS)) ?
+                                 mapData[bank].engineHours : 0xFFFFFFFF;  // Sentinella se non ricevute
+        if (!simMasterCheckResponse(response, length, 11) || rpm != (float)mapData[bank].rpm ||
+            response[7] != 0 || response[8] != 0 || response[11] != 0 || response[12] != 0 ||
+            hours != expectedHours || sa != mapData[bank].sourceAddress) {
+            mapMismatches++;
+        }
+    }
+    uint8_t inputRequest[8];
+    simMasterRequest(inputRequest, currentSlaveId, 4, 1);
+    inputRequest[1] = MB_FC_READ_INPUT_REGISTERS;
+    uint16_t inputCrc = calculateCRC16(inputRequest, 6);
+    inputRequest[6] = inputCrc & 0xFF;
+    inputRequest[7] = inputCrc >> 8;
+    size_t inputLength = simModbusTransaction(inputRequest, sizeof(inputRequest), response, sizeof(response));
+    int16_t coolant = (int16_t)((response[3] << 8) | response[4]);
+    if (!simMasterCheckResponse(response, inputLength, 1) ||
+        coolant != (int16_t)lround(mapData[0].coolantTemp * 0.1 - 40.0)) {
+        mapMismatches++;
+    }
+    simMasterRequest(request, currentSlaveId, 16 * ENGINE_DATA_MAX_SOURCES - 1, 2);  // Oltre l'ultimo banco
+    size_t beyondLength = simModbusTransaction(request, sizeof(request), response, sizeof(response));
+    if (beyondLength != 5 || response[2] != 0x02) mapMismatches++;
+    if (mapError != NULL || overlapError == NULL || strideError == NULL || modbusMap.count != 4 ||
+        mapMismatches) {
+        HAL_LOG("Register map mismatch: %u reads, errors '%s' '%s' '%s'\n", (unsigned)mapMismatches,
+                mapError ? mapError : "", overlapError ? overlapError : "", strideError ? strideError : "");
+        errors++;
+    }
+    modbusMapLoad(MODBUS_DEFAULT_MAP, MODBUS_DEFAULT_MAP_COUNT, MODBUS_BANK_SIZE);
+
+    // Registri di configurazione: cambio slave ID con FC 0x10, rilettura dal
+    // nuovo ID, scritture rifiutate (sola lettura, valore non valido), ripristino
+    uint8_t writeRequest[32];
+    uint16_t newSlaveId = 7;
+    uint16_t badBaudrate[2] = { 0, 300 };
+    uint16_t mapEntries = 1;
+    uint8_t originalSlaveId = currentSlaveId;
+    modbusConfigChanged = simConfigChanged;
+    size_t writeLength = simMasterWrite(writeRequest, currentSlaveId, MODBUS_CONFIG_BASE + MB_CFG_SLAVE_ID, &newSlaveId, 1);
+    size_t ackLength = simModbusTransaction(writeRequest, writeLength, response, sizeof(response));
+    bool ackOk = ackLength == 8 && memcmp(response, writeRequest, 6) == 0;
+    simMasterRequest(request, 7, MODBUS_CONFIG_BASE, MB_CFG_COUNT);
+    size_t configLength = simModbusTransaction(request, sizeof(request), response, sizeof(response));
+    uint32_t configBaudrate = ((uint32_t)response[5] << 24) | ((uint32_t)response[6] << 16) |
+                              ((uint32_t)response[7] << 8) | response[8];
+    bool configOk = simMasterCheckResponse(response, configLength, MB_CFG_COUNT) && response[4] == 7 &&
+                    configBaudrate == currentBaudrate && response[12] == MODBUS_DEFAULT_MAP_COUNT;
+    writeLength = simMasterWrite(writeRequest, 7, MODBUS_CONFIG_BASE + MB_CFG_MAP_ENTRIES, &mapEntries, 1);
+    simModbusTransaction(writeRequest, writeLength, response, sizeof(response));
+    uint8_t readOnlyException = response[2];
+    writeLength = simMasterWrite(writeRequest, 7, MODBUS_CONFIG_BASE + MB_CFG_BAUDRATE, badBaudrate, 2);
+    simModbusTransaction(writeRequest, writeLength, response, sizeof(response));
+    uint8_t valueException = response[2];
+    uint16_t restoreSlaveId = originalSlaveId;
+    writeLength = simMasterWrite(writeRequest, 7, MODBUS_CONFIG_BASE + MB_CFG_SLAVE_ID, &restoreSlaveId, 1);
+    simModbusTransaction(writeRequest, writeLength, response, sizeof(response));
+    modbusConfigChanged = NULL;
+    if (!ackOk || !configOk || readOnlyException != 0x02 || valueException != 0x03 ||
+        simConfigChanges != 2 || currentSlaveId != originalSlaveId) {
+        HAL_LOG("Config registers mismatch: ack %d, read %d, exceptions %u/%u, %u changes\n",
+                ackOk, configOk, readOnlyException, valueException, (unsigned)simConfigChanges);
+        errors++;
+    }
+
+    // Baudrate senza riavvio: la conferma della scrittura esce al baudrate
+    // vecchio, la UART cambia prima del frame successivo
+    uint32_t originalBaudrate = currentBaudrate;
+    uint16_t fastBaudrate[2] = { 115200 >> 16, 115200 & 0xFFFF };
+    writeLength = simMasterWrite(writeRequest, currentSlaveId, MODBUS_CONFIG_BASE + MB_CFG_BAUDRATE, fastBaudrate, 2);
+    hal_native_uart_inject(writeRequest, writeLength);
+    hal_native_uart_inject(request, simMasterRequest(request, currentSlaveId, 0, MODBUS_REGISTERS_COUNT));
+    bool baudrateBefore = hal_native_uart_baudrate() == originalBaudrate;
+    processModbusRequest();
+    size_t baudLength = hal_native_uart_take(response, sizeof(response));
+    bool baudrateAfter = hal_native_uart_baudrate() == 115200;
+    processModbusRequest();
+    baudLength += hal_native_uart_take(response, sizeof(response));
+    {
+        std::lock_guard<std::mutex> lock(modbusMutex);
+        modbusConfigApply(currentSlaveId, originalBaudrate, modbusSetMapping);
+    }
+    processModbusRequest();
+    if (!baudrateBefore || !baudrateAfter || baudLength != 8 + 5 + MODBUS_REGISTERS_COUNT * 2 ||
+        hal_native_uart_baudrate() != originalBaudrate || modbusConfigApply(0, originalBaudrate, 0)) {
+        HAL_LOG("Live baudrate mismatch: UART at %u, %u response bytes\n",
+                (unsigned)hal_native_uart_baudrate(), (unsigned)baudLength);
+        errors++;
+    }
+
+    // Baudrate a metà: FC 0x06 su una sola word (da 9600 a 115200 la word
+    // alta darebbe 75136 baud) o FC 0x10 che ne copre una sola, rifiutati
+    uint8_t halfExceptions[3] = { 0, 0, 0 };
+    writeLength = simMasterWriteSingle(writeRequest, currentSlaveId, MODBUS_CONFIG_BASE + MB_CFG_BAUDRATE, 115200 >> 16);
+    simModbusTransaction(writeRequest, writeLength, response, sizeof(response));
+    halfExceptions[0] = response[2];
+    writeLength = simMasterWriteSingle(writeRequest, currentSlaveId, MODBUS_CONFIG_BASE + MB_CFG_BAUDRATE + 1, 115200 & 0xFFFF);
+    simModbusTransaction(writeRequest, writeLength, response, sizeof(response));
+    halfExceptions[1] = response[2];
+    uint16_t lowAndMapping[2] = { 115200 & 0xFFFF, modbusSetMapping };
+    writeLength = simMasterWrite(writeRequest, currentSlaveId, MODBUS_CONFIG_BASE + MB_CFG_BAUDRATE + 1, lowAndMapping, 2);
+    simModbusTransaction(writeRequest, writeLength, response, sizeof(response));
+    halfExceptions[2] = response[2];
+    if (halfExceptions[0] != 0x02 || halfExceptions[1] != 0x02 || halfExceptions[2] != 0x02 ||
+        currentBaudrate != originalBaudrate || hal_native_uart_baudrate() != originalBaudrate) {
+        HAL_LOG("Partial baudrate write accepted: exceptions %u/%u/%u, UART at %u\n",
+                halfExceptions[0], halfExceptions[1], halfExceptions[2], (unsigned)hal_native_uart_baudrate());
+        errors++;
+    }
+
+    // Modbus TCP: tre richieste in pipeline (l'ultima spezzata in due
+    // segmenti), buffer di trasmissione pieno e unit ID senza data set
+    ModbusTcpSession tcpSession;
+    memset(&tcpSession, 0, sizeof(tcpSession));
+    SimTcpClient tcpClient;
+    tcpClient.stalled = false;
+    uint8_t pipeline[3 * 12];
+    simTcpRequest(pipeline, 1, 0xFF, 0, MODBUS_REGISTERS_COUNT);
+    simTcpRequest(&pipeline[12], 2, currentSlaveId, MB_REG_ENGINE_RPM, 2);
+    simTcpRequest(&pipeline[24], 3, currentSlaveId, MB_REG_BATTERY_VOLTAGE, 1);
+    bool tcpOk = modbusTcpReceive(tcpSession, pipeline, 30, simTcpWrite, &tcpClient);
+    size_t afterFirstSegment = tcpClient.received.size();
+    tcpClient.stalled = true;
+    tcpOk = tcpOk && modbusTcpReceive(tcpSession, &pipeline[30], 6, simTcpWrite, &tcpClient);
+    size_t whileStalled = tcpClient.received.size();
+    tcpClient.stalled = false;
+    tcpOk = tcpOk && modbusTcpReceive(tcpSession, NULL, 0, simTcpWrite, &tcpClient);
+    const uint8_t *tcpResponse = tcpClient.received.data();
+    size_t tcpRemaining = tcpClient.received.size();
+    const uint16_t tcpQuantity[3] = { MODBUS_REGISTERS_COUNT, 2, 1 };
+    const uint8_t tcpUnit[3] = { 0xFF, currentSlaveId, currentSlaveId };
+    for (uint16_t t = 0; t < 3 && tcpOk; t++) {
+        size_t used = simTcpCheckResponse(tcpResponse, tcpRemaining, t + 1, tcpUnit[t], tcpQuantity[t]);
+        tcpOk = (used != 0);
+        tcpResponse += used;
+        tcpRemaining -= used;
+    }
+    modbusSetMapping = MODBUS_MAP_UNIT_ID;
+    simTcpRequest(pipeline, 4, currentSlaveId + 5, 0, 1);
+    tcpClient.received.clear();
+    tcpOk = tcpOk && modbusTcpReceive(tcpSession, pipeline, 12, simTcpWrite, &tcpClient);
+    modbusSetMapping = MODBUS_MAP_REGISTER_BANK;
+    if (!tcpOk || tcpRemaining != 0 || whileStalled != afterFirstSegment ||
+        tcpClient.received.size() != 9 || tcpClient.received[7] != 0x83 || tcpClient.received[8] != 0x0B) {
+        HAL_LOG("Modbus TCP mismatch\n");
+        errors++;
+    }
+
+    // Concorrenza: due client TCP in thread separati e lo slave RTU leggono
+    // la stessa immagine mentre il task CAN la aggiorna
+    uint32_t tcpFailures = 0;
+    std::vector<std::thread> tcpThreads;
+    for (uint8_t c = 0; c < 2; c++) {
+        tcpThreads.emplace_back([&tcpFailures, c]() {
+            ModbusTcpSession *session = new ModbusTcpSession();
+            SimTcpClient client;
+            client.stalled = false;
+            uint32_t failures = 0;
+            for (uint16_t k = 0; k < 5000; k++) {
+                uint8_t adu[12];
+                simTcpRequest(adu, k, currentSlaveId, c * 4, MODBUS_REGISTERS_COUNT - c * 4);
+                client.received.clear();
+                if (!modbusTcpReceive(*session, adu, sizeof(adu), simTcpWrite, &client) ||
+                    simTcpCheckResponse(client.received.data(), client.received.size(), k, currentSlaveId,
+                                        MODBUS_REGISTERS_COUNT - c * 4) == 0) {
+                    failures++;
+                }
+            }
+            delete session;
+            __atomic_add_fetch(&tcpFailures, failures, __ATOMIC_RELAXED);
+        });
+    }
+    for (uint32_t k = 0; k < 5000; k++) {
+        hal_native_can_inject(simEcuFrame(k));
+        CAN_Task();
+        simMasterRequest(request, currentSlaveId, 0, MODBUS_REGISTERS_COUNT);
+        hal_native_uart_inject(request, sizeof(request));
+        processModbusRequest();
+        size_t length = hal_native_uart_take(response, sizeof(response));
+        if (!simMasterCheckResponse(response, length, MODBUS_REGISTERS_COUNT)) tcpFailures++;
+    }
+    for (std::thread &thread : tcpThreads) thread.join();
+    if (tcpFailures) {
+        HAL_LOG("Modbus RTU/TCP concurrency: %u bad responses\n", (unsigned)tcpFailures);
+        errors++;
+    }
+
+    // Dashboard: primo messaggio completo, poi solo i campi cambiati; un
+    // frame EEC1 del secondo motore produce solo rpm (e coppia) del set 1
+    static char liveBuffer[LIVE_DATA_BUFFER];
+    LiveDataState liveState;
+    liveDataReset(liveState);
+    size_t fullLength = liveDataEncodeChanges(liveState, liveBuffer, sizeof(liveBuffer));
+    bool liveFull = strstr(liveBuffer, "\"sources\":[0,1]") != NULL &&
+                    strstr(liveBuffer, "\"set\":1,\"sa\":1,\"rpm\":") != NULL;
+    size_t idleLength = liveDataEncodeChanges(liveState, liveBuffer, sizeof(liveBuffer));
+    twai_message_t liveFrame = simEcuFrame(7 * 101);
+    liveFrame.identifier = (liveFrame.identifier & ~0xFFUL) | SIM_ECU2_SA;
+    hal_native_can_inject(liveFrame);
+    CAN_Task();
+    size_t deltaLength = liveDataEncodeChanges(liveState, liveBuffer, sizeof(liveBuffer));
+    char expectedDelta[64];
+    snprintf(expectedDelta, sizeof(expectedDelta), "{\"sets\":[{\"set\":1,\"rpm\":%u}]}",
+             (unsigned)(800 + ((7 * 101) & 0x3FF)));
+    char tinyBuffer[32];
+    liveDataReset(liveState);
+    size_t overflowLength = liveDataEncodeChanges(liveState, tinyBuffer, sizeof(tinyBuffer));
+    if (fullLength == 0 || !liveFull || idleLength != 0 || deltaLength == 0 ||
+        strcmp(liveBuffer, expectedDelta) != 0 || overflowLength != 0 || liveState.count != 0xFF) {
+        HAL_LOG("Live data mismatch: %s\n", liveBuffer);
+        errors++;
+    }
+    // Campi con segno: -10 °C di liquido (ET1) e -5 % di coppia (EEC1)
+    // pubblicati come numeri negativi, non come complemento a 2
+    twai_message_t coldFrame = simFrame(6, PGN_ENGINE_TEMP, SIM_ECU2_SA);
+    coldFrame.data[0] = 30;
+    hal_native_can_inject(coldFrame);
+    twai_message_t dragFrame = simFrame(3, PGN_ELECTRONIC_ENGINE_1, SIM_ECU2_SA);
+    dragFrame.data[2] = 120;
+    hal_native_can_inject(dragFrame);
+    CAN_Task();
+    liveDataEncodeSet(liveBuffer, sizeof(liveBuffer), 1);
+    if (strstr(liveBuffer, "\"coolantTemp\":-100,") == NULL || strstr(liveBuffer, "\"engineTorque\":-5,") == NULL) {
+        HAL_LOG("Live data signed fields mismatch: %s\n", liveBuffer);
+        errors++;
+    }
+    HAL_LOG("Live data: full %u bytes, single-field delta %u bytes\n",
+            (unsigned)fullLength, (unsigned)deltaLength);
+
+    // CRC16: vettori su tutte le lunghezze e confronto prestazioni
+    uint32_t crcMismatches = simCrcBenchmark(iterations / 10 + 1);
+    if (crcMismatches) {
+        HAL_LOG("CRC16 mismatch on %u lengths\n", (unsigned)crcMismatches);
+        errors++;
+    }
+
+    // Seqlock: uno scrittore pubblica rpm con le due word sempre uguali, un
+    // lettore concorrente non deve mai vedere word di aggiornamenti diversi
+    EngineData &engine = engineDataSets[0];
+    EngineData saved = engine;
+    uint32_t torn = 0;
+    engine.rpm = 0;
+    engineDataTouch(0);
+    engineDataPublish();
+    std::thread writer([&engine]() {
+        for (uint32_t k = 0; k < 200000; k++) {
+            engine.rpm = (k & 0xFFFF) * 0x10001;
+            engineDataTouch(0);
+            engineDataPublish();
+        }
+    });
+    for (uint32_t k = 0; k < 200000; k++) {
+        EngineData snapshot;
+        engineDataRead(0, snapshot);
+        if ((snapshot.rpm >> 16) != (snapshot.rpm & 0xFFFF)) torn++;
+    }
+    writer.join();
+    engine = saved;
+    engineDataTouch(0);
+    engineDataPublish();
+    if (torn) {
+        HAL_LOG("Seqlock: %u torn reads\n", (unsigned)torn);
+        errors++;
+    }
+
+    // Throughput decoder: burst di frame alla profondità della coda RX, con
+    // tre frame di traffico non decodificato per ogni frame delle ECU motore
+    // (SIM_ECU_COUNT indirizzi sorgente attivi)
+    J1939RxStats rxBefore = j1939RxStats;
+    uint32_t frames = 0;
+    SimClock::time_point start = SimClock::now();
+    for (uint32_t i = 0; i < iterations; i += SIM_THROUGHPUT_BATCH) {
+        for (uint32_t j = 0; j < SIM_THROUGHPUT_BATCH; j++) {
+            if (j & 3) {
+                hal_native_can_inject(simBackgroundFrame(i + j));
+            } else {
+                twai_message_t frame = simEcuFrame(i + j);
+                frame.identifier = (frame.identifier & ~0xFFUL) | (((i + j) / 4) % SIM_ECU_COUNT);
+                hal_native_can_inject(frame);
+            }
+        }
+        CAN_Task();
+        frames += SIM_THROUGHPUT_BATCH;
+    }
+    double seconds = std::chrono::duration<double>(SimClock::now() - start).count();
+
+    std::sort(latencies.begin(), latencies.end());
+    HAL_LOG("CAN->Modbus latency over %u polls (ns): min %.0f  p50 %.0f  p99 %.0f  max %.0f\n",
+            (unsigned)iterations, latencies.front(), percentile(latencies, 0.50),
+            percentile(latencies, 0.99), latencies.back());
+    HAL_LOG("CAN decode throughput: %.0f bus frames/s, %u ECUs\n", frames / seconds,
+            (unsigned)engineDataSourceCount());
+    HAL_LOG("CAN frames: %u accepted, %u rejected in hardware, %u rejected in software\n",
+            (unsigned)(j1939RxStats.accepted - rxBefore.accepted),
+            (unsigned)(j1939RxStats.hardwareRejected - rxBefore.hardwareRejected),
+            (unsigned)(j1939RxStats.softwareRejected - rxBefore.softwareRejected));
+
+    // Logger CAN: SIM_LOG_FRAMES frame a SIM_LOG_RATE frame/s, svuotati da un
+    // thread come il task di log; il file riletto deve contenere tutti i frame
+    // in ordine, senza perdite
+    char logRoot[64];
+    snprintf(logRoot, sizeof(logRoot), "/tmp/j1939gtw_sim_%d", (int)getpid());
+    hal_native_storage_root(logRoot);
+    bool logStarted = canLogBegin();
+    std::atomic<bool> logRunning(true);
+    std::thread logger([&logRunning]() {
+        while (logRunning.load()) {
+            canLogService(hal_millis());
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    });
+    SimClock::time_point logStart = SimClock::now();
+    double logTaskNs = 0;
+    for (uint32_t i = 0; i < SIM_LOG_FRAMES; i += SIM_LOG_BATCH) {
+        SimClock::time_point due = logStart + std::chrono::microseconds((uint64_t)i * 1000000 / SIM_LOG_RATE);
+        while (SimClock::now() < due) {
+        }
+        for (uint32_t j = i; j < i + SIM_LOG_BATCH && j < SIM_LOG_FRAMES; j++) {
+            hal_native_can_inject(simLogFrame(j));
+        }
+        SimClock::time_point t0 = SimClock::now();
+        CAN_Task();
+        logTaskNs += std::chrono::duration<double, std::nano>(SimClock::now() - t0).count();
+    }
+    double logSeconds = std::chrono::duration<double>(SimClock::now() - logStart).count();
+    logRunning = false;
+    logger.join();
+    canLogStop();
+
+    char logPath[128];
+    snprintf(logPath, sizeof(logPath), "%s/" CAN_LOG_DIRECTORY "/%05u.bin", logRoot, (unsigned)canLogStats.fileIndex);
+    FILE *logFile = fopen(logPath, "rb");
+    SimLogCheck logCheck = { 0, 0, 0 };
+    CanLogReader logReader;
+    canLogReaderInit(logReader);
+    uint8_t logBlock[CAN_LOG_BLOCK_SIZE];
+    uint32_t logBlocks = 0;
+    char candump[64];
+    size_t candumpLength = 0;
+    while (logFile != NULL && fread(logBlock, 1, sizeof(logBlock), logFile) == sizeof(logBlock)) {
+        canLogReadBlock(logReader, logBlock, simLogCheckFrame, &logCheck);
+        if (logBlocks++ == 0) {
+            // Formato candump di un frame con DLC ridotto
+            CanLogFrame frame;
+            memset(&frame, 0, sizeof(frame));
+            frame.timestamp = 12000345;
+            frame.identifier = 0x18FEF103;
+            frame.extended = true;
+            frame.dlc = 3;
+            frame.data[0] = 0x0A;
+            frame.data[2] = 0xFF;
+            candumpLength = canLogFormatCandump(candump, sizeof(candump), frame, "can0");
+        }
+    }
+    if (logFile != NULL) fclose(logFile);
+
+    // Download del log: elenco, intervallo di byte uguale al file, CSV con
+    // tutti i frame e intervallo di tempo, a pezzi piccoli; limite ai
+    // download contemporanei
+    uint32_t logIndex = canLogStats.fileIndex;
+    uint32_t logBytes = logBlocks * CAN_LOG_BLOCK_SIZE;
+    std::string logList;
+    char listChunk[LOG_LIST_MIN_CHUNK];
+    LogListQuery listQuery;
+    logListQueryBegin(listQuery, logIndex, true);
+    while (listQuery.stage != 2) logList.append(listChunk, logListQueryRead(listQuery, listChunk, sizeof(listChunk)));
+    char listItem[96];
+    snprintf(listItem, sizeof(listItem), "{\"file\":%u,\"name\":\"%05u.bin\",\"bytes\":%u}]}",
+             (unsigned)logIndex, (unsigned)logIndex, (unsigned)logBytes);
+    bool downloadOk = logList.find(listItem) != std::string::npos;
+
+    std::string logRaw;
+    snprintf(logPath, sizeof(logPath), "%s/" CAN_LOG_DIRECTORY "/%05u.bin", logRoot, (unsigned)logIndex);
+    logFile = fopen(logPath, "rb");
+    if (logFile != NULL) {
+        logRaw.resize(logBytes);
+        if (fread(&logRaw[0], 1, logBytes, logFile) != logBytes) logRaw.clear();
+        fclose(logFile);
+    }
+    LogDownload *download = new LogDownload();
+    uint32_t rangeFirst = 0;
+    uint32_t rangeEnd = 0;
+    downloadOk = downloadOk && logDownloadBegin(*download, logIndex, LOG_FORMAT_BINARY, 0, LOG_DOWNLOAD_END_US) == LOG_DOWNLOAD_OK &&
+                 logDownloadParseRange("bytes=1000-4999", download->size, rangeFirst, rangeEnd) == LOG_RANGE_OK;
+    if (downloadOk) {
+        logDownloadSetRange(*download, rangeFirst, rangeEnd);
+        downloadOk = simDownload(*download, 700) == logRaw.substr(1000, 4000);
+        logDownloadEnd(*download);
+    }
+    downloadOk = downloadOk &&
+        logDownloadParseRange("bytes=-100", logBytes, rangeFirst, rangeEnd) == LOG_RANGE_OK &&
+        rangeFirst == logBytes - 100 && rangeEnd == logBytes &&
+        logDownloadParseRange("bytes=10-", logBytes, rangeFirst, rangeEnd) == LOG_RANGE_OK && rangeEnd == logBytes &&
+        logDownloadParseRange("bytes=0-1,5-9", logBytes, rangeFirst, rangeEnd) == LOG_RANGE_NONE &&
+        logDownloadParseRange("bytes=99999999-", logBytes, rangeFirst, rangeEnd) == LOG_RANGE_INVALID;
+
+    std::string logCsv;
+    uint32_t csvLines = 0;
+    if (downloadOk && logDownloadBegin(*download, logIndex, LOG_FORMAT_CSV, 0, LOG_DOWNLOAD_END_US) == LOG_DOWNLOAD_OK) {
+        logCsv = simDownload(*download, LOG_DOWNLOAD_MIN_CHUNK);
+        logDownloadEnd(*download);
+        csvLines = std::count(logCsv.begin(), logCsv.end(), '\n');
+    }
+    downloadOk = downloadOk && csvLines == SIM_LOG_FRAMES + 1 &&
+                 logCsv.compare(0, strlen(CAN_LOG_CSV_HEADER) + 9, CAN_LOG_CSV_HEADER "0.000000,") == 0;
+
+    // 100-200 ms: righe solo dell'intervallo, blocchi interi che lo toccano
+    uint32_t sliceLines = 0;
+    if (downloadOk && logDownloadBegin(*download, logIndex, LOG_FORMAT_CSV, 100000, 200000) == LOG_DOWNLOAD_OK) {
+        std::string slice = simDownload(*download, LOG_DOWNLOAD_MIN_CHUNK);
+        logDownloadEnd(*download);
+        size_t line = strlen(CAN_LOG_CSV_HEADER);
+        while (line < slice.size()) {
+            double seconds = atof(slice.c_str() + line);
+            if (seconds < 0.1 || seconds > 0.2) downloadOk = false;
+            sliceLines++;
+            line = slice.find('\n', line) + 1;
+        }
+    }
+    std::string sliceBlocks;
+    if (downloadOk && logDownloadBegin(*download, logIndex, LOG_FORMAT_BINARY, 100000, 200000) == LOG_DOWNLOAD_OK) {
+        sliceBlocks = simDownload(*download, 3 * CAN_LOG_BLOCK_SIZE);
+        logDownloadEnd(*download);
+    }
+    downloadOk = downloadOk && sliceLines > 0 && sliceLines < SIM_LOG_FRAMES && !sliceBlocks.empty() &&
+                 sliceBlocks.size() % CAN_LOG_BLOCK_SIZE == 0 && logRaw.find(sliceBlocks) != std::string::npos;
+
+    LogDownload *second = new LogDownload();
+    downloadOk = downloadOk &&
+        logDownloadBegin(*download, logIndex, LOG_FORMAT_BINARY, 0, LOG_DOWNLOAD_END_US) == LOG_DOWNLOAD_OK &&
+        logDownloadBegin(*second, logIndex, LOG_FORMAT_CSV, 0, LOG_DOWNLOAD_END_US) == LOG_DOWNLOAD_OK &&
+        logDownloadBegin(*second, logIndex, LOG_FORMAT_CSV, 0, LOG_DOWNLOAD_END_US) == LOG_DOWNLOAD_BUSY &&
+        logDownloadBegin(*second, logIndex + 1, LOG_FORMAT_BINARY, 0, LOG_DOWNLOAD_END_US) == LOG_DOWNLOAD_BUSY;
+    logDownloadEnd(*download);
+    logDownloadEnd(*second);
+    downloadOk = downloadOk &&
+        logDownloadBegin(*download, logIndex + 1, LOG_FORMAT_BINARY, 0, LOG_DOWNLOAD_END_US) == LOG_DOWNLOAD_NOT_FOUND;
+    delete second;
+    delete download;
+    if (!downloadOk) {
+        HAL_LOG("Log download mismatch: %u CSV lines, %u in slice, %u slice bytes\n",
+                (unsigned)csvLines, (unsigned)sliceLines, (unsigned)sliceBlocks.size());
+        errors++;
+    }
+
+    snprintf(logPath, sizeof(logPath), "rm -rf %s", logRoot);
+    if (system(logPath) != 0) HAL_LOG("Cannot remove %s\n", logRoot);
+    if (!logStarted || logCheck.next != SIM_LOG_FRAMES || logCheck.mismatches || canLogStats.dropped ||
+        canLogStats.writeErrors || logReader.gaps || logReader.badBlocks || logBlocks != canLogStats.blocks ||
+        strcmp(candump, "(12.000345) can0 18FEF103#0A00FF") != 0 || candumpLength != strlen(candump)) {
+        HAL_LOG("CAN log mismatch: %u/%u frames read back, %u wrong, %u dropped\n",
+                (unsigned)logCheck.next, (unsigned)SIM_LOG_FRAMES, (unsigned)logCheck.mismatches,
+                (unsigned)canLogStats.dropped);
+        errors++;
+    }
+
+    // Storico: 10 minuti di rpm a 10 campioni/s su un orologio simulato, poi
+    // 10 s senza traffico. Bucket da 1 s e da 1 min confrontati con i valori
+    // attesi, risposta a pezzi da 128 byte uguale a quella in un colpo solo
+    const uint32_t historyBase = 1000UL * 3600000UL;
+    EngineData historyData = engineDataSets[0];
+    historyData.validFlags |= FIELD_BIT(FIELD_RPM);
+    historyReset();
+    SimClock::time_point historyStart = SimClock::now();
+    for (uint32_t k = 0; k < 6000; k++) {
+        historyData.rpm = 1000 + ((k / 10) % 60) * 10 + k % 10;
+        historyRecord(0, historyData, FIELD_BIT(FIELD_RPM), historyBase + k * 100);
+    }
+    double historyNs = std::chrono::duration<double, std::nano>(SimClock::now() - historyStart).count() / 6000;
+    historyTick(historyBase + 610500);
+    static char historyJson[16384];
+    char historyChunk[HISTORY_QUERY_MIN_CHUNK];
+    HistoryQuery query;
+    std::string chunked;
+    bool historyOk = historyQueryBegin(query, 0, historyFieldIndex("rpm"), historyTierIndex("1s"), 15, historyBase + 610500);
+    HistoryQuery single = query;
+    while (historyOk && query.stage != 2) {
+        size_t length = historyQueryRead(query, historyChunk, sizeof(historyChunk));
+        if (length == 0) historyOk = false;
+        chunked.append(historyChunk, length);
+    }
+    size_t singleLength = historyQueryRead(single, historyJson, sizeof(historyJson));
+    historyJson[singleLength] = '\0';
+    const char *expectedSeconds = "{\"set\":0,\"sa\":0,\"field\":\"rpm\",\"tier\":\"1s\",\"periodMs\":1000,"
+        "\"ageMs\":500,\"points\":[[1550,1559,1555],[1560,1569,1565],[1570,1579,1575],[1580,1589,1585],"
+        "[1590,1599,1595],null,null,null,null,null,null,null,null,null,null]}";
+    if (historyOk) {
+        historyOk = chunked == historyJson && strcmp(historyJson, expectedSeconds) == 0 &&
+                    historyQueryBegin(query, 0, historyFieldIndex("rpm"), historyTierIndex("1m"), 100, historyBase + 610500);
+    }
+    if (historyOk) {
+        singleLength = historyQueryRead(query, historyJson, sizeof(historyJson));
+        historyJson[singleLength] = '\0';
+        historyOk = strstr(historyJson, "\"ageMs\":10500,\"points\":[[1000,1599,1300],") != NULL &&
+                    strstr(historyJson, "[1000,1599,1300]]}") != NULL;
+    }
+    // Ring girato: anche il punto più vecchio restituito è valido
+    size_t historyPoints = 0;
+    if (historyOk && historyQueryBegin(query, 0, historyFieldIndex("rpm"), historyTierIndex("1s"), 100000, historyBase + 610500)) {
+        historyPoints = query.end - query.first;
+        singleLength = historyQueryRead(query, historyJson, sizeof(historyJson));
+        historyJson[singleLength] = '\0';
+        historyOk = strstr(historyJson, "\"points\":[[") != NULL;
+    }
+    historyOk = historyOk && historyPoints == HISTORY_SECONDS - 1 && historyFieldIndex("fuelRate") < 0;
+    if (!historyOk) {
+        HAL_LOG("History mismatch: %s\n", historyJson);
+        errors++;
+    }
+    historyReset();
+    HAL_LOG("History: %.0f ns per sample, %u bytes for %u signals\n", historyNs,
+            (unsigned)HISTORY_MEMORY_BYTES, (unsigned)HISTORY_FIELD_COUNT);
+
+    // Nodo J1939 su un orologio simulato: address claim con contese (NAME
+    // più basso vince, NAME più alto respinto), risposta alla richiesta di
+    // claim, poi 2 minuti di richieste periodiche, NACK, pausa dopo
+    // TX_FAILED e richieste arretrate distanziate dal budget
+    uint32_t nodeNow = 1000000;
+    uint64_t nodeName = j1939MakeName(0x1234);
+    twai_message_t tx;
+    uint32_t nodeMismatches = 0;
+    while (hal_native_can_take(&tx)) {}
+    j1939NodeBegin(nodeName, nodeNow);
+    j1939NodePoll(nodeNow, 0);
+    uint64_t sentName = 0;
+    bool claimed = hal_native_can_take(&tx);
+    for (uint8_t i = 0; i < 8; i++) sentName |= (uint64_t)tx.data[i] << (8 * i);
+    if (!claimed || tx.identifier != 0x18EEFF00UL + J1939_PREFERRED_ADDRESS || sentName != nodeName) nodeMismatches++;
+
+    uint8_t claimData[8];
+    for (uint8_t i = 0; i < 8; i++) claimData[i] = ((nodeName - 1) >> (8 * i)) & 0xFF;
+    j1939NodeProcessFrame(PGN_ADDRESS_CLAIMED, J1939_PREFERRED_ADDRESS, J1939_GLOBAL_ADDRESS, claimData, 8, nodeNow + 10);
+    j1939NodePoll(nodeNow + 10, 0);
+    if (!hal_native_can_take(&tx) || (tx.identifier & 0xFF) != 128 || j1939NodeAddress() != 128) nodeMismatches++;
+    for (uint8_t i = 0; i < 8; i++) claimData[i] = ((nodeName + 1) >> (8 * i)) & 0xFF;
+    j1939NodeProcessFrame(PGN_ADDRESS_CLAIMED, 128, J1939_GLOBAL_ADDRESS, claimData, 8, nodeNow + 20);
+    j1939NodePoll(nodeNow + 20, 0);
+    if (!hal_native_can_take(&tx) || (tx.identifier & 0xFF) != 128) nodeMismatches++;
+    uint8_t claimRequest[3] = { 0x00, 0xEE, 0x00 };
+    j1939NodeProcessFrame(PGN_REQUEST, 0x00, J1939_GLOBAL_ADDRESS, claimRequest, 3, nodeNow + 30);
+    j1939NodePoll(nodeNow + 30, 0);
+    if (!hal_native_can_take(&tx) || ((tx.identifier >> 8) & 0xFFFF) != 0xEEFF) nodeMismatches++;
+
+    uint32_t hoursRequests = 0;
+    uint32_t dm2Requests = 0;
+    uint32_t minGap = 0xFFFFFFFF;
+    uint32_t lastRequest = 0;
+    uint32_t nodeStart = nodeNow + 40;
+    for (uint32_t t = nodeStart; t < nodeStart + 120000; t += 10) {
+        j1939NodePoll(t, 0);
+        while (hal_native_can_take(&tx)) {
+            uint32_t pgn = tx.data[0] | (tx.data[1] << 8) | ((uint32_t)tx.data[2] << 16);
+            if (((tx.identifier >> 16) & 0xFF) != 0xEA || tx.data_length_code != 3) {
+                nodeMismatches++;
+                continue;
+            }
+            if (lastRequest != 0 && t - lastRequest < minGap) minGap = t - lastRequest;
+            lastRequest = t;
+            if (pgn == PGN_ENGINE_HOURS) hoursRequests++;
+            if (pgn == PGN_DIAGNOSTIC_MESSAGE_2) dm2Requests++;
+        }
+    }
+    nodeNow = nodeStart + 120000;
+
+    uint8_t idRequest[3] = { 0xEB, 0xFE, 0x00 };  // Component ID, non trasmesso dal gateway
+    j1939NodeProcessFrame(PGN_REQUEST, 0x00, 128, idRequest, 3, nodeNow);
+    bool nacked = hal_native_can_take(&tx) && ((tx.identifier >> 16) & 0xFF) == 0xE8 &&
+                  tx.data[0] == 0x01 && tx.data[4] == 0x00 && tx.data[5] == 0xEB && tx.data[6] == 0xFE;
+
+    // Errori ravvicinati: pausa raddoppiata fino al massimo, nessuna
+    // richiesta durante gli errori; al termine le due richieste arretrate
+    // partono distanziate dal budget
+    j1939NodePoll(nodeNow, TWAI_ALERT_TX_FAILED);
+    j1939NodePoll(nodeNow + 50, TWAI_ALERT_TX_FAILED);
+    uint32_t pausedBackoff = j1939NodeStats.backoffMs;
+    uint32_t deferredBefore = j1939NodeStats.budgetDeferred;
+    uint32_t duringPause = 0;
+    uint32_t afterPause[2] = { 0, 0 };
+    uint32_t afterCount = 0;
+    uint32_t failUntil = nodeNow + 31000;  // Oltre il periodo di DM2: entrambe arretrate
+    for (uint32_t t = nodeNow + 60; t < failUntil + 20000; t += 10) {
+        j1939NodePoll(t, (t < failUntil && t % 100 == 0) ? TWAI_ALERT_TX_FAILED : 0);
+        while (hal_native_can_take(&tx)) {
+            if (t < failUntil + J1939_TX_BACKOFF_MAX_MS - 100) duringPause++;
+            if (afterCount < 2) afterPause[afterCount] = t;
+            afterCount++;
+        }
+    }
+    j1939NodeStop();
+    while (hal_native_can_take(&tx)) {}
+    if (nodeMismatches || hoursRequests < 11 || hoursRequests > 13 || dm2Requests < 3 || dm2Requests > 5 ||
+        minGap < J1939_REQUEST_MIN_GAP_MS || !nacked || pausedBackoff != 2 * J1939_TX_BACKOFF_MIN_MS ||
+        duringPause != 0 || afterPause[1] - afterPause[0] < J1939_REQUEST_MIN_GAP_MS ||
+        j1939NodeStats.budgetDeferred == deferredBefore) {
+        HAL_LOG("J1939 node mismatch: %u frames, %u/%u requests, gap %u ms, backoff %u ms, %u in pause\n",
+                (unsigned)nodeMismatches, (unsigned)hoursRequests, (unsigned)dm2Requests, (unsigned)minGap,
+                (unsigned)pausedBackoff, (unsigned)duringPause);
+        errors++;
+    }
+    HAL_LOG("J1939 node: %u requests in 120 s, min gap %u ms, %u deferred by budget\n",
+            (unsigned)(hoursRequests + dm2Requests), (unsigned)minGap, (unsigned)j1939NodeStats.budgetDeferred);
+
+    // Comandi J1939: TSC1 scritto via Modbus (FC 0x06 e 0x10), 1 s di tick da
+    // 1 ms con latenza di risveglio fino a 200 us e rinfresco ogni 50 ms per
+    // 500 ms: periodo di 10 ms senza deriva, arresto per timeout dopo 100 ms
+    // senza scritture, eccezioni per registri in sola lettura e valori non
+    // validi, nessuna trasmissione senza indirizzo
+    uint32_t commandMismatches = 0;
+    uint8_t commandRequest[64];
+    uint8_t commandResponse[256];
+    uint16_t commandBase = MODBUS_COMMAND_BASE + MB_CMD_SLOTS;
+    size_t commandLength = simMasterWriteSingle(commandRequest, currentSlaveId, MODBUS_COMMAND_BASE + MB_CMD_TIMEOUT, 100);
+    if (simModbusTransaction(commandRequest, commandLength, commandResponse, sizeof(commandResponse)) != 8 ||
+        memcmp(commandResponse, commandRequest, 8) != 0) {
+        commandMismatches++;
+    }
+    // Speed control a 1500 rpm (0.125 rpm/bit), coppia non disponibile
+    uint16_t tsc1[MB_CMD_SLOT_WORDS] = { 1, 0x0000, 0x0000, 3, 0x00, 10, 8, 0x01E0, 0x2EFF, 0xFFFF, 0xFFFF };
+    commandLength = simMasterWrite(commandRequest, currentSlaveId, commandBase, tsc1, MB_CMD_SLOT_WORDS);
+    if (simModbusTransaction(commandRequest, commandLength, commandResponse, sizeof(commandResponse)) != 8 ||
+        memcmp(commandResponse, commandRequest, 6) != 0) {
+        commandMismatches++;
+    }
+    uint8_t commandExceptions[3] = { 0, 0, 0 };
+    commandLength = simMasterWriteSingle(commandRequest, currentSlaveId, MODBUS_COMMAND_BASE + MB_CMD_ACTIVE, 1);
+    simModbusTransaction(commandRequest, commandLength, commandResponse, sizeof(commandResponse));
+    commandExceptions[0] = commandResponse[2];
+    commandLength = simMasterWriteSingle(commandRequest, currentSlaveId, commandBase + MB_CMD_SLOT_PRIORITY, 9);
+    simModbusTransaction(commandRequest, commandLength, commandResponse, sizeof(commandResponse));
+    commandExceptions[1] = commandResponse[2];
+    uint16_t pdu1WithDestination[2] = { 0x0000, 0xEF05 };
+    commandLength = simMasterWrite(commandRequest, currentSlaveId, commandBase + MB_CMD_SLOT_STRIDE + MB_CMD_SLOT_PGN,
+                                   pdu1WithDestination, 2);
+    simModbusTransaction(commandRequest, commandLength, commandResponse, sizeof(commandResponse));
+    commandExceptions[2] = commandResponse[2];
+    if (commandExceptions[0] != 0x02 || commandExceptions[1] != 0x03 || commandExceptions[2] != 0x03) commandMismatches++;
+
+    twai_message_t commandFrame;
+    while (hal_native_can_take(&commandFrame)) {}
+    uint32_t commandBaseMs = hal_millis();
+    uint32_t commandBaseUs = 5000000;
+    j1939CommandSetSource(J1939_NULL_ADDRESS);
+    j1939CommandService(commandBaseUs, commandBaseMs);
+    if (hal_native_can_take(&commandFrame)) commandMismatches++;
+    j1939CommandSetSource(0x80);
+
+    uint32_t commandFrames = 0;
+    uint32_t lastCommandUs = 0;
+    uint32_t minCommandInterval = 0xFFFFFFFF;
+    uint32_t maxCommandInterval = 0;
+    uint32_t lastCommandMs = 0;
+    uint32_t activeDuringRefresh = 0;
+    uint8_t keepalive[2] = { 0xFF, 0xFF };
+    for (uint32_t tick = 0; tick < 1000; tick++) {
+        uint32_t nowMs = commandBaseMs + tick;
+        if (tick % 50 == 0 && tick < 500) {
+            std::lock_guard<std::mutex> lock(modbusMutex);
+            if (j1939CommandWrite(MB_CMD_SLOTS + MB_CMD_SLOT_DATA + 3, 1, keepalive, nowMs) != 0) commandMismatches++;
+        }
+        uint32_t nowUs = commandBaseUs + tick * 1000 + (tick * 7919) % 200;
+        j1939CommandService(nowUs, nowMs);
+        while (hal_native_can_take(&commandFrame)) {
+            if (commandFrame.identifier != 0x0C000080 || commandFrame.data_length_code != 8 ||
+                commandFrame.data[0] != 0x01 || commandFrame.data[1] != 0xE0 || commandFrame.data[2] != 0x2E) {
+                commandMismatches++;
+            }
+            if (commandFrames > 0) {
+                minCommandInterval = std::min(minCommandInterval, nowUs - lastCommandUs);
+                maxCommandInterval = std::max(maxCommandInterval, nowUs - lastCommandUs);
+            }
+            lastCommandUs = nowUs;
+            lastCommandMs = tick;
+            commandFrames++;
+        }
+        if (tick == 400) {
+            std::lock_guard<std::mutex> lock(modbusMutex);
+            uint16_t status[MB_CMD_HEADER_COUNT];
+            j1939CommandRead(0, MB_CMD_HEADER_COUNT, status);
+            activeDuringRefresh = status[MB_CMD_ACTIVE];
+            if (status[MB_CMD_TIMEOUT] != 100 || status[MB_CMD_SOURCE_ADDRESS] != 0x80) commandMismatches++;
+        }
+    }
+    simMasterRequest(request, currentSlaveId, commandBase, MB_CMD_SLOT_WORDS);
+    size_t slotLength = simModbusTransaction(request, sizeof(request), commandResponse, sizeof(commandResponse));
+    bool slotReadOk = simMasterCheckResponse(commandResponse, slotLength, MB_CMD_SLOT_WORDS) &&
+                      commandResponse[4] == 1 && commandResponse[3 + MB_CMD_SLOT_PERIOD * 2 + 1] == 10 &&
+                      commandResponse[3 + (MB_CMD_SLOT_DATA + 3) * 2] == 0xFF;
+    {
+        std::lock_guard<std::mutex> lock(modbusMutex);
+        uint8_t disable[2] = { 0, 0 };
+        uint8_t timeoutDefault[2] = { J1939_COMMAND_TIMEOUT_MS >> 8, J1939_COMMAND_TIMEOUT_MS & 0xFF };
+        j1939CommandWrite(MB_CMD_SLOTS + MB_CMD_SLOT_ENABLE, 1, disable, commandBaseMs + 1000);
+        j1939CommandWrite(MB_CMD_TIMEOUT, 1, timeoutDefault, commandBaseMs + 1000);
+    }
+    j1939CommandSetSource(J1939_NULL_ADDRESS);
+    // Ultima scrittura a 450 ms, timeout 100 ms: ultimo frame a 550 ms
+    if (commandMismatches || commandFrames < 55 || commandFrames > 56 || lastCommandMs < 540 || lastCommandMs > 550 ||
+        minCommandInterval < 9800 || maxCommandInterval > 10200 || j1939CommandStats.maxLateUs > 200 ||
+        j1939CommandStats.timeouts != 1 || j1939CommandStats.overruns != 0 || activeDuringRefresh != 1 || !slotReadOk) {
+        HAL_LOG("J1939 command mismatch: %u errors, %u frames, last at %u ms, interval %u-%u us, late %u us, "
+                "%u timeouts, read %d\n",
+                (unsigned)commandMismatches, (unsigned)commandFrames, (unsigned)lastCommandMs,
+                (unsigned)minCommandInterval, (unsigned)maxCommandInterval, (unsigned)j1939CommandStats.maxLateUs,
+                (unsigned)j1939CommandStats.timeouts, slotReadOk);
+        errors++;
+    }
+    HAL_LOG("J1939 commands: %u TSC1 frames in 1 s, interval %u-%u us, max late %u us\n",
+            (unsigned)commandFrames, (unsigned)minCommandInterval, (unsigned)maxCommandInterval,
+            (unsigned)j1939CommandStats.maxLateUs);
+
+    // MQTT report-by-exception: report completo iniziale, variazione entro la
+    // banda morta ignorata, oltre la banda solo il segnale cambiato, null se
+    // non valido, coda limitata senza broker e report completo dopo le
+    // perdite, ripubblicazione per età massima. Senza broker (prima di
+    // mqttReportBegin) nessuna coda e nessun messaggio
+    MqttReportConfig mqttConfig = MQTT_REPORT_DEFAULTS;
+    mqttConfig.maxAgeMs = 5000;
+    mqttConfig.flushIntervalMs = 1000;
+    SimMqttCapture capture;
+    memset(&capture, 0, sizeof(capture));
+    uint32_t mqttNow = 1000000;
+    mqttReportService(mqttNow, simMqttPublish, &capture);
+    bool mqttIdle = capture.ecuMessages == 0 && mqttReportQueued() == 0 && mqttReportStats.messages == 0;
+    mqttIdle = mqttReportBegin(mqttConfig) && mqttIdle;
+    simSendRpm(1000);
+    mqttReportService(mqttNow, simMqttPublish, &capture);
+    bool mqttFull = capture.ecuMessages == 1 && strstr(capture.ecuPayload, "\"rpm\":1000") != NULL &&
+                    strstr(capture.ecuPayload, "\"coolantTemp\":") != NULL;
+    simSendRpm(1000 + MQTT_REPORT_DEFAULTS.deadband[FIELD_RPM]);
+    mqttReportService(mqttNow + 1000, simMqttPublish, &capture);
+    bool mqttDeadband = capture.ecuMessages == 1;
+    simSendRpm(1050);
+    mqttReportService(mqttNow + 1500, simMqttPublish, &capture);  // Prima del flush
+    bool mqttBatched = capture.ecuMessages == 1;
+    mqttReportService(mqttNow + 2000, simMqttPublish, &capture);
+    bool mqttChange = capture.ecuMessages == 2 && strstr(capture.ecuPayload, "\"rpm\":1050") != NULL &&
+                      strstr(capture.ecuPayload, "coolantTemp") == NULL;
+    simSendRpm(0xFFFF);
+    mqttReportService(mqttNow + 3000, simMqttPublish, &capture);
+    bool mqttNull = capture.ecuMessages == 3 && strstr(capture.ecuPayload, "\"rpm\":null") != NULL;
+    mqttNow += 4000;
+    for (uint32_t k = 0; k < MQTT_QUEUE_MESSAGES + 8; k++, mqttNow += 1000) {
+        simSendRpm(1000 + (k & 1) * 1000);
+        mqttReportService(mqttNow, NULL, NULL);
+    }
+    uint16_t offlineQueued = mqttReportQueued();
+    uint32_t offlineDropped = mqttReportStats.dropped;
+    simSendRpm(3000);
+    mqttReportService(mqttNow, simMqttPublish, &capture);
+    bool mqttResync = strstr(capture.ecuPayload, "\"rpm\":3000") != NULL &&
+                      strstr(capture.ecuPayload, "\"coolantTemp\":") != NULL && mqttReportQueued() == 0;
+    uint32_t beforeAge = capture.ecuMessages;
+    mqttReportService(mqttNow + 4000, simMqttPublish, &capture);
+    bool mqttQuiet = capture.ecuMessages == beforeAge;
+    mqttReportService(mqttNow + 5000, simMqttPublish, &capture);
+    bool mqttAged = capture.ecuMessages == beforeAge + 1 && strstr(capture.ecuPayload, "\"rpm\":3000") != NULL;
+    if (!mqttIdle || !mqttFull || !mqttDeadband || !mqttBatched || !mqttChange || !mqttNull ||
+        offlineQueued != MQTT_QUEUE_MESSAGES || offlineDropped == 0 || !mqttResync || !mqttQuiet || !mqttAged) {
+        HAL_LOG("MQTT report mismatch: idle %d, full %d, deadband %d, batch %d, change %d, null %d, queue %u/%u dropped, "
+                "resync %d, age %d/%d (%s)\n",
+                mqttIdle, mqttFull, mqttDeadband, mqttBatched, mqttChange, mqttNull, (unsigned)offlineQueued,
+                (unsigned)offlineDropped, mqttResync, mqttQuiet, mqttAged, capture.ecuPayload);
+        errors++;
+    }
+    HAL_LOG("MQTT: %u messages, %u signals, %u dropped offline\n", (unsigned)mqttReportStats.messages,
+            (unsigned)mqttReportStats.signals, (unsigned)mqttReportStats.dropped);
+
+    // Diagnostica FC 0x08: eco, azzeramento, contatori dopo una lettura e un
+    // frame con CRC errato, sotto-funzione non supportata
+    uint8_t diagRequest[8];
+    uint8_t diagResponse[16];
+    simMasterDiagnostics(diagRequest, currentSlaveId, MB_DIAG_RETURN_QUERY_DATA, 0xA55A);
+    bool echoOk = simModbusTransaction(diagRequest, 8, diagResponse, sizeof(diagResponse)) == 8 &&
+                  memcmp(diagRequest, diagResponse, 8) == 0;
+    simMasterDiagnostics(diagRequest, currentSlaveId, MB_DIAG_CLEAR_COUNTERS, 0);
+    bool clearOk = simModbusTransaction(diagRequest, 8, diagResponse, sizeof(diagResponse)) == 8 &&
+                   memcmp(diagRequest, diagResponse, 8) == 0;
+    simMasterRequest(request, currentSlaveId, 0, MODBUS_REGISTERS_COUNT);
+    simModbusTransaction(request, sizeof(request), response, sizeof(response));
+    request[7] ^= 0x01;
+    size_t corruptLength = simModbusTransaction(request, sizeof(request), response, sizeof(response));
+    const uint16_t diagSubFunctions[] = {
+        MB_DIAG_BUS_MESSAGE_COUNT, MB_DIAG_BUS_COMM_ERROR_COUNT, MB_DIAG_SERVER_MESSAGE_COUNT, 0x0004,
+        MB_DIAG_BUS_EXCEPTION_COUNT
+    };
+    uint16_t diagValues[5];
+    for (uint8_t i = 0; i < 5; i++) {
+        simMasterDiagnostics(diagRequest, currentSlaveId, diagSubFunctions[i], 0);
+        size_t length = simModbusTransaction(diagRequest, 8, diagResponse, sizeof(diagResponse));
+        diagValues[i] = (length == 8) ? (diagResponse[4] << 8) | diagResponse[5]
+                                      : (length == 5 && diagResponse[1] == 0x88) ? 0xE000 | diagResponse[2] : 0xFFFF;
+    }
+    if (!echoOk || !clearOk || corruptLength != 0 || diagValues[0] != 2 || diagValues[1] != 1 ||
+        diagValues[2] != 4 || diagValues[3] != 0xE001 || diagValues[4] != 1) {
+        HAL_LOG("Modbus diagnostics mismatch: echo %d, clear %d, counters %u/%u/%u/0x%04X/%u\n",
+                echoOk, clearOk, diagValues[0], diagValues[1], diagValues[2], diagValues[3], diagValues[4]);
+        errors++;
+    }
+
+    // Inventario del bus: EEC1 ogni 5 ms (periodo stimato), PGN senza
+    // decoder visto a filtro hardware aperto,
+    // frame PDU1 con destinazione, tabella piena, risposta a pezzi minimi
+    // uguale a quella in un colpo solo
+    busDiscoveryReset();
+    uint32_t discoveryErrors = 0;
+    for (uint8_t i = 0; i < 6; i++) {
+        hal_native_can_inject(simEcuFrame(0));
+        CAN_Task();
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    const uint32_t PGN_CCVS = 0xFEF1;
+    const uint32_t PGN_PROPRIETARY_A = 0xEF00;
+    // Il filtro dei PGN decodificati può lasciar passare anche CCVS
+    uint32_t rejectedBefore = hal_can_filter_rejected();
+    hal_native_can_inject(simFrame(6, PGN_CCVS, SIM_TCU_SA));
+    CAN_Task();
+    uint32_t ccvsExpected = (hal_can_filter_rejected() == rejectedBefore) ? 2 : 1;
+    j1939SetFilterOpen(true);
+    CAN_Task();
+    twai_message_t proprietary = simFrame(6, PGN_PROPRIETARY_A, SIM_TCU_SA);
+    proprietary.identifier |= 0x25 << 8;  // Destinazione 0x25
+    proprietary.data_length_code = 3;
+    hal_native_can_inject(simFrame(6, PGN_CCVS, SIM_TCU_SA));
+    hal_native_can_inject(proprietary);
+    CAN_Task();
+    BusDiscoveryEntry eec1 = {};
+    BusDiscoveryEntry ccvs = {};
+    BusDiscoveryEntry proprietaryEntry = {};
+    for (uint16_t slot = 0; slot < BUS_DISCOVERY_SLOTS; slot++) {
+        BusDiscoveryEntry entry;
+        if (!busDiscoveryRead(slot, entry)) continue;
+        if (entry.pgn == PGN_ELECTRONIC_ENGINE_1 && entry.sourceAddress == SIM_ECU_SA) eec1 = entry;
+        if (entry.pgn == PGN_CCVS) ccvs = entry;
+        if (entry.pgn == PGN_PROPRIETARY_A) proprietaryEntry = entry;
+    }
+    if (busDiscoveryStats.pairs != 3 || eec1.frames != 6 || !eec1.handled ||
+        eec1.periodUs < 4000 || eec1.periodUs > 20000) {
+        discoveryErrors++;
+    }
+    if (ccvs.frames != ccvsExpected || ccvs.handled || ccvs.sourceAddress != SIM_TCU_SA) discoveryErrors++;
+    if (proprietaryEntry.dlc != 3 || ((proprietaryEntry.identifier >> 8) & 0xFF) != 0x25) discoveryErrors++;
+    static char discoveryText[24576];
+    BusDiscoveryQuery discoveryQuery;
+    busDiscoveryQueryBegin(discoveryQuery, BUS_DISCOVERY_ALL, j1939FilterOpen(), hal_millis());
+    size_t discoveryLength = busDiscoveryQueryRead(discoveryQuery, discoveryText, sizeof(discoveryText) - 1);
+    discoveryText[discoveryLength] = '\0';
+    if (strstr(discoveryText, "\"filterOpen\":true") == NULL ||
+        strstr(discoveryText, "\"pgn\":61184,\"sa\":3,\"priority\":6,\"da\":37,") == NULL ||
+        strstr(discoveryText, "\"pgn\":65265,\"sa\":3,\"priority\":6,\"da\":null,") == NULL) {
+        discoveryErrors++;
+    }
+    // Tabella piena: le coppie oltre la capacità sono solo contate
+    for (uint16_t sa = 0; sa < 0x100; sa++) {
+        hal_native_can_inject(simFrame(6, PGN_CCVS, sa));
+        if (sa % 16 == 15) CAN_Task();
+    }
+    if (busDiscoveryStats.pairs != BUS_DISCOVERY_CAPACITY || busDiscoveryStats.untracked == 0) discoveryErrors++;
+    // Stesso istante per le due letture: ageMs non deve cambiare tra l'una e l'altra
+    uint32_t discoveryNowMs = hal_millis();
+    busDiscoveryQueryBegin(discoveryQuery, BUS_DISCOVERY_ALL, j1939FilterOpen(), discoveryNowMs);
+    discoveryLength = busDiscoveryQueryRead(discoveryQuery, discoveryText, sizeof(discoveryText) - 1);
+    static char discoveryChunked[sizeof(discoveryText)];
+    busDiscoveryQueryBegin(discoveryQuery, BUS_DISCOVERY_ALL, j1939FilterOpen(), discoveryNowMs);
+    size_t discoveryChunkedLength = 0;
+    size_t discoveryChunk;
+    while ((discoveryChunk = busDiscoveryQueryRead(discoveryQuery, discoveryChunked + discoveryChunkedLength,
+                                                   BUS_DISCOVERY_MIN_CHUNK)) > 0) {
+        discoveryChunkedLength += discoveryChunk;
+    }
+    if (discoveryQuery.stage != 2 || discoveryChunkedLength != discoveryLength ||
+        memcmp(discoveryChunked, discoveryText, discoveryLength) != 0) {
+        discoveryErrors++;
+    }
+    j1939SetFilterOpen(false);
+    CAN_Task();
+    hal_native_can_inject(simFrame(6, PGN_CCVS, SIM_TCU_SA));
+    CAN_Task();
+    uint32_t untracked = busDiscoveryStats.untracked;
+    busDiscoveryReset();
+    hal_native_can_inject(simEcuFrame(0));
+    CAN_Task();
+    if (j1939FilterOpen() || busDiscoveryStats.pairs != 1 || busDiscoveryStats.untracked != 0) discoveryErrors++;
+    // Filtro aperto che non si installa: torna quello dei PGN decodificati.
+    // Se fallisce anche quello il driver resta rimosso fino al nuovo tentativo
+    hal_native_can_fail(1);
+    j1939SetFilterOpen(true);
+    CAN_Task();
+    if (j1939FilterOpen() || !hal_native_can_inject(simEcuFrame(0))) discoveryErrors++;
+    CAN_Task();
+    hal_native_can_fail(2);
+    j1939SetFilterOpen(true);
+    CAN_Task();
+    if (j1939FilterOpen() || hal_native_can_inject(simEcuFrame(0))) discoveryErrors++;
+    std::this_thread::sleep_for(std::chrono::milliseconds(CAN_RESTART_RETRY_MS));
+    CAN_Task();
+    if (j1939FilterOpen() || !hal_native_can_inject(simEcuFrame(0))) discoveryErrors++;
+    CAN_Task();
+    // Data Page 1 (127488, NMEA 2000) ed EDP: PGN a 18 bit nell'inventario,
+    // un EEC1 con DP = 1 non è EEC1 e non va decodificato
+    j1939SetFilterOpen(true);
+    CAN_Task();
+    busDiscoveryReset();
+    uint32_t rpmBefore = engineDataSets[0].rpm;
+    uint32_t rejectedBeforeDp = j1939RxStats.softwareRejected;
+    twai_message_t pageOne = simFrame(3, 0x10000 | PGN_ELECTRONIC_ENGINE_1, SIM_ECU_SA);  // DP = 1
+    pageOne.data[3] = 0x34;
+    pageOne.data[4] = 0x12;
+    hal_native_can_inject(pageOne);
+    hal_native_can_inject(simFrame(2, 127488, SIM_TCU_SA));
+    hal_native_can_inject(simFrame(6, J1939_PGN_EDP | PGN_PROPRIETARY_A, SIM_TCU_SA));
+    CAN_Task();
+    busDiscoveryQueryBegin(discoveryQuery, BUS_DISCOVERY_ALL, j1939FilterOpen(), hal_millis());
+    size_t pageLength = busDiscoveryQueryRead(discoveryQuery, discoveryChunked, sizeof(discoveryChunked) - 1);
+    discoveryChunked[pageLength] = '\0';
+    if (engineDataSets[0].rpm != rpmBefore || j1939RxStats.softwareRejected - rejectedBeforeDp != 3 ||
+        strstr(discoveryChunked, "\"pgn\":127488,\"sa\":3,\"priority\":2,\"da\":null,") == NULL ||
+        strstr(discoveryChunked, "\"pgn\":126980,\"sa\":0,\"priority\":3,\"da\":null,") == NULL ||
+        strstr(discoveryChunked, "\"pgn\":192256,\"sa\":3,\"priority\":6,\"da\":0,") == NULL) {
+        discoveryErrors++;
+    }
+    j1939SetFilterOpen(false);
+    CAN_Task();
+    if (discoveryErrors) {
+        HAL_LOG("Bus discovery mismatch: %u errors\n", (unsigned)discoveryErrors);
+        errors++;
+    }
+    HAL_LOG("Bus discovery: EEC1 period %u us jitter %u us, %u pairs max, %u frames untracked, %u bytes JSON\n",
+            (unsigned)eec1.periodUs, (unsigned)eec1.jitterUs, (unsigned)BUS_DISCOVERY_CAPACITY,
+            (unsigned)untracked, (unsigned)discoveryLength);
+
+    // Profiler: sezioni CAN e Modbus già attive, jitter di una sezione
+    // periodica con un'attivazione in ritardo, attesa dei frame in coda al
+    // rientro nel task CAN, azzeramento eseguito dallo scrittore, costo
+    uint32_t profileErrors = 0;
+    if (profileStats[PROFILE_CAN].time.count == 0 || profileStats[PROFILE_MODBUS].time.count == 0) profileErrors++;
+    const uint32_t profileDelaysMs[] = { 2, 2, 6, 2 };
+    for (uint32_t delayMs : profileDelaysMs) {
+        uint32_t sectionStart = profileBegin(PROFILE_LOG);
+        profileEnd(PROFILE_LOG, sectionStart);
+        std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+    }
+    uint32_t sectionStart = profileBegin(PROFILE_LOG);
+    profileEnd(PROFILE_LOG, sectionStart);
+    const ProfileStats &logProfile = profileStats[PROFILE_LOG];
+    uint32_t logJitter = logProfile.maxIntervalUs - logProfile.minIntervalUs;
+    if (logProfile.time.count != 5 || logJitter < 3000 || logJitter > 20000) profileErrors++;
+    CAN_Task();
+    hal_native_can_inject(simEcuFrame(0));
+    std::this_thread::sleep_for(std::chrono::milliseconds(3));
+    CAN_Task();
+    if (profileCanBacklog.count == 0 || profileCanBacklogMaxUs < 3000) profileErrors++;
+    const uint32_t profilePairs = 100000;
+    auto profileT0 = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < profilePairs; i++) {
+        uint32_t pairStart = profileBegin(PROFILE_STATUS);
+        profileEnd(PROFILE_STATUS, pairStart);
+    }
+    double profilePairNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - profileT0).count() / profilePairs;
+    char profileText[PROFILE_REPORT_SIZE];
+    size_t profileLength = profileReport(profileText, sizeof(profileText));
+    if (profileLength == 0 || strstr(profileText, "\nstatus ") == NULL || strstr(profileText, "can backlog: ") == NULL) {
+        profileErrors++;
+    }
+    profileReset();
+    sectionStart = profileBegin(PROFILE_LOG);
+    profileEnd(PROFILE_LOG, sectionStart);
+    if (profileStats[PROFILE_LOG].time.count != 1 || profileStats[PROFILE_LOG].maxIntervalUs != 0 ||
+        profileStats[PROFILE_STATUS].time.count != profilePairs) {
+        profileErrors++;
+    }
+    if (profileErrors) {
+        HAL_LOG("Profiler mismatch: %u errors\n%s", (unsigned)profileErrors, profileText);
+        errors++;
+    }
+    HAL_LOG("Profiler: %.0f ns per section, log jitter %u us, CAN backlog max %u us\n",
+            profilePairNs, (unsigned)logJitter, (unsigned)profileCanBacklogMaxUs);
+
+    // /metrics: serie attese e documento identico per ogni dimensione dei pezzi
+    static char metricsText[16384];
+    MetricsCursor metricsCursor;
+    metricsBegin(metricsCursor);
+    size_t metricsLength = 0;
+    size_t metricsChunk;
+    while ((metricsChunk = metricsRead(metricsCursor, metricsText + metricsLength,
+                                       sizeof(metricsText) - 1 - metricsLength)) > 0) {
+        metricsLength += metricsChunk;
+    }
+    metricsText[metricsLength] = '\0';
+    const char *expectedSeries[] = {
+        "j1939gw_can_frames_total{pgn=\"61444\"} ",
+        "# TYPE j1939gw_can_frames_rejected_total counter\n",
+        "j1939gw_modbus_crc_errors_total 1\n",
+        "j1939gw_modbus_exceptions_total{code=\"1\"} 1\n",
+        "j1939gw_decode_seconds_bucket{le=\"+Inf\"} ",
+        "j1939gw_modbus_rtu_turnaround_seconds_count ",
+        "j1939gw_section_seconds_bucket{section=\"can\",le=\"+Inf\"} ",
+        "j1939gw_section_seconds_count{section=\"status\"} ",
+        "j1939gw_section_jitter_seconds{section=\"log\"} ",
+        "j1939gw_can_rx_backlog_max_seconds ",
+        "# TYPE j1939gw_task_stack_free_bytes gauge\n",
+    };
+    uint32_t missingSeries = 0;
+    for (const char *series : expectedSeries) {
+        if (strstr(metricsText, series) == NULL) missingSeries++;
+    }
+    uint32_t chunkMismatches = 0;
+    static char metricsChunked[sizeof(metricsText)];
+    for (size_t chunk = METRICS_MIN_CHUNK; chunk < METRICS_MIN_CHUNK + 64; chunk += 7) {
+        metricsBegin(metricsCursor);
+        size_t length = 0;
+        while (length + chunk < sizeof(metricsChunked) &&
+               (metricsChunk = metricsRead(metricsCursor, metricsChunked + length, chunk)) > 0) {
+            length += metricsChunk;
+        }
+        if (length != metricsLength || memcmp(metricsChunked, metricsText, length) != 0) chunkMismatches++;
+    }
+    if (missingSeries || chunkMismatches || metricsDecodeTime.count == 0) {
+        HAL_LOG("Metrics mismatch: %u series missing, %u chunk sizes differ\n",
+                (unsigned)missingSeries, (unsigned)chunkMismatches);
+        errors++;
+    }
+    HAL_LOG("Metrics: %u bytes, decode %u frames avg %.0f ns\n", (unsigned)metricsLength,
+            (unsigned)metricsDecodeTime.count, (double)metricsDecodeTime.sumNs / metricsDecodeTime.count);
+
+    // Risorse web: pagina su "/", contenuti gzip, If-None-Match con liste,
+    // tag deboli e *, Accept-Encoding con q=0
+    const WebAsset *page = webAssetFind("/");
+    uint32_t assetErrors = 0;
+    for (uint8_t i = 0; i < WEB_ASSET_COUNT; i++) {
+        const WebAsset &asset = WEB_ASSETS[i];
+        if (asset.length < 18 || asset.data[0] != 0x1F || asset.data[1] != 0x8B) assetErrors++;
+        if (!webEtagMatches(asset.etag, asset.etag)) assetErrors++;
+    }
+    if (page == NULL || page->immutable || webAssetFind("/app.js") == NULL || webAssetFind("/missing") != NULL) {
+        assetErrors++;
+    }
+    if (page != NULL) {
+        std::string etag = page->etag;
+        std::string weak = "W/" + etag;
+        std::string list = "\"0000\", " + etag;
+        if (!webEtagMatches(list.c_str(), page->etag) || !webEtagMatches(weak.c_str(), page->etag) ||
+            !webEtagMatches("*", page->etag) || webEtagMatches("\"0000\"", page->etag) ||
+            webEtagMatches(etag.substr(0, etag.size() - 2).c_str(), page->etag)) {
+            assetErrors++;
+        }
+    }
+    if (!webAcceptsGzip("gzip, deflate, br") || !webAcceptsGzip("deflate, GZIP;q=0.5") ||
+        !webAcceptsGzip("*") || webAcceptsGzip("gzip;q=0") || webAcceptsGzip("identity") ||
+        webAcceptsGzip("") || !webAcceptsGzip("x-gzip")) {
+        assetErrors++;
+    }
+    if (assetErrors) {
+        HAL_LOG("Web assets mismatch: %u errors\n", (unsigned)assetErrors);
+        errors++;
+    }
+    uint32_t assetBytes = 0;
+    for (uint8_t i = 0; i < WEB_ASSET_COUNT; i++) assetBytes += WEB_ASSETS[i].length;
+    HAL_LOG("Web assets: %u files, %u bytes gzip\n", (unsigned)WEB_ASSET_COUNT, (unsigned)assetBytes);
+
+    HAL_LOG("CAN log: %u frames at %.0f frames/s in %u blocks (%.1f bytes/frame), ring peak %u, "
+            "CAN task %.0f ns/frame\n",
+            (unsigned)canLogStats.frames, SIM_LOG_FRAMES / logSeconds, (unsigned)canLogStats.blocks,
+            canLogStats.blocks * (double)CAN_LOG_BLOCK_SIZE / SIM_LOG_FRAMES,
+            (unsigned)canLogStats.ringHighWater, logTaskNs / SIM_LOG_FRAMES);
+    HAL_LOG("Log download: %u CSV bytes for %u frames, 100-200 ms slice %u frames in %u blocks\n",
+            (unsigned)logCsv.size(), (unsigned)csvLines - 1, (unsigned)sliceLines,
+            (unsigned)(sliceBlocks.size() / CAN_LOG_BLOCK_SIZE));
+    HAL_LOG("Errors: %u\n", (unsigned)errors);
+
+    return errors ? 1 : 0;
+}
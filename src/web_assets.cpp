@@ -0,0 +1,57 @@
+/*
+ * @Description: Ricerca delle risorse web e intestazioni di cache (vedi
+ * web_assets.h; i dati sono in web_assets_data.cpp, generato)
+ */
+
+#include "web_assets.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+const WebAsset *webAssetFind(const char *path) {
+    for (uint8_t i = 0; i < WEB_ASSET_COUNT; i++) {
+        if (strcmp(WEB_ASSETS[i].path, path) == 0) return &WEB_ASSETS[i];
+    }
+    return NULL;
+}
+
+// Confronto debole (RFC 9110 13.1.2): il prefisso W/ non conta
+bool webEtagMatches(const char *ifNoneMatch, const char *etag) {
+    size_t etagLength = strlen(etag);
+    const char *p = ifNoneMatch;
+    while (*p != '\0') {
+        while (*p == ' ' || *p == '\t' || *p == ',') p++;
+        if (*p == '*') return true;
+        if (p[0] == 'W' && p[1] == '/') p += 2;
+        const char *end = p;
+        while (*end != '\0' && *end != ',' && *end != ' ' && *end != '\t') end++;
+        if ((size_t)(end - p) == etagLength && memcmp(p, etag, etagLength) == 0) return true;
+        p = end;
+    }
+    return false;
+}
+
+bool webAcceptsGzip(const char *acceptEncoding) {
+    for (const char *p = acceptEncoding; *p != '\0';) {
+        while (*p == ' ' || *p == '\t' || *p == ',') p++;
+        const char *token = p;
+        while (*p != '\0' && *p != ',' && *p != ';' && *p != ' ') p++;
+        size_t length = p - token;
+        bool gzip = (length == 4 && strncasecmp(token, "gzip", 4) == 0) ||
+                    (length == 6 && strncasecmp(token, "x-gzip", 6) == 0) ||
+                    (length == 1 && *token == '*');
+        // Parametri: solo q=0 esclude la codifica
+        float q = 1;
+        while (*p != '\0' && *p != ',') {
+            if (*p == ';') {
+                const char *param = p + 1;
+                while (*param == ' ') param++;
+                if (tolower((unsigned char)param[0]) == 'q' && param[1] == '=') q = strtof(param + 2, NULL);
+            }
+            p++;
+        }
+        if (gzip) return q > 0;
+    }
+    return false;
+}
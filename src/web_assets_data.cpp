@@ -0,0 +1,190 @@
+/*
+ * @Description: Risorse web compresse (gzip) generate da tools/web_assets.py
+ * a partire da web/. Non modificare: rigenerare dopo ogni modifica a web/
+ */
+
+#include "web_assets.h"
+
+// app.js: 2276 byte, 984 compressi
+static const uint8_t WEB_APP_JS[] = {
+    0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x8D, 0x56, 0xDD, 0x6E, 0xDB, 0x36,
+    0x14, 0xBE, 0xF7, 0x53, 0x9C, 0x05, 0xE8, 0x24, 0xA1, 0x8E, 0xE4, 0x64, 0x1B, 0x50, 0xC4, 0x71,
+    0x86, 0xCE, 0x4B, 0xD1, 0x0E, 0x49, 0x1B, 0xD4, 0x59, 0x7B, 0x51, 0xE4, 0x82, 0x96, 0x18, 0x9B,
+    0x0D, 0x45, 0x0A, 0x24, 0x15, 0x27, 0x69, 0xFD, 0x4E, 0x7D, 0x86, 0x3E, 0xD9, 0xCE, 0xA1, 0x24,
+    0x9B, 0x72, 0x9B, 0x76, 0xBE, 0xB0, 0xA5, 0xC3, 0x73, 0xBE, 0xEF, 0xE3, 0xF9, 0x21, 0x9D, 0x65,
+    0xF0, 0x37, 0x73, 0x02, 0x84, 0xBA, 0x15, 0xF4, 0x5B, 0x30, 0x09, 0x0B, 0xE6, 0xF8, 0x8A, 0xDD,
+    0x03, 0x5A, 0xE0, 0x3D, 0x9F, 0xCF, 0x74, 0x7E, 0xC3, 0xDD, 0x11, 0x58, 0xC7, 0x9C, 0x86, 0x5C,
+    0x97, 0x95, 0xE4, 0xF8, 0xC0, 0xA4, 0x64, 0x83, 0x2C, 0x43, 0x83, 0x52, 0xDC, 0x5A, 0xA1, 0x15,
+    0x1F, 0x42, 0xA5, 0x05, 0x58, 0x2D, 0x35, 0x08, 0xC8, 0x59, 0x59, 0xF9, 0xEF, 0x39, 0x01, 0x0F,
+    0xD0, 0xCD, 0x3A, 0xB0, 0xDC, 0x59, 0x98, 0xC0, 0x87, 0xAB, 0xF1, 0x60, 0x70, 0x5D, 0xAB, 0xDC,
+    0x61, 0x58, 0x83, 0x90, 0xBB, 0x38, 0x81, 0x4F, 0x03, 0xC0, 0x4F, 0xEB, 0xEA, 0x69, 0xD1, 0x59,
+    0xF1, 0xD5, 0x56, 0x46, 0x1C, 0xAD, 0xEC, 0x51, 0x96, 0x45, 0xF0, 0x14, 0xA4, 0xCE, 0x19, 0xC5,
+    0xA7, 0x4B, 0x8D, 0xEE, 0x4F, 0x21, 0xCA, 0x56, 0x36, 0x4A, 0xC6, 0x1E, 0xA2, 0x09, 0x4E, 0xB5,
+    0x2A, 0x51, 0x1A, 0x5B, 0x70, 0x84, 0xE1, 0xB7, 0x5C, 0x21, 0xDC, 0x49, 0x4B, 0xB2, 0x25, 0xDA,
+    0xBA, 0xFC, 0x33, 0x7B, 0xF3, 0x3A, 0xAD, 0x98, 0xB1, 0x3C, 0xF6, 0xDE, 0x69, 0xC1, 0x1C, 0x6B,
+    0x11, 0x03, 0x61, 0x5C, 0xA2, 0x5A, 0x74, 0x2F, 0x74, 0x5E, 0x97, 0xE4, 0xB6, 0xE0, 0xEE, 0x54,
+    0x72, 0x7A, 0xFC, 0xEB, 0xFE, 0x55, 0x11, 0x47, 0x14, 0x36, 0xE3, 0x2E, 0x0A, 0x42, 0xC5, 0x35,
+    0xC4, 0x2D, 0x51, 0x6A, 0x75, 0x6D, 0x72, 0x6E, 0x93, 0x40, 0x09, 0x7D, 0x30, 0x97, 0x88, 0xA2,
+    0x72, 0x0D, 0xA7, 0xD3, 0x7F, 0x87, 0xA0, 0x4D, 0x21, 0x14, 0x56, 0x02, 0x2A, 0x6E, 0xB0, 0x3C,
+    0x85, 0x30, 0xE2, 0xE1, 0x41, 0xE3, 0xCE, 0xCC, 0x02, 0x89, 0x38, 0x15, 0x82, 0x63, 0x9A, 0xE7,
+    0x4C, 0xE5, 0x4B, 0x01, 0xE7, 0xBA, 0x98, 0xD7, 0xB6, 0x87, 0x17, 0xAA, 0xE5, 0x05, 0xEA, 0x6D,
+    0x1E, 0xD3, 0x5B, 0x26, 0x6B, 0x0E, 0x9F, 0x3F, 0xC3, 0x68, 0xDC, 0xF3, 0xA7, 0xDA, 0xA4, 0x28,
+    0x60, 0xE1, 0x96, 0xE8, 0xFC, 0xCD, 0xA2, 0x8F, 0x15, 0x58, 0x29, 0xF3, 0xF2, 0xF2, 0xFC, 0x0C,
+    0x3D, 0x76, 0xB6, 0x93, 0x96, 0xAC, 0x8A, 0x63, 0xCB, 0x86, 0x20, 0x12, 0x4C, 0x73, 0x2F, 0x9A,
+    0x3E, 0xD1, 0xB1, 0xAE, 0x7C, 0xB9, 0x3D, 0xFF, 0x64, 0x8F, 0x4A, 0x28, 0xA8, 0x6C, 0x7B, 0x27,
+    0xB3, 0xE7, 0x40, 0x6F, 0x96, 0xD1, 0xEB, 0x71, 0xD6, 0xF8, 0x9D, 0x44, 0x49, 0xFA, 0x51, 0x0B,
+    0x15, 0x47, 0x61, 0x1E, 0x03, 0x2D, 0xCD, 0x3E, 0x26, 0x70, 0xCE, 0xDC, 0x32, 0x2D, 0xD1, 0xB1,
+    0xDB, 0xEA, 0xB0, 0x35, 0xB1, 0xBB, 0xDD, 0x94, 0x77, 0xDB, 0xDB, 0x87, 0x83, 0x21, 0x8C, 0x92,
+    0x00, 0x77, 0xBD, 0x79, 0xDA, 0x84, 0x50, 0x3A, 0xAE, 0xB5, 0x39, 0x65, 0xF9, 0x12, 0xA1, 0x9B,
+    0xD6, 0xF1, 0x49, 0xFA, 0x80, 0x5F, 0xB4, 0x7C, 0x85, 0xE4, 0x6F, 0xE6, 0x1F, 0x49, 0x0B, 0xC3,
+    0x01, 0x58, 0x90, 0x82, 0x70, 0x15, 0x53, 0xFC, 0x69, 0x3D, 0xA4, 0x90, 0x64, 0x0C, 0xEB, 0x80,
+    0xAC, 0xAE, 0xB0, 0x43, 0x38, 0xCE, 0x1D, 0x8B, 0x5B, 0xEB, 0x7A, 0xA7, 0x6D, 0x73, 0xA9, 0x2D,
+    0xED, 0x2D, 0xA6, 0x54, 0x12, 0xC2, 0xA5, 0x28, 0xB9, 0xAE, 0x5D, 0xDC, 0xCE, 0xCA, 0x10, 0x0E,
+    0x47, 0xA3, 0x11, 0x06, 0xAF, 0x83, 0x39, 0x0A, 0x61, 0x7B, 0xA3, 0x44, 0xFD, 0xE8, 0xEB, 0x8F,
+    0xEA, 0x7E, 0xDE, 0xB4, 0x41, 0x83, 0x5C, 0x35, 0xB2, 0xA8, 0x79, 0x7F, 0xF1, 0xB3, 0x00, 0x86,
+    0xBB, 0xDA, 0x28, 0x9C, 0xDE, 0xB6, 0x63, 0x67, 0x7C, 0xA1, 0x98, 0x14, 0xA0, 0x90, 0xBF, 0x10,
+    0xB6, 0xD2, 0x4A, 0xCC, 0x05, 0xBE, 0xE3, 0x09, 0xA0, 0x80, 0x1B, 0xA3, 0x0D, 0x87, 0x12, 0xE7,
+    0xD3, 0xD0, 0xE1, 0xE2, 0x5B, 0x36, 0xDA, 0x8F, 0xC2, 0x29, 0x5F, 0xEA, 0x15, 0xED, 0x53, 0x60,
+    0xD5, 0xE6, 0x02, 0xF7, 0xE5, 0xF8, 0x9D, 0x4B, 0xFA, 0x63, 0xFA, 0x98, 0x64, 0x51, 0x24, 0x29,
+    0xB9, 0x4F, 0x35, 0xCE, 0x03, 0xCD, 0x36, 0xC4, 0x24, 0x92, 0xF4, 0x8B, 0xE2, 0x85, 0x64, 0x0B,
+    0x0B, 0xBF, 0x42, 0x7C, 0x00, 0xC7, 0xC7, 0x04, 0x9D, 0x24, 0xF0, 0xA7, 0x47, 0x87, 0x23, 0xD2,
+    0xD0, 0xCF, 0x3B, 0xAA, 0x88, 0x23, 0x53, 0x95, 0x11, 0xB6, 0xC5, 0xD0, 0xE7, 0x2B, 0xC5, 0x37,
+    0x6A, 0x47, 0x78, 0x7B, 0x71, 0xBE, 0x39, 0x55, 0xBC, 0x1B, 0xB6, 0x90, 0x50, 0xFC, 0x92, 0x97,
+    0x15, 0x7A, 0x63, 0x1F, 0x35, 0xA4, 0x5B, 0x2B, 0x64, 0x70, 0x30, 0x42, 0x65, 0xFA, 0x85, 0xB8,
+    0xE3, 0x45, 0x7C, 0x90, 0x78, 0x98, 0xAF, 0x5F, 0xA6, 0x7D, 0x18, 0x2D, 0xE4, 0x85, 0xC1, 0x5E,
+    0xAB, 0x0D, 0x47, 0x9C, 0xC3, 0x96, 0x35, 0xB0, 0xFA, 0xB0, 0x9B, 0x0B, 0xD6, 0x0F, 0xBB, 0xAE,
+    0xB9, 0x7C, 0x8B, 0x65, 0xC6, 0x98, 0xDF, 0x3A, 0xEE, 0xCE, 0xE6, 0x99, 0x03, 0xEA, 0xC3, 0x86,
+    0xFA, 0x2C, 0x5B, 0x7E, 0x6F, 0x07, 0x2F, 0x71, 0x26, 0x2C, 0xC2, 0xFC, 0xDE, 0xDF, 0x82, 0x37,
+    0x3F, 0x82, 0xB4, 0x83, 0x93, 0x6B, 0x2D, 0x99, 0x72, 0x6D, 0x2A, 0xFE, 0xE8, 0x70, 0x02, 0xF3,
+    0xFF, 0xCC, 0x45, 0xC3, 0x7C, 0xA6, 0x59, 0x81, 0x38, 0xCF, 0xDA, 0x54, 0x6C, 0x8D, 0x3E, 0xE8,
+    0x49, 0x3F, 0x64, 0xCE, 0x9C, 0xE3, 0xE6, 0xFE, 0x9D, 0x96, 0x0E, 0xA7, 0x95, 0x2A, 0xB1, 0x29,
+    0x45, 0x7F, 0xE9, 0xFB, 0x12, 0xDE, 0x75, 0x68, 0x8F, 0xCF, 0x83, 0xCB, 0xA7, 0xBA, 0x56, 0x34,
+    0x10, 0xFD, 0x26, 0xF3, 0x1C, 0xDD, 0x6A, 0x3B, 0x09, 0x78, 0x23, 0xFA, 0xFB, 0xB1, 0xB6, 0x97,
+    0xD4, 0x61, 0x13, 0x88, 0xDA, 0x06, 0xDB, 0x2E, 0x4C, 0x25, 0x1E, 0x12, 0xED, 0xCA, 0x66, 0xAA,
+    0x3C, 0x56, 0xB3, 0xDE, 0x35, 0xEC, 0xE8, 0xEE, 0x19, 0x8D, 0x76, 0xD0, 0xFF, 0x7D, 0xE0, 0xD3,
+    0x66, 0xA8, 0xA6, 0xBA, 0xAC, 0x95, 0xC8, 0xD9, 0x03, 0x5D, 0xBC, 0x30, 0x7D, 0xFE, 0x3A, 0x1A,
+    0xEF, 0x04, 0x6C, 0x08, 0x9B, 0xD7, 0x7D, 0x3F, 0x8D, 0x5D, 0xDF, 0x03, 0x97, 0x78, 0xC0, 0x3C,
+    0xC6, 0x31, 0x6D, 0xEE, 0x74, 0xFD, 0x53, 0x4C, 0x7D, 0xD3, 0x01, 0x0E, 0x7E, 0x9C, 0xCD, 0xF6,
+    0xDC, 0x42, 0xB1, 0x33, 0x1F, 0x89, 0x59, 0x0D, 0xEF, 0x92, 0xC1, 0xF6, 0x96, 0xB0, 0x15, 0xC3,
+    0xBF, 0x04, 0xC4, 0x33, 0xD9, 0x6B, 0x58, 0x9A, 0xCB, 0x21, 0xE0, 0xF7, 0x97, 0xC6, 0xD6, 0xE8,
+    0x55, 0xFB, 0x9B, 0x83, 0x62, 0x4F, 0x22, 0x7F, 0x2A, 0x6E, 0xFE, 0x54, 0x8C, 0x07, 0xFF, 0x01,
+    0x43, 0x4B, 0x4B, 0xA5, 0xE4, 0x08, 0x00, 0x00,
+};
+
+// style.css: 1461 byte, 576 compressi
+static const uint8_t WEB_STYLE_CSS[] = {
+    0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x75, 0x54, 0xC1, 0x6E, 0xA3, 0x30,
+    0x10, 0xBD, 0xE7, 0x2B, 0xAC, 0x54, 0x2B, 0x25, 0x52, 0x1C, 0x41, 0x08, 0x55, 0x4A, 0xB4, 0x87,
+    0xAA, 0x52, 0x7F, 0x62, 0xD5, 0x83, 0xC1, 0x06, 0xAC, 0x18, 0x1B, 0x19, 0x53, 0x92, 0x56, 0xFD,
+    0xF7, 0x1D, 0x83, 0x21, 0x81, 0x42, 0xB8, 0x44, 0x63, 0xBF, 0x99, 0xF7, 0x9E, 0x67, 0x26, 0x56,
+    0xF4, 0x86, 0xBE, 0xD1, 0x0A, 0xC1, 0x2F, 0x55, 0xD2, 0xE0, 0x94, 0x14, 0x5C, 0xDC, 0x22, 0xF4,
+    0xAA, 0x39, 0x11, 0xE7, 0xEE, 0xA0, 0x20, 0x3A, 0xE3, 0x32, 0x42, 0x07, 0xAF, 0xBC, 0x9E, 0xDB,
+    0x48, 0x4C, 0x92, 0x4B, 0xA6, 0x55, 0x2D, 0x29, 0x4E, 0x94, 0x50, 0x3A, 0x42, 0x4F, 0xA9, 0x67,
+    0xBF, 0xF3, 0xEA, 0x67, 0xB5, 0x4F, 0x20, 0x11, 0xE1, 0x92, 0x69, 0xF4, 0xED, 0xF0, 0x57, 0xDC,
+    0x70, 0x6A, 0xF2, 0x08, 0x9D, 0xBC, 0x21, 0x47, 0x9F, 0xD5, 0x43, 0xA4, 0x36, 0x6A, 0x29, 0x6F,
+    0x93, 0x73, 0xC3, 0xBA, 0xC3, 0x92, 0x50, 0xCA, 0x65, 0x36, 0xE2, 0xA1, 0x34, 0x65, 0x1A, 0x6B,
+    0x42, 0x79, 0x5D, 0x45, 0xC8, 0x7F, 0x38, 0xB8, 0xE2, 0x2A, 0x27, 0x54, 0x35, 0xB6, 0x80, 0xD7,
+    0x9E, 0x20, 0x9D, 0xC5, 0x64, 0xE3, 0xED, 0xDA, 0x6F, 0xEF, 0x6F, 0x2D, 0xD7, 0xDC, 0xEF, 0xD5,
+    0xF7, 0x3A, 0x82, 0x20, 0xE8, 0x52, 0x18, 0x76, 0x35, 0x98, 0x08, 0x9E, 0x01, 0xC7, 0x84, 0x49,
+    0xC3, 0x74, 0x2B, 0x8E, 0x12, 0x43, 0x70, 0xA6, 0x39, 0x75, 0xE2, 0x28, 0xAF, 0x4A, 0x41, 0xC0,
+    0x31, 0x1B, 0xEB, 0x90, 0xF6, 0x1F, 0x36, 0xAC, 0x80, 0xB8, 0x61, 0x56, 0x48, 0x5D, 0x48, 0x60,
+    0xA7, 0x59, 0xC9, 0x88, 0xD9, 0x58, 0xB5, 0x38, 0xE5, 0x66, 0x87, 0x0A, 0x2E, 0xC1, 0x9A, 0xCD,
+    0x21, 0x04, 0x72, 0x3B, 0xE4, 0xA7, 0x7A, 0xBB, 0x75, 0x09, 0x48, 0x09, 0x62, 0xC2, 0xB1, 0x53,
+    0xD8, 0xA8, 0xB2, 0xD7, 0xDE, 0xF3, 0x00, 0x6F, 0x0A, 0xC7, 0x63, 0xEE, 0x49, 0x4E, 0xF6, 0x9B,
+    0x98, 0x77, 0x4F, 0x3B, 0x31, 0x6F, 0x12, 0x87, 0x9B, 0x60, 0x59, 0xA5, 0x04, 0x28, 0x7D, 0xA2,
+    0x94, 0xDE, 0x8B, 0x0A, 0x12, 0x33, 0xE1, 0xAA, 0xB6, 0x3D, 0xD3, 0x30, 0x9E, 0xE5, 0x26, 0x02,
+    0xA0, 0x70, 0x0E, 0xF4, 0x0C, 0xC2, 0x30, 0x1C, 0x49, 0x88, 0x95, 0x31, 0xAA, 0x70, 0xB5, 0xFA,
+    0x7C, 0x9F, 0x44, 0xD4, 0xEC, 0x31, 0x5F, 0xC5, 0xBF, 0x18, 0x94, 0xDF, 0x1F, 0x58, 0x71, 0xFE,
+    0xFD, 0x36, 0x00, 0xAB, 0x0C, 0x31, 0x75, 0xE5, 0x20, 0x83, 0x32, 0x48, 0x3A, 0xEA, 0x80, 0x91,
+    0xBA, 0xA0, 0x8F, 0x0F, 0xEF, 0xC5, 0xA5, 0x80, 0x1E, 0xC5, 0xB1, 0x50, 0xC9, 0xE5, 0xB7, 0xCF,
+    0x7E, 0xEF, 0x73, 0x57, 0x0B, 0xAB, 0x0B, 0x34, 0xCA, 0x8C, 0xC7, 0xC7, 0xB7, 0xD7, 0xF7, 0xD0,
+    0x3B, 0xA3, 0x51, 0xBB, 0xA2, 0x3B, 0xAE, 0x21, 0x5A, 0x02, 0xBB, 0x79, 0x70, 0x9A, 0xBE, 0xC0,
+    0x40, 0x2C, 0x83, 0x99, 0xD6, 0x4A, 0x2F, 0x40, 0x8F, 0xC7, 0x20, 0x78, 0x9E, 0x81, 0xC2, 0xF0,
+    0xA5, 0x3C, 0xC3, 0x15, 0x4B, 0x0C, 0x57, 0x72, 0x98, 0xC0, 0xBB, 0xB2, 0x60, 0xB0, 0x68, 0x6E,
+    0xA0, 0x96, 0x07, 0x7B, 0xA9, 0x65, 0x7E, 0x56, 0x5C, 0x96, 0xB5, 0xF9, 0x67, 0x6E, 0x25, 0xFB,
+    0xBB, 0xB6, 0x53, 0xB3, 0xFE, 0xD8, 0xA1, 0xC7, 0x58, 0x49, 0xAA, 0xAA, 0x01, 0xE4, 0x34, 0x2E,
+    0xEB, 0x22, 0x66, 0x7A, 0xFD, 0xE1, 0x48, 0xBA, 0x15, 0xE1, 0x7B, 0xDE, 0x9F, 0x09, 0xBF, 0xD3,
+    0x74, 0x67, 0xD8, 0xA7, 0xF6, 0x1E, 0x26, 0x9D, 0x7F, 0xB5, 0xF7, 0x1C, 0x3D, 0x08, 0x59, 0x5A,
+    0x71, 0x0D, 0xCD, 0x26, 0x97, 0xC7, 0xC3, 0x3D, 0xDD, 0x63, 0x87, 0xCD, 0x6D, 0x9B, 0x76, 0x75,
+    0x4C, 0x57, 0x4E, 0x84, 0xA4, 0x92, 0x6C, 0xD6, 0x94, 0x63, 0x7F, 0x33, 0xA9, 0x75, 0x65, 0x93,
+    0x96, 0x8A, 0x77, 0xDB, 0x63, 0xA9, 0xC7, 0x3A, 0xA2, 0x51, 0xAE, 0x3E, 0x87, 0x95, 0x39, 0x47,
+    0x37, 0x24, 0xDE, 0xF1, 0xC5, 0xDE, 0xFF, 0x0F, 0x6C, 0x1E, 0x0C, 0x10, 0xB5, 0x05, 0x00, 0x00,
+};
+
+// index.html: 4437 byte, 1053 compressi
+static const uint8_t WEB_INDEX_HTML[] = {
+    0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xBD, 0x58, 0xDB, 0x52, 0x23, 0x37,
+    0x10, 0x7D, 0xDF, 0xAF, 0x50, 0xE6, 0x09, 0x2A, 0x31, 0xBE, 0x71, 0x73, 0xCA, 0x76, 0x0A, 0x0C,
+    0x9B, 0x25, 0x05, 0x0B, 0x85, 0xD9, 0x6C, 0xE5, 0x51, 0x33, 0x6A, 0xDB, 0x9D, 0x68, 0xA4, 0x59,
+    0x49, 0x63, 0x16, 0xFE, 0x2C, 0xCF, 0xFB, 0x63, 0xDB, 0x92, 0xC6, 0x5C, 0xCD, 0x62, 0x9B, 0xC4,
+    0x3C, 0x20, 0x46, 0xD3, 0x97, 0xA3, 0xD3, 0xAD, 0xEE, 0x66, 0xBA, 0x3F, 0x1D, 0x9D, 0x0F, 0xAE,
+    0xFE, 0xBA, 0x38, 0x66, 0x1F, 0xAE, 0xCE, 0x4E, 0xFB, 0xEF, 0xBA, 0x13, 0x97, 0x4B, 0xBF, 0x00,
+    0x17, 0xFD, 0x77, 0x8C, 0x7E, 0xBA, 0x0E, 0x9D, 0x84, 0xFE, 0xEF, 0xDC, 0xC1, 0x35, 0xBF, 0x61,
+    0x67, 0x5A, 0xA4, 0xA5, 0xAD, 0x0D, 0x0E, 0x3E, 0xB2, 0x3F, 0x9A, 0x9D, 0x76, 0xA7, 0x5B, 0x8F,
+    0xEF, 0xA3, 0x6C, 0x0E, 0x8E, 0x33, 0xC5, 0x73, 0xE8, 0x25, 0x53, 0x84, 0xEB, 0x42, 0x1B, 0x97,
+    0xB0, 0x4C, 0x2B, 0x07, 0xCA, 0xF5, 0x92, 0x6B, 0x14, 0x6E, 0xD2, 0x13, 0x30, 0xC5, 0x0C, 0x6A,
+    0xE1, 0xE1, 0x17, 0x86, 0x0A, 0x1D, 0x72, 0x59, 0xB3, 0x19, 0x97, 0xD0, 0x6B, 0x26, 0x95, 0x21,
+    0x89, 0xEA, 0x1F, 0x66, 0x40, 0xF6, 0x12, 0xEB, 0x6E, 0x24, 0xD8, 0x09, 0x00, 0x59, 0x9A, 0x18,
+    0x18, 0xF5, 0x92, 0x7A, 0xD8, 0xDA, 0xCA, 0xAC, 0xFD, 0x6D, 0xDA, 0x83, 0x9D, 0x46, 0xCA, 0x77,
+    0x76, 0x47, 0xA2, 0xD5, 0xD8, 0xDF, 0x6D, 0xEF, 0x09, 0x32, 0xD0, 0xAD, 0x47, 0xF4, 0xDD, 0x54,
+    0x8B, 0x9B, 0xCA, 0x9E, 0xC0, 0x29, 0xCB, 0x24, 0xB7, 0xB6, 0x97, 0x78, 0x38, 0x1C, 0x15, 0x98,
+    0xCA, 0x57, 0x78, 0x3F, 0x69, 0xFE, 0xE0, 0x84, 0xF4, 0xF2, 0x4E, 0xF2, 0x5E, 0xC5, 0x9B, 0x44,
+    0x11, 0xEC, 0x29, 0xC8, 0x1C, 0x6A, 0x35, 0x74, 0xDC, 0x95, 0x36, 0xE9, 0x77, 0xEB, 0xF4, 0x6E,
+    0x9E, 0xCA, 0xA4, 0xD5, 0x3F, 0xE2, 0x0E, 0xC9, 0x85, 0xD3, 0x06, 0xE8, 0xEC, 0xEC, 0x0A, 0xF2,
+    0x42, 0xB3, 0x4B, 0xA0, 0xC3, 0x93, 0x9F, 0xD6, 0x03, 0x44, 0x92, 0xA7, 0x20, 0xFB, 0xC7, 0x83,
+    0x4F, 0x6C, 0x03, 0x95, 0x40, 0x83, 0xB7, 0xB7, 0x9A, 0x59, 0x6D, 0xC6, 0x44, 0x25, 0x6C, 0xFE,
+    0xDA, 0xAD, 0x47, 0x81, 0x7B, 0x05, 0x0B, 0x92, 0x60, 0x04, 0x48, 0x82, 0x3B, 0x3E, 0xF4, 0x84,
+    0x69, 0x95, 0x4D, 0xB8, 0x1A, 0x53, 0x38, 0xCA, 0x82, 0x36, 0x81, 0xBC, 0xF3, 0x8D, 0x4D, 0x8F,
+    0x30, 0x4A, 0xF7, 0x1F, 0x1F, 0xA7, 0x62, 0xC8, 0xAB, 0xD7, 0xC6, 0x06, 0x45, 0x12, 0xAC, 0x81,
+    0x1A, 0x13, 0x5D, 0x5E, 0xF5, 0x01, 0x63, 0x73, 0x75, 0xD0, 0x41, 0xFE, 0x44, 0x66, 0xAE, 0x5C,
+    0x80, 0x9E, 0xF4, 0x2F, 0x2F, 0xCE, 0x2A, 0x2A, 0x9E, 0x30, 0xF6, 0xA2, 0xE2, 0x94, 0xCB, 0x12,
+    0x22, 0x2A, 0x53, 0x90, 0xAB, 0xDA, 0x1C, 0xC5, 0x79, 0x5B, 0x6F, 0x04, 0xEA, 0xA3, 0x04, 0x86,
+    0x82, 0x6B, 0xF8, 0xEA, 0x80, 0x23, 0x8D, 0xDE, 0xD4, 0xDA, 0x70, 0x5F, 0x18, 0xB0, 0x96, 0x12,
+    0x13, 0xD8, 0xB9, 0x44, 0xBD, 0x02, 0x66, 0x8D, 0x32, 0xD8, 0x28, 0x0D, 0xAC, 0x0D, 0xF4, 0x40,
+    0x2B, 0x5B, 0xE6, 0x9A, 0x0D, 0xB8, 0x49, 0x89, 0x70, 0xCA, 0xF6, 0x15, 0x80, 0x8F, 0x4A, 0x90,
+    0x97, 0x94, 0xF0, 0x6B, 0x43, 0x7D, 0x4E, 0xF7, 0x59, 0x20, 0x7B, 0x5F, 0xAA, 0x5B, 0x22, 0x9C,
+    0x2A, 0xA0, 0x72, 0x7A, 0xE5, 0x24, 0xF9, 0xA0, 0x4B, 0x63, 0xD7, 0x9A, 0xDD, 0x5B, 0xEC, 0x14,
+    0xBF, 0x94, 0x28, 0xA8, 0x16, 0xF1, 0xD1, 0x68, 0x6B, 0x05, 0xE4, 0x99, 0xD6, 0x92, 0x82, 0xB5,
+    0xD6, 0xFC, 0xA6, 0x14, 0xC1, 0x4C, 0xBF, 0xF5, 0x4A, 0x9E, 0x6A, 0x2E, 0xD6, 0x48, 0xB6, 0x8A,
+    0x37, 0xF2, 0x90, 0x3B, 0x07, 0x06, 0xF9, 0x0A, 0xB0, 0xD3, 0xA0, 0x7A, 0xF3, 0xA7, 0x96, 0x8E,
+    0x8F, 0xD7, 0x79, 0x31, 0x05, 0x66, 0xC8, 0x8E, 0x8D, 0xF1, 0xCD, 0xEB, 0xC0, 0x39, 0x9C, 0xE2,
+    0x0A, 0xE8, 0x85, 0xCB, 0x06, 0xBA, 0x54, 0x6E, 0x21, 0xDC, 0x2F, 0xB6, 0xD2, 0xC7, 0x0D, 0x7D,
+    0x84, 0xE3, 0x9A, 0x8D, 0x4D, 0xF8, 0x69, 0x8F, 0x9A, 0xB4, 0x7D, 0x45, 0x21, 0x01, 0xAA, 0x25,
+    0xB7, 0x81, 0xF9, 0xCF, 0xF8, 0x9E, 0x70, 0xD3, 0xFE, 0x63, 0xC1, 0x91, 0x36, 0x39, 0xE3, 0xC1,
+    0x06, 0xCD, 0x18, 0xD7, 0x38, 0xC2, 0x84, 0xD1, 0x3C, 0x33, 0xD1, 0x84, 0xF9, 0xE2, 0x7C, 0x78,
+    0x35, 0x8F, 0xA9, 0xD8, 0x83, 0x87, 0xC3, 0x93, 0xA3, 0xE7, 0x0D, 0xF9, 0x4E, 0x08, 0x55, 0x51,
+    0x3A, 0xE6, 0x6E, 0x0A, 0x6A, 0xC3, 0x0E, 0xBE, 0x52, 0x5B, 0x8E, 0x13, 0x12, 0x95, 0x66, 0xEA,
+    0xB0, 0x06, 0xE8, 0xDE, 0x19, 0x10, 0xCF, 0x15, 0x5F, 0x72, 0x77, 0x41, 0xA7, 0xBE, 0xD6, 0x46,
+    0x2C, 0xE8, 0xB2, 0xA8, 0xC4, 0x67, 0x6E, 0xEF, 0x9E, 0x17, 0xF1, 0x98, 0x96, 0xCE, 0x69, 0x55,
+    0x59, 0xB2, 0x65, 0x9A, 0x23, 0xC5, 0x6D, 0xC8, 0xE5, 0x94, 0xB3, 0xB9, 0xAC, 0x46, 0xF9, 0xA7,
+    0x21, 0xF5, 0xD4, 0xFE, 0xBF, 0x31, 0x8D, 0x43, 0xDB, 0xAB, 0x51, 0xCD, 0x83, 0xD8, 0xC2, 0x71,
+    0x95, 0x7C, 0x0A, 0x6C, 0xE1, 0xD8, 0xAA, 0x32, 0x4F, 0x69, 0xAA, 0x9C, 0x45, 0xD7, 0x2B, 0x9F,
+    0x10, 0xEB, 0x39, 0x92, 0xE7, 0x26, 0xAD, 0xFC, 0x6B, 0x2F, 0x69, 0x6D, 0xEF, 0x25, 0x2C, 0x5C,
+    0x06, 0xBF, 0xB7, 0x44, 0xCC, 0xF1, 0xDB, 0xBF, 0xCC, 0x0F, 0x83, 0xB6, 0x94, 0x8C, 0x8E, 0xF0,
+    0x03, 0x48, 0xD5, 0x1C, 0x58, 0xA1, 0x00, 0x77, 0xC6, 0x8B, 0x02, 0xD5, 0x78, 0x8E, 0xB3, 0x20,
+    0xAE, 0x0B, 0xCF, 0xCD, 0x3D, 0x26, 0x16, 0xF5, 0x29, 0x21, 0x0F, 0x39, 0x4D, 0x8F, 0xE8, 0xBB,
+    0x5A, 0xBB, 0x45, 0x69, 0x3A, 0x46, 0xEB, 0x0C, 0x7A, 0x00, 0x92, 0x06, 0x51, 0x47, 0x53, 0x81,
+    0x66, 0x33, 0x86, 0xBA, 0xF5, 0x68, 0x66, 0x21, 0x1F, 0x8D, 0xA4, 0xFF, 0x49, 0xDD, 0xEB, 0x32,
+    0x1A, 0xAD, 0xC2, 0xD1, 0x36, 0xEE, 0x76, 0x7E, 0x66, 0x1F, 0x37, 0x5F, 0x36, 0xF9, 0x7C, 0x78,
+    0x7D, 0x8D, 0xBD, 0x43, 0x5E, 0x0A, 0x1A, 0xDF, 0x60, 0x51, 0xD6, 0xD2, 0x4A, 0x7E, 0x31, 0xCE,
+    0x3A, 0xBB, 0x0D, 0x3A, 0x92, 0xFF, 0xBD, 0x14, 0x0D, 0xCD, 0x4E, 0x8B, 0xF4, 0xEE, 0xE9, 0x0E,
+    0xCF, 0x4B, 0x59, 0x68, 0xEF, 0x6F, 0x7B, 0xCF, 0x61, 0x59, 0x4A, 0x71, 0x67, 0x2F, 0x40, 0x0E,
+    0xCB, 0x72, 0x98, 0x9B, 0x3B, 0x1E, 0x74, 0x3F, 0xAE, 0x4B, 0xA9, 0xB6, 0xDA, 0x8D, 0x80, 0x36,
+    0xAE, 0x4B, 0xA9, 0x6E, 0xEF, 0x36, 0xF6, 0xBD, 0x6A, 0x5C, 0x97, 0x52, 0xED, 0xB4, 0x9A, 0x31,
+    0x3A, 0x61, 0xFD, 0x6F, 0x72, 0x6A, 0xF1, 0x9A, 0x38, 0xAB, 0x4A, 0x6B, 0xAB, 0x8A, 0x27, 0x34,
+    0x2D, 0x9B, 0x11, 0xCF, 0x32, 0xE4, 0xEC, 0x33, 0xA4, 0xAF, 0x77, 0x39, 0x48, 0x17, 0x2D, 0x86,
+    0x07, 0xE3, 0x31, 0x6A, 0x53, 0x4D, 0xB6, 0x4C, 0xF8, 0x7F, 0x63, 0x37, 0x72, 0xBB, 0xB9, 0x52,
+    0x6D, 0x2C, 0x4A, 0x3B, 0x39, 0xB3, 0xB3, 0xD2, 0xE8, 0x6F, 0xC1, 0x2C, 0x31, 0x7D, 0xAC, 0xDE,
+    0x14, 0x82, 0xA5, 0xC9, 0x7E, 0xF0, 0x67, 0x7C, 0xB6, 0x99, 0xC1, 0xC2, 0x31, 0x6B, 0x32, 0x22,
+    0x88, 0x6A, 0xE7, 0xD6, 0xDF, 0xFE, 0x3B, 0x43, 0xA3, 0xC3, 0x77, 0xDA, 0x9D, 0x06, 0x8C, 0xF6,
+    0xF6, 0x38, 0xE7, 0x4D, 0x1E, 0xFE, 0x87, 0x0E, 0x92, 0xFE, 0x83, 0x43, 0xFC, 0xD2, 0x40, 0x74,
+    0x87, 0xAF, 0x27, 0xDF, 0x01, 0xE0, 0x94, 0x88, 0xEF, 0x55, 0x11, 0x00, 0x00,
+};
+
+const WebAsset WEB_ASSETS[] = {
+    { "/app.js", "application/javascript", "\"09a5390ef77aaa1a\"", WEB_APP_JS, sizeof(WEB_APP_JS), true },
+    { "/style.css", "text/css", "\"e50ba56fd208637d\"", WEB_STYLE_CSS, sizeof(WEB_STYLE_CSS), true },
+    { "/", "text/html", "\"971b3b25a874bd34\"", WEB_INDEX_HTML, sizeof(WEB_INDEX_HTML), false },
+};
+
+const uint8_t WEB_ASSET_COUNT = sizeof(WEB_ASSETS) / sizeof(WEB_ASSETS[0]);
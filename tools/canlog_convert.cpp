@@ -0,0 +1,90 @@
+/*
+ * @Description: Convertitore host dei log CAN binari della SD (canlog/NNNNN.bin)
+ * in formato candump (can-utils), Vector ASC o CSV.
+ *
+ *   g++ -std=gnu++17 -O2 -Iinclude tools/canlog_convert.cpp src/can_log_reader.cpp -o canlog_convert
+ *   ./canlog_convert [-f candump|asc|csv] [-i can0] 00000.bin [00001.bin ...] > trace.log
+ *
+ * I timestamp sono µs dall'avvio del gateway. Blocchi persi, frame scartati
+ * dal logger e blocchi corrotti sono riportati su stderr.
+ */
+
+#include "can_log.h"
+#include "can_log_reader.h"
+
+#include <stdio.h>
+#include <string.h>
+
+struct ConvertContext {
+    bool asc;
+    bool csv;
+    bool first;
+    uint64_t start;
+    const char *interface;
+    size_t frames;
+};
+
+static void printFrame(const CanLogFrame &frame, void *ctx) {
+    ConvertContext &convert = *(ConvertContext *)ctx;
+    char line[128];
+    if (convert.first) {
+        convert.first = false;
+        convert.start = frame.timestamp;
+        if (convert.csv) fputs(CAN_LOG_CSV_HEADER, stdout);
+        if (convert.asc) {
+            printf("date Thu Jan 1 00:00:00.000 1970\nbase hex  timestamps absolute\n"
+                   "no internal events logged\nBegin Triggerblock\n");
+        }
+    }
+    if (convert.asc) {
+        canLogFormatAsc(line, sizeof(line), frame, convert.start, 1);
+    } else if (convert.csv) {
+        canLogFormatCsv(line, sizeof(line), frame, convert.start);
+    } else {
+        canLogFormatCandump(line, sizeof(line), frame, convert.interface);
+    }
+    puts(line);
+    convert.frames++;
+}
+
+int main(int argc, char **argv) {
+    ConvertContext convert = { false, false, true, 0, "can0", 0 };
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-'; arg++) {
+        if (strcmp(argv[arg], "-f") == 0 && arg + 1 < argc) {
+            arg++;
+            convert.asc = strcmp(argv[arg], "asc") == 0;
+            convert.csv = strcmp(argv[arg], "csv") == 0;
+        } else if (strcmp(argv[arg], "-i") == 0 && arg + 1 < argc) {
+            convert.interface = argv[++arg];
+        } else {
+            break;
+        }
+    }
+    if (arg >= argc) {
+        fprintf(stderr, "usage: %s [-f candump|asc|csv] [-i can0] file.bin [...]\n", argv[0]);
+        return 2;
+    }
+
+    // I file di una stessa registrazione vanno passati in ordine: lo stato del
+    // lettore prosegue da un file al successivo
+    CanLogReader reader;
+    canLogReaderInit(reader);
+    uint8_t block[CAN_LOG_BLOCK_SIZE];
+    for (; arg < argc; arg++) {
+        FILE *file = fopen(argv[arg], "rb");
+        if (file == NULL) {
+            fprintf(stderr, "%s: cannot open\n", argv[arg]);
+            return 1;
+        }
+        while (fread(block, 1, sizeof(block), file) == sizeof(block)) {
+            canLogReadBlock(reader, block, printFrame, &convert);
+        }
+        fclose(file);
+    }
+    if (convert.asc && !convert.first) printf("End TriggerBlock\n");
+
+    fprintf(stderr, "%zu frames, %u dropped by logger, %u block gaps, %u bad blocks\n",
+        convert.frames, (unsigned)reader.dropped, (unsigned)reader.gaps, (unsigned)reader.badBlocks);
+    return 0;
+}
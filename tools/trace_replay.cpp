@@ -0,0 +1,293 @@
+/*
+ * @Description: Benchmark host del decoder J1939 su tracce registrate
+ * (candump -L, candump o Vector ASC, anche prodotte da canlog_convert). I
+ * frame passano dal filtro di accettazione della HAL native, da
+ * processJ1939Message e dall'aggiornamento dell'immagine registri Modbus,
+ * alla massima velocità e a lotti come nel task CAN.
+ *
+ *   g++ -std=gnu++17 -O2 -Iinclude tools/trace_replay.cpp src/hal/hal_native.cpp \
+ *       $(find src -maxdepth 1 -name '*.cpp' ! -name main.cpp) -pthread -o trace_replay
+ *   ./trace_replay [-r ripetizioni] [-b lotto] [-m min_frame_s] [-g golden | -w golden] trace.log
+ *
+ * Riporta frame/s, costo di decodifica per PGN e lo stato finale (data set
+ * e registri Modbus). Con -g lo stato finale, i contatori e i frame per PGN
+ * sono confrontati con il file golden (scritto con -w): exit 1 se diversi o
+ * se il throughput è sotto -m. Timestamp e registri temporali sono esclusi
+ * dal golden, che dipende solo dalla traccia e dal decoder.
+ */
+
+#include "bus_discovery.h"
+#include "can_log_reader.h"
+#include "config.h"
+#include "dtc_store.h"
+#include "engine_data.h"
+#include "hal.h"
+#include "j1939.h"
+#include "j1939_filter.h"
+#include "j1939_tp.h"
+#include "modbus_rtu.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock ReplayClock;
+
+struct PgnCost {
+    uint32_t frames;
+    double ns;
+};
+
+static bool loadTrace(const char *path, std::vector<twai_message_t> &frames) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) return false;
+    char line[256];
+    CanLogFrame frame;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (!canLogParseLine(line, frame)) continue;
+        twai_message_t message;
+        memset(&message, 0, sizeof(message));
+        message.identifier = frame.identifier;
+        message.extd = frame.extended;
+        message.rtr = frame.rtr;
+        message.data_length_code = frame.dlc;
+        memcpy(message.data, frame.data, sizeof(message.data));
+        frames.push_back(message);
+    }
+    fclose(file);
+    return true;
+}
+
+// Un passaggio della traccia: lotti iniettati e svuotati come nel task CAN,
+// poi pubblicazione e immagine registri. Con costs, tempo di ogni frame per PGN
+static void replay(const std::vector<twai_message_t> &frames, size_t batch,
+                   std::map<uint32_t, PgnCost> *costs) {
+    for (size_t start = 0; start < frames.size(); start += batch) {
+        size_t end = (start + batch < frames.size()) ? start + batch : frames.size();
+        for (size_t i = start; i < end; i++) {
+            hal_native_can_inject(frames[i]);
+        }
+        twai_message_t message;
+        while (hal_can_receive(&message, 0)) {
+            if (costs == NULL) {
+                processJ1939Message(message);
+                continue;
+            }
+            ReplayClock::time_point t0 = ReplayClock::now();
+            processJ1939Message(message);
+            ReplayClock::time_point t1 = ReplayClock::now();
+            PgnCost &cost = (*costs)[message.extd ? getPGN(message.identifier) : 0xFFFFFFFF];
+            cost.frames++;
+            cost.ns += std::chrono::duration<double, std::nano>(t1 - t0).count();
+        }
+        engineDataPublish();
+        updateModbusRegisters();
+    }
+}
+
+static void appendf(std::string &out, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+static void appendf(std::string &out, const char *format, ...) {
+    char line[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    out += line;
+}
+
+static uint8_t typeWords(uint8_t type) {
+    return (type == MODBUS_TYPE_U16 || type == MODBUS_TYPE_I16) ? 1 : 2;
+}
+
+// Stato finale deterministico: contatori del primo passaggio, frame per PGN,
+// data set per indirizzo sorgente, registri della mappa attiva per banco, DTC
+// e inventario del bus
+static std::string goldenState(const J1939RxStats &rx, const J1939TpStats &tp,
+                               const std::map<uint32_t, PgnCost> &costs) {
+    std::string out;
+    appendf(out, "rx accepted %u softwareRejected %u hardwareRejected %u sourcesDropped %u\n",
+            (unsigned)rx.accepted, (unsigned)rx.softwareRejected, (unsigned)rx.hardwareRejected,
+            (unsigned)rx.sourcesDropped);
+    appendf(out, "tp completed %u timeouts %u aborted %u poolFull %u\n",
+            (unsigned)tp.completed, (unsigned)tp.timeouts, (unsigned)tp.aborted, (unsigned)tp.poolFull);
+    for (const auto &entry : costs) {
+        if (entry.first == 0xFFFFFFFF) {
+            appendf(out, "pgn standard frames %u\n", (unsigned)entry.second.frames);
+        } else {
+            appendf(out, "pgn 0x%05X frames %u\n", (unsigned)entry.first, (unsigned)entry.second.frames);
+        }
+    }
+
+    uint8_t slots[ENGINE_DATA_MAX_SOURCES];
+    uint8_t count = engineDataSlotsBySource(slots);
+    for (uint8_t set = 0; set < count; set++) {
+        EngineData data;
+        engineDataRead(slots[set], data);
+        appendf(out, "set %u sa 0x%02X", (unsigned)set, (unsigned)data.sourceAddress);
+        for (uint8_t field = 0; field < FIELD_COUNT; field++) {
+            if (data.validFlags & FIELD_BIT(field)) {
+                appendf(out, " %s=%lld", engineFieldName((EngineField)field),
+                        (long long)engineFieldValue(data, (EngineField)field));
+            } else {
+                appendf(out, " %s=-", engineFieldName((EngineField)field));
+            }
+        }
+        appendf(out, " errorFlags=0x%04X dtcCount=%u previousDtcCount=%u spnErrorFlags=0x%04X\n",
+                (unsigned)data.errorFlags, (unsigned)data.dtcCount, (unsigned)data.previousDtcCount,
+                (unsigned)data.spnErrorFlags);
+
+        for (uint8_t i = 0; i < modbusMap.count; i++) {
+            const ModbusMapEntry &entry = modbusMap.entries[i];
+            if (entry.signal == MB_SIGNAL_LAST_UPDATE) continue;
+            const uint16_t *words = &modbusRegisters[set * MODBUS_BANK_WORDS + modbusMap.entryWord[i]];
+            appendf(out, "reg %u %u %s %04X", (unsigned)set, (unsigned)entry.address,
+                    modbusMapSignalName(entry.signal), (unsigned)words[0]);
+            if (typeWords(entry.type) == 2) appendf(out, "%04X", (unsigned)words[1]);
+            out += '\n';
+        }
+    }
+
+    // Registro DTC, senza i tempi di ricezione
+    static const char *const LIST_NAMES[DTC_LIST_COUNT] = { "active", "previous" };
+    for (uint8_t list = 0; list < DTC_LIST_COUNT; list++) {
+        DtcRecord record;
+        DtcStoreInfo info;
+        for (uint8_t i = 0; dtcStoreRead(list, i, &record, 1, info) == 1; i++) {
+            appendf(out, "dtc %s sa 0x%02X spn %u fmi %u oc %u cm %u\n", LIST_NAMES[list],
+                    (unsigned)record.sourceAddress, (unsigned)record.spn, (unsigned)record.fmi,
+                    (unsigned)record.occurrence, (unsigned)record.conversion);
+        }
+    }
+
+    // Inventario del bus per PGN e indirizzo sorgente, senza periodi e jitter
+    std::map<uint32_t, BusDiscoveryEntry> pairs;
+    for (uint16_t slot = 0; slot < BUS_DISCOVERY_SLOTS; slot++) {
+        BusDiscoveryEntry entry;
+        if (busDiscoveryRead(slot, entry)) pairs[((uint32_t)entry.pgn << 8) | entry.sourceAddress] = entry;
+    }
+    for (const auto &pair : pairs) {
+        const BusDiscoveryEntry &entry = pair.second;
+        appendf(out, "bus pgn 0x%04X sa 0x%02X frames %u dlc %u handled %u\n", (unsigned)entry.pgn,
+                (unsigned)entry.sourceAddress, (unsigned)entry.frames, (unsigned)entry.dlc, (unsigned)entry.handled);
+    }
+    appendf(out, "bus untracked %u\n", (unsigned)busDiscoveryStats.untracked);
+    return out;
+}
+
+// Prima riga diversa tra stato e golden (numerata da 1), 0 se identici
+static size_t firstDifference(const std::string &state, const std::string &golden) {
+    size_t line = 1;
+    for (size_t i = 0; i < state.size() || i < golden.size(); i++) {
+        if (i >= state.size() || i >= golden.size() || state[i] != golden[i]) return line;
+        if (state[i] == '\n') line++;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    uint32_t repeats = 20;
+    size_t batch = 16;
+    double minRate = 0;
+    const char *goldenPath = NULL;
+    bool writeGolden = false;
+    int arg = 1;
+    for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+        if (strcmp(argv[arg], "-r") == 0) {
+            repeats = strtoul(argv[arg + 1], NULL, 10);
+        } else if (strcmp(argv[arg], "-b") == 0) {
+            batch = strtoul(argv[arg + 1], NULL, 10);
+        } else if (strcmp(argv[arg], "-m") == 0) {
+            minRate = strtod(argv[arg + 1], NULL);
+        } else if (strcmp(argv[arg], "-g") == 0 || strcmp(argv[arg], "-w") == 0) {
+            goldenPath = argv[arg + 1];
+            writeGolden = (argv[arg][1] == 'w');
+        } else {
+            break;
+        }
+    }
+    if (arg + 1 != argc || batch == 0) {
+        fprintf(stderr, "usage: %s [-r repeats] [-b batch] [-m min_frames_s] [-g|-w golden] trace\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<twai_message_t> frames;
+    if (!loadTrace(argv[arg], frames)) {
+        fprintf(stderr, "%s: cannot open\n", argv[arg]);
+        return 1;
+    }
+    if (batch > CAN_RX_QUEUE_LEN) batch = CAN_RX_QUEUE_LEN;
+
+    CAN_J1939_Init();
+
+    // Primo passaggio con tempo per frame: costo per PGN e stato golden
+    std::map<uint32_t, PgnCost> costs;
+    replay(frames, batch, &costs);
+    J1939RxStats rx = j1939RxStats;
+    rx.hardwareRejected = hal_can_filter_rejected();
+    J1939TpStats tp = j1939TpStats;
+    std::string state = goldenState(rx, tp, costs);
+
+    // Throughput: passaggi ripetuti senza misure per frame
+    ReplayClock::time_point t0 = ReplayClock::now();
+    for (uint32_t i = 0; i < repeats; i++) {
+        replay(frames, batch, NULL);
+    }
+    double seconds = std::chrono::duration<double>(ReplayClock::now() - t0).count();
+    double rate = (repeats > 0 && seconds > 0) ? (double)frames.size() * repeats / seconds : 0;
+
+    printf("%s: %zu frames, %u data sets, %.0f frames/s (%u passes, batch %zu)\n",
+           argv[arg], frames.size(), (unsigned)engineDataSourceCount(), rate, (unsigned)repeats, batch);
+    printf("%-10s %10s %12s\n", "pgn", "frames", "ns/frame");
+    for (const auto &entry : costs) {
+        char pgn[16];
+        if (entry.first == 0xFFFFFFFF) {
+            snprintf(pgn, sizeof(pgn), "standard");
+        } else {
+            snprintf(pgn, sizeof(pgn), "0x%05X", (unsigned)entry.first);
+        }
+        printf("%-10s %10u %12.1f\n", pgn, (unsigned)entry.second.frames, entry.second.ns / entry.second.frames);
+    }
+    if (goldenPath == NULL) {
+        fputs(state.c_str(), stdout);
+    }
+
+    int result = 0;
+    if (goldenPath != NULL && writeGolden) {
+        FILE *file = fopen(goldenPath, "w");
+        if (file == NULL || fputs(state.c_str(), file) < 0) {
+            fprintf(stderr, "%s: cannot write\n", goldenPath);
+            result = 1;
+        }
+        if (file != NULL) fclose(file);
+    } else if (goldenPath != NULL) {
+        std::string golden;
+        FILE *file = fopen(goldenPath, "r");
+        if (file == NULL) {
+            fprintf(stderr, "%s: cannot open\n", goldenPath);
+            return 1;
+        }
+        char chunk[4096];
+        size_t read;
+        while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0) golden.append(chunk, read);
+        fclose(file);
+        size_t line = firstDifference(state, golden);
+        if (line != 0) {
+            fprintf(stderr, "%s: state differs from golden at line %zu\n", argv[arg], line);
+            result = 1;
+        } else {
+            printf("golden: match\n");
+        }
+    }
+    if (minRate > 0 && rate < minRate) {
+        fprintf(stderr, "%s: %.0f frames/s below minimum %.0f\n", argv[arg], rate, minRate);
+        result = 1;
+    }
+    return result;
+}
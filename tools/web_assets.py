@@ -0,0 +1,96 @@
+# @Description: Generatore delle risorse web incorporate nel firmware. I
+# file di web/ sono compressi con gzip (deterministico, mtime 0) e scritti in
+# src/web_assets_data.cpp come array costanti (in flash, serviti senza copia
+# in RAM) con un ETag forte dall'hash del contenuto. In index.html i
+# riferimenti alle altre risorse diventano URL versionati (/app.js?v=hash),
+# memorizzabili dal browser senza riconvalida.
+#
+#   python3 tools/web_assets.py
+#
+# Eseguito anche da PlatformIO prima di ogni build (extra_scripts): il file
+# generato viene riscritto solo se cambia.
+
+import gzip
+import hashlib
+import os
+
+# Sotto PlatformIO (SCons) __file__ non è definito: radice dal progetto
+try:
+    Import("env")  # noqa: F821 - definito da PlatformIO
+    ROOT = env.subst("$PROJECT_DIR")  # noqa: F821
+except NameError:
+    ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+WEB_DIR = os.path.join(ROOT, "web")
+OUTPUT = os.path.join(ROOT, "src", "web_assets_data.cpp")
+
+CONTENT_TYPES = {
+    ".html": "text/html",
+    ".js": "application/javascript",
+    ".css": "text/css",
+}
+
+# Pagina principale servita anche su "/": riferimenti riscritti dopo gli altri
+INDEX = "index.html"
+
+
+def c_name(name):
+    return "WEB_" + "".join(c.upper() if c.isalnum() else "_" for c in name)
+
+
+def load_assets():
+    names = sorted(n for n in os.listdir(WEB_DIR) if os.path.splitext(n)[1] in CONTENT_TYPES)
+    assets = []
+    versions = {}
+    for name in [n for n in names if n != INDEX] + [INDEX]:
+        with open(os.path.join(WEB_DIR, name), "rb") as f:
+            content = f.read()
+        if name == INDEX:
+            for other, version in versions.items():
+                content = content.replace(('"/%s"' % other).encode(),
+                                          ('"/%s?v=%s"' % (other, version)).encode())
+        data = gzip.compress(content, 9, mtime=0)
+        etag = hashlib.sha256(content).hexdigest()[:16]
+        versions[name] = etag
+        assets.append((name, content, data, etag))
+    return assets
+
+
+def render(assets):
+    out = []
+    out.append("/*\n")
+    out.append(" * @Description: Risorse web compresse (gzip) generate da tools/web_assets.py\n")
+    out.append(" * a partire da web/. Non modificare: rigenerare dopo ogni modifica a web/\n")
+    out.append(" */\n\n")
+    out.append('#include "web_assets.h"\n')
+    for name, content, data, etag in assets:
+        out.append("\n// %s: %u byte, %u compressi\n" % (name, len(content), len(data)))
+        out.append("static const uint8_t %s[] = {\n" % c_name(name))
+        for i in range(0, len(data), 16):
+            out.append("    " + " ".join("0x%02X," % b for b in data[i:i + 16]) + "\n")
+        out.append("};\n")
+    out.append("\nconst WebAsset WEB_ASSETS[] = {\n")
+    for name, content, data, etag in assets:
+        path = "/" if name == INDEX else "/" + name
+        content_type = CONTENT_TYPES[os.path.splitext(name)[1]]
+        immutable = "false" if name == INDEX else "true"
+        out.append('    { "%s", "%s", "\\"%s\\"", %s, sizeof(%s), %s },\n'
+                   % (path, content_type, etag, c_name(name), c_name(name), immutable))
+    out.append("};\n\n")
+    out.append("const uint8_t WEB_ASSET_COUNT = sizeof(WEB_ASSETS) / sizeof(WEB_ASSETS[0]);\n")
+    return "".join(out)
+
+
+def generate():
+    text = render(load_assets())
+    try:
+        with open(OUTPUT, "r") as f:
+            if f.read() == text:
+                return
+    except OSError:
+        pass
+    with open(OUTPUT, "w") as f:
+        f.write(text)
+    print("web_assets: %s updated" % os.path.relpath(OUTPUT, ROOT))
+
+
+generate()
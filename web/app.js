@@ -0,0 +1,57 @@
+// Dati inviati dal gateway via WebSocket: stato completo alla
+// connessione, poi solo i campi cambiati
+const sets = [];
+
+function connect() {
+    const socket = new WebSocket('ws://' + location.host + '/ws');
+    socket.onmessage = event => {
+        const message = JSON.parse(event.data);
+        const select = document.getElementById('dataSet');
+        if (message.sources) {
+            // Elenco ECU, ordinate per indirizzo sorgente come i banchi Modbus
+            const selected = select.value || 0;
+            sets.length = 0;
+            select.innerHTML = message.sources.map((sa, i) =>
+                '<option value="' + i + '">SA ' + sa + '</option>').join('');
+            select.value = Math.min(selected, Math.max(message.sources.length - 1, 0));
+        }
+        message.sets.forEach(set => { sets[set.set] = Object.assign(sets[set.set] || {}, set); });
+        updateData();
+    };
+    socket.onclose = () => setTimeout(connect, 2000);
+}
+
+function updateData() {
+    const data = sets[document.getElementById('dataSet').value || 0];
+    if (!data) return;
+
+    // Segnali non disponibili o in errore mostrati come '-'
+    const show = (id, bit, text) => {
+        document.getElementById(id).textContent = (data.validFlags & (1 << bit)) ? text : '-';
+    };
+    show('rpm', 0, data.rpm + ' RPM');
+    show('engineTemp', 1, (data.engineTemp / 10).toFixed(1) + ' °C');
+    show('oilPressure', 2, data.oilPressure + ' kPa');
+    show('fuelRate', 3, (data.fuelRate / 100).toFixed(2) + ' L/h');
+    show('engineHours', 4, (data.engineHours / 100).toFixed(2) + ' h');
+    show('coolantTemp', 5, (data.coolantTemp / 10).toFixed(1) + ' °C');
+    show('engineLoad', 8, data.engineLoad + ' %');
+    show('batteryVoltage', 11, (data.batteryVoltage / 10).toFixed(1) + ' V');
+    document.getElementById('dtcCount').textContent = data.dtcCount;
+
+    let statusText = '';
+    let statusClass = '';
+
+    if (data.statusFlags & 0x8000) {
+        statusText = 'Errore Comunicazione CAN';
+        statusClass = 'status-error';
+    } else {
+        statusText = 'Connesso';
+        statusClass = 'status-ok';
+    }
+
+    document.getElementById('connectionStatus').innerHTML = 
+        '<span class="status ' + statusClass + '">' + statusText + '</span>';
+}
+
+connect();